@@ -0,0 +1,598 @@
+// Coroutine-based file I/O implementation
+#include "async_storage.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Entries in the submission queue; the kernel sizes the completion queue
+// at twice this
+const unsigned RING_ENTRIES = 256;
+
+// io_uring lengths are 32-bit; longer appends are split into linked writes
+const size_t MAX_WRITE = size_t(1) << 30;
+
+string systemError(const string& what, int code) {
+    return what + ": " + strerror(code);
+}
+
+int openForRead(const string& path) {
+#ifdef _WIN32
+    return _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+int openForAppend(const string& path) {
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+void closeFile(int fd) {
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+int64_t fileSize(int fd) {
+#ifdef _WIN32
+    struct _stat64 info;
+    return _fstat64(fd, &info) == 0 ? info.st_size : -1;
+#else
+    struct stat info;
+    return fstat(fd, &info) == 0 ? info.st_size : -1;
+#endif
+}
+
+// Blocking versions of the ring operations, for the thread pool. Like
+// io_uring they make one attempt and return the bytes moved or -errno.
+int64_t readAt(int fd, char* buffer, size_t length, int64_t offset) {
+#ifdef _WIN32
+    OVERLAPPED at = {};
+    at.Offset = static_cast<DWORD>(offset);
+    at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD n = 0;
+    if (ReadFile(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), buffer, static_cast<DWORD>(length), &n, &at)) return n;
+    return GetLastError() == ERROR_HANDLE_EOF ? 0 : -EIO;
+#else
+    ssize_t n;
+    do {
+        n = pread(fd, buffer, length, offset);
+    } while (n < 0 && errno == EINTR);
+    return n < 0 ? -errno : n;
+#endif
+}
+
+// offset -1 writes at the current position (the end, for O_APPEND)
+int64_t writeAt(int fd, const char* buffer, size_t length, int64_t offset) {
+#ifdef _WIN32
+    if (offset < 0) {
+        int n = _write(fd, buffer, static_cast<unsigned>(length));
+        return n < 0 ? -errno : n;
+    }
+    OVERLAPPED at = {};
+    at.Offset = static_cast<DWORD>(offset);
+    at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD n = 0;
+    if (WriteFile(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), buffer, static_cast<DWORD>(length), &n, &at)) return n;
+    return -EIO;
+#else
+    ssize_t n;
+    do {
+        n = offset < 0 ? write(fd, buffer, length) : pwrite(fd, buffer, length, offset);
+    } while (n < 0 && errno == EINTR);
+    return n < 0 ? -errno : n;
+#endif
+}
+
+int64_t syncFile(int fd) {
+#ifdef _WIN32
+    return _commit(fd) == 0 ? 0 : -errno;
+#else
+    return fsync(fd) == 0 ? 0 : -errno;
+#endif
+}
+
+} // namespace
+
+#ifdef __linux__
+// The rings shared with the kernel. Only the submitting threads (under
+// submitLock) move the submission tail and only the reaper moves the
+// completion head; the kernel moves the other two.
+struct AsyncStorage::Ring {
+    int fd = -1;
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    void* sqeMap = MAP_FAILED;
+    size_t sqeMapSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned* sqArray = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    mutex submitLock;
+    // The stop signal could not be submitted; the reaper checks this when
+    // it cannot wait on the ring
+    atomic<bool> stopRequested{false};
+
+    ~Ring() {
+        if (sqeMap != MAP_FAILED) munmap(sqeMap, sqeMapSize);
+        if (cqMap != MAP_FAILED && cqMap != sqMap) munmap(cqMap, cqMapSize);
+        if (sqMap != MAP_FAILED) munmap(sqMap, sqMapSize);
+        if (fd >= 0) close(fd);
+    }
+
+    // False if the kernel has no io_uring, has it disabled, or is older
+    // than the features relied on here
+    bool open(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return false;
+        // NODROP: completions are never lost when the queue is full;
+        // RW_CUR_POS: offset -1 means the file position (5.6, with READ/WRITE)
+        if (!(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_RW_CUR_POS)) return false;
+
+        sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sqMapSize = cqMapSize = max(sqMapSize, cqMapSize);
+        sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqMap == MAP_FAILED) return false;
+        cqMap = single ? sqMap
+                       : mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                              IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED) return false;
+        sqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqeMap = mmap(nullptr, sqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqeMap == MAP_FAILED) return false;
+
+        char* sq = static_cast<char*>(sqMap);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqEntries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sqes = static_cast<io_uring_sqe*>(sqeMap);
+        char* cq = static_cast<char*>(cqMap);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    unsigned freeEntries() {
+        return sqEntries - (*sqTail - atomic_ref<unsigned>(*sqHead).load(memory_order_acquire));
+    }
+
+    // Without SQPOLL the kernel consumes the queued entries during the
+    // call, so afterwards the whole queue is free again. Returns 0, or
+    // -errno if the kernel refused them; `queued` are then still queued.
+    int submitQueued(unsigned& queued) {
+        while (queued > 0) {
+            int n = enter(queued, 0, 0);
+            if (n >= 0) {
+                queued -= static_cast<unsigned>(n);
+            } else if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                this_thread::yield(); // EBUSY: the reaper is behind on completions
+            } else {
+                return -errno;
+            }
+        }
+        return 0;
+    }
+
+    // Take back the last `count` queued entries, which the kernel has not
+    // seen, and return their user_data
+    vector<uint64_t> unqueue(unsigned count) {
+        vector<uint64_t> userData;
+        unsigned tail = *sqTail;
+        for (unsigned i = tail - count; i != tail; ++i) userData.push_back(sqes[sqArray[i & sqMask]].user_data);
+        atomic_ref<unsigned>(*sqTail).store(tail - count, memory_order_release);
+        return userData;
+    }
+
+    // Queue one operation; user_data 0 is the reaper's stop signal
+    void queue(uint8_t opcode, int opFd, uint64_t address, unsigned length, int64_t offset, bool linkNext,
+               uint64_t userData) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = opFd;
+        sqe.addr = address;
+        sqe.len = length;
+        sqe.off = offset < 0 ? ~uint64_t(0) : static_cast<uint64_t>(offset);
+        if (linkNext) sqe.flags |= IOSQE_IO_LINK;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        atomic_ref<unsigned>(*sqTail).store(tail + 1, memory_order_release);
+    }
+};
+
+void AsyncStorage::submitToRing(vector<IoOp>& ops) {
+    lock_guard<mutex> guard(ring->submitLock);
+    unsigned queued = 0;
+    int error = 0;
+    size_t i = 0;
+    while (i < ops.size()) {
+        // A linked chain must go to the kernel in a single call
+        size_t chain = 1;
+        while (i + chain < ops.size() && ops[i + chain].linked) chain++;
+        if (ring->freeEntries() < chain && (error = ring->submitQueued(queued)) != 0) break;
+        for (size_t end = i + chain; i < end; ++i) {
+            IoOp& op = ops[i];
+            uint8_t opcode = op.kind == IoOp::READ ? IORING_OP_READ
+                             : op.kind == IoOp::WRITE ? IORING_OP_WRITE
+                                                      : IORING_OP_FSYNC;
+            ring->queue(opcode, op.fd, reinterpret_cast<uint64_t>(op.buffer), static_cast<unsigned>(op.length),
+                        op.offset, i + 1 < end, reinterpret_cast<uint64_t>(&op));
+            queued++;
+        }
+    }
+    if (error == 0) error = ring->submitQueued(queued);
+    if (error == 0) return;
+    // The kernel refused the entries (not just busy): fail them, and the
+    // operations not queued yet, so their batch still completes
+    for (uint64_t userData : ring->unqueue(queued)) finish(*reinterpret_cast<IoOp*>(userData), error);
+    for (; i < ops.size(); ++i) finish(ops[i], error);
+}
+
+void AsyncStorage::reap() {
+    bool stop = false;
+    chrono::milliseconds pause(0);
+    while (!stop) {
+        if (ring->enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            // Cannot wait on the ring: still collect what completes, but
+            // poll with a growing pause instead of spinning
+            pause = min(max(pause * 2, chrono::milliseconds(1)), chrono::milliseconds(100));
+            this_thread::sleep_for(pause);
+            stop = ring->stopRequested.load();
+        } else {
+            pause = chrono::milliseconds(0);
+        }
+        unsigned head = *ring->cqHead;
+        unsigned tail = atomic_ref<unsigned>(*ring->cqTail).load(memory_order_acquire);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = ring->cqes[head & ring->cqMask];
+            if (cqe.user_data == 0) {
+                stop = true;
+            } else {
+                finish(*reinterpret_cast<IoOp*>(cqe.user_data), cqe.res);
+            }
+        }
+        atomic_ref<unsigned>(*ring->cqHead).store(head, memory_order_release);
+    }
+}
+#else
+struct AsyncStorage::Ring {};
+
+void AsyncStorage::submitToRing(vector<IoOp>&) {}
+
+void AsyncStorage::reap() {}
+#endif
+
+AsyncStorage::AsyncStorage(Backend preferred, size_t threads) {
+#ifdef __linux__
+    if (preferred == IO_URING) {
+        ring = make_unique<Ring>();
+        if (ring->open(RING_ENTRIES)) {
+            reaper = thread(&AsyncStorage::reap, this);
+        } else {
+            ring.reset();
+        }
+    }
+#else
+    (void)preferred;
+#endif
+    // Workers resume the coroutines with either backend
+    for (size_t i = 0; i < max<size_t>(threads, 1); ++i) workers.emplace_back(&AsyncStorage::work, this);
+}
+
+AsyncStorage::~AsyncStorage() {
+#ifdef __linux__
+    if (ring) {
+        {
+            lock_guard<mutex> guard(ring->submitLock);
+            unsigned queued = 1;
+            ring->queue(IORING_OP_NOP, -1, 0, 0, 0, false, 0);
+            if (ring->submitQueued(queued) != 0) {
+                ring->unqueue(queued);
+                ring->stopRequested = true;
+            }
+        }
+        reaper.join();
+        ring.reset();
+    }
+#endif
+    {
+        lock_guard<mutex> guard(jobsLock);
+        stopping = true;
+    }
+    jobsReady.notify_all();
+    for (thread& worker : workers) worker.join();
+}
+
+AsyncStorage::Backend AsyncStorage::backend() const {
+    return ring ? IO_URING : THREAD_POOL;
+}
+
+const char* AsyncStorage::backendName() const {
+    return ring ? "io_uring" : "thread pool";
+}
+
+void AsyncStorage::post(function<void()> job) {
+    {
+        lock_guard<mutex> guard(jobsLock);
+        jobs.push_back(move(job));
+    }
+    jobsReady.notify_one();
+}
+
+void AsyncStorage::work() {
+    while (true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> guard(jobsLock);
+            jobsReady.wait(guard, [this] { return !jobs.empty() || stopping; });
+            if (jobs.empty()) return;
+            job = move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void AsyncStorage::submit(vector<IoOp>& ops) {
+    if (ring) {
+        submitToRing(ops);
+        return;
+    }
+    // One job per linked chain, which then runs in order
+    for (size_t i = 0; i < ops.size();) {
+        size_t chain = 1;
+        while (i + chain < ops.size() && ops[i + chain].linked) chain++;
+        IoOp* first = &ops[i];
+        post([this, first, chain] { runChain(first, chain); });
+        i += chain;
+    }
+}
+
+void AsyncStorage::runChain(IoOp* first, size_t count) {
+    // As with io_uring links, a failed or short operation cancels the rest
+    bool failed = false;
+    for (size_t i = 0; i < count; ++i) {
+        IoOp& op = first[i];
+        int64_t result = -ECANCELED;
+        if (!failed) {
+            switch (op.kind) {
+                case IoOp::READ:
+                    result = readAt(op.fd, op.buffer, op.length, op.offset);
+                    break;
+                case IoOp::WRITE:
+                    result = writeAt(op.fd, op.buffer, op.length, op.offset);
+                    break;
+                case IoOp::FSYNC:
+                    result = syncFile(op.fd);
+                    break;
+            }
+            failed = result < 0 || (op.kind != IoOp::FSYNC && static_cast<size_t>(result) != op.length);
+        }
+        // Once the last one finished the batch (and `first`) may be gone
+        finish(op, result);
+    }
+}
+
+void AsyncStorage::finish(IoOp& op, int64_t result) {
+    op.result = result;
+    op.batch->completeOne();
+}
+
+bool AsyncStorage::IoBatch::await_suspend(coroutine_handle<> awaiting) {
+    waiter = awaiting;
+    remaining.store(ops.size() + 1);
+    for (IoOp& op : ops) op.batch = this;
+    storage.submit(ops);
+    // Holding one count ourselves means the last completion may also be
+    // us, in which case the coroutine just carries on
+    return remaining.fetch_sub(1) != 1;
+}
+
+void AsyncStorage::IoBatch::completeOne() {
+    if (remaining.fetch_sub(1) != 1) return;
+    coroutine_handle<> resume = waiter;
+    storage.post([resume] { resume.resume(); });
+}
+
+Task<bool> AsyncStorage::readFiles(vector<string> paths, vector<string>& contents, string& error) {
+    struct Piece {
+        size_t file;
+        int64_t offset;
+        size_t length;
+    };
+    contents.assign(paths.size(), string());
+    vector<int> fds(paths.size(), -1);
+    vector<int64_t> ends(paths.size(), 0); // lowered if a file shrinks while read
+    deque<Piece> pieces;
+    bool ok = true;
+    for (size_t f = 0; f < paths.size(); ++f) {
+        int fd = openForRead(paths[f]);
+        if (fd < 0) {
+            if (errno == ENOENT) continue;
+            error = systemError("cannot open " + paths[f], errno);
+            ok = false;
+            break;
+        }
+        fds[f] = fd;
+        int64_t size = fileSize(fd);
+        if (size < 0) {
+            error = systemError("cannot read " + paths[f], errno);
+            ok = false;
+            break;
+        }
+#ifdef __linux__
+        // Lets the kernel's own readahead run further ahead of our reads
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        contents[f].resize(static_cast<size_t>(size));
+        ends[f] = size;
+        for (int64_t offset = 0; offset < size; offset += CHUNK) {
+            pieces.push_back({f, offset, static_cast<size_t>(min<int64_t>(CHUNK, size - offset))});
+        }
+    }
+
+    while (ok && !pieces.empty()) {
+        vector<IoOp> ops;
+        vector<Piece> wave;
+        while (!pieces.empty() && ops.size() < READ_AHEAD) {
+            Piece piece = pieces.front();
+            pieces.pop_front();
+            IoOp op;
+            op.kind = IoOp::READ;
+            op.fd = fds[piece.file];
+            op.buffer = &contents[piece.file][piece.offset];
+            op.length = piece.length;
+            op.offset = piece.offset;
+            ops.push_back(op);
+            wave.push_back(piece);
+        }
+        co_await IoBatch(*this, ops);
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const Piece& piece = wave[i];
+            int64_t result = ops[i].result;
+            if (result < 0) {
+                error = systemError("cannot read " + paths[piece.file], static_cast<int>(-result));
+                ok = false;
+                break;
+            }
+            if (result == 0) {
+                ends[piece.file] = min(ends[piece.file], piece.offset);
+            } else if (static_cast<size_t>(result) < piece.length) {
+                pieces.push_front({piece.file, piece.offset + result, piece.length - static_cast<size_t>(result)});
+            }
+        }
+    }
+
+    for (size_t f = 0; f < paths.size(); ++f) {
+        if (fds[f] >= 0) closeFile(fds[f]);
+        if (static_cast<size_t>(ends[f]) < contents[f].size()) contents[f].resize(static_cast<size_t>(ends[f]));
+    }
+    co_return ok;
+}
+
+Task<bool> AsyncStorage::readFile(string path, string& contents, string& error) {
+    vector<string> paths(1, path);
+    vector<string> read;
+    bool ok = co_await readFiles(move(paths), read, error);
+    contents = move(read[0]);
+    co_return ok;
+}
+
+Task<bool> AsyncStorage::appendFiles(vector<FileAppend> appends, bool sync, string& error) {
+    // Join the pieces for each file, in the order the files first appear
+    vector<FileAppend> files;
+    map<string, size_t> fileIndex;
+    for (FileAppend& append : appends) {
+        auto found = fileIndex.find(append.path);
+        if (found == fileIndex.end()) {
+            fileIndex[append.path] = files.size();
+            files.push_back(move(append));
+        } else {
+            files[found->second].data += append.data;
+        }
+    }
+
+    vector<int> fds;
+    vector<IoOp> ops;
+    vector<const string*> opPaths;
+    bool ok = true;
+    for (FileAppend& file : files) {
+        if (file.data.empty()) continue;
+        int fd = openForAppend(file.path);
+        if (fd < 0) {
+            error = systemError("cannot open " + file.path, errno);
+            ok = false;
+            break;
+        }
+        fds.push_back(fd);
+        for (size_t offset = 0; offset < file.data.size(); offset += MAX_WRITE) {
+            IoOp write;
+            write.kind = IoOp::WRITE;
+            write.fd = fd;
+            write.buffer = &file.data[offset];
+            write.length = min(MAX_WRITE, file.data.size() - offset);
+            write.linked = offset > 0;
+            ops.push_back(write);
+            opPaths.push_back(&file.path);
+        }
+        if (sync) {
+            IoOp fsync;
+            fsync.kind = IoOp::FSYNC;
+            fsync.fd = fd;
+            fsync.offset = 0; // with length 0: the whole file
+            fsync.linked = true;
+            ops.push_back(fsync);
+            opPaths.push_back(&file.path);
+        }
+    }
+
+    if (ok) co_await IoBatch(*this, ops);
+    for (size_t i = 0; ok && i < ops.size(); ++i) {
+        const IoOp& op = ops[i];
+        if (op.result == -ECANCELED) continue; // reported by the operation that failed
+        if (op.result < 0) {
+            string what = (op.kind == IoOp::FSYNC ? "cannot sync " : "cannot write ") + *opPaths[i];
+            error = systemError(what, static_cast<int>(-op.result));
+            ok = false;
+        } else if (op.kind == IoOp::WRITE && static_cast<size_t>(op.result) != op.length) {
+            error = "short write to " + *opPaths[i];
+            ok = false;
+        }
+    }
+    for (int fd : fds) closeFile(fd);
+    co_return ok;
+}
+
+AsyncStorage& sharedStorage() {
+    static AsyncStorage storage;
+    return storage;
+}
@@ -0,0 +1,251 @@
+// Coroutine-based file I/O: io_uring on Linux, a thread pool elsewhere
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class Task;
+
+namespace task_detail {
+
+// Signalled when a task that was started with start() or get() finishes
+struct Completion {
+    mutex lock;
+    condition_variable done;
+    bool finished = false;
+
+    void signal() {
+        lock_guard<mutex> guard(lock);
+        finished = true;
+        done.notify_all();
+    }
+    void wait() {
+        unique_lock<mutex> guard(lock);
+        done.wait(guard, [this] { return finished; });
+    }
+};
+
+template <typename T>
+struct Result {
+    optional<T> value;
+    void return_value(T result) { value = move(result); }
+};
+
+template <>
+struct Result<void> {
+    void return_void() {}
+};
+
+} // namespace task_detail
+
+// A lazily started coroutine producing a T. `co_await task` runs it and
+// resumes the awaiting coroutine when it finishes; outside a coroutine,
+// start() runs it up to its first suspension and get() blocks for the
+// result. An exception thrown by the task is rethrown from co_await or
+// get(). Tasks awaiting I/O resume on AsyncStorage worker threads.
+template <typename T>
+class Task {
+public:
+    struct promise_type : task_detail::Result<T> {
+        coroutine_handle<> continuation;
+        shared_ptr<task_detail::Completion> completion;
+        exception_ptr error; // thrown out of the body; rethrown to the awaiter
+
+        Task get_return_object() { return Task(coroutine_handle<promise_type>::from_promise(*this)); }
+        suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept {
+            struct Finish {
+                bool await_ready() noexcept { return false; }
+                coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept {
+                    promise_type& promise = handle.promise();
+                    if (promise.continuation) return promise.continuation;
+                    // The waiter may destroy the frame as soon as it is
+                    // signalled, so keep the completion alive on our own
+                    shared_ptr<task_detail::Completion> completion = promise.completion;
+                    if (completion) completion->signal();
+                    return noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return Finish{};
+        }
+        void unhandled_exception() { error = current_exception(); }
+    };
+
+private:
+    coroutine_handle<promise_type> handle;
+
+    explicit Task(coroutine_handle<promise_type> handle) : handle(handle) {}
+
+public:
+    Task(Task&& other) noexcept : handle(exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { reset(); }
+
+    bool await_ready() const noexcept { return false; }
+    coroutine_handle<> await_suspend(coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return result(); }
+
+    // Run until the first suspension, so the work overlaps with the caller's
+    void start() {
+        if (handle.promise().completion) return;
+        handle.promise().completion = make_shared<task_detail::Completion>();
+        handle.resume();
+    }
+    // Block this thread until the task finished; starts it if needed
+    T get() {
+        start();
+        handle.promise().completion->wait();
+        return result();
+    }
+
+private:
+    T result() {
+        if (handle.promise().error) rethrow_exception(handle.promise().error);
+        if constexpr (!is_void_v<T>) return move(*handle.promise().value);
+    }
+
+    void reset() {
+        if (!handle) return;
+        // A running task still owns buffers in its frame
+        if (handle.promise().completion) handle.promise().completion->wait();
+        handle.destroy();
+        handle = nullptr;
+    }
+};
+
+// Appending `data` to the file `path`
+struct FileAppend {
+    string path;
+    string data;
+};
+
+// Reads and appends as awaitable tasks. With io_uring every operation of a
+// call goes to the kernel in one submission, and a reaper thread collects
+// the completions; without it (other systems, old kernels, or THREAD_POOL
+// asked for) the same operations run as blocking calls on worker threads.
+// Either way the awaiting coroutines are resumed on the worker threads,
+// which must not be blocked waiting for further I/O.
+class AsyncStorage {
+public:
+    enum Backend { IO_URING, THREAD_POOL };
+
+    // Reads are split into CHUNK-sized requests with up to READ_AHEAD of
+    // them in flight, across all the files of a readFiles() call
+    static const size_t CHUNK = 256 * 1024;
+    static const size_t READ_AHEAD = 16;
+
+private:
+    class IoBatch;
+
+    // One read, write or fsync; a `linked` operation starts only after the
+    // previous one succeeded
+    struct IoOp {
+        enum Kind { READ, WRITE, FSYNC };
+        Kind kind = READ;
+        int fd = -1;
+        char* buffer = nullptr;
+        size_t length = 0;
+        int64_t offset = -1; // -1 writes at the end of an O_APPEND file
+        bool linked = false;
+        int64_t result = 0; // bytes transferred, or -errno
+        IoBatch* batch = nullptr;
+    };
+
+    // Awaitable for a group of operations; resumes once all completed
+    class IoBatch {
+    private:
+        AsyncStorage& storage;
+        vector<IoOp>& ops;
+        atomic<size_t> remaining{0};
+        coroutine_handle<> waiter;
+
+    public:
+        IoBatch(AsyncStorage& storage, vector<IoOp>& ops) : storage(storage), ops(ops) {}
+        bool await_ready() const { return ops.empty(); }
+        bool await_suspend(coroutine_handle<> awaiting);
+        void await_resume() {}
+        void completeOne();
+    };
+
+    struct Ring; // io_uring state, Linux only
+    unique_ptr<Ring> ring;
+    thread reaper;
+    void reap();
+    void submitToRing(vector<IoOp>& ops);
+
+    vector<thread> workers;
+    mutex jobsLock;
+    condition_variable jobsReady;
+    deque<function<void()>> jobs;
+    bool stopping = false;
+    void work();
+    void runChain(IoOp* first, size_t count);
+
+    void submit(vector<IoOp>& ops);
+    static void finish(IoOp& op, int64_t result);
+
+public:
+    // Falls back to THREAD_POOL when io_uring cannot be set up
+    explicit AsyncStorage(Backend preferred = IO_URING, size_t threads = 4);
+    ~AsyncStorage();
+
+    AsyncStorage(const AsyncStorage&) = delete;
+    AsyncStorage& operator=(const AsyncStorage&) = delete;
+
+    Backend backend() const;
+    const char* backendName() const;
+
+    // Run `job` on a worker thread
+    void post(function<void()> job);
+    // co_await schedule() continues the coroutine on a worker thread
+    auto schedule() {
+        struct Hop {
+            AsyncStorage& storage;
+            bool await_ready() const { return false; }
+            void await_suspend(coroutine_handle<> handle) { storage.post([handle] { handle.resume(); }); }
+            void await_resume() {}
+        };
+        return Hop{*this};
+    }
+
+    // Whole files, read with read-ahead. A missing file reads as empty;
+    // false with `error` if a file cannot be read. Opening a file is a
+    // plain system call, only the reads are asynchronous.
+    Task<bool> readFiles(vector<string> paths, vector<string>& contents, string& error);
+    Task<bool> readFile(string path, string& contents, string& error);
+
+    // Append to several files with one submission: the pieces for the same
+    // file are joined into a single write, in order. With `sync` each file
+    // is fsynced after its write. False with `error` if any write failed.
+    Task<bool> appendFiles(vector<FileAppend> appends, bool sync, string& error);
+};
+
+// The storage the patient files go through, created on first use
+AsyncStorage& sharedStorage();
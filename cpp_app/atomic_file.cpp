@@ -0,0 +1,419 @@
+// Atomic file replacement implementation
+#include "atomic_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Size and checksum of one generation of a file
+struct Generation {
+    bool valid = false;
+    long long size = 0;
+    uint32_t checksum = 0;
+
+    bool matches(const string& data) const {
+        return valid && static_cast<long long>(data.size()) == size && crc32(data) == checksum;
+    }
+};
+
+struct Manifest {
+    unsigned long long generation = 0;
+    Generation current;
+    Generation previous;
+    long long stamp = -1; // modification time of the current file, in ns
+};
+
+Generation describe(const string& data) {
+    Generation g;
+    g.valid = true;
+    g.size = static_cast<long long>(data.size());
+    g.checksum = crc32(data);
+    return g;
+}
+
+// Modification time in nanoseconds (whole seconds on Windows), -1 if missing
+long long modifiedTime(const string& path, long long* size = nullptr) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return -1;
+    if (size) *size = static_cast<long long>(info.st_size);
+#if defined(_WIN32)
+    return static_cast<long long>(info.st_mtime) * 1000000000LL;
+#elif defined(__APPLE__)
+    return static_cast<long long>(info.st_mtimespec.tv_sec) * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+    return static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+}
+
+bool readFile(const string& path, string& data) {
+    ifstream file(path, ios::binary);
+    if (!file) return false;
+    stringstream buffer;
+    buffer << file.rdbuf();
+    data = buffer.str();
+    return true;
+}
+
+string systemError(const string& what) {
+    return what + ": " + strerror(errno);
+}
+
+// Cut `path` to its first `size` bytes and force it to the disk
+bool truncateAndSync(const string& path, long long size) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) return false;
+    bool ok = _chsize_s(fd, size) == 0 && _commit(fd) == 0;
+    _close(fd);
+#else
+    int fd = open(path.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+    bool ok = ftruncate(fd, static_cast<off_t>(size)) == 0 && fsync(fd) == 0;
+    close(fd);
+#endif
+    return ok;
+}
+
+// Write `data` to `path` and force it to the disk
+bool writeAndSync(const string& path, const string& data, string& error) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0) {
+        error = systemError("cannot create " + path);
+        return false;
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+#ifdef _WIN32
+        int n = _write(fd, data.data() + written, static_cast<unsigned>(data.size() - written));
+#else
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            error = systemError("cannot write " + path);
+#ifdef _WIN32
+            _close(fd);
+#else
+            close(fd);
+#endif
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+#ifdef _WIN32
+    bool synced = _commit(fd) == 0;
+    _close(fd);
+#else
+    bool synced = fsync(fd) == 0;
+    close(fd);
+#endif
+    if (!synced) {
+        error = systemError("cannot sync " + path);
+        return false;
+    }
+    return true;
+}
+
+bool renameOver(const string& from, const string& to, string& error) {
+#ifdef _WIN32
+    bool ok = MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool ok = rename(from.c_str(), to.c_str()) == 0;
+#endif
+    if (!ok) error = systemError("cannot rename " + from + " to " + to);
+    return ok;
+}
+
+// Make the renames in the file's directory durable
+void syncDirectoryOf(const string& path) {
+#ifndef _WIN32
+    size_t slash = path.find_last_of('/');
+    string dir = slash == string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = open(dir.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+#else
+    (void)path;
+#endif
+}
+
+// Keep the current file as `prev`; a hard link costs no copy
+bool keepPrevious(const string& path, const string& prev, const string& data, string& error) {
+    remove(prev.c_str());
+#ifndef _WIN32
+    if (link(path.c_str(), prev.c_str()) == 0) return true;
+#endif
+    return writeAndSync(prev, data, error);
+}
+
+bool readManifest(const string& path, Manifest& manifest) {
+    ifstream file(path);
+    if (!file) return false;
+    string line, key;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        ss >> key;
+        if (key == "generation") {
+            ss >> manifest.generation;
+        } else if (key == "current" || key == "previous") {
+            Generation& g = key == "current" ? manifest.current : manifest.previous;
+            ss >> g.size >> hex >> g.checksum;
+            g.valid = !ss.fail();
+        } else if (key == "stamp") {
+            ss >> manifest.stamp;
+        }
+    }
+    return manifest.current.valid;
+}
+
+bool writeManifest(const string& path, const Manifest& manifest, string& error) {
+    stringstream out;
+    out << "generation " << manifest.generation << "\n";
+    out << "current " << manifest.current.size << " " << hex << manifest.current.checksum << dec << "\n";
+    if (manifest.previous.valid) {
+        out << "previous " << manifest.previous.size << " " << hex << manifest.previous.checksum << dec << "\n";
+    }
+    if (manifest.stamp >= 0) out << "stamp " << manifest.stamp << "\n";
+    string tmp = path + ".tmp";
+    return writeAndSync(tmp, out.str(), error) && renameOver(tmp, path, error);
+}
+
+} // namespace
+
+uint32_t crc32(const string& data) {
+    static uint32_t table[256];
+    static bool ready = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)ready;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (unsigned char byte : data) crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool replaceFileAtomically(const string& path, const string& contents, string& error) {
+    string tmp = path + ".tmp";
+    string manifestPath = path + ".manifest";
+
+    Manifest manifest;
+    string old;
+    bool hadFile = readFile(path, old);
+    readManifest(manifestPath, manifest);
+
+    // 1. The new data is durable under a temporary name
+    if (!writeAndSync(tmp, contents, error)) return false;
+
+    // 2. The manifest names the new generation and the one it replaces
+    Manifest next;
+    next.generation = manifest.generation + 1;
+    next.current = describe(contents);
+    if (hadFile) next.previous = describe(old);
+    // The rename keeps the temp file's time, which lets recovery trust an
+    // unchanged file without reading it
+    next.stamp = modifiedTime(tmp);
+    if (!writeManifest(manifestPath, next, error)) return false;
+
+    // 3. Keep the old generation, then swap the new one in
+    if (hadFile && !keepPrevious(path, path + ".prev", old, error)) return false;
+    if (!renameOver(tmp, path, error)) return false;
+    syncDirectoryOf(path);
+    return true;
+}
+
+bool commitTempFile(const string& path, string& error) {
+    string tmp = path + ".tmp";
+#ifdef _WIN32
+    int fd = _open(tmp.c_str(), _O_RDWR | _O_BINARY);
+    bool synced = fd >= 0 && _commit(fd) == 0;
+    if (fd >= 0) _close(fd);
+#else
+    int fd = open(tmp.c_str(), O_RDWR);
+    bool synced = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+#endif
+    if (!synced) {
+        error = systemError("cannot sync " + tmp);
+        return false;
+    }
+    if (!renameOver(tmp, path, error)) return false;
+    syncDirectoryOf(path);
+    return true;
+}
+
+bool recoverFile(const string& path, string& action) {
+    action.clear();
+    string tmp = path + ".tmp";
+    string prev = path + ".prev";
+    Manifest manifest;
+    if (!readManifest(path + ".manifest", manifest)) {
+        // Never written atomically; nothing to check against
+        remove(tmp.c_str());
+        return true;
+    }
+
+    // Same size and nanosecond timestamp as committed: nothing touched it
+    long long size = -1;
+    long long stamp = modifiedTime(path, &size);
+    if (stamp >= 0 && stamp == manifest.stamp && size == manifest.current.size) {
+        remove(tmp.c_str());
+        return true;
+    }
+
+    string data;
+    bool present = readFile(path, data);
+    if (present && manifest.current.matches(data)) {
+        remove(tmp.c_str());
+        return true;
+    }
+
+    string error;
+    string pending;
+    if (readFile(tmp, pending) && manifest.current.matches(pending)) {
+        // Crashed after the manifest was updated; finish the rename
+        if (!renameOver(tmp, path, error)) {
+            action = error;
+            return false;
+        }
+        syncDirectoryOf(path);
+        action = "completed an interrupted write of " + path;
+        return true;
+    }
+    remove(tmp.c_str());
+
+    if (!present) {
+        // Deleted on purpose (a crash never leaves it missing); start over
+        remove((path + ".manifest").c_str());
+        remove(prev.c_str());
+        return true;
+    }
+    if (stamp > modifiedTime(path + ".manifest")) {
+        // Edited outside the application after the last commit; adopt it
+        Manifest adopted;
+        adopted.generation = manifest.generation + 1;
+        adopted.current = describe(data);
+        adopted.stamp = stamp;
+        writeManifest(path + ".manifest", adopted, error);
+        action = "accepted outside changes to " + path;
+        return true;
+    }
+
+    Manifest rolledBack;
+    rolledBack.generation = manifest.generation > 0 ? manifest.generation - 1 : 0;
+    rolledBack.current = manifest.previous;
+    if (manifest.previous.matches(data)) {
+        // The new generation never made it; the old file is intact.
+        // Stamped like a commit, so later startups need not read it again
+        rolledBack.stamp = stamp;
+        writeManifest(path + ".manifest", rolledBack, error);
+        action = "kept the previous generation of " + path;
+        return true;
+    }
+
+    string backup;
+    if (readFile(prev, backup) && manifest.previous.matches(backup)) {
+        if (!writeAndSync(tmp, backup, error) || !renameOver(tmp, path, error)) {
+            action = error;
+            return false;
+        }
+        syncDirectoryOf(path);
+        rolledBack.stamp = modifiedTime(path);
+        writeManifest(path + ".manifest", rolledBack, error);
+        action = "restored " + path + " from its previous generation";
+        return true;
+    }
+
+    action = "no generation of " + path + " passes its checksum";
+    return false;
+}
+
+bool beginAppending(const string& path, string& error) {
+    string marker = path + ".appending";
+    if (!writeAndSync(marker, "", error)) return false;
+    syncDirectoryOf(marker);
+    return true;
+}
+
+bool endAppending(const string& path, string& error) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    bool synced = fd < 0 || _commit(fd) == 0;
+    if (fd >= 0) _close(fd);
+#else
+    int fd = open(path.c_str(), O_RDWR);
+    bool synced = fd < 0 || fsync(fd) == 0; // a missing file has nothing to sync
+    if (fd >= 0) close(fd);
+#endif
+    if (!synced) {
+        error = systemError("cannot sync " + path);
+        return false;
+    }
+    remove((path + ".appending").c_str());
+    return true;
+}
+
+bool repairLastLine(const string& path, string& action) {
+    action.clear();
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) return true;
+    long long size = static_cast<long long>(file.tellg());
+    // Walk back from the end to the last newline, reading only the tail
+    long long keep = 0;
+    char block[4096];
+    for (long long end = size; end > 0 && keep == 0;) {
+        long long start = max(0LL, end - static_cast<long long>(sizeof(block)));
+        file.seekg(start);
+        if (!file.read(block, end - start)) {
+            action = "cannot read " + path;
+            return false;
+        }
+        for (long long i = end - start; i-- > 0;) {
+            if (block[i] == '\n') {
+                keep = start + i + 1;
+                break;
+            }
+        }
+        end = start;
+    }
+    file.close();
+    if (keep == size) return true;
+
+    if (ifstream(path + ".appending").good()) {
+        if (!truncateAndSync(path, keep)) {
+            action = systemError("cannot truncate " + path);
+            return false;
+        }
+        action = "dropped an incomplete last line of " + path;
+        return true;
+    }
+    ofstream out(path, ios::binary | ios::app);
+    if (!(out << '\n') || !out.flush()) {
+        action = "cannot append to " + path;
+        return false;
+    }
+    action = "added the missing newline at the end of " + path;
+    return true;
+}
@@ -0,0 +1,45 @@
+// Crash-consistent whole-file replacement and startup recovery
+#pragma once
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+uint32_t crc32(const string& data);
+
+// Replace `path` with `contents` so that a crash leaves either the old or
+// the new file, never a mix: the data goes to `path.tmp` and is fsynced,
+// `path.manifest` records the sizes and checksums of the new and the
+// previous generation, the previous file is kept as `path.prev`, and the
+// temp file is renamed over `path` before the directory is fsynced.
+bool replaceFileAtomically(const string& path, const string& contents, string& error);
+
+// Move a file that was streamed to `path.tmp` over `path`: the temp file
+// is fsynced, renamed, and the directory fsynced, so readers see either
+// the old or the complete new file. Unlike replaceFileAtomically no
+// manifest or previous generation is kept.
+bool commitTempFile(const string& path, string& error);
+
+// Startup check for a file written by replaceFileAtomically. Validates it
+// against its manifest and, if it is torn or missing, finishes the
+// interrupted write from `path.tmp` or restores `path.prev`. A file with
+// the size and nanosecond timestamp the manifest recorded is trusted
+// without being read; otherwise only the file and its two siblings are
+// read. A file that is newer than its manifest was edited by hand and is
+// accepted as is. `action` describes any repair
+// made; false means no generation passed its checksum and the file was
+// left alone.
+bool recoverFile(const string& path, string& action);
+
+// Appends in flight: `path.appending` is created and synced before the
+// first append to `path`, and removed once the appended data was synced,
+// so a partial last line found while it exists was torn by a crash.
+bool beginAppending(const string& path, string& error);
+bool endAppending(const string& path, string& error);
+
+// Startup check for a file that is only appended to. An incomplete last
+// line is cut if an append was in flight (see beginAppending); otherwise
+// the file was edited by hand and the missing newline is added. Only the
+// tail of the file is read. `action` describes any repair; false if the
+// file could not be changed.
+bool repairLastLine(const string& path, string& action);
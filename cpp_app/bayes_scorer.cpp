@@ -0,0 +1,281 @@
+// Naive Bayes disease ranking implementation
+#include "bayes_scorer.h"
+#include "prolog_engine.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+// Keeps log(p) and log(1 - p) finite
+const double MIN_PROBABILITY = 0.001;
+const double MAX_PROBABILITY = 0.999;
+
+// Patients scored per mostLikely() block; the scores stay in L1
+const size_t BLOCK = 64;
+
+string trim(const string& text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+bool parseProbability(const string& text, double& value) {
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && value >= 0 && value <= 1;
+}
+
+double clampProbability(double p) {
+    return min(max(p, MIN_PROBABILITY), MAX_PROBABILITY);
+}
+
+} // namespace
+
+BayesScorer::BayesScorer() {
+    buildMatrix();
+}
+
+void BayesScorer::buildMatrix() {
+    base.fill(-numeric_limits<float>::infinity());
+    weights.fill(0.0f);
+    const size_t symptoms = symptomCatalog().size();
+    for (size_t d = 0; d < diseases.size(); ++d) {
+        double total = log(clampProbability(priors[d]));
+        for (size_t s = 0; s < symptoms; ++s) {
+            double p = clampProbability(likelihoods[d][s]);
+            total += log(1 - p);
+            weights[s * MAX_DISEASES + d] = static_cast<float>(log(p) - log(1 - p));
+        }
+        base[d] = static_cast<float>(total);
+    }
+}
+
+bool BayesScorer::parse(const string& text, BayesScorer& out, string& error) {
+    BayesScorer parsed;
+    vector<bool> priorGiven;
+    stringstream ss(text);
+    string line;
+    int lineNumber = 0;
+    while (getline(ss, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != string::npos) line = line.substr(0, comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        string where = "line " + to_string(lineNumber) + ": ";
+        size_t colon = line.find(':');
+        string disease = colon == string::npos ? "" : trim(line.substr(0, colon));
+        if (disease.empty()) {
+            error = where + "expected 'Disease: symptom=probability, ...'";
+            return false;
+        }
+        if (find(parsed.diseases.begin(), parsed.diseases.end(), disease) != parsed.diseases.end()) {
+            error = where + "duplicate disease '" + disease + "'";
+            return false;
+        }
+        if (parsed.diseases.size() == MAX_DISEASES) {
+            error = where + "too many diseases (maximum " + to_string(MAX_DISEASES) + ")";
+            return false;
+        }
+
+        double prior = 0;
+        double other = SEED_ABSENT;
+        bool hasPrior = false;
+        map<int, double> listed;
+        stringstream entries(line.substr(colon + 1));
+        string entry;
+        while (getline(entries, entry, ',')) {
+            size_t eq = entry.find('=');
+            string name = trim(entry.substr(0, eq));
+            double value;
+            if (eq == string::npos || !parseProbability(trim(entry.substr(eq + 1)), value)) {
+                error = where + "expected 'name=probability' in '" + trim(entry) + "'";
+                return false;
+            }
+            if (name == "prior") {
+                prior = value;
+                hasPrior = true;
+            } else if (name == "other") {
+                other = value;
+            } else if (symptomIndex(name) >= 0) {
+                listed[symptomIndex(name)] = value;
+            } else {
+                error = where + "unknown symptom '" + name + "'";
+                return false;
+            }
+        }
+        array<double, SYMPTOM_ROWS> row;
+        row.fill(other);
+        for (const auto& symptom : listed) row[symptom.first] = symptom.second;
+        parsed.diseases.push_back(disease);
+        parsed.priors.push_back(prior);
+        parsed.likelihoods.push_back(row);
+        priorGiven.push_back(hasPrior);
+    }
+    if (parsed.diseases.empty()) {
+        error = "no diseases defined";
+        return false;
+    }
+    // Diseases without a prior share what the others leave
+    double given = 0;
+    size_t missing = 0;
+    for (size_t d = 0; d < parsed.diseases.size(); ++d) {
+        if (priorGiven[d]) given += parsed.priors[d];
+        else missing++;
+    }
+    for (size_t d = 0; d < parsed.diseases.size(); ++d) {
+        if (!priorGiven[d]) parsed.priors[d] = max(1 - given, 0.0) / missing;
+    }
+    parsed.buildMatrix();
+    out = parsed;
+    return true;
+}
+
+bool BayesScorer::loadFromFile(const string& path, BayesScorer& out, string& error) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    stringstream buffer;
+    buffer << file.rdbuf();
+    return parse(buffer.str(), out, error);
+}
+
+bool BayesScorer::fromKnowledgeBase(PrologEngine& engine, BayesScorer& out, string& error) {
+    string facts;
+    if (!engine.runGoal("forall(has_symptom(D, S), format('~w ~w~n', [D, S]))", facts)) {
+        error = "has_symptom/2 failed: " + engine.lastError();
+        return false;
+    }
+    // In fact order, so diseases keep their knowledge base order
+    vector<string> order;
+    map<string, vector<string>> symptomsOf;
+    stringstream lines(facts);
+    string disease, symptom;
+    while (lines >> disease >> symptom) {
+        if (!symptomsOf.count(disease)) order.push_back(disease);
+        replace(symptom.begin(), symptom.end(), '_', ' ');
+        symptomsOf[disease].push_back(symptom);
+    }
+    string text;
+    for (const auto& atom : order) {
+        text += diseaseDisplayName(atom) + ":";
+        for (const auto& name : symptomsOf[atom]) {
+            if (symptomIndex(name) < 0) continue; // not a built-in symptom
+            text += " " + name + "=" + to_string(SEED_PRESENT) + ",";
+        }
+        text += " other=" + to_string(SEED_ABSENT) + "\n";
+    }
+    return parse(text, out, error);
+}
+
+string BayesScorer::toText() const {
+    const vector<string>& catalog = symptomCatalog();
+    ostringstream text;
+    for (size_t d = 0; d < diseases.size(); ++d) {
+        // The most common value is written once as `other`
+        map<double, int> counts;
+        for (size_t s = 0; s < catalog.size(); ++s) counts[likelihoods[d][s]]++;
+        double other = max_element(counts.begin(), counts.end(), [](const pair<const double, int>& a,
+                                                                    const pair<const double, int>& b) {
+                           return a.second < b.second;
+                       })->first;
+        text << diseases[d] << ": prior=" << priors[d] << ", other=" << other;
+        for (size_t s = 0; s < catalog.size(); ++s) {
+            if (likelihoods[d][s] != other) text << ", " << catalog[s] << "=" << likelihoods[d][s];
+        }
+        text << "\n";
+    }
+    return text.str();
+}
+
+size_t BayesScorer::diseaseCount() const {
+    return diseases.size();
+}
+
+const string& BayesScorer::diseaseName(size_t d) const {
+    return diseases[d];
+}
+
+void BayesScorer::score(SymptomMask symptoms, float* out) const {
+    // A local accumulator with a constant width: the adds vectorize
+    // without aliasing checks or a remainder loop
+    float sums[MAX_DISEASES];
+    for (size_t d = 0; d < MAX_DISEASES; ++d) sums[d] = base[d];
+    for (SymptomMask bits = symptoms; bits != 0; bits &= bits - 1) {
+        const float* row = &weights[countr_zero(bits) * MAX_DISEASES];
+        for (size_t d = 0; d < MAX_DISEASES; ++d) sums[d] += row[d];
+    }
+    for (size_t d = 0; d < MAX_DISEASES; ++d) out[d] = sums[d];
+}
+
+void BayesScorer::scoreBatch(const SymptomMask* symptoms, size_t count, float* out) const {
+    for (size_t i = 0; i < count; ++i) score(symptoms[i], out + i * MAX_DISEASES);
+}
+
+void BayesScorer::mostLikely(const SymptomMask* symptoms, size_t count, int* diseaseOut) const {
+    alignas(32) float scores[BLOCK * MAX_DISEASES];
+    const size_t used = diseases.size();
+    for (size_t first = 0; first < count; first += BLOCK) {
+        size_t n = min(BLOCK, count - first);
+        scoreBatch(symptoms + first, n, scores);
+        for (size_t i = 0; i < n; ++i) {
+            const float* row = scores + i * MAX_DISEASES;
+            size_t best = 0;
+            for (size_t d = 1; d < used; ++d) {
+                if (row[d] > row[best]) best = d;
+            }
+            diseaseOut[first + i] = used ? static_cast<int>(best) : -1;
+        }
+    }
+}
+
+vector<size_t> BayesScorer::countMostLikely(const PatientSnapshot& patients) const {
+    vector<size_t> counts(diseases.size(), 0);
+    SymptomMask masks[BLOCK];
+    int best[BLOCK];
+    size_t n = 0;
+    auto flush = [&]() {
+        mostLikely(masks, n, best);
+        for (size_t i = 0; i < n; ++i) {
+            if (best[i] >= 0) counts[best[i]]++;
+        }
+        n = 0;
+    };
+    for (const auto& patient : patients) {
+        masks[n++] = toSymptomMask(patient.symptoms);
+        if (n == BLOCK) flush();
+    }
+    flush();
+    return counts;
+}
+
+vector<DiseaseScore> BayesScorer::rank(const vector<string>& symptoms, size_t limit) const {
+    float scores[MAX_DISEASES];
+    score(toSymptomMask(symptoms), scores);
+    if (diseases.empty()) return {};
+    double top = *max_element(scores, scores + diseases.size());
+    double total = 0;
+    vector<DiseaseScore> ranked;
+    for (size_t d = 0; d < diseases.size(); ++d) {
+        double weight = exp(scores[d] - top);
+        total += weight;
+        ranked.push_back({diseases[d], weight});
+    }
+    for (auto& entry : ranked) entry.probability /= total;
+    stable_sort(ranked.begin(), ranked.end(),
+                [](const DiseaseScore& a, const DiseaseScore& b) { return a.probability > b.probability; });
+    if (ranked.size() > limit) ranked.resize(limit);
+    return ranked;
+}
@@ -0,0 +1,73 @@
+// Naive Bayes ranking of diseases by how well they explain the symptoms
+#pragma once
+#include "patient_store.h"
+#include "rule_set.h"
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PrologEngine;
+
+struct DiseaseScore {
+    string disease;
+    double probability; // posterior, the scores of all diseases sum to 1
+};
+
+// Each disease has a prior and, per built-in symptom, the probability that
+// a patient with the disease has it. Symptoms are treated as independent,
+// so a patient's log-likelihood for a disease is
+//   base[d] + sum over present symptoms s of weight[s][d]
+// with base[d] = log prior + sum of log(1 - p) and weight = log p - log(1 - p).
+// The weights are a dense symptom x disease matrix with a fixed row width,
+// so scoring adds one row per present symptom with SIMD adds.
+class BayesScorer {
+public:
+    static const size_t MAX_DISEASES = 32;
+    static const size_t SYMPTOM_ROWS = 32; // one per SymptomMask bit
+
+private:
+    vector<string> diseases;
+    vector<double> priors;
+    vector<array<double, SYMPTOM_ROWS>> likelihoods; // p(symptom | disease)
+    alignas(32) array<float, MAX_DISEASES> base;
+    alignas(32) array<float, SYMPTOM_ROWS * MAX_DISEASES> weights;
+
+    void buildMatrix();
+
+public:
+    // Probabilities for symptoms has_symptom/2 lists and does not list
+    static constexpr double SEED_PRESENT = 0.8;
+    static constexpr double SEED_ABSENT = 0.05;
+
+    BayesScorer();
+
+    // One disease per line: "Disease: prior=0.1, other=0.02, fever=0.9, cough=0.7".
+    // prior defaults to equal for every disease; `other` (default
+    // SEED_ABSENT) applies to the symptoms not listed. Returns false and
+    // sets `error` (with the line number) on a malformed line.
+    static bool parse(const string& text, BayesScorer& out, string& error);
+    static bool loadFromFile(const string& path, BayesScorer& out, string& error);
+    // Every has_symptom(Disease, Symptom) fact of a consulted knowledge
+    // base, with equal priors
+    static bool fromKnowledgeBase(PrologEngine& engine, BayesScorer& out, string& error);
+    string toText() const;
+
+    size_t diseaseCount() const;
+    const string& diseaseName(size_t d) const;
+
+    // Log-likelihood of every disease, MAX_DISEASES floats; unused slots
+    // are -infinity
+    void score(SymptomMask symptoms, float* out) const;
+    // `count` patients at once: out holds count rows of MAX_DISEASES
+    void scoreBatch(const SymptomMask* symptoms, size_t count, float* out) const;
+    // The most likely disease of each patient, without keeping the scores;
+    // for scoring a whole population
+    void mostLikely(const SymptomMask* symptoms, size_t count, int* diseaseOut) const;
+    // Patients per disease, by each patient's most likely disease
+    vector<size_t> countMostLikely(const PatientSnapshot& patients) const;
+
+    // Diseases by posterior probability, most likely first
+    vector<DiseaseScore> rank(const vector<string>& symptoms, size_t limit = MAX_DISEASES) const;
+};
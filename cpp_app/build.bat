@@ -1,20 +1,20 @@
-@echo off
-echo Building MediCheck C++ Application...
-
-:: Create build directory if it doesn't exist
-if not exist "bin" mkdir bin
-
-:: Compile all source files
-echo Compiling source files...
-g++ -std=c++17 -Wall -Wextra -O2 main.cpp patient.cpp patient_manager.cpp diagnosis.cpp -o bin\medicheck.exe
-
-if %errorlevel% neq 0 (
-    echo Build failed!
-    pause
-    exit /b 1
-)
-
-echo Build successful! Executable created: bin\medicheck.exe
-echo.
-echo To run the application, execute: bin\medicheck.exe
-pause
+@echo off
+echo Building MediCheck C++ Application...
+
+:: Create build directory if it doesn't exist
+if not exist "bin" mkdir bin
+
+:: Compile all source files
+echo Compiling source files...
+g++ -std=c++20 -Wall -Wextra -O2 -pthread main.cpp patient.cpp patient_id.cpp patient_manager.cpp patient_index.cpp patient_similarity.cpp population_analytics.cpp patient_store.cpp symptom_history.cpp symptom_loader.cpp symptom_vocabulary.cpp diagnosis.cpp atomic_file.cpp persistence_writer.cpp prolog_engine.cpp rule_set.cpp differential_harness.cpp rule_registry.cpp rule_optimizer.cpp result_export.cpp rediagnosis.cpp shared_registry.cpp workload_trace.cpp bayes_scorer.cpp async_storage.cpp -o bin\medicheck.exe
+
+if %errorlevel% neq 0 (
+    echo Build failed!
+    pause
+    exit /b 1
+)
+
+echo Build successful! Executable created: bin\medicheck.exe
+echo.
+echo To run the application, execute: bin\medicheck.exe
+pause
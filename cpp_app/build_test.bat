@@ -1,20 +1,20 @@
-@echo off
-echo Building MediCheck Test Suite...
-
-:: Create build directory if it doesn't exist
-if not exist "bin" mkdir bin
-
-:: Compile test file with all dependencies
-echo Compiling test suite...
-g++ -std=c++17 -Wall -Wextra -O2 test_medicheck.cpp patient.cpp patient_manager.cpp diagnosis.cpp -o bin\test_medicheck.exe
-
-if %errorlevel% neq 0 (
-    echo Test build failed!
-    pause
-    exit /b 1
-)
-
-echo Test build successful! Executable created: bin\test_medicheck.exe
-echo.
-echo To run the tests, execute: bin\test_medicheck.exe
-pause
+@echo off
+echo Building MediCheck Test Suite...
+
+:: Create build directory if it doesn't exist
+if not exist "bin" mkdir bin
+
+:: Compile test file with all dependencies
+echo Compiling test suite...
+g++ -std=c++20 -Wall -Wextra -O2 -pthread test_medicheck.cpp patient.cpp patient_id.cpp patient_manager.cpp patient_index.cpp patient_similarity.cpp population_analytics.cpp patient_store.cpp symptom_history.cpp symptom_loader.cpp symptom_vocabulary.cpp diagnosis.cpp atomic_file.cpp persistence_writer.cpp prolog_engine.cpp rule_set.cpp differential_harness.cpp rule_registry.cpp rule_optimizer.cpp result_export.cpp rediagnosis.cpp shared_registry.cpp workload_trace.cpp bayes_scorer.cpp async_storage.cpp -o bin\test_medicheck.exe
+
+if %errorlevel% neq 0 (
+    echo Test build failed!
+    pause
+    exit /b 1
+)
+
+echo Test build successful! Executable created: bin\test_medicheck.exe
+echo.
+echo To run the tests, execute: bin\test_medicheck.exe
+pause
@@ -1,8 +1,8 @@
-// Diagnosis rules header
-#pragma once
-#include <vector>
-#include <string>
-
-using namespace std;
-
-vector<string> predictDiseases(const vector<string>& symptoms);
+// Diagnosis rules header
+#pragma once
+#include <vector>
+#include <string>
+
+using namespace std;
+
+vector<string> predictDiseases(const vector<string>& symptoms);
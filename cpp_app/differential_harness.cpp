@@ -0,0 +1,146 @@
+// Differential testing harness implementation
+#include "differential_harness.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const uint64_t CHUNK_SIZE = 1024;
+
+// splitmix64, so each sample depends only on the seed and its index
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+DifferentialHarness::DifferentialHarness(const RuleSet& rules) : explainer(rules) {}
+
+void DifferentialHarness::addVariant(const string& name, const function<DiseasePredictor()>& factory) {
+    variants.push_back({name, factory});
+}
+
+DifferentialResult DifferentialHarness::runExhaustive(unsigned threads) const {
+    uint64_t cases = uint64_t(1) << symptomCatalog().size();
+    return run(cases, [](uint64_t i) { return static_cast<SymptomMask>(i); }, threads);
+}
+
+DifferentialResult DifferentialHarness::runRandom(uint64_t samples, uint64_t seed, unsigned threads) const {
+    SymptomMask all = (SymptomMask(1) << symptomCatalog().size()) - 1;
+    return run(samples, [seed, all](uint64_t i) { return static_cast<SymptomMask>(mix(seed + i)) & all; }, threads);
+}
+
+DifferentialResult DifferentialHarness::run(uint64_t cases, const function<SymptomMask(uint64_t)>& caseMask,
+                                            unsigned threads) const {
+    DifferentialResult result;
+    if (variants.size() < 2) return result;
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+
+    // Workers claim chunks of case indices; once a divergence is found
+    // nobody starts work beyond it, so the reported case is the first one
+    atomic<uint64_t> nextCase{0};
+    atomic<uint64_t> firstDivergence{numeric_limits<uint64_t>::max()};
+    atomic<uint64_t> checked{0};
+    mutex resultMutex;
+
+    auto worker = [&]() {
+        vector<DiseasePredictor> predictors;
+        for (const auto& variant : variants) predictors.push_back(variant.factory());
+
+        while (true) {
+            uint64_t begin = nextCase.fetch_add(CHUNK_SIZE);
+            if (begin >= cases || begin > firstDivergence.load()) break;
+            uint64_t end = min(cases, begin + CHUNK_SIZE);
+            uint64_t done = 0;
+            for (uint64_t i = begin; i < end && i < firstDivergence.load(); ++i) {
+                SymptomMask mask = caseMask(i);
+                vector<string> symptoms = fromSymptomMask(mask);
+                vector<string> expected = predictors[0](symptoms);
+                sort(expected.begin(), expected.end());
+                done++;
+
+                for (size_t v = 1; v < predictors.size(); ++v) {
+                    vector<string> actual = predictors[v](symptoms);
+                    sort(actual.begin(), actual.end());
+                    if (actual == expected) continue;
+
+                    lock_guard<mutex> lock(resultMutex);
+                    if (i < firstDivergence.load()) {
+                        firstDivergence.store(i);
+                        result.agreed = false;
+                        result.symptoms = mask;
+                        result.referenceEngine = variants[0].name;
+                        result.divergingEngine = variants[v].name;
+                        result.referenceDiseases = expected;
+                        result.divergingDiseases = actual;
+                    }
+                    break;
+                }
+            }
+            checked.fetch_add(done);
+        }
+    };
+
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    result.casesChecked = checked.load();
+    if (!result.agreed) explain(result);
+    return result;
+}
+
+void DifferentialHarness::explain(DifferentialResult& result) const {
+    vector<string> differing;
+    set_symmetric_difference(result.referenceDiseases.begin(), result.referenceDiseases.end(),
+                             result.divergingDiseases.begin(), result.divergingDiseases.end(),
+                             back_inserter(differing));
+    if (differing.empty()) return;
+    result.disease = differing.front();
+
+    const vector<DiseaseRule>& rules = explainer.getRules();
+    int count = popcount(result.symptoms);
+    for (size_t r = 0; r < rules.size(); ++r) {
+        if (rules[r].disease != result.disease) continue;
+        int clause = explainer.matchingClause(r, result.symptoms, count);
+        if (clause >= 0) {
+            result.rule = "Rule " + to_string(r + 1) + " (" + result.disease + "), clause " +
+                          to_string(clause + 1) + " matches: " + explainer.describeClause(rules[r].clauses[clause]);
+        } else {
+            result.rule = "Rule " + to_string(r + 1) + " (" + result.disease + "): no clause matches";
+        }
+        return;
+    }
+    result.rule = result.disease + ": not in the rule table";
+}
+
+void DifferentialHarness::printResult(const DifferentialResult& result) {
+    if (result.agreed) {
+        cout << "All engines agree on " << result.casesChecked << " symptom sets.\n";
+        return;
+    }
+    auto join = [](const vector<string>& items) {
+        string text;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i) text += ", ";
+            text += items[i];
+        }
+        return text.empty() ? string("(none)") : text;
+    };
+    cout << "Engines diverge on symptoms: " << join(fromSymptomMask(result.symptoms)) << "\n";
+    cout << "  " << result.referenceEngine << ": " << join(result.referenceDiseases) << "\n";
+    cout << "  " << result.divergingEngine << ": " << join(result.divergingDiseases) << "\n";
+    cout << "  Responsible rule: " << result.rule << "\n";
+}
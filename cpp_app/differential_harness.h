@@ -0,0 +1,57 @@
+// Differential testing of the diagnosis engines over symptom subsets
+#pragma once
+#include "rule_set.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Symptoms in, sorted display names out (the predictDiseases contract)
+typedef function<vector<string>(const vector<string>&)> DiseasePredictor;
+
+struct DifferentialResult {
+    bool agreed = true;
+    uint64_t casesChecked = 0;
+
+    // Only meaningful when agreed == false
+    SymptomMask symptoms = 0;
+    string referenceEngine;
+    string divergingEngine;
+    vector<string> referenceDiseases;
+    vector<string> divergingDiseases;
+    string disease;       // first disease the engines disagree on
+    string rule;          // the rule for that disease and the clause that fired, if any
+};
+
+class DifferentialHarness {
+private:
+    struct Variant {
+        string name;
+        // Called once per worker thread so engines with internal state
+        // (like PrologEngine) each get their own instance
+        function<DiseasePredictor()> factory;
+    };
+
+    vector<Variant> variants;
+    RuleSet explainer; // the rules under test, for naming the clause that fired
+
+    DifferentialResult run(uint64_t cases, const function<SymptomMask(uint64_t)>& caseMask, unsigned threads) const;
+    void explain(DifferentialResult& result) const;
+
+public:
+    // Pass the rules the engines were built from, e.g. after a rules.txt
+    // reload, so divergences are explained with those rules
+    explicit DifferentialHarness(const RuleSet& rules = RuleSet::builtin());
+
+    // The first variant added is the reference the others are checked against
+    void addVariant(const string& name, const function<DiseasePredictor()>& factory);
+
+    // Every subset of the symptom catalog (2^18 cases)
+    DifferentialResult runExhaustive(unsigned threads = 0) const;
+    // `samples` random subsets, reproducible from `seed`
+    DifferentialResult runRandom(uint64_t samples, uint64_t seed, unsigned threads = 0) const;
+
+    static void printResult(const DifferentialResult& result);
+};
@@ -1,234 +1,549 @@
-#include "patient.h"
-#include "patient_manager.h"
-#include "diagnosis.h"
-#include <iostream>
-#include <limits>
-using namespace std;
-
-void clearInputStream() {
-    cin.clear();
-    cin.ignore(numeric_limits<streamsize>::max(), '\n');
-}
-
-void displayMainMenu() {
-    cout << "\n========== MediCheck - Main Menu ==========\n";
-    cout << "1. Patient Management\n";
-    cout << "2. Symptom Management\n";
-    cout << "3. Disease Diagnosis\n";
-    cout << "4. Exit\n";
-    cout << "==========================================\n";
-    cout << "Select an option: ";
-}
-
-void displayPatientMenu() {
-    cout << "\n--- Patient Management ---\n";
-    cout << "1. Add New Patient\n";
-    cout << "2. View All Patients\n";
-    cout << "3. Edit Patient\n";
-    cout << "4. Delete Patient\n";
-    cout << "5. Back to Main Menu\n";
-    cout << "Choice: ";
-}
-
-void displaySymptomMenu() {
-    cout << "\n--- Symptom Management ---\n";
-    cout << "1. Add Symptoms to Patient\n";
-    cout << "2. View Patient Symptoms\n";
-    cout << "3. Clear Patient Symptoms\n";
-    cout << "4. View Available Symptoms\n";
-    cout << "5. Back to Main Menu\n";
-    cout << "Choice: ";
-}
-
-void handlePatientManagement(PatientManager& manager) {
-    int choice;
-    do {
-        displayPatientMenu();
-        cin >> choice;
-
-        if (cin.fail()) {
-            clearInputStream();
-            cout << "Invalid input. Please enter a number.\n";
-            continue;
-        }
-
-        switch (choice) {
-            case 1:
-                manager.addPatient();
-                break;
-            case 2:
-                manager.viewAllPatients();
-                break;
-            case 3: {
-                if (manager.isEmpty()) {
-                    cout << "No patients available for editing.\n";
-                    break;
-                }
-                int id;
-                cout << "Enter patient ID to edit: ";
-                cin >> id;
-                manager.editPatient(id);
-                break;
-            }
-            case 4: {
-                if (manager.isEmpty()) {
-                    cout << "No patients available for deletion.\n";
-                    break;
-                }
-                int id;
-                cout << "Enter patient ID to delete: ";
-                cin >> id;
-                manager.deletePatient(id);
-                break;
-            }
-            case 5:
-                cout << "Returning to main menu...\n";
-                break;
-            default:
-                cout << "Invalid choice. Please try again.\n";
-        }
-    } while (choice != 5);
-}
-
-void handleSymptomManagement(PatientManager& manager) {
-    int choice;
-    do {
-        displaySymptomMenu();
-        cin >> choice;
-
-        if (cin.fail()) {
-            clearInputStream();
-            cout << "Invalid input. Please enter a number.\n";
-            continue;
-        }
-
-        switch (choice) {
-            case 1: {
-                if (manager.isEmpty()) {
-                    cout << "No patients available. Please add a patient first.\n";
-                    break;
-                }
-                manager.viewAllPatients();
-                int id;
-                cout << "Enter patient ID to add symptoms: ";
-                cin >> id;
-                manager.addSymptomToPatient(id);
-                break;
-            }
-            case 2: {
-                if (manager.isEmpty()) {
-                    cout << "No patients available.\n";
-                    break;
-                }
-                manager.viewAllPatients();
-                int id;
-                cout << "Enter patient ID to view symptoms: ";
-                cin >> id;
-                manager.viewPatientSymptoms(id);
-                break;
-            }
-            case 3: {
-                if (manager.isEmpty()) {
-                    cout << "No patients available.\n";
-                    break;
-                }
-                manager.viewAllPatients();
-                int id;
-                cout << "Enter patient ID to clear symptoms: ";
-                cin >> id;
-                manager.clearPatientSymptoms(id);
-                break;
-            }
-            case 4:
-                manager.displayAvailableSymptoms();
-                break;
-            case 5:
-                cout << "Returning to main menu...\n";
-                break;
-            default:
-                cout << "Invalid choice. Please try again.\n";
-        }
-    } while (choice != 5);
-}
-
-void handleDiagnosis(PatientManager& manager) {
-    if (manager.isEmpty()) {
-        cout << "No patients available. Please add a patient first.\n";
-        return;
-    }
-
-    manager.viewAllPatients();
-    int id;
-    cout << "Enter patient ID for diagnosis: ";
-    cin >> id;
-
-    Patient* patient = manager.findPatientById(id);
-    if (!patient) {
-        cout << "Patient with ID " << id << " not found.\n";
-        return;
-    }
-
-    if (patient->symptoms.empty()) {
-        cout << "No symptoms recorded for this patient. Please add symptoms first.\n";
-        return;
-    }
-
-    cout << "\n--- Diagnosis for " << patient->name << " ---\n";
-    patient->displaySymptoms();
-
-    auto possibleDiseases = predictDiseases(patient->symptoms);
-    
-    if (possibleDiseases.empty()) {
-        cout << "No matching conditions found based on current symptoms.\n";
-    } else {
-        cout << "\nPossible conditions:\n";
-        for (const auto& disease : possibleDiseases) {
-            cout << "- " << disease << "\n";
-        }
-        cout << "\nNote: This is for informational purposes only. Please consult a healthcare professional.\n";
-    }
-}
-
-int main() {
-    PatientManager manager;
-    int choice;
-
-    // Load existing data from CSV files
-    manager.loadDataFromCSV();
-
-    cout << "========================================\n";
-    cout << "   Welcome to MediCheck Application    \n";
-    cout << "   Simple Medical Diagnosis System     \n";
-    cout << "========================================\n";
-
-    do {
-        displayMainMenu();
-        cin >> choice;
-
-        if (cin.fail()) {
-            clearInputStream();
-            cout << "Invalid input. Please enter a number.\n";
-            continue;
-        }
-
-        switch (choice) {
-            case 1:
-                handlePatientManagement(manager);
-                break;
-            case 2:
-                handleSymptomManagement(manager);
-                break;
-            case 3:
-                handleDiagnosis(manager);
-                break;
-            case 4:
-                cout << "\nThank you for using MediCheck!\n";
-                cout << "Goodbye!\n";
-                break;
-            default:
-                cout << "Invalid choice. Please select 1-4.\n";
-        }
-    } while (choice != 4);
-
-    return 0;
-}
+#include "patient.h"
+#include "patient_manager.h"
+#include "diagnosis.h"
+#include "bayes_scorer.h"
+#include "prolog_engine.h"
+#include "rule_registry.h"
+#include "result_export.h"
+#include "rediagnosis.h"
+#include "shared_registry.h"
+#include "symptom_vocabulary.h"
+#include "workload_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <thread>
+using namespace std;
+
+void clearInputStream() {
+    cin.clear();
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+}
+
+void displayMainMenu() {
+    cout << "\n========== MediCheck - Main Menu ==========\n";
+    cout << "1. Patient Management\n";
+    cout << "2. Symptom Management\n";
+    cout << "3. Disease Diagnosis\n";
+    cout << "4. Export Diagnosis Results\n";
+    cout << "5. Re-diagnose All Patients\n";
+    cout << "6. Population Statistics\n";
+    cout << "7. Exit\n";
+    cout << "==========================================\n";
+    cout << "Select an option: ";
+}
+
+void displayPatientMenu() {
+    cout << "\n--- Patient Management ---\n";
+    cout << "1. Add New Patient\n";
+    cout << "2. View All Patients\n";
+    cout << "3. Edit Patient\n";
+    cout << "4. Delete Patient\n";
+    cout << "5. Find Patients\n";
+    cout << "6. Import Patients from CSV\n";
+    cout << "7. Back to Main Menu\n";
+    cout << "Choice: ";
+}
+
+void displaySymptomMenu() {
+    cout << "\n--- Symptom Management ---\n";
+    cout << "1. Add Symptoms to Patient\n";
+    cout << "2. View Patient Symptoms\n";
+    cout << "3. Clear Patient Symptoms\n";
+    cout << "4. View Available Symptoms\n";
+    cout << "5. Find Patients with Similar Symptoms\n";
+    cout << "6. Back to Main Menu\n";
+    cout << "Choice: ";
+}
+
+void handlePatientManagement(PatientManager& manager) {
+    int choice;
+    do {
+        displayPatientMenu();
+        cin >> choice;
+
+        if (cin.fail()) {
+            clearInputStream();
+            cout << "Invalid input. Please enter a number.\n";
+            continue;
+        }
+
+        switch (choice) {
+            case 1:
+                manager.addPatient();
+                break;
+            case 2:
+                manager.viewAllPatients();
+                break;
+            case 3: {
+                if (manager.isEmpty()) {
+                    cout << "No patients available for editing.\n";
+                    break;
+                }
+                int id = manager.selectPatient("edit");
+                if (id > 0) manager.editPatient(id);
+                break;
+            }
+            case 4: {
+                if (manager.isEmpty()) {
+                    cout << "No patients available for deletion.\n";
+                    break;
+                }
+                int id = manager.selectPatient("delete");
+                if (id > 0) manager.deletePatient(id);
+                break;
+            }
+            case 5:
+                manager.searchPatients();
+                break;
+            case 6: {
+                string path, error;
+                cout << "CSV file (name,age,gender after a header line): ";
+                cin.ignore();
+                getline(cin, path);
+                int added = manager.importPatients(path, error);
+                if (added < 0) {
+                    cout << "Import failed: " << error << "\n";
+                } else {
+                    cout << added << " patients imported.\n";
+                }
+                break;
+            }
+            case 7:
+                cout << "Returning to main menu...\n";
+                break;
+            default:
+                cout << "Invalid choice. Please try again.\n";
+        }
+    } while (choice != 7);
+}
+
+void handleSymptomManagement(PatientManager& manager) {
+    int choice;
+    do {
+        displaySymptomMenu();
+        cin >> choice;
+
+        if (cin.fail()) {
+            clearInputStream();
+            cout << "Invalid input. Please enter a number.\n";
+            continue;
+        }
+
+        switch (choice) {
+            case 1: {
+                if (manager.isEmpty()) {
+                    cout << "No patients available. Please add a patient first.\n";
+                    break;
+                }
+                int id = manager.selectPatient("add symptoms");
+                if (id > 0) manager.addSymptomToPatient(id);
+                break;
+            }
+            case 2: {
+                if (manager.isEmpty()) {
+                    cout << "No patients available.\n";
+                    break;
+                }
+                int id = manager.selectPatient("view symptoms");
+                if (id > 0) manager.viewPatientSymptoms(id);
+                break;
+            }
+            case 3: {
+                if (manager.isEmpty()) {
+                    cout << "No patients available.\n";
+                    break;
+                }
+                int id = manager.selectPatient("clear symptoms");
+                if (id > 0) manager.clearPatientSymptoms(id);
+                break;
+            }
+            case 4:
+                manager.displayAvailableSymptoms();
+                break;
+            case 5: {
+                if (manager.isEmpty()) {
+                    cout << "No patients available.\n";
+                    break;
+                }
+                int id = manager.selectPatient("compare");
+                if (id > 0) manager.viewSimilarPatients(id);
+                break;
+            }
+            case 6:
+                cout << "Returning to main menu...\n";
+                break;
+            default:
+                cout << "Invalid choice. Please try again.\n";
+        }
+    } while (choice != 6);
+}
+
+void handleDiagnosis(PatientManager& manager, RuleRegistry& rules, const CodedRuleSet& codedRules,
+                     const BayesScorer& bayes) {
+    if (manager.isEmpty()) {
+        cout << "No patients available. Please add a patient first.\n";
+        return;
+    }
+
+    int id = manager.selectPatient("diagnose");
+    if (id <= 0) return;
+
+    Patient* patient = manager.findPatientById(id);
+    if (!patient) {
+        cout << "Patient with ID " << id << " not found.\n";
+        return;
+    }
+
+    if (patient->symptoms.empty()) {
+        cout << "No symptoms recorded for this patient. Please add symptoms first.\n";
+        return;
+    }
+
+    cout << "\n--- Diagnosis for " << patient->name << " ---\n";
+    patient->displaySymptoms();
+
+    if (WorkloadRecorder* recorder = manager.getRecorder()) {
+        recorder->record(TraceEvent::DIAGNOSE, {id}, patient->symptoms);
+    }
+    auto possibleDiseases = rules.diagnose(patient->symptoms, codedRules, manager.getVocabulary());
+
+    // The rules decide which conditions fit; the naive Bayes model orders
+    // them, most likely first. Conditions it does not know go last.
+    map<string, double> probability;
+    for (const auto& score : bayes.rank(patient->symptoms)) probability[score.disease] = score.probability;
+    stable_sort(possibleDiseases.begin(), possibleDiseases.end(), [&probability](const string& a, const string& b) {
+        double pa = probability.count(a) ? probability[a] : -1;
+        double pb = probability.count(b) ? probability[b] : -1;
+        return pa > pb;
+    });
+    
+    if (possibleDiseases.empty()) {
+        cout << "No matching conditions found based on current symptoms.\n";
+    } else {
+        cout << "\nPossible conditions, most likely first:\n";
+        for (const auto& disease : possibleDiseases) {
+            cout << "- " << disease;
+            if (probability.count(disease)) {
+                cout << " (" << static_cast<int>(probability[disease] * 100 + 0.5) << "%)";
+            }
+            cout << "\n";
+        }
+        cout << "\nNote: This is for informational purposes only. Please consult a healthcare professional.\n";
+    }
+}
+
+// Write every patient's diagnosis to data/diagnoses.mcdx for analytics.
+// Disease IDs come from data/disease_ids.txt so they stay the same
+// across exports; new diseases are appended to it.
+void handleExport(PatientManager& manager, RuleRegistry& rules, const CodedRuleSet& codedRules) {
+    const string path = "data/diagnoses.mcdx";
+    const string dictionaryPath = "data/disease_ids.txt";
+    string error;
+    DiseaseDictionary dictionary;
+    ResultWriter writer;
+    if (!DiseaseDictionary::load(dictionaryPath, dictionary, error) || !writer.open(path, error)) {
+        cout << "Export failed: " << error << "\n";
+        return;
+    }
+    for (const auto& patient : manager.snapshot()) {
+        uint64_t diseases = 0;
+        if (!dictionary.maskFor(rules.diagnose(patient.symptoms, codedRules, manager.getVocabulary()), diseases, error)) {
+            writer.discard();
+            cout << "Export failed: " << error << "\n";
+            return;
+        }
+        writer.add(patient.getId(), diseases);
+    }
+    if (!writer.close(dictionary, error) || !dictionary.save(dictionaryPath, error)) {
+        cout << "Export failed: " << error << "\n";
+        return;
+    }
+
+    // Read the file back so a bad export is noticed now, not downstream
+    ResultReader reader;
+    DiagnosisRecord record;
+    uint64_t count = 0;
+    if (reader.open(path, error)) {
+        while (reader.next(record)) count++;
+        error = reader.lastError();
+    }
+    if (count != writer.recordCount() || !error.empty()) {
+        cout << "Export could not be verified: " << error << "\n";
+        return;
+    }
+    cout << "Exported " << count << " diagnosis results to " << path << " (" << exportCompression() << " blocks)\n";
+}
+
+// The population-wide views work on the built-in symptom bits
+void noteCodedRulesSkipped(const CodedRuleSet& codedRules) {
+    if (!codedRules.getRules().empty()) {
+        cout << "(Rules from data/coded_rules.txt are not included here; only the built-in symptoms are counted.)\n";
+    }
+}
+
+// Diagnose every patient again in worker processes, one per core, and
+// show how many patients each disease was found in
+void handleRediagnosis(PatientManager& manager, RuleRegistry& rules, const CodedRuleSet& codedRules) {
+    RuleSet active;
+    {
+        RuleRegistry::ReadGuard guard = rules.acquire();
+        active = guard.rules();
+    }
+    RediagnosisOptions options;
+    options.workers = max(1, static_cast<int>(thread::hardware_concurrency()));
+    auto start = chrono::steady_clock::now();
+    RediagnosisResult result = rediagnoseInWorkers(manager.snapshot(), active, options);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!result.error.empty()) {
+        cout << "Re-diagnosis failed: " << result.error << "\n";
+        return;
+    }
+
+    cout << "\n--- Re-diagnosis of " << result.patients << " patients (" << options.workers << " workers, "
+         << seconds << " s) ---\n";
+    for (const auto& entry : result.diseaseCounts) cout << entry.first << ": " << entry.second << "\n";
+    cout << "No matching condition: " << result.undiagnosed << "\n";
+    if (result.workerFailures > 0) {
+        cout << result.workerFailures << " worker(s) failed; their patients were re-assigned.\n";
+    }
+    noteCodedRulesSkipped(codedRules);
+}
+
+string describeSymptoms(SymptomMask mask) {
+    string text;
+    for (const auto& symptom : fromSymptomMask(mask)) text += (text.empty() ? "" : " + ") + symptom;
+    return text;
+}
+
+string signedCount(int64_t count) {
+    return (count > 0 ? "+" : "") + to_string(count);
+}
+
+// Symptom combinations and disease prevalence by age band and gender,
+// with the changes since the statistics were last shown
+void handlePopulationStats(PatientManager& manager, RuleRegistry& rules, const CodedRuleSet& codedRules) {
+    static PopulationStats previous;
+    RuleSet active;
+    {
+        RuleRegistry::ReadGuard guard = rules.acquire();
+        active = guard.rules();
+    }
+    const PopulationStats& stats = manager.populationStats(active);
+    bool compare = previous.patients > 0 && previous.diseases == stats.diseases;
+    PopulationStats delta = compare ? stats.deltaFrom(previous) : PopulationStats(stats.diseases);
+
+    cout << "\n--- Population Statistics (" << stats.patients << " patients) ---\n";
+    cout << "Most common symptom pairs:\n";
+    for (const auto& entry : stats.topPairs(5)) cout << "  " << describeSymptoms(entry.first) << ": " << entry.second << "\n";
+    cout << "Most common symptom triples:\n";
+    for (const auto& entry : stats.topTriples(5)) cout << "  " << describeSymptoms(entry.first) << ": " << entry.second << "\n";
+
+    cout << "Diseases (M/F/other, then by age):\n";
+    for (size_t d = 0; d < stats.diseases.size(); ++d) {
+        int disease = static_cast<int>(d);
+        int64_t total = stats.prevalence(disease);
+        if (total == 0) continue;
+        int64_t byGender[PopulationStats::GENDERS] = {};
+        string bands;
+        for (int band = 0; band < PopulationStats::AGE_BANDS; ++band) {
+            int64_t inBand = 0;
+            for (int g = 0; g < PopulationStats::GENDERS; ++g) {
+                int64_t count = stats.prevalence(disease, band, static_cast<PopulationStats::Gender>(g));
+                byGender[g] += count;
+                inBand += count;
+            }
+            if (inBand > 0) bands += " " + PopulationStats::ageBandName(band) + ":" + to_string(inBand);
+        }
+        cout << "  " << stats.diseases[d] << ": " << total << " (" << byGender[PopulationStats::MALE] << "/"
+             << byGender[PopulationStats::FEMALE] << "/" << byGender[PopulationStats::OTHER] << ")" << bands;
+        if (compare && delta.prevalence(disease) != 0) cout << " [" << signedCount(delta.prevalence(disease)) << "]";
+        cout << "\n";
+    }
+    cout << "  No matching condition: " << stats.undiagnosed << "\n";
+    if (compare) {
+        cout << "Since last shown: " << signedCount(delta.patients) << " patients, " << signedCount(delta.undiagnosed)
+             << " without a matching condition\n";
+    }
+    noteCodedRulesSkipped(codedRules);
+    previous = stats;
+}
+
+// Enough patients for stable symptom and clause frequencies
+const size_t PROFILE_SAMPLE = 4096;
+
+// Profile a sample of the patients and let the rule registry reorder its
+// symptom checks to match them
+void optimizeRulesForPopulation(PatientManager& manager, RuleRegistry& rules) {
+    RuleSet active;
+    uint64_t version;
+    {
+        RuleRegistry::ReadGuard guard = rules.acquire();
+        active = guard.rules();
+        version = guard.versionNumber();
+    }
+    RuleProfile profile(active, version);
+    for (const auto& patient : manager.samplePatients(PROFILE_SAMPLE)) {
+        profile.record(active, toSymptomMask(patient.symptoms), static_cast<int>(patient.symptoms.size()));
+    }
+    rules.optimize(profile);
+}
+
+// Built on the first diagnosis or export; the sample reads only its own
+// patients' symptoms, so the rest are still loaded lazily
+void ensureRulesOptimized(PatientManager& manager, RuleRegistry& rules) {
+    static bool optimized = false;
+    if (optimized) return;
+    optimizeRulesForPopulation(manager, rules);
+    optimized = true;
+}
+
+const char* const SHARED_REGISTRY = "/medicheck_registry";
+
+// --attach: print what another MediCheck started with --publish shares,
+// without loading any files
+int showSharedRegistry() {
+    SharedRegistryReader reader;
+    string error;
+    if (!reader.attach(SHARED_REGISTRY, error)) {
+        cout << "Cannot attach: " << error << "\n";
+        return 1;
+    }
+    cout << "Shared registry version " << reader.version() << ", " << reader.patientCount() << " patients\n";
+    vector<size_t> counts = reader.symptomCounts();
+    for (size_t i = 0; i < counts.size(); ++i) cout << symptomCatalog()[i] << ": " << counts[i] << "\n";
+    return 0;
+}
+
+void publishRegistry(SharedRegistryWriter& shared, PatientManager& manager) {
+    string error;
+    if (!shared.publish(manager.snapshot(), error)) cout << "Could not update the shared registry: " << error << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    bool publish = false;
+    string tracePath;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--attach") == 0) return showSharedRegistry();
+        if (strcmp(argv[i], "--publish") == 0) publish = true;
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) tracePath = argv[++i];
+    }
+
+    PatientManager manager;
+    int choice;
+
+    // Load existing data from CSV files while the rules and the model are
+    // set up; symptoms are parsed as patients are used and by a background
+    // thread, so large files do not delay the menu
+    Task<void> loading = manager.loadDataFromCSVAsync(PatientManager::LAZY_WITH_WARMUP);
+    loading.start();
+
+    // Disease rules come from data/rules.txt and are reloaded when it changes
+    RuleRegistry rules;
+    string ruleError;
+    if (!rules.reload("data/rules.txt", ruleError)) {
+        cout << "Using built-in disease rules (" << ruleError << ")\n";
+    }
+    rules.startWatching("data/rules.txt");
+
+    // Ranks the diagnoses: data/bayes_model.txt, or else one seeded from
+    // has_symptom/2 in the knowledge base
+    BayesScorer bayes;
+    string modelError;
+    if (ifstream("data/bayes_model.txt").good()) {
+        if (!BayesScorer::loadFromFile("data/bayes_model.txt", bayes, modelError)) {
+            cout << "Ignoring data/bayes_model.txt (" << modelError << ")\n";
+        }
+    } else {
+        PrologEngine engine;
+        if (!engine.consult("../prolog_version/knowledge_base.pl") ||
+            !BayesScorer::fromKnowledgeBase(engine, bayes, modelError)) {
+            cout << "Diagnoses will not be ranked (no data/bayes_model.txt or knowledge base)\n";
+        }
+    }
+
+    loading.get();
+
+    // Optional rules that may name any symptom of data/symptom_codes.txt
+    CodedRuleSet codedRules;
+    if (ifstream("data/coded_rules.txt").good() &&
+        !CodedRuleSet::loadFromFile("data/coded_rules.txt", manager.getVocabulary(), codedRules, ruleError)) {
+        cout << "Ignoring data/coded_rules.txt (" << ruleError << ")\n";
+    }
+
+    // --record FILE: trace this session for medicheck_replay
+    WorkloadRecorder recorder;
+    if (!tracePath.empty()) {
+        string error;
+        if (recorder.open(tracePath, error)) {
+            manager.startRecording(&recorder);
+            cout << "Recording to " << tracePath << "\n";
+        } else {
+            cout << "Recording disabled: " << error << "\n";
+        }
+    }
+
+    // --publish: keep a read-only copy of the patients in shared memory for
+    // other processes, refreshed after patient and symptom management
+    SharedRegistryWriter shared;
+    if (publish) {
+        string error;
+        if (shared.create(SHARED_REGISTRY, error)) {
+            publishRegistry(shared, manager);
+        } else {
+            cout << "Shared registry disabled: " << error << "\n";
+        }
+    }
+
+    cout << "========================================\n";
+    cout << "   Welcome to MediCheck Application    \n";
+    cout << "   Simple Medical Diagnosis System     \n";
+    cout << "========================================\n";
+
+    do {
+        displayMainMenu();
+        cin >> choice;
+
+        if (cin.fail()) {
+            clearInputStream();
+            cout << "Invalid input. Please enter a number.\n";
+            continue;
+        }
+
+        switch (choice) {
+            case 1:
+                handlePatientManagement(manager);
+                break;
+            case 2:
+                handleSymptomManagement(manager);
+                break;
+            case 3:
+                ensureRulesOptimized(manager, rules);
+                handleDiagnosis(manager, rules, codedRules, bayes);
+                break;
+            case 4:
+                ensureRulesOptimized(manager, rules);
+                handleExport(manager, rules, codedRules);
+                break;
+            case 5:
+                handleRediagnosis(manager, rules, codedRules);
+                break;
+            case 6:
+                handlePopulationStats(manager, rules, codedRules);
+                break;
+            case 7:
+                cout << "\nThank you for using MediCheck!\n";
+                cout << "Goodbye!\n";
+                break;
+            default:
+                cout << "Invalid choice. Please select 1-7.\n";
+        }
+        if (publish && (choice == 1 || choice == 2)) publishRegistry(shared, manager);
+    } while (choice != 7);
+
+    return 0;
+}
@@ -1,34 +1,37 @@
-// Patient class definition
-#pragma once
-#include <string>
-#include <vector>
-#include <iostream>
-
-using namespace std;
-
-class Patient {
-private:
-    static int nextId;
-    int id;
-
-public:
-    string name;
-    int age;
-    string gender;
-    vector<string> symptoms;
-
-    Patient();
-    Patient(const string& name, int age, const string& gender);
-
-    int getId() const;
-
-    static void setNextId(int id);
-
-    void addSymptom(const string& symptom);
-    void clearSymptoms();
-    void displaySymptoms() const;
-
-    // Display patient information
-    void displayInfo() const;
-    void displaySummary() const;
-};
+// Patient class definition
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+class Patient {
+private:
+    int id;
+
+public:
+    string name;
+    int age;
+    string gender;
+    vector<string> symptoms;
+
+    Patient(); // ID 0: no ID is allocated
+    // A new patient, numbered by patientIds()
+    Patient(const string& name, int age, const string& gender);
+    // A patient restored from storage with its saved ID; the caller reports
+    // the IDs to patientIds().observe()
+    Patient(int id, const string& name, int age, const string& gender);
+
+    int getId() const;
+
+    void addSymptom(const string& symptom);
+    void clearSymptoms();
+    void displaySymptoms() const;
+
+    // Display patient information
+    void displayInfo() const;
+    void displaySummary() const;
+    // Append the one-line summary to `out`, for rendering whole pages at once
+    void appendSummary(string& out) const;
+};
@@ -0,0 +1,109 @@
+// Patient ID allocation implementation
+#include "patient_id.h"
+#include "atomic_file.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+int IdAllocator::allocate() {
+    int id = nextId.fetch_add(1, memory_order_relaxed);
+    if (id >= durableMark.load(memory_order_acquire)) coverUpTo(id + 1);
+    return id;
+}
+
+int IdAllocator::reserve(int count) {
+    int first = nextId.fetch_add(count, memory_order_relaxed);
+    if (first + count > durableMark.load(memory_order_acquire)) coverUpTo(first + count);
+    return first;
+}
+
+bool IdAllocator::release(int first, int end) {
+    int expected = end;
+    return first < end && nextId.compare_exchange_strong(expected, first, memory_order_relaxed);
+}
+
+// Slow path, once per window: move the saved mark past `end`. Threads
+// that got IDs in the same window wait here until it is on disk.
+void IdAllocator::coverUpTo(int end) {
+    lock_guard<mutex> lock(markLock);
+    if (markPath.empty() || end <= durableMark.load(memory_order_relaxed)) return;
+    int mark = end + markWindow;
+    string error;
+    bool saved = replaceFileAtomically(markPath, to_string(mark) + "\n", error);
+    if (!saved && !markFailing) {
+        cout << "Could not save " << markPath << ": " << error << " (will retry; new IDs may be reused after a crash)\n";
+    } else if (saved && markFailing) {
+        cout << "Saved " << markPath << " again\n";
+    }
+    markFailing = !saved;
+    // After a failure this is only the point of the next attempt
+    durableMark.store(mark, memory_order_release);
+}
+
+void IdAllocator::observe(int id) {
+    int current = nextId.load(memory_order_relaxed);
+    while (current <= id && !nextId.compare_exchange_weak(current, id + 1, memory_order_relaxed)) {
+    }
+}
+
+int IdAllocator::peekNext() const {
+    return nextId.load(memory_order_relaxed);
+}
+
+bool IdAllocator::load(const string& path, string& error) {
+    string action;
+    if (!recoverFile(path, action)) {
+        error = "no valid copy of " + path;
+        return false;
+    }
+    ifstream file(path);
+    int next = 0;
+    if (!(file >> next) || next < 1) {
+        error = "invalid ID mark in " + path;
+        return false;
+    }
+    observe(next - 1);
+    return true;
+}
+
+bool IdAllocator::save(const string& path, string& error) const {
+    return replaceFileAtomically(path, to_string(peekNext()) + "\n", error);
+}
+
+bool IdAllocator::persistTo(const string& path, string& error, int window) {
+    lock_guard<mutex> lock(markLock);
+    int mark = peekNext() + max(window, 0);
+    if (!replaceFileAtomically(path, to_string(mark) + "\n", error)) return false;
+    markPath = path;
+    markWindow = max(window, 0);
+    markFailing = false;
+    durableMark.store(mark, memory_order_release);
+    return true;
+}
+
+void IdAllocator::stopPersisting() {
+    lock_guard<mutex> lock(markLock);
+    markPath.clear();
+    durableMark.store(INT32_MAX, memory_order_release);
+}
+
+IdAllocator& patientIds() {
+    static IdAllocator allocator;
+    return allocator;
+}
+
+IdBlock::IdBlock(IdAllocator& allocator, int blockSize) : allocator(allocator), blockSize(blockSize) {}
+
+IdBlock::~IdBlock() {
+    allocator.release(current, end);
+}
+
+int IdBlock::next() {
+    if (current == end) {
+        current = allocator.reserve(blockSize);
+        end = current + blockSize;
+    }
+    return current++;
+}
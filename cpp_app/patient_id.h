@@ -0,0 +1,79 @@
+// Patient ID allocation
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+// Hands out patient IDs from one atomic counter, so concurrent intake never
+// sees a duplicate. IDs restored from storage are reported with observe()
+// and never handed out again.
+class IdAllocator {
+private:
+    atomic<int> nextId{1};
+
+    // IDs below durableMark are covered by the mark file of persistTo()
+    atomic<int> durableMark{INT32_MAX};
+    mutex markLock;
+    string markPath;
+    int markWindow = 0;
+    bool markFailing = false; // the last save failed and was reported
+    void coverUpTo(int end);
+
+public:
+    static const int MARK_WINDOW = 64;
+
+    int allocate();
+    // `count` consecutive IDs; returns the first. Like allocate(), the
+    // saved mark is moved past them first when persisting.
+    int reserve(int count);
+    // Give back [first, end) if nothing was allocated after it, so an
+    // unfinished block does not leave a gap
+    bool release(int first, int end);
+    // IDs up to `id` are in use
+    void observe(int id);
+    int peekNext() const;
+
+    // High-water mark file: the next unused ID, so IDs that were handed out
+    // but not kept (deleted or unsaved patients) are not reused after a
+    // restart. Written with replaceFileAtomically().
+    bool load(const string& path, string& error);
+    bool save(const string& path, string& error) const;
+
+    // Keep the mark file at `path` ahead of every ID handed out: an ID at
+    // or past the saved mark is only returned after the mark was moved
+    // `window` IDs further and saved, so even after a crash no ID is given
+    // out twice. The file is written once per `window` IDs, and a restart
+    // skips at most that many.
+    // If a save fails, it is reported once and retried a window later, so
+    // IDs keep coming; IDs handed out meanwhile are not covered.
+    bool persistTo(const string& path, string& error, int window = MARK_WINDOW);
+    void stopPersisting();
+};
+
+// The allocator used by Patient
+IdAllocator& patientIds();
+
+// A thread's private run of IDs for bulk imports: takes BLOCK_SIZE IDs at a
+// time, so importing threads touch the shared counter once per block.
+// Unused IDs go back to the allocator on destruction when possible.
+class IdBlock {
+private:
+    IdAllocator& allocator;
+    int blockSize;
+    int current = 0;
+    int end = 0;
+
+public:
+    static const int BLOCK_SIZE = 64;
+
+    explicit IdBlock(IdAllocator& allocator = patientIds(), int blockSize = BLOCK_SIZE);
+    ~IdBlock();
+
+    IdBlock(const IdBlock&) = delete;
+    IdBlock& operator=(const IdBlock&) = delete;
+
+    int next();
+};
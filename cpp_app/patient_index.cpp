@@ -0,0 +1,477 @@
+// Patient attribute indexes and query planner implementation
+#include "patient_index.h"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+
+string foldCase(const string& text) {
+    string key = text;
+    transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return tolower(c); });
+    return key;
+}
+
+void insertSorted(vector<int>& ids, int id) {
+    auto it = lower_bound(ids.begin(), ids.end(), id);
+    if (it == ids.end() || *it != id) ids.insert(it, id);
+}
+
+void eraseSorted(vector<int>& ids, int id) {
+    auto it = lower_bound(ids.begin(), ids.end(), id);
+    if (it != ids.end() && *it == id) ids.erase(it);
+}
+
+// A name and, if it has several, each of its words
+vector<string> nameKeys(const string& folded) {
+    vector<string> keys = {folded};
+    string word;
+    for (size_t i = 0; i <= folded.size(); ++i) {
+        if (i < folded.size() && folded[i] != ' ') {
+            word += folded[i];
+        } else if (!word.empty()) {
+            if (word.size() != folded.size()) keys.push_back(word);
+            word.clear();
+        }
+    }
+    return keys;
+}
+
+// Trigrams of `key` and where they start, padded so that its first and
+// last letters get trigrams of their own; key.size() + 1 of them
+vector<pair<uint32_t, int>> trigramsOf(const string& key) {
+    string padded = "\x01\x01" + key + "\x02";
+    vector<pair<uint32_t, int>> grams;
+    for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+        uint32_t gram = static_cast<uint8_t>(padded[i]) << 16 | static_cast<uint8_t>(padded[i + 1]) << 8 |
+                        static_cast<uint8_t>(padded[i + 2]);
+        grams.push_back({gram, static_cast<int>(i)});
+    }
+    return grams;
+}
+
+uint64_t trigramKey(uint32_t gram, size_t length) {
+    return uint64_t(length) << 24 | gram;
+}
+
+// Every string left after deleting up to `count` letters of `key`
+vector<string> deletionsOf(const string& key, int count) {
+    vector<string> result = {key};
+    size_t from = 0;
+    for (int round = 0; round < count; ++round) {
+        size_t to = result.size();
+        for (size_t r = from; r < to; ++r) {
+            string shorter = result[r];
+            for (size_t i = 0; i < shorter.size(); ++i) result.push_back(shorter.substr(0, i) + shorter.substr(i + 1));
+        }
+        from = to;
+    }
+    sort(result.begin(), result.end());
+    result.erase(unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+int editBound(const string& query, int maxDistance) {
+    if (maxDistance < 0) return query.size() <= 4 ? 1 : 2;
+    return min(maxDistance, NameIndex::MAX_EDITS);
+}
+
+} // namespace
+
+void IdBitmap::set(int id) {
+    if (id < 0) return;
+    size_t word = static_cast<size_t>(id) / 64;
+    if (word >= words.size()) words.resize(word + 1, 0);
+    uint64_t bit = uint64_t(1) << (id % 64);
+    if (!(words[word] & bit)) {
+        words[word] |= bit;
+        bits++;
+    }
+}
+
+void IdBitmap::reset(int id) {
+    if (!test(id)) return;
+    words[id / 64] &= ~(uint64_t(1) << (id % 64));
+    bits--;
+}
+
+bool IdBitmap::test(int id) const {
+    if (id < 0 || static_cast<size_t>(id) / 64 >= words.size()) return false;
+    return (words[id / 64] >> (id % 64)) & 1;
+}
+
+size_t IdBitmap::count() const {
+    return bits;
+}
+
+int IdBitmap::next(int afterId) const {
+    int start = afterId < 0 ? 0 : afterId + 1;
+    size_t word = static_cast<size_t>(start) / 64;
+    if (word >= words.size()) return -1;
+    // Mask off the bits at or before afterId in the first word
+    uint64_t current = words[word] & (~uint64_t(0) << (start % 64));
+    while (true) {
+        if (current) return static_cast<int>(word * 64 + countr_zero(current));
+        if (++word >= words.size()) return -1;
+        current = words[word];
+    }
+}
+
+void PatientIndex::insertEntry(int id, const Entry& entry) {
+    all.set(id);
+    insertSorted(byAge[entry.age], id);
+    byGender[entry.gender].set(id);
+    for (const auto& symptom : entry.symptoms) insertSorted(bySymptom[symptom], id);
+}
+
+void PatientIndex::eraseEntry(int id, const Entry& entry) {
+    all.reset(id);
+    auto age = byAge.find(entry.age);
+    if (age != byAge.end()) {
+        eraseSorted(age->second, id);
+        if (age->second.empty()) byAge.erase(age);
+    }
+    auto gender = byGender.find(entry.gender);
+    if (gender != byGender.end()) {
+        gender->second.reset(id);
+        if (gender->second.count() == 0) byGender.erase(gender);
+    }
+    for (const auto& symptom : entry.symptoms) {
+        auto postings = bySymptom.find(symptom);
+        if (postings == bySymptom.end()) continue;
+        eraseSorted(postings->second, id);
+        if (postings->second.empty()) bySymptom.erase(postings);
+    }
+}
+
+void PatientIndex::update(const Patient& patient) {
+    Entry entry{patient.age, foldCase(patient.gender), patient.symptoms};
+    int id = patient.getId();
+    auto it = entries.find(id);
+    if (it != entries.end()) {
+        const Entry& old = it->second;
+        if (old.age == entry.age && old.gender == entry.gender && old.symptoms == entry.symptoms) return;
+        eraseEntry(id, old);
+    }
+    insertEntry(id, entry);
+    entries[id] = entry;
+}
+
+void PatientIndex::remove(int id) {
+    auto it = entries.find(id);
+    if (it == entries.end()) return;
+    eraseEntry(id, it->second);
+    entries.erase(it);
+}
+
+void PatientIndex::clear() {
+    entries.clear();
+    all = IdBitmap();
+    byAge.clear();
+    byGender.clear();
+    bySymptom.clear();
+}
+
+size_t PatientIndex::size() const {
+    return entries.size();
+}
+
+bool PatientIndex::matches(const Entry& entry, const PatientQuery& query, const string& gender) const {
+    if (query.minAge >= 0 && entry.age < query.minAge) return false;
+    if (query.maxAge >= 0 && entry.age > query.maxAge) return false;
+    if (!gender.empty() && entry.gender != gender) return false;
+    for (const auto& symptom : query.symptoms) {
+        if (find(entry.symptoms.begin(), entry.symptoms.end(), symptom) == entry.symptoms.end()) return false;
+    }
+    return true;
+}
+
+QueryPage PatientIndex::query(const PatientQuery& query, int afterId, size_t limit) const {
+    QueryPage page;
+    if (limit == 0) return page;
+    string gender = foldCase(query.gender);
+
+    // Estimate how many IDs each filter selects and drive with the smallest
+    size_t best = all.count();
+    page.plan = "full scan";
+    function<int(int)> next = [this](int after) { return all.next(after); };
+
+    if (!gender.empty()) {
+        auto it = byGender.find(gender);
+        const IdBitmap* bitmap = it == byGender.end() ? nullptr : &it->second;
+        size_t estimate = bitmap ? bitmap->count() : 0;
+        if (estimate < best) {
+            best = estimate;
+            page.plan = "gender bitmap '" + query.gender + "'";
+            next = [bitmap](int after) { return bitmap ? bitmap->next(after) : -1; };
+        }
+    }
+
+    for (const auto& symptom : query.symptoms) {
+        auto it = bySymptom.find(symptom);
+        const vector<int>* postings = it == bySymptom.end() ? nullptr : &it->second;
+        size_t estimate = postings ? postings->size() : 0;
+        if (estimate < best) {
+            best = estimate;
+            page.plan = "symptom postings '" + symptom + "'";
+            next = [postings](int after) {
+                if (!postings) return -1;
+                auto pos = upper_bound(postings->begin(), postings->end(), after);
+                return pos == postings->end() ? -1 : *pos;
+            };
+        }
+    }
+
+    if (query.minAge >= 0 || query.maxAge >= 0) {
+        auto first = query.minAge >= 0 ? byAge.lower_bound(query.minAge) : byAge.begin();
+        auto last = query.maxAge >= 0 ? byAge.upper_bound(query.maxAge) : byAge.end();
+        size_t estimate = 0;
+        for (auto it = first; it != last && estimate < best; ++it) estimate += it->second.size();
+        if (estimate < best) {
+            best = estimate;
+            page.plan = "age range";
+            // Merge the per-age ID lists back into ID order
+            typedef pair<int, const vector<int>*> Cursor; // next ID, bucket
+            auto heap = make_shared<priority_queue<Cursor, vector<Cursor>, greater<Cursor>>>();
+            for (auto it = first; it != last; ++it) {
+                auto pos = upper_bound(it->second.begin(), it->second.end(), afterId);
+                if (pos != it->second.end()) heap->push({*pos, &it->second});
+            }
+            next = [heap](int) {
+                if (heap->empty()) return -1;
+                Cursor top = heap->top();
+                heap->pop();
+                auto pos = upper_bound(top.second->begin(), top.second->end(), top.first);
+                if (pos != top.second->end()) heap->push({*pos, top.second});
+                return top.first;
+            };
+        }
+    }
+
+    // Walk the driver in ID order, probing the other filters per candidate;
+    // one match past the page tells us there is another page
+    for (int id = next(afterId); id >= 0; id = next(id)) {
+        auto entry = entries.find(id);
+        if (entry == entries.end() || !matches(entry->second, query, gender)) continue;
+        if (page.ids.size() == limit) {
+            page.nextAfterId = page.ids.back();
+            break;
+        }
+        page.ids.push_back(id);
+    }
+    return page;
+}
+
+int boundedEditDistance(const string& a, const string& b, int maxDistance) {
+    int n = static_cast<int>(a.size());
+    int m = static_cast<int>(b.size());
+    int over = maxDistance + 1;
+    if (abs(n - m) > maxDistance) return over;
+    // Only cells with |i - j| <= maxDistance can stay within the bound
+    // (Ukkonen's band), so each row computes at most 2k + 1 of them and
+    // everything outside reads as `over`
+    vector<int> previous(m + 1, over), current(m + 1, over);
+    for (int j = 0; j <= min(m, maxDistance); ++j) previous[j] = j;
+    for (int i = 1; i <= n; ++i) {
+        int from = max(1, i - maxDistance);
+        int to = min(m, i + maxDistance);
+        current[from - 1] = from == 1 ? min(i, over) : over;
+        int rowMin = current[from - 1];
+        for (int j = from; j <= to; ++j) {
+            int substitute = previous[j - 1] + (a[i - 1] != b[j - 1]);
+            current[j] = min(min(substitute, over), min(previous[j], current[j - 1]) + 1);
+            rowMin = min(rowMin, current[j]);
+        }
+        // Distances never shrink from one row to the next
+        if (rowMin > maxDistance) return over;
+        swap(previous, current);
+    }
+    return min(previous[m], over);
+}
+
+void NameIndex::addSpellings(int id, const string& name) {
+    for (const auto& key : nameKeys(name)) {
+        auto it = spellingNumbers.find(key);
+        if (it != spellingNumbers.end()) {
+            insertSorted(spellings[it->second].ids, id);
+            continue;
+        }
+        int number;
+        if (!freeSpellings.empty()) {
+            number = freeSpellings.back();
+            freeSpellings.pop_back();
+        } else {
+            number = static_cast<int>(spellings.size());
+            spellings.push_back(Spelling());
+        }
+        spellings[number] = {key, {id}};
+        spellingNumbers[key] = number;
+        for (const auto& gram : trigramsOf(key)) {
+            vector<TrigramPosting>& postings = byTrigram[trigramKey(gram.first, key.size())];
+            auto at = upper_bound(postings.begin(), postings.end(), number,
+                                  [](int spelling, const TrigramPosting& posting) { return spelling < posting.spelling; });
+            postings.insert(at, {number, gram.second});
+        }
+        if (key.size() <= SHORT_SPELLING) {
+            for (const auto& shorter : deletionsOf(key, MAX_EDITS)) insertSorted(byDeletion[shorter], number);
+        }
+    }
+}
+
+void NameIndex::removeSpellings(int id, const string& name) {
+    for (const auto& key : nameKeys(name)) {
+        auto it = spellingNumbers.find(key);
+        if (it == spellingNumbers.end()) continue;
+        int number = it->second;
+        eraseSorted(spellings[number].ids, id);
+        if (!spellings[number].ids.empty()) continue;
+        // Last patient with this spelling is gone; free its slot
+        for (const auto& gram : trigramsOf(key)) {
+            auto postings = byTrigram.find(trigramKey(gram.first, key.size()));
+            if (postings == byTrigram.end()) continue;
+            auto first = lower_bound(postings->second.begin(), postings->second.end(), number,
+                                     [](const TrigramPosting& posting, int spelling) { return posting.spelling < spelling; });
+            auto last = first;
+            while (last != postings->second.end() && last->spelling == number) ++last;
+            postings->second.erase(first, last);
+            if (postings->second.empty()) byTrigram.erase(postings);
+        }
+        if (key.size() <= SHORT_SPELLING) {
+            for (const auto& shorter : deletionsOf(key, MAX_EDITS)) {
+                auto postings = byDeletion.find(shorter);
+                if (postings == byDeletion.end()) continue;
+                eraseSorted(postings->second, number);
+                if (postings->second.empty()) byDeletion.erase(postings);
+            }
+        }
+        spellings[number].text.clear();
+        freeSpellings.push_back(number);
+        spellingNumbers.erase(it);
+    }
+}
+
+void NameIndex::update(int id, const string& name) {
+    string key = foldCase(name);
+    auto it = names.find(id);
+    if (it != names.end()) {
+        if (it->second == key) return;
+        byName.erase({it->second, id});
+        removeSpellings(id, it->second);
+    }
+    byName.insert({key, id});
+    addSpellings(id, key);
+    names[id] = key;
+}
+
+void NameIndex::remove(int id) {
+    auto it = names.find(id);
+    if (it == names.end()) return;
+    byName.erase({it->second, id});
+    removeSpellings(id, it->second);
+    names.erase(it);
+}
+
+void NameIndex::clear() {
+    byName.clear();
+    names.clear();
+    spellings.clear();
+    freeSpellings.clear();
+    spellingNumbers.clear();
+    byTrigram.clear();
+    byDeletion.clear();
+}
+
+NamePage NameIndex::findPrefix(const string& prefix, const NameCursor& after, size_t limit) const {
+    NamePage page;
+    string key = foldCase(prefix);
+    // Everything with the prefix sorts at or after the prefix itself
+    auto it = after.id == 0 ? byName.lower_bound({key, INT_MIN}) : byName.upper_bound({after.name, after.id});
+    for (; it != byName.end() && it->first.compare(0, key.size(), key) == 0; ++it) {
+        if (page.ids.size() == limit) {
+            page.hasMore = true;
+            break;
+        }
+        page.ids.push_back(it->second);
+        page.next = {it->first, it->second};
+    }
+    return page;
+}
+
+vector<int> NameIndex::candidatesFor(const string& query, int maxDistance) const {
+    int length = static_cast<int>(query.size());
+    vector<int> candidates;
+    if (length + 1 <= 3 * maxDistance) {
+        // Too short for the trigram count: any match is a short spelling
+        // sharing one of the query's deletions
+        for (const auto& shorter : deletionsOf(query, maxDistance)) {
+            auto postings = byDeletion.find(shorter);
+            if (postings == byDeletion.end()) continue;
+            for (int number : postings->second) {
+                if (abs(static_cast<int>(spellings[number].text.size()) - length) <= maxDistance) candidates.push_back(number);
+            }
+        }
+        sort(candidates.begin(), candidates.end());
+        candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+        return candidates;
+    }
+
+    // Count the query's trigrams each spelling of a close length has
+    // within maxDistance places of the query's position
+    vector<pair<uint32_t, int>> grams = trigramsOf(query);
+    unordered_map<int, int> shared;
+    for (int other = max(0, length - maxDistance); other <= length + maxDistance; ++other) {
+        for (const auto& gram : grams) {
+            auto postings = byTrigram.find(trigramKey(gram.first, other));
+            if (postings == byTrigram.end()) continue;
+            for (const TrigramPosting& posting : postings->second) {
+                if (abs(posting.position - gram.second) <= maxDistance) shared[posting.spelling]++;
+            }
+        }
+    }
+    for (const auto& entry : shared) {
+        int longer = max(length, static_cast<int>(spellings[entry.first].text.size()));
+        if (entry.second >= longer + 1 - 3 * maxDistance) candidates.push_back(entry.first);
+    }
+    sort(candidates.begin(), candidates.end());
+    return candidates;
+}
+
+size_t NameIndex::similarCandidates(const string& name, int maxDistance) const {
+    string query = foldCase(name);
+    return candidatesFor(query, editBound(query, maxDistance)).size();
+}
+
+vector<NameMatch> NameIndex::findSimilar(const string& name, int maxDistance, size_t limit) const {
+    string query = foldCase(name);
+    maxDistance = editBound(query, maxDistance);
+    vector<int> candidates = candidatesFor(query, maxDistance);
+
+    vector<pair<int, const Spelling*>> close; // distance, spelling
+    for (int number : candidates) {
+        int distance = boundedEditDistance(query, spellings[number].text, maxDistance);
+        if (distance <= maxDistance) close.push_back({distance, &spellings[number]});
+    }
+    sort(close.begin(), close.end(), [](const pair<int, const Spelling*>& a, const pair<int, const Spelling*>& b) {
+        return a.first != b.first ? a.first < b.first : a.second->text < b.second->text;
+    });
+
+    // A patient can match through its full name and a word; the first
+    // (closest) one wins
+    vector<NameMatch> matches;
+    unordered_set<int> seen;
+    for (const auto& entry : close) {
+        for (int id : entry.second->ids) {
+            if (matches.size() == limit) return matches;
+            if (seen.insert(id).second) matches.push_back({id, entry.first});
+        }
+    }
+    return matches;
+}
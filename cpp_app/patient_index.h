@@ -0,0 +1,155 @@
+// Secondary indexes over patient attributes and a small query planner
+#pragma once
+#include "patient.h"
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// One bit per patient ID
+class IdBitmap {
+private:
+    vector<uint64_t> words;
+    size_t bits = 0;
+
+public:
+    void set(int id);
+    void reset(int id);
+    bool test(int id) const;
+    size_t count() const;
+    // Smallest set ID greater than `afterId`, or -1
+    int next(int afterId) const;
+};
+
+// Filters for PatientIndex::query; unset fields match everyone
+struct PatientQuery {
+    int minAge = -1;
+    int maxAge = -1;
+    string gender;           // case-insensitive, e.g. "f" matches "F"
+    vector<string> symptoms; // the patient must have all of them
+};
+
+struct QueryPage {
+    vector<int> ids;     // ascending
+    int nextAfterId = 0; // cursor for the next page, 0 when there is none
+    string plan;         // the index that drove the scan
+};
+
+// Age (ordered tree of buckets), gender (bitmaps) and symptom (sorted
+// posting lists) indexes keyed by patient ID. The planner estimates how
+// many IDs each filter selects, walks the smallest one in ID order and
+// probes the others, so a page costs about `limit` probes instead of a
+// scan over every patient.
+class PatientIndex {
+private:
+    struct Entry {
+        int age;
+        string gender;
+        vector<string> symptoms;
+    };
+
+    unordered_map<int, Entry> entries;
+    IdBitmap all;
+    map<int, vector<int>> byAge; // age -> sorted IDs
+    map<string, IdBitmap> byGender;
+    map<string, vector<int>> bySymptom; // symptom -> sorted IDs
+
+    void insertEntry(int id, const Entry& entry);
+    void eraseEntry(int id, const Entry& entry);
+    bool matches(const Entry& entry, const PatientQuery& query, const string& gender) const;
+
+public:
+    // Insert or re-index a patient after any change
+    void update(const Patient& patient);
+    void remove(int id);
+    void clear();
+
+    size_t size() const;
+
+    QueryPage query(const PatientQuery& query, int afterId = 0, size_t limit = 20) const;
+};
+
+// Position in a name-ordered listing; id 0 means "from the start"
+struct NameCursor {
+    string name; // case-folded
+    int id = 0;
+};
+
+struct NamePage {
+    vector<int> ids;      // in name order
+    bool hasMore = false; // if set, pass `next` to get the following page
+    NameCursor next;
+};
+
+struct NameMatch {
+    int id;
+    int distance; // edits between the query and the name (or one word of it)
+};
+
+// Patient names in case-folded sorted order for prefix search, plus two
+// filters for typo-tolerant search, so only a few names are compared in
+// full. Each edit changes at most 3 trigrams, so a name within k edits
+// of the query has all but 3k of its trigrams at most k places from where
+// the query has them; trigram lists are kept per name length, and only
+// lengths within k of the query's are counted. Queries too short for that
+// (3k letters or fewer) look up their deletion neighbourhood instead: two
+// strings within k edits become equal after deleting at most k letters
+// from each, and short names are indexed by all such deletions.
+class NameIndex {
+public:
+    static constexpr int MAX_EDITS = 2;
+
+
+private:
+    set<pair<string, int>> byName; // folded name, ID
+    unordered_map<int, string> names;
+
+    // Distinct spellings (whole names and their single words) with the
+    // patients using them. Trigram lists point at spellings, so a common
+    // surname is compared once however many patients share it.
+    struct Spelling {
+        string text;
+        vector<int> ids; // sorted; empty for a free slot
+    };
+    vector<Spelling> spellings;
+    vector<int> freeSpellings;
+    unordered_map<string, int> spellingNumbers;
+
+    struct TrigramPosting {
+        int spelling;
+        int position;
+    };
+    // Keyed by trigram and spelling length; sorted by spelling
+    unordered_map<uint64_t, vector<TrigramPosting>> byTrigram;
+    // Spellings of up to SHORT_SPELLING letters by every string left after
+    // deleting up to MAX_EDITS of their letters; sorted spelling numbers
+    static constexpr size_t SHORT_SPELLING = 4 * MAX_EDITS - 1;
+    unordered_map<string, vector<int>> byDeletion;
+
+    void addSpellings(int id, const string& name);
+    void removeSpellings(int id, const string& name);
+    // Spellings that may be within maxDistance edits of the folded query
+    vector<int> candidatesFor(const string& query, int maxDistance) const;
+
+public:
+    void update(int id, const string& name);
+    void remove(int id);
+    void clear();
+
+    // Patients whose name starts with `prefix`, ignoring case
+    NamePage findPrefix(const string& prefix, const NameCursor& after = NameCursor(), size_t limit = 20) const;
+    // Names within `maxDistance` edits of `name`, either as a whole or
+    // for one of their words, closest first. -1 picks 1 edit for names
+    // of up to 4 letters, 2 otherwise; larger values count as MAX_EDITS.
+    vector<NameMatch> findSimilar(const string& name, int maxDistance = -1, size_t limit = 20) const;
+    // Spellings findSimilar() compares in full, for tests and tuning
+    size_t similarCandidates(const string& name, int maxDistance = -1) const;
+};
+
+// Levenshtein distance, or maxDistance + 1 once it is known to be larger.
+// Takes O(maxDistance * length) time.
+int boundedEditDistance(const string& a, const string& b, int maxDistance);
@@ -1,352 +1,908 @@
-// Patient Manager implementation
-#include "patient_manager.h"
-#include <iostream>
-#include <algorithm>
-#include <limits>
-#include <fstream>
-#include <sys/stat.h>
-#include <sstream>
-void PatientManager::loadDataFromCSV() {
-    patients.clear();
-    maxId = 0;
-    // Load patients
-    ifstream pfile("data/patients.csv");
-    string line;
-    getline(pfile, line); // skip header
-    while (getline(pfile, line)) {
-        if (line.empty()) continue;
-        stringstream ss(line);
-        string idStr, name, ageStr, gender;
-        getline(ss, idStr, ',');
-        getline(ss, name, ',');
-        getline(ss, ageStr, ',');
-        getline(ss, gender, ',');
-        int id = stoi(idStr);
-        int age = stoi(ageStr);
-        Patient p(name, age, gender);
-        // Set correct ID
-        *(int*)&p = id;
-        patients.push_back(p);
-        if (id > maxId) maxId = id;
-    }
-    pfile.close();
-    // Load symptoms
-    ifstream sfile("data/symptoms.csv");
-    getline(sfile, line); // skip header
-    while (getline(sfile, line)) {
-        if (line.empty()) continue;
-        stringstream ss(line);
-        string pidStr, symptomsStr;
-        getline(ss, pidStr, ',');
-        getline(ss, symptomsStr);
-        int pid = stoi(pidStr);
-        
-        // Parse semicolon-separated symptoms
-        if (!symptomsStr.empty()) {
-            stringstream symptomStream(symptomsStr);
-            string symptom;
-            while (getline(symptomStream, symptom, ';')) {
-                for (auto& p : patients) {
-                    if (p.getId() == pid) {
-                        p.addSymptom(symptom);
-                        break;
-                    }
-                }
-            }
-        }
-    }
-    sfile.close();
-    // Update nextId
-    if (!patients.empty()) Patient::setNextId(maxId + 1);
-}
-
-void PatientManager::updatePatientSymptomsInCSV(int patientId, const vector<string>& symptoms) {
-    // Read all existing data
-    vector<string> lines;
-    ifstream inFile("data/symptoms.csv");
-    string line;
-    bool hasHeader = false;
-    
-    // Check if file exists and read header
-    if (inFile.is_open() && getline(inFile, line)) {
-        if (line == "patient_id,symptoms") {
-            hasHeader = true;
-            lines.push_back(line);
-        } else {
-            // First line is data, not header - put it back
-            inFile.seekg(0);
-        }
-    }
-    inFile.close();
-    
-    // If no header exists, add it
-    if (!hasHeader) {
-        lines.push_back("patient_id,symptoms");
-    }
-    
-    // Read existing data, skip lines for this patient
-    ifstream inFile2("data/symptoms.csv");
-    if (hasHeader) getline(inFile2, line); // skip header
-    while (getline(inFile2, line)) {
-        if (!line.empty()) {
-            stringstream ss(line);
-            string pidStr;
-            getline(ss, pidStr, ',');
-            if (stoi(pidStr) != patientId) {
-                lines.push_back(line);
-            }
-        }
-    }
-    inFile2.close();
-    
-    // Add new entry for this patient with all symptoms
-    if (!symptoms.empty()) {
-        string symptomsStr = "";
-        for (size_t i = 0; i < symptoms.size(); ++i) {
-            symptomsStr += symptoms[i];
-            if (i < symptoms.size() - 1) symptomsStr += ";";
-        }
-        lines.push_back(to_string(patientId) + "," + symptomsStr);
-    }
-    
-    // Write everything back
-    ofstream outFile("data/symptoms.csv");
-    for (const string& l : lines) {
-        outFile << l << "\n";
-    }
-    outFile.close();
-}
- #include <fstream>
-
-using namespace std;
-
-// Available symptoms in the system
-vector<string> PatientManager::getAvailableSymptoms() const {
-    return {
-        "fever", "cough", "headache", "sore throat", "runny nose",
-        "shortness of breath", "fatigue", "muscle aches", "nausea",
-        "vomiting", "diarrhea", "loss of taste", "loss of smell",
-        "chest pain", "dizziness", "rash", "joint pain", "chills"
-    };
-}
-
-// Display available symptoms
-void PatientManager::displayAvailableSymptoms() const {
-    cout << "\nAvailable Symptoms:\n";
-    auto symptoms = getAvailableSymptoms();
-    for (size_t i = 0; i < symptoms.size(); ++i) {
-        cout << (i + 1) << ". " << symptoms[i] << "\n";
-    }
-    cout << "\n";
-}
-
-// Add a new patient (interactive)
-void PatientManager::addPatient() {
-    string name, gender;
-    int age;
-
-    cout << "\n--- Add New Patient ---\n";
-    cout << "Enter patient name: ";
-    cin.ignore();
-    getline(cin, name);
-
-    cout << "Enter age: ";
-    cin >> age;
-    cin.ignore();
-
-    cout << "Enter gender (M/F/Other): ";
-    getline(cin, gender);
-
-    addPatient(name, age, gender);
-}
-
-// Add a new patient
-void PatientManager::addPatient(const string& name, int age, const string& gender) {
-    Patient newPatient(name, age, gender);
-    patients.push_back(newPatient);
-    cout << "Patient '" << name << "' added successfully with ID: " << newPatient.getId() << "\n";
-
-    // Write to CSV only one header
-    struct stat buffer;
-    bool fileExists = (stat("data/patients.csv", &buffer) == 0);
-    bool isEmpty = !fileExists || buffer.st_size == 0;
-    std::ofstream file("data/patients.csv", std::ios::app);
-    if (isEmpty) file << "id,name,age,gender\n";
-    file << newPatient.getId() << "," << newPatient.name << "," << newPatient.age << "," << newPatient.gender << "\n";
-    file.close();
-}
-
-// View all patients
-void PatientManager::viewAllPatients() const {
-    if (patients.empty()) {
-        cout << "\nNo patients found.\n";
-        return;
-    }
-
-    cout << "\n--- All Patients ---\n";
-    for (const auto& patient : patients) {
-        patient.displaySummary();
-    }
-    cout << "\nTotal patients: " << patients.size() << "\n";
-}
-
-// Find patient by ID
-Patient* PatientManager::findPatientById(int id) {
-    for (auto& patient : patients) {
-        if (patient.getId() == id) {
-            return &patient;
-        }
-    }
-    return nullptr;
-}
-
-// Delete a patient
-bool PatientManager::deletePatient(int id) {
-    auto it = remove_if(patients.begin(), patients.end(),
-        [id](const Patient& patient) { return patient.getId() == id; });
-    
-    if (it != patients.end()) {
-        patients.erase(it, patients.end());
-        cout << "Patient with ID " << id << " deleted successfully.\n";
-        return true;
-    }
-    cout << "Patient with ID " << id << " not found.\n";
-    return false;
-}
-
-// Edit patient information
-void PatientManager::editPatient(int id) {
-    Patient* patient = findPatientById(id);
-    if (!patient) {
-        cout << "Patient with ID " << id << " not found.\n";
-        return;
-    }
-
-    cout << "\n--- Edit Patient (ID: " << id << ") ---\n";
-    patient->displayInfo();
-
-    int choice;
-    cout << "\nWhat would you like to edit?\n";
-    cout << "1. Name\n";
-    cout << "2. Age\n";
-    cout << "3. Gender\n";
-    cout << "4. Cancel\n";
-    cout << "Choice: ";
-    cin >> choice;
-
-    cin.ignore();
-    switch (choice) {
-        case 1: {
-            string newName;
-            cout << "Enter new name: ";
-            getline(cin, newName);
-            patient->name = newName;
-            cout << "Name updated successfully.\n";
-            break;
-        }
-        case 2: {
-            int newAge;
-            cout << "Enter new age: ";
-            cin >> newAge;
-            patient->age = newAge;
-            cout << "Age updated successfully.\n";
-            break;
-        }
-        case 3: {
-            string newGender;
-            cout << "Enter new gender: ";
-            getline(cin, newGender);
-            patient->gender = newGender;
-            cout << "Gender updated successfully.\n";
-            break;
-        }
-        case 4:
-            cout << "Edit cancelled.\n";
-            break;
-        default:
-            cout << "Invalid choice.\n";
-    }
-}
-
-// Add symptom to a specific patient
-void PatientManager::addSymptomToPatient(int patientId) {
-    Patient* patient = findPatientById(patientId);
-    if (!patient) {
-        cout << "Patient with ID " << patientId << " not found.\n";
-        return;
-    }
-
-    displayAvailableSymptoms();
-    
-    cout << "\nEnter symptom numbers separated by spaces (e.g., 1 3 5), or 0 to cancel: ";
-    string input;
-    cin.ignore();
-    getline(cin, input);
-    
-    if (input == "0") {
-        cout << "Operation cancelled.\n";
-        return;
-    }
-
-    // Parse input to get symptom numbers
-    stringstream ss(input);
-    vector<int> choices;
-    int choice;
-    while (ss >> choice) {
-        choices.push_back(choice);
-    }
-
-    if (choices.empty()) {
-        cout << "No symptoms selected.\n";
-        return;
-    }
-
-    auto symptoms = getAvailableSymptoms();
-    vector<string> selectedSymptoms;
-    
-    for (int choice : choices) {
-        if (choice >= 1 && choice <= static_cast<int>(symptoms.size())) {
-            patient->addSymptom(symptoms[choice - 1]);
-            selectedSymptoms.push_back(symptoms[choice - 1]);
-        } else {
-            cout << "Invalid symptom number: " << choice << "\n";
-        }
-    }
-
-    if (!selectedSymptoms.empty()) {
-        // Write all symptoms for this patient to CSV (replace existing)
-        updatePatientSymptomsInCSV(patientId, patient->symptoms);
-        cout << "Added " << selectedSymptoms.size() << " symptoms successfully.\n";
-    }
-}// View symptoms for a specific patient
-void PatientManager::viewPatientSymptoms(int patientId) const {
-    auto it = find_if(patients.begin(), patients.end(),
-        [patientId](const Patient& patient) { return patient.getId() == patientId; });
-    
-    if (it != patients.end()) {
-        cout << "\n--- Symptoms for " << it->name << " (ID: " << patientId << ") ---\n";
-        it->displaySymptoms();
-    } else {
-        cout << "Patient with ID " << patientId << " not found.\n";
-    }
-}
-
-// Clear symptoms for a specific patient
-void PatientManager::clearPatientSymptoms(int patientId) {
-    Patient* patient = findPatientById(patientId);
-    if (!patient) {
-        cout << "Patient with ID " << patientId << " not found.\n";
-        return;
-    }
-    patient->clearSymptoms();
-}
-
-// Get total number of patients
-int PatientManager::getPatientCount() const {
-    return static_cast<int>(patients.size());
-}
-
-// Check if patient list is empty
-bool PatientManager::isEmpty() const {
-    return patients.empty();
-}
+// Patient Manager implementation
+#include "patient_manager.h"
+#include "atomic_file.h"
+#include "diagnosis.h"
+#include "rule_set.h"
+#include <ctime>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Loaded symptoms are added quietly, once each
+void attachSymptoms(Patient& patient, vector<string>& symptoms) {
+    for (auto& symptom : symptoms) {
+        if (find(patient.symptoms.begin(), patient.symptoms.end(), symptom) == patient.symptoms.end()) {
+            patient.symptoms.push_back(move(symptom));
+        }
+    }
+}
+
+} // namespace
+
+PatientManager::~PatientManager() {
+    waitForIndexes();
+    patientIds().stopPersisting();
+}
+
+void PatientManager::loadDataFromCSV(SymptomLoading loading) {
+    beginLoad();
+    ifstream pfile("data/patients.csv");
+    loadPatientRows(pfile);
+    ifstream sfile;
+    if (loading == EAGER) sfile.open("data/symptoms.csv");
+    loadSymptomRows(loading, sfile);
+    ifstream hfile("data/symptom_history.csv");
+    finishLoad(loading, hfile);
+}
+
+Task<void> PatientManager::loadDataFromCSVAsync(SymptomLoading loading) {
+    beginLoad();
+    // The lazy modes index symptoms.csv through a mapping instead
+    vector<string> paths = {"data/patients.csv", "data/symptom_history.csv"};
+    if (loading == EAGER) paths.push_back("data/symptoms.csv");
+    vector<string> contents;
+    string error;
+    bool read = co_await sharedStorage().readFiles(move(paths), contents, error);
+    if (!read) {
+        cout << "Error loading patients: " << error << "\n";
+        contents.assign(3, string());
+    }
+    contents.resize(3);
+    istringstream pfile(move(contents[0]));
+    loadPatientRows(pfile);
+    istringstream sfile(move(contents[2]));
+    loadSymptomRows(loading, sfile);
+    istringstream hfile(move(contents[1]));
+    finishLoad(loading, hfile);
+}
+
+void PatientManager::beginLoad() {
+    waitForIndexes();
+    // Repair whatever an interrupted write left behind before parsing
+    writer.flush();
+    string action;
+    if (!recoverFile("data/symptoms.csv", action) || !action.empty()) {
+        cout << "Data recovery: " << action << "\n";
+    }
+    for (string path : {"data/patients.csv", "data/symptom_history.csv"}) {
+        if (!repairLastLine(path, action) || !action.empty()) cout << "Data recovery: " << action << "\n";
+    }
+
+    string vocabularyError;
+    if (ifstream("data/symptom_codes.txt").good() && !loadVocabulary("data/symptom_codes.txt", vocabularyError)) {
+        cout << "Using the built-in symptoms (" << vocabularyError << ")\n";
+    }
+
+    pendingSymptoms.close();
+    patients.clear();
+    maxId = 0;
+}
+
+void PatientManager::loadPatientRows(istream& pfile) {
+    string line;
+    getline(pfile, line); // skip header
+    while (getline(pfile, line)) {
+        if (line.empty()) continue;
+        stringstream ss(line);
+        string idStr, name, ageStr, gender;
+        getline(ss, idStr, ',');
+        getline(ss, name, ',');
+        getline(ss, ageStr, ',');
+        getline(ss, gender, ',');
+        int id = stoi(idStr);
+        int age = stoi(ageStr);
+        patients.insert(Patient(id, name, age, gender));
+        if (id > maxId) maxId = id;
+    }
+}
+
+void PatientManager::loadSymptomRows(SymptomLoading loading, istream& sfile) {
+    if (loading != EAGER) {
+        // Only index the rows now; loadSymptoms() parses them on first use
+        pendingSymptoms.open("data/symptoms.csv");
+        if (loading == LAZY_WITH_WARMUP) pendingSymptoms.startWarming();
+        return;
+    }
+    string line;
+    getline(sfile, line); // skip header
+    vector<string> symptoms;
+    while (getline(sfile, line)) {
+        if (line.empty() || line == "\r") continue;
+        int pid = 0;
+        size_t begin = 0, end = 0;
+        if (!parseSymptomLine(line.data(), line.size(), pid, begin, end)) {
+            cout << "Skipping malformed line in data/symptoms.csv: " << line << "\n";
+            continue;
+        }
+        Patient* patient = patients.findMutable(pid);
+        if (!patient) continue;
+        symptoms.clear();
+        splitSymptoms(line.data() + begin, line.data() + end, symptoms);
+        attachSymptoms(*patient, symptoms);
+    }
+}
+
+void PatientManager::finishLoad(SymptomLoading loading, istream& hfile) {
+    // New patients are numbered after every stored ID and after the IDs
+    // handed out before the last shutdown
+    patientIds().observe(maxId);
+    string idError;
+    if (ifstream(ID_MARK_PATH).good() && !patientIds().load(ID_MARK_PATH, idError)) {
+        cout << "Data recovery: " << idError << "\n";
+    }
+    if (!patientIds().persistTo(ID_MARK_PATH, idError)) {
+        cout << "Could not save " << ID_MARK_PATH << ": " << idError << "\n";
+    }
+    if (loading == EAGER) {
+        rebuildIndexes();
+    } else {
+        buildIndexesInBackground();
+    }
+    loadHistory(hfile);
+}
+
+void PatientManager::loadHistory(istream& hfile) {
+    history.clear();
+    string line;
+    getline(hfile, line); // skip header
+    while (getline(hfile, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        stringstream ss(line);
+        string pidStr, timeStr, symptom, event;
+        getline(ss, pidStr, ',');
+        getline(ss, timeStr, ',');
+        getline(ss, symptom, ',');
+        getline(ss, event, ',');
+        char* idEnd = nullptr;
+        char* timeEnd = nullptr;
+        long pid = strtol(pidStr.c_str(), &idEnd, 10);
+        long long when = strtoll(timeStr.c_str(), &timeEnd, 10);
+        int index = symptomIndex(symptom);
+        if (pidStr.empty() || *idEnd != '\0' || timeStr.empty() || *timeEnd != '\0' || index < 0 ||
+            (event != "onset" && event != "resolved")) {
+            // A bad row (e.g. a hand edit) should not stop the startup
+            cout << "Skipping malformed line in data/symptom_history.csv: " << line << "\n";
+            continue;
+        }
+        history.record(static_cast<int>(pid), index, event == "onset", when);
+    }
+
+    // Patients whose symptoms are not loaded yet are checked in loadSymptoms()
+    int64_t now = time(nullptr);
+    for (const auto& patient : patients.snapshot()) {
+        if (!pendingSymptoms.has(patient.getId())) reconcileHistory(patient, now);
+    }
+}
+
+// Symptoms without history (older files, hand edits) start at `now`
+void PatientManager::reconcileHistory(const Patient& patient, int64_t now) {
+    SymptomMask recorded = history.current(patient.getId());
+    SymptomMask actual = toSymptomMask(patient.symptoms);
+    if (recorded != actual) recordSymptomChange(patient.getId(), recorded, actual, now);
+}
+
+// Attach a patient's symptoms that are still waiting in symptoms.csv
+void PatientManager::loadSymptoms(int id) {
+    if (!pendingSymptoms.has(id)) return;
+    vector<string> symptoms;
+    pendingSymptoms.take(id, symptoms);
+    Patient* patient = patients.findMutable(id);
+    if (!patient) return;
+    attachSymptoms(*patient, symptoms);
+    modified.insert(id); // re-indexed with its symptoms before the next query
+    reconcileHistory(*patient, time(nullptr));
+}
+
+void PatientManager::loadAllSymptoms() {
+    if (pendingSymptoms.pendingCount() == 0) return;
+    for (int id : pendingSymptoms.pendingIds()) loadSymptoms(id);
+}
+
+size_t PatientManager::pendingSymptomCount() const {
+    return pendingSymptoms.pendingCount();
+}
+
+void PatientManager::recordSymptomChange(int patientId, SymptomMask before, SymptomMask after, int64_t time) {
+    const vector<string>& catalog = symptomCatalog();
+    for (size_t i = 0; i < catalog.size(); ++i) {
+        SymptomMask bit = SymptomMask(1) << i;
+        if ((before & bit) == (after & bit)) continue;
+        history.record(patientId, static_cast<int>(i), (after & bit) != 0, time);
+        writer.appendHistory(patientId, time, catalog[i], (after & bit) != 0);
+    }
+}
+
+bool PatientManager::recordSymptomEvent(int patientId, const string& symptom, bool onset, int64_t time) {
+    if (recorder) recorder->record(TraceEvent::SYMPTOM_EVENT, {patientId, onset, time}, {symptom});
+    Patient* patient = findPatientById(patientId);
+    // Any vocabulary term, by name or code; it is stored by name as the
+    // symptom menus do. Only the built-in symptoms have a history.
+    int code = vocabulary.find(symptom);
+    if (!patient || code < 0) return false;
+    const string& name = vocabulary.name(static_cast<SymptomCode>(code));
+    SymptomMask before = toSymptomMask(patient->symptoms);
+    auto it = find(patient->symptoms.begin(), patient->symptoms.end(), name);
+    if (onset && it == patient->symptoms.end()) patient->symptoms.push_back(name);
+    if (!onset && it != patient->symptoms.end()) patient->symptoms.erase(it);
+    recordSymptomChange(patientId, before, toSymptomMask(patient->symptoms), time);
+    writer.updateSymptoms(patientId, patient->symptoms);
+    return true;
+}
+
+const SymptomHistory& PatientManager::getSymptomHistory() const {
+    return history;
+}
+
+vector<string> PatientManager::diagnoseAt(int patientId, int64_t time) {
+    if (recorder) recorder->record(TraceEvent::DIAGNOSE_AT, {patientId, time});
+    loadSymptoms(patientId);
+    return predictDiseases(fromSymptomMask(history.symptomsAt(patientId, time)));
+}
+
+void PatientManager::updatePatientSymptomsInCSV(int patientId, const vector<string>& symptoms) {
+    // Let queued writes land first so this synchronous rewrite wins
+    writer.flush();
+    writeSymptomUpdates("data/symptoms.csv", {{patientId, symptoms}});
+}
+
+// Wait until all queued CSV writes have reached the disk
+void PatientManager::flushPersistence() {
+    writer.flush();
+}
+
+Task<void> PatientManager::flushPersistenceAsync() {
+    co_await writer.flushed();
+}
+
+Task<int> PatientManager::addPatientAsync(string name, int age, string gender) {
+    int id = addPatient(name, age, gender);
+    co_await writer.flushed();
+    co_return id;
+}
+
+Task<bool> PatientManager::setPatientSymptomsAsync(int patientId, vector<string> symptoms, int64_t time) {
+    if (!setPatientSymptoms(patientId, symptoms, time)) co_return false;
+    co_await writer.flushed();
+    co_return true;
+}
+
+void PatientManager::rebuildIndexes() {
+    attributeIndex.clear();
+    nameIndex.clear();
+    similarity.clear();
+    modified.clear();
+    PatientSnapshot all = patients.snapshot();
+    for (const auto& patient : all) {
+        attributeIndex.update(patient);
+        nameIndex.update(patient.getId(), patient.name);
+        similarity.update(patient);
+    }
+    analytics.rebuild(all);
+}
+
+// The indexes are built from a snapshot, so the menu can appear while
+// this runs; patients loaded or edited meanwhile are in `modified`
+void PatientManager::buildIndexesInBackground() {
+    waitForIndexes();
+    attributeIndex.clear();
+    nameIndex.clear();
+    similarity.clear();
+    modified.clear();
+    PatientSnapshot all = patients.snapshot();
+    indexBuilder = thread([this, all]() {
+        for (const auto& patient : all) {
+            attributeIndex.update(patient);
+            nameIndex.update(patient.getId(), patient.name);
+            similarity.update(patient);
+        }
+        analytics.rebuild(all);
+    });
+}
+
+void PatientManager::waitForIndexes() {
+    if (indexBuilder.joinable()) indexBuilder.join();
+}
+
+// Pick up edits made through pointers from findPatientById()
+void PatientManager::refreshIndexes() {
+    waitForIndexes();
+    for (int id : modified) {
+        const Patient* patient = patients.find(id);
+        if (!patient) continue;
+        attributeIndex.update(*patient);
+        nameIndex.update(id, patient->name);
+        similarity.update(*patient);
+        analytics.update(*patient);
+    }
+    modified.clear();
+}
+
+QueryPage PatientManager::findPatients(const PatientQuery& query, int afterId, size_t limit) {
+    if (recorder) {
+        vector<string> texts = {query.gender};
+        texts.insert(texts.end(), query.symptoms.begin(), query.symptoms.end());
+        recorder->record(TraceEvent::FIND_PATIENTS, {query.minAge, query.maxAge, afterId, static_cast<int64_t>(limit)},
+                         texts);
+    }
+    if (!query.symptoms.empty()) loadAllSymptoms();
+    refreshIndexes();
+    return attributeIndex.query(query, afterId, limit);
+}
+
+vector<SimilarPatient> PatientManager::findSimilarPatients(int patientId, size_t k, SimilarityIndex::Measure measure) {
+    if (recorder) recorder->record(TraceEvent::FIND_SIMILAR_PATIENTS, {patientId, static_cast<int64_t>(k), measure});
+    if (!patients.find(patientId)) return {};
+    loadAllSymptoms();
+    refreshIndexes();
+    const Patient* patient = patients.find(patientId); // loading may have moved it
+    return similarity.nearest(toSymptomMask(patient->symptoms), k, measure, patientId);
+}
+
+const PopulationStats& PatientManager::populationStats(const RuleSet& rules) {
+    if (recorder) recorder->record(TraceEvent::POPULATION_STATS, {});
+    loadAllSymptoms();
+    refreshIndexes();
+    if (!analytics.usesRules(rules)) analytics.rebuild(patients.snapshot(), rules);
+    return analytics.stats();
+}
+
+// Most similar patients first, with the symptoms they share
+void PatientManager::viewSimilarPatients(int patientId) {
+    vector<SimilarPatient> similar = findSimilarPatients(patientId);
+    const Patient* patient = patients.find(patientId);
+    if (!patient) {
+        cout << "Patient with ID " << patientId << " not found.\n";
+        return;
+    }
+    if (similar.empty()) {
+        cout << "No other patient shares a symptom with " << patient->name << ".\n";
+        return;
+    }
+    SymptomMask own = toSymptomMask(patient->symptoms);
+    cout << "\n--- Patients Similar to " << patient->name << " (ID: " << patientId << ") ---\n";
+    for (const auto& match : similar) {
+        const Patient* other = patients.find(match.id);
+        if (!other) continue;
+        cout << other->name << " (ID: " << match.id << ") " << static_cast<int>(match.score * 100 + 0.5) << "% - shares: ";
+        vector<string> shared = fromSymptomMask(toSymptomMask(other->symptoms) & own);
+        for (size_t i = 0; i < shared.size(); ++i) cout << (i ? ", " : "") << shared[i];
+        cout << "\n";
+    }
+}
+
+// Interactive attribute search, one page of results at a time
+void PatientManager::searchPatients() {
+    PatientQuery query;
+    string input;
+
+    cout << "\n--- Find Patients ---\n";
+    cout << "Minimum age (blank for any): ";
+    cin.ignore();
+    getline(cin, input);
+    if (!input.empty()) query.minAge = atoi(input.c_str());
+    cout << "Maximum age (blank for any): ";
+    getline(cin, input);
+    if (!input.empty()) query.maxAge = atoi(input.c_str());
+    cout << "Gender (blank for any): ";
+    getline(cin, query.gender);
+
+    displayAvailableSymptoms();
+    cout << "Required symptoms: numbers separated by spaces, or names/codes separated by commas (blank for any): ";
+    getline(cin, input);
+    query.symptoms = readSymptomChoices(input);
+
+    cout << "\n--- Matching Patients ---\n";
+    int afterId = 0;
+    size_t shown = 0;
+    while (true) {
+        QueryPage page = findPatients(query, afterId, PAGE_SIZE);
+        printPatients(page.ids);
+        shown += page.ids.size();
+        if (page.nextAfterId == 0) break;
+        cout << "Press Enter for more, or q to stop: ";
+        getline(cin, input);
+        if (input == "q" || input == "Q") break;
+        afterId = page.nextAfterId;
+    }
+    if (shown == 0) {
+        cout << "No patients match.\n";
+    } else {
+        cout << "\nPatients shown: " << shown << "\n";
+    }
+}
+
+NamePage PatientManager::findPatientsByName(const string& prefix, const NameCursor& after, size_t limit) {
+    if (recorder) {
+        recorder->record(TraceEvent::FIND_BY_NAME, {after.id, static_cast<int64_t>(limit)}, {prefix, after.name});
+    }
+    refreshIndexes();
+    return nameIndex.findPrefix(prefix, after, limit);
+}
+
+vector<NameMatch> PatientManager::findSimilarNames(const string& name, size_t limit) {
+    if (recorder) recorder->record(TraceEvent::FIND_SIMILAR_NAMES, {static_cast<int64_t>(limit)}, {name});
+    refreshIndexes();
+    return nameIndex.findSimilar(name, -1, limit);
+}
+
+void PatientManager::printPatients(const vector<int>& ids) {
+    pageBuffer.clear();
+    for (int id : ids) {
+        const Patient* patient = loadedPatient(id);
+        if (patient) patient->appendSummary(pageBuffer);
+    }
+    cout.write(pageBuffer.data(), pageBuffer.size());
+    cout.flush();
+}
+
+int PatientManager::selectPatient(const string& action) {
+    // Drop the rest of the menu choice line
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    string prefix;   // empty: list everyone in ID order
+    int afterId = 0; // cursor when listing
+    NameCursor afterName;
+    bool more = true;
+    string input;
+
+    cout << "Enter patient ID to " << action << ", a name to search, or press Enter to list patients: ";
+    while (getline(cin, input)) {
+        if (!input.empty() && input.size() <= 9 && all_of(input.begin(), input.end(), ::isdigit)) {
+            int id = stoi(input);
+            return id == 0 ? -1 : id;
+        }
+
+        if (!input.empty()) {
+            prefix = input;
+            afterName = NameCursor();
+            more = true;
+        } else if (!more) {
+            // Start the listing over
+            afterId = 0;
+            afterName = NameCursor();
+            more = true;
+        }
+
+        vector<int> ids;
+        if (prefix.empty()) {
+            QueryPage page = findPatients(PatientQuery(), afterId, PAGE_SIZE);
+            ids = page.ids;
+            afterId = page.nextAfterId;
+            more = afterId != 0;
+        } else {
+            bool firstPage = afterName.id == 0;
+            NamePage page = findPatientsByName(prefix, afterName, PAGE_SIZE);
+            ids = page.ids;
+            afterName = page.next;
+            more = page.hasMore;
+            if (ids.empty() && firstPage) {
+                // Probably a typo; offer the closest names instead
+                for (const auto& match : findSimilarNames(prefix)) ids.push_back(match.id);
+                if (!ids.empty()) cout << "No names start with '" << prefix << "'. Closest matches:\n";
+            }
+        }
+
+        if (ids.empty()) cout << (prefix.empty() ? "No patients found.\n" : "No patient names match '" + prefix + "'.\n");
+        printPatients(ids);
+        cout << "Enter patient ID to " << action << ", a name to search, "
+             << (more ? "Enter for more" : "Enter to start over") << ", or 0 to cancel: ";
+    }
+    return -1;
+}
+ #include <fstream>
+
+using namespace std;
+
+// Available symptoms in the system
+vector<string> PatientManager::getAvailableSymptoms() const {
+    vector<string> symptoms;
+    symptoms.reserve(vocabulary.size());
+    for (SymptomCode code = 0; code < vocabulary.size(); ++code) symptoms.push_back(vocabulary.name(code));
+    return symptoms;
+}
+
+const SymptomVocabulary& PatientManager::getVocabulary() const {
+    return vocabulary;
+}
+
+bool PatientManager::loadVocabulary(const string& path, string& error) {
+    return SymptomVocabulary::loadFromFile(path, vocabulary, error);
+}
+
+// Display available symptoms; a large vocabulary is searched by name
+// instead of listed
+void PatientManager::displayAvailableSymptoms() const {
+    cout << "\nAvailable Symptoms:\n";
+    size_t listed = min(vocabulary.size(), symptomCatalog().size());
+    for (SymptomCode code = 0; code < listed; ++code) {
+        cout << (code + 1) << ". " << vocabulary.name(code);
+        if (!vocabulary.externalCode(code).empty()) cout << " [" << vocabulary.externalCode(code) << "]";
+        cout << "\n";
+    }
+    if (vocabulary.size() > listed) {
+        cout << "... and " << (vocabulary.size() - listed) << " coded symptoms, entered by name or code\n";
+    }
+    cout << "\n";
+}
+
+vector<string> PatientManager::readSymptomChoices(const string& input) const {
+    vector<string> chosen;
+    auto choose = [this, &chosen](const string& item) {
+        if (item.find_first_not_of("0123456789") == string::npos) {
+            int number = atoi(item.c_str());
+            if (number >= 1 && number <= static_cast<int>(vocabulary.size())) {
+                chosen.push_back(vocabulary.name(number - 1));
+            } else {
+                cout << "Invalid symptom number: " << number << "\n";
+            }
+            return;
+        }
+        int code = vocabulary.find(item);
+        if (code >= 0) {
+            chosen.push_back(vocabulary.name(code));
+            return;
+        }
+        cout << "Unknown symptom: " << item << "\n";
+        vector<SymptomCode> suggestions = vocabulary.withPrefix(item, 5);
+        for (size_t i = 0; i < suggestions.size(); ++i) {
+            cout << (i ? ", " : "  Did you mean: ") << vocabulary.name(suggestions[i]);
+        }
+        if (!suggestions.empty()) cout << "\n";
+    };
+
+    string item;
+    if (input.find_first_not_of("0123456789 ") == string::npos) {
+        stringstream numbers(input);
+        while (numbers >> item) choose(item);
+        return chosen;
+    }
+    stringstream items(input);
+    while (getline(items, item, ',')) {
+        size_t start = item.find_first_not_of(" \t");
+        if (start == string::npos) continue;
+        item = item.substr(start, item.find_last_not_of(" \t") - start + 1);
+        choose(item);
+    }
+    return chosen;
+}
+
+// Add a new patient (interactive)
+void PatientManager::addPatient() {
+    string name, gender;
+    int age;
+
+    cout << "\n--- Add New Patient ---\n";
+    cout << "Enter patient name: ";
+    cin.ignore();
+    getline(cin, name);
+
+    cout << "Enter age: ";
+    cin >> age;
+    cin.ignore();
+
+    cout << "Enter gender (M/F/Other): ";
+    getline(cin, gender);
+
+    addPatient(name, age, gender);
+}
+
+// Add a new patient
+int PatientManager::addPatient(const string& name, int age, const string& gender) {
+    Patient newPatient(name, age, gender);
+    insertNewPatient(newPatient);
+    cout << "Patient '" << name << "' added successfully with ID: " << newPatient.getId() << "\n";
+    return newPatient.getId();
+}
+
+int PatientManager::importPatients(const string& path, string& error) {
+    ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return -1;
+    }
+    // One reservation per 64 rows instead of one per patient
+    IdBlock ids;
+    int added = 0;
+    string line;
+    getline(file, line); // skip header
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        stringstream ss(line);
+        string name, ageStr, gender;
+        getline(ss, name, ',');
+        getline(ss, ageStr, ',');
+        getline(ss, gender, ',');
+        char* ageEnd = nullptr;
+        long age = strtol(ageStr.c_str(), &ageEnd, 10);
+        if (name.empty() || ageStr.empty() || *ageEnd != '\0' || age < 0 || age > 200 || gender.empty()) {
+            cout << "Skipping malformed line in " << path << ": " << line << "\n";
+            continue;
+        }
+        insertNewPatient(Patient(ids.next(), name, static_cast<int>(age), gender));
+        added++;
+    }
+    return added;
+}
+
+void PatientManager::insertNewPatient(const Patient& patient) {
+    if (recorder) recorder->record(TraceEvent::ADD_PATIENT, {patient.getId(), patient.age}, {patient.name, patient.gender});
+    patients.insert(patient);
+    waitForIndexes();
+    attributeIndex.update(patient);
+    nameIndex.update(patient.getId(), patient.name);
+    similarity.update(patient);
+    analytics.update(patient);
+
+    // Appended to patients.csv by the background writer
+    writer.appendPatient(patient.getId(), patient.name, patient.age, patient.gender);
+}
+
+// View all patients, one page at a time
+void PatientManager::viewAllPatients() {
+    if (patients.empty()) {
+        cout << "\nNo patients found.\n";
+        return;
+    }
+
+    cout << "\n--- All Patients ---\n";
+    // The ID bitmap is kept exact on add/delete, so an unfiltered query
+    // needs no refresh of edited patients
+    waitForIndexes();
+    QueryPage page = attributeIndex.query(PatientQuery(), 0, PAGE_SIZE);
+    printPatients(page.ids);
+    if (page.nextAfterId != 0) cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    while (page.nextAfterId != 0) {
+        cout << "Press Enter for more, or q to stop: ";
+        string input;
+        if (!getline(cin, input) || input == "q" || input == "Q") break;
+        page = attributeIndex.query(PatientQuery(), page.nextAfterId, PAGE_SIZE);
+        printPatients(page.ids);
+    }
+    cout << "\nTotal patients: " << patients.size() << "\n";
+}
+
+// Find patient by ID
+Patient* PatientManager::findPatientById(int id) {
+    loadSymptoms(id);
+    Patient* patient = patients.findMutable(id);
+    if (patient) modified.insert(id);
+    return patient;
+}
+
+const Patient* PatientManager::loadedPatient(int id) {
+    loadSymptoms(id);
+    return patients.find(id);
+}
+
+// Delete a patient
+bool PatientManager::deletePatient(int id) {
+    if (recorder) recorder->record(TraceEvent::DELETE_PATIENT, {id});
+    vector<string> unloaded;
+    pendingSymptoms.take(id, unloaded);
+    if (patients.erase(id)) {
+        waitForIndexes();
+        attributeIndex.remove(id);
+        nameIndex.remove(id);
+        similarity.remove(id);
+        analytics.remove(id);
+        modified.erase(id);
+        cout << "Patient with ID " << id << " deleted successfully.\n";
+        return true;
+    }
+    cout << "Patient with ID " << id << " not found.\n";
+    return false;
+}
+
+// Edit patient information
+void PatientManager::editPatient(int id) {
+    Patient* patient = findPatientById(id);
+    if (!patient) {
+        cout << "Patient with ID " << id << " not found.\n";
+        return;
+    }
+
+    cout << "\n--- Edit Patient (ID: " << id << ") ---\n";
+    patient->displayInfo();
+
+    int choice;
+    cout << "\nWhat would you like to edit?\n";
+    cout << "1. Name\n";
+    cout << "2. Age\n";
+    cout << "3. Gender\n";
+    cout << "4. Cancel\n";
+    cout << "Choice: ";
+    cin >> choice;
+
+    cin.ignore();
+    string name = patient->name, gender = patient->gender;
+    int age = patient->age;
+    switch (choice) {
+        case 1: {
+            cout << "Enter new name: ";
+            getline(cin, name);
+            updatePatient(id, name, age, gender);
+            cout << "Name updated successfully.\n";
+            break;
+        }
+        case 2: {
+            cout << "Enter new age: ";
+            cin >> age;
+            updatePatient(id, name, age, gender);
+            cout << "Age updated successfully.\n";
+            break;
+        }
+        case 3: {
+            cout << "Enter new gender: ";
+            getline(cin, gender);
+            updatePatient(id, name, age, gender);
+            cout << "Gender updated successfully.\n";
+            break;
+        }
+        case 4:
+            cout << "Edit cancelled.\n";
+            return;
+        default:
+            cout << "Invalid choice.\n";
+            return;
+    }
+}
+
+bool PatientManager::updatePatient(int id, const string& name, int age, const string& gender) {
+    loadSymptoms(id);
+    Patient* patient = patients.findMutable(id);
+    if (!patient) return false;
+    if (recorder) recorder->record(TraceEvent::EDIT_PATIENT, {id, age}, {name, gender});
+    patient->name = name;
+    patient->age = age;
+    patient->gender = gender;
+    waitForIndexes();
+    attributeIndex.update(*patient);
+    nameIndex.update(id, patient->name);
+    analytics.update(*patient);
+    writer.appendPatient(id, name, age, gender);
+    return true;
+}
+
+// Add symptom to a specific patient
+void PatientManager::addSymptomToPatient(int patientId) {
+    Patient* patient = findPatientById(patientId);
+    if (!patient) {
+        cout << "Patient with ID " << patientId << " not found.\n";
+        return;
+    }
+
+    displayAvailableSymptoms();
+    
+    cout << "\nEnter symptom numbers separated by spaces (e.g., 1 3 5),\n"
+         << "or symptom names or codes separated by commas (e.g., fever, R05), or 0 to cancel: ";
+    string input;
+    getline(cin >> ws, input);
+    
+    if (input == "0") {
+        cout << "Operation cancelled.\n";
+        return;
+    }
+
+    vector<string> selectedSymptoms = readSymptomChoices(input);
+    if (selectedSymptoms.empty()) {
+        cout << "No symptoms selected.\n";
+        return;
+    }
+
+    SymptomMask before = toSymptomMask(patient->symptoms);
+    for (const auto& symptom : selectedSymptoms) patient->addSymptom(symptom);
+    symptomsChanged(*patient, before, time(nullptr));
+    cout << "Added " << selectedSymptoms.size() << " symptoms successfully.\n";
+}// View symptoms for a specific patient
+void PatientManager::viewPatientSymptoms(int patientId) {
+    const Patient* patient = loadedPatient(patientId);
+    if (patient) {
+        cout << "\n--- Symptoms for " << patient->name << " (ID: " << patientId << ") ---\n";
+        patient->displaySymptoms();
+        int64_t now = time(nullptr);
+        for (const auto& symptom : patient->symptoms) {
+            int64_t duration = history.presentFor(patientId, symptomIndex(symptom), now);
+            if (duration > 0) cout << "  " << symptom << ": present for " << describeDuration(duration) << "\n";
+        }
+    } else {
+        cout << "Patient with ID " << patientId << " not found.\n";
+    }
+}
+
+// Clear symptoms for a specific patient
+void PatientManager::clearPatientSymptoms(int patientId) {
+    Patient* patient = findPatientById(patientId);
+    if (!patient) {
+        cout << "Patient with ID " << patientId << " not found.\n";
+        return;
+    }
+    SymptomMask before = toSymptomMask(patient->symptoms);
+    patient->clearSymptoms();
+    symptomsChanged(*patient, before, time(nullptr));
+}
+
+bool PatientManager::setPatientSymptoms(int patientId, const vector<string>& symptoms, int64_t time) {
+    Patient* patient = findPatientById(patientId);
+    if (!patient) return false;
+    SymptomMask before = toSymptomMask(patient->symptoms);
+    patient->symptoms = symptoms;
+    symptomsChanged(*patient, before, time);
+    return true;
+}
+
+void PatientManager::symptomsChanged(const Patient& patient, SymptomMask before, int64_t time) {
+    if (recorder) recorder->record(TraceEvent::SET_SYMPTOMS, {patient.getId(), time}, patient.symptoms);
+    // Queue a rewrite of this patient's symptoms (replace existing)
+    writer.updateSymptoms(patient.getId(), patient.symptoms);
+    recordSymptomChange(patient.getId(), before, toSymptomMask(patient.symptoms), time);
+}
+
+void PatientManager::startRecording(WorkloadRecorder* target) {
+    for (const auto& patient : snapshot()) {
+        vector<string> texts = {patient.name, patient.gender};
+        texts.insert(texts.end(), patient.symptoms.begin(), patient.symptoms.end());
+        target->record(TraceEvent::PATIENT, {patient.getId(), patient.age}, texts);
+    }
+    recorder = target;
+}
+
+void PatientManager::stopRecording() {
+    recorder = nullptr;
+}
+
+WorkloadRecorder* PatientManager::getRecorder() const {
+    return recorder;
+}
+
+PatientSnapshot PatientManager::snapshot() {
+    loadAllSymptoms();
+    return patients.snapshot();
+}
+
+vector<Patient> PatientManager::samplePatients(size_t limit) {
+    vector<int> ids;
+    {
+        PatientSnapshot all = patients.snapshot();
+        if (all.empty() || limit == 0) return {};
+        if (all.size() <= limit) {
+            for (const auto& patient : all) ids.push_back(patient.getId());
+        } else {
+            int64_t first = all.begin()->getId();
+            int64_t span = int64_t(all.back().getId()) - first + 1;
+            for (size_t i = 0; i < limit; ++i) {
+                auto it = all.from(static_cast<int>(first + span * int64_t(i) / int64_t(limit)));
+                if (it != all.end() && (ids.empty() || it->getId() != ids.back())) ids.push_back(it->getId());
+            }
+        }
+    } // released before loading, so the rows are not copied
+    vector<Patient> sample;
+    sample.reserve(ids.size());
+    for (int id : ids) {
+        loadSymptoms(id);
+        if (const Patient* patient = patients.find(id)) sample.push_back(*patient);
+    }
+    return sample;
+}
+
+// Read-only access to every patient, e.g. for statistics
+PatientSnapshot PatientManager::getAllPatients() {
+    return snapshot();
+}
+
+// Get total number of patients
+int PatientManager::getPatientCount() const {
+    return static_cast<int>(patients.size());
+}
+
+// Check if patient list is empty
+bool PatientManager::isEmpty() const {
+    return patients.empty();
+}
@@ -1,37 +1,198 @@
-// Patient Manager class for handling multiple patients
-#pragma once
-#include "patient.h"
-#include <vector>
-#include <string>
-
-using namespace std;
-
-class PatientManager {
-private:
-    vector<Patient> patients;
-    int maxId = 0;
-
-public:
-    // Patient CRUD operations
-    void addPatient();
-    void addPatient(const string& name, int age, const string& gender);
-    void viewAllPatients() const;
-    Patient* findPatientById(int id);
-    bool deletePatient(int id);
-    void editPatient(int id);
-
-    // Symptom management for patients
-    void addSymptomToPatient(int patientId);
-    void viewPatientSymptoms(int patientId) const;
-    void clearPatientSymptoms(int patientId);
-
-    // Available symptoms list
-    void displayAvailableSymptoms() const;
-    vector<string> getAvailableSymptoms() const;
-    void loadDataFromCSV();
-    void updatePatientSymptomsInCSV(int patientId, const vector<string>& symptoms);
-
-    // Utility methods
-    int getPatientCount() const;
-    bool isEmpty() const;
-};
+// Patient Manager class for handling multiple patients
+#pragma once
+#include "async_storage.h"
+#include "patient.h"
+#include "patient_id.h"
+#include "patient_index.h"
+#include "patient_similarity.h"
+#include "population_analytics.h"
+#include "patient_store.h"
+#include "persistence_writer.h"
+#include "symptom_history.h"
+#include "symptom_loader.h"
+#include "symptom_vocabulary.h"
+#include "workload_trace.h"
+#include <vector>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+using namespace std;
+
+class PatientManager {
+private:
+    // Patients by ID; snapshot() shares it instead of copying
+    PatientStore patients;
+    int maxId = 0;
+    PersistenceWriter writer;
+
+    // Patient IDs handed out so far, kept across restarts; once loaded,
+    // saved ahead of use by patientIds().persistTo()
+    static constexpr const char* ID_MARK_PATH = "data/next_id.txt";
+
+    // Age/gender/symptom indexes used by findPatients()
+    PatientIndex attributeIndex;
+    // Patients handed out through findPatientById() since the last query;
+    // re-indexed before the next one, since callers may have edited them
+    unordered_set<int> modified;
+    NameIndex nameIndex;
+    SimilarityIndex similarity;
+    PopulationAnalytics analytics;
+
+    // Pages are formatted here and written with a single flush; the
+    // buffer is reused so rendering a page does not allocate per line
+    string pageBuffer;
+    void printPatients(const vector<int>& ids);
+
+    // Onset/resolution events, mirrored to data/symptom_history.csv
+    SymptomHistory history;
+    void recordSymptomChange(int patientId, SymptomMask before, SymptomMask after, int64_t time);
+    // Save, record history and trace after a patient's symptoms changed
+    void symptomsChanged(const Patient& patient, SymptomMask before, int64_t time);
+    void loadHistory(istream& hfile);
+    void reconcileHistory(const Patient& patient, int64_t now);
+
+    // Rows of symptoms.csv not attached to their patient yet (lazy loading).
+    // Attaching them edits the store, so every method that may load one
+    // is non-const; const methods never change the manager.
+    SymptomLoader pendingSymptoms;
+    void loadSymptoms(int id);
+    void loadAllSymptoms();
+    // The patient with its symptoms loaded, without marking it modified
+    const Patient* loadedPatient(int id);
+
+    // Symptoms that can be recorded: the built-in ones plus, when
+    // data/symptom_codes.txt exists, a coded vocabulary
+    SymptomVocabulary vocabulary;
+    // "1 3 5" picks from the numbered list; otherwise comma-separated
+    // names or codes
+    vector<string> readSymptomChoices(const string& input) const;
+
+    // Store, index, trace and save a patient that has just got its ID
+    void insertNewPatient(const Patient& patient);
+
+    void rebuildIndexes();
+    void refreshIndexes();
+    // Lazy loading builds the indexes on this thread; joined before use
+    thread indexBuilder;
+    void buildIndexesInBackground();
+    void waitForIndexes();
+
+    // Where operations are traced while recording; null otherwise
+    WorkloadRecorder* recorder = nullptr;
+
+public:
+    static const size_t PAGE_SIZE = 20;
+
+    // How loadDataFromCSV() reads symptoms.csv. The lazy modes index the
+    // rows and parse a patient's symptoms when the patient is first used,
+    // and build the search indexes on a background thread;
+    // LAZY_WITH_WARMUP also parses the remaining symptoms in the background.
+    enum SymptomLoading { EAGER, LAZY, LAZY_WITH_WARMUP };
+
+private:
+    // The steps of loadDataFromCSV(), shared with loadDataFromCSVAsync()
+    void beginLoad();
+    void loadPatientRows(istream& pfile);
+    void loadSymptomRows(SymptomLoading loading, istream& sfile);
+    void finishLoad(SymptomLoading loading, istream& hfile);
+
+public:
+    ~PatientManager();
+
+    // Patient CRUD operations
+    void addPatient();
+    int addPatient(const string& name, int age, const string& gender); // returns the new ID
+    // Add every "name,age,gender" row after the header of a CSV file as a
+    // new patient, numbered from one IdBlock. Returns how many were added,
+    // or -1 with `error` set if the file cannot be read.
+    int importPatients(const string& path, string& error);
+    void viewAllPatients(); // one page at a time
+    Patient* findPatientById(int id);
+    bool deletePatient(int id);
+    void editPatient(int id);
+    // Change a patient's details in the store and the indexes, and append
+    // the new row to patients.csv (on load a later row for an ID wins)
+    bool updatePatient(int id, const string& name, int age, const string& gender);
+
+    // Symptom management for patients
+    void addSymptomToPatient(int patientId);
+    void viewPatientSymptoms(int patientId);
+    void clearPatientSymptoms(int patientId);
+    // Replace a patient's symptoms, as the two menu actions above do
+    bool setPatientSymptoms(int patientId, const vector<string>& symptoms, int64_t time);
+
+    // Symptom history. recordSymptomEvent also updates the current
+    // symptoms and accepts any vocabulary term, but only the built-in
+    // symptoms are kept in the history; an event older than the patient's
+    // latest one is recorded at that latest time, since the history is
+    // append-only.
+    bool recordSymptomEvent(int patientId, const string& symptom, bool onset, int64_t time);
+    const SymptomHistory& getSymptomHistory() const;
+    // predictDiseases() on the symptoms the patient had at `time`
+    vector<string> diagnoseAt(int patientId, int64_t time);
+
+    // Available symptoms list
+    void displayAvailableSymptoms() const;
+    vector<string> getAvailableSymptoms() const; // every vocabulary term, by code
+    const SymptomVocabulary& getVocabulary() const;
+    // Replace the vocabulary with a code table (see SymptomVocabulary::parse);
+    // loadDataFromCSV() does this with data/symptom_codes.txt if present
+    bool loadVocabulary(const string& path, string& error);
+    void loadDataFromCSV(SymptomLoading loading = EAGER);
+    size_t pendingSymptomCount() const; // patients whose symptoms are not loaded yet
+    void updatePatientSymptomsInCSV(int patientId, const vector<string>& symptoms);
+    void flushPersistence();
+
+    // Awaitable versions, for overlapping the disk with other work such as
+    // diagnosis. Started tasks own the manager until they finish: the load
+    // reads the three files through sharedStorage() and parses them on its
+    // worker threads. The add and the symptom change are made in memory
+    // when the task starts, and the task finishes once they are on disk.
+    Task<void> loadDataFromCSVAsync(SymptomLoading loading = EAGER);
+    Task<int> addPatientAsync(string name, int age, string gender);
+    Task<bool> setPatientSymptomsAsync(int patientId, vector<string> symptoms, int64_t time);
+    Task<void> flushPersistenceAsync();
+
+    // Attribute queries, e.g. "age 60-80, gender F, with fever", one page
+    // at a time; pass the returned nextAfterId to get the following page
+    QueryPage findPatients(const PatientQuery& query, int afterId = 0, size_t limit = 20);
+    void searchPatients();
+
+    // Name prefix search, ignoring case, in name order
+    NamePage findPatientsByName(const string& prefix, const NameCursor& after = NameCursor(), size_t limit = PAGE_SIZE);
+    // Typo-tolerant name search, closest first
+    vector<NameMatch> findSimilarNames(const string& name, size_t limit = PAGE_SIZE);
+    // The k patients whose symptoms are most like this patient's, most
+    // similar first; empty if the patient has no symptoms
+    vector<SimilarPatient> findSimilarPatients(int patientId, size_t k = PAGE_SIZE,
+                                               SimilarityIndex::Measure measure = SimilarityIndex::JACCARD);
+    void viewSimilarPatients(int patientId);
+
+    // Symptom co-occurrence and disease prevalence over every patient,
+    // with diseases predicted by `rules`. Kept up to date as patients
+    // change; recomputed only when the rules differ from the last call.
+    const PopulationStats& populationStats(const RuleSet& rules);
+
+    // Ask for a patient ID; the user can also search by name or page
+    // through the list first. Returns -1 if they cancel.
+    int selectPatient(const string& action);
+
+    // Frozen view of every patient in ID order, for reports that must not
+    // see later edits; taking one is O(1) and the manager stays writable
+    PatientSnapshot snapshot();
+    // Up to `limit` patients spread evenly over the IDs, with their
+    // symptoms; unlike snapshot() only these patients' rows are loaded
+    vector<Patient> samplePatients(size_t limit);
+
+    // Trace patient operations to `recorder`, starting with the current
+    // patients, until stopRecording(); see workload_trace.h
+    void startRecording(WorkloadRecorder* recorder);
+    void stopRecording();
+    WorkloadRecorder* getRecorder() const;
+
+    // Utility methods
+    PatientSnapshot getAllPatients(); // same as snapshot()
+    int getPatientCount() const;
+    bool isEmpty() const;
+};
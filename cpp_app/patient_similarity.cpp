@@ -0,0 +1,240 @@
+// Similar-patient search implementation
+#include "patient_similarity.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+const size_t BLOCK = 1024;
+
+// Branch-free, so the block loop below vectorizes
+inline uint32_t bitCount(uint32_t v) {
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    v = (v + (v >> 4)) & 0x0F0F0F0F;
+    return (v * 0x01010101) >> 24;
+}
+
+void weightsFor(const size_t prevalence[32], size_t patients, float weights[32]) {
+    for (int bit = 0; bit < 32; ++bit) {
+        weights[bit] = static_cast<float>(log((patients + 1.0) / (prevalence[bit] + 1.0)));
+    }
+}
+
+// Sum of symptom weights of a mask, one table per byte
+struct WeightTables {
+    float byByte[4][256];
+
+    explicit WeightTables(const float weights[32]) {
+        for (int b = 0; b < 4; ++b) {
+            for (int value = 0; value < 256; ++value) {
+                float sum = 0;
+                for (int bit = 0; bit < 8; ++bit) {
+                    if (value & (1 << bit)) sum += weights[b * 8 + bit];
+                }
+                byByte[b][value] = sum;
+            }
+        }
+    }
+
+    float operator()(SymptomMask mask) const {
+        return (byByte[0][mask & 0xFF] + byByte[1][(mask >> 8) & 0xFF]) +
+               (byByte[2][(mask >> 16) & 0xFF] + byByte[3][mask >> 24]);
+    }
+};
+
+// Both search paths score through this, so they agree to the last bit
+class Scorer {
+private:
+    SymptomMask query;
+    bool weighted;
+    WeightTables tables;
+
+public:
+    Scorer(SymptomMask query, SimilarityIndex::Measure measure, const float weights[32])
+        : query(query), weighted(measure == SimilarityIndex::WEIGHTED), tables(weights) {}
+
+    float operator()(SymptomMask mask) const {
+        if (weighted) {
+            float either = tables(mask | query);
+            return either > 0 ? tables(mask & query) / either : 0.0f;
+        }
+        return float(bitCount(mask & query)) / float(max(bitCount(mask | query), 1u));
+    }
+
+    // scores[j] for a whole block of masks. The Jaccard loop has no
+    // branches or lookups and a fixed trip count, so it compiles to SIMD
+    // code even at -O2.
+    void scoreBlock(const SymptomMask* masks, float* scores) const {
+        if (weighted) {
+            for (size_t j = 0; j < BLOCK; ++j) scores[j] = (*this)(masks[j]);
+            return;
+        }
+        for (size_t j = 0; j < BLOCK; ++j) {
+            uint32_t shared = bitCount(masks[j] & query);
+            uint32_t either = bitCount(masks[j] | query);
+            scores[j] = float(shared) / float(max(either, 1u));
+        }
+    }
+};
+
+bool better(const SimilarPatient& a, const SimilarPatient& b) {
+    return a.score != b.score ? a.score > b.score : a.id < b.id;
+}
+
+// The k best seen so far; the worst of them is at the front
+class TopK {
+private:
+    size_t k;
+    vector<SimilarPatient> heap;
+
+public:
+    explicit TopK(size_t k) : k(k) { heap.reserve(k); }
+
+    // Candidates must score above this to get in; sharing no symptom at
+    // all never counts as similar
+    float threshold() const { return heap.size() < k ? 0.0f : heap.front().score; }
+
+    void offer(int id, float score) {
+        SimilarPatient candidate{id, score};
+        if (heap.size() < k) {
+            heap.push_back(candidate);
+            push_heap(heap.begin(), heap.end(), better);
+        } else if (k > 0 && better(candidate, heap.front())) {
+            pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = candidate;
+            push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+
+    vector<SimilarPatient> take() {
+        sort(heap.begin(), heap.end(), better);
+        return move(heap);
+    }
+};
+
+} // namespace
+
+void SimilarityIndex::addToGroup(int id, SymptomMask mask) {
+    vector<int>& group = groups[mask];
+    group.insert(lower_bound(group.begin(), group.end(), id), id);
+    for (SymptomMask bits = mask; bits != 0; bits &= bits - 1) prevalence[countr_zero(bits)]++;
+}
+
+void SimilarityIndex::removeFromGroup(int id, SymptomMask mask) {
+    auto found = groups.find(mask);
+    if (found == groups.end()) return;
+    vector<int>& group = found->second;
+    auto position = lower_bound(group.begin(), group.end(), id);
+    if (position == group.end() || *position != id) return;
+    group.erase(position);
+    if (group.empty()) groups.erase(found);
+    for (SymptomMask bits = mask; bits != 0; bits &= bits - 1) prevalence[countr_zero(bits)]--;
+}
+
+void SimilarityIndex::update(int id, SymptomMask symptoms) {
+    // New patients have the highest ID, so this is normally an append
+    auto position = lower_bound(ids.begin(), ids.end(), id);
+    size_t i = position - ids.begin();
+    if (position != ids.end() && *position == id) {
+        if (masks[i] == symptoms) return;
+        removeFromGroup(id, masks[i]);
+        masks[i] = symptoms;
+    } else {
+        ids.insert(position, id);
+        masks.insert(masks.begin() + i, symptoms);
+    }
+    addToGroup(id, symptoms);
+}
+
+void SimilarityIndex::update(const Patient& patient) {
+    update(patient.getId(), toSymptomMask(patient.symptoms));
+}
+
+void SimilarityIndex::remove(int id) {
+    auto position = lower_bound(ids.begin(), ids.end(), id);
+    if (position == ids.end() || *position != id) return;
+    size_t i = position - ids.begin();
+    removeFromGroup(id, masks[i]);
+    ids.erase(position);
+    masks.erase(masks.begin() + i);
+}
+
+void SimilarityIndex::clear() {
+    ids.clear();
+    masks.clear();
+    groups.clear();
+    fill(begin(prevalence), end(prevalence), 0);
+}
+
+size_t SimilarityIndex::size() const {
+    return ids.size();
+}
+
+size_t SimilarityIndex::distinctSets() const {
+    return groups.size();
+}
+
+vector<SimilarPatient> SimilarityIndex::scan(SymptomMask query, size_t k, Measure measure, int excludeId) const {
+    float weights[32];
+    weightsFor(prevalence, ids.size(), weights);
+    Scorer scorer(query, measure, weights);
+    TopK best(k);
+    float scores[BLOCK];
+    SymptomMask tail[BLOCK] = {};
+    for (size_t start = 0; start < ids.size(); start += BLOCK) {
+        size_t count = min(BLOCK, ids.size() - start);
+        const SymptomMask* block = masks.data() + start;
+        if (count < BLOCK) {
+            copy(block, block + count, tail);
+            block = tail;
+        }
+        scorer.scoreBlock(block, scores);
+        // IDs ascend, so a later patient with an equal score never displaces one
+        float threshold = best.threshold();
+        for (size_t j = 0; j < count; ++j) {
+            if (scores[j] <= threshold || ids[start + j] == excludeId) continue;
+            best.offer(ids[start + j], scores[j]);
+            threshold = best.threshold();
+        }
+    }
+    return best.take();
+}
+
+vector<SimilarPatient> SimilarityIndex::nearest(SymptomMask query, size_t k, Measure measure, int excludeId) const {
+    float weights[32];
+    weightsFor(prevalence, ids.size(), weights);
+    Scorer scorer(query, measure, weights);
+    vector<pair<float, const vector<int>*>> scored;
+    scored.reserve(groups.size());
+    for (const auto& group : groups) scored.push_back({scorer(group.first), &group.second});
+    sort(scored.begin(), scored.end(),
+         [](const pair<float, const vector<int>*>& a, const pair<float, const vector<int>*>& b) {
+             return a.first > b.first;
+         });
+
+    // Take whole score levels while they fit; the level that does not fit
+    // is cut by ID, as the scan would
+    vector<SimilarPatient> result;
+    vector<int> level;
+    for (size_t i = 0; i < scored.size() && scored[i].first > 0 && result.size() < k;) {
+        float score = scored[i].first;
+        level.clear();
+        for (; i < scored.size() && scored[i].first == score; ++i) {
+            for (int id : *scored[i].second) {
+                if (id != excludeId) level.push_back(id);
+            }
+        }
+        size_t wanted = min(level.size(), k - result.size());
+        if (wanted < level.size()) {
+            nth_element(level.begin(), level.begin() + wanted, level.end());
+            level.resize(wanted);
+        }
+        for (int id : level) result.push_back({id, score});
+    }
+    sort(result.begin(), result.end(), better);
+    return result;
+}
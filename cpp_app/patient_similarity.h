@@ -0,0 +1,54 @@
+// Nearest-neighbour search over the patients' symptom sets
+#pragma once
+#include "patient.h"
+#include "rule_set.h"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct SimilarPatient {
+    int id;
+    float score; // 0 (nothing shared) to 1 (same symptoms)
+};
+
+// Keeps every patient's symptom set twice: as ID-ordered columns for a
+// full scan, and grouped by identical set. Since the catalog is small,
+// many patients share a set, so nearest() scores each distinct set once
+// and is independent of the number of patients; scan() is the plain
+// scan it must agree with.
+class SimilarityIndex {
+public:
+    // JACCARD: shared symptoms / symptoms either patient has.
+    // WEIGHTED: the same with each symptom weighted by how rare it is,
+    // log((patients + 1) / (patients with it + 1)), so sharing a rare
+    // symptom counts for more than sharing a common one.
+    enum Measure { JACCARD, WEIGHTED };
+
+private:
+    vector<int> ids; // ascending
+    vector<SymptomMask> masks;
+    unordered_map<SymptomMask, vector<int>> groups; // set -> sorted IDs
+    size_t prevalence[32] = {};                     // patients per symptom bit
+
+    void addToGroup(int id, SymptomMask mask);
+    void removeFromGroup(int id, SymptomMask mask);
+
+public:
+    // Insert or re-index a patient after any change
+    void update(int id, SymptomMask symptoms);
+    void update(const Patient& patient);
+    void remove(int id);
+    void clear();
+
+    size_t size() const;
+    size_t distinctSets() const;
+
+    // The k patients most similar to `query`, best first and by ID among
+    // equal scores; `excludeId` (the patient asking) and patients sharing
+    // no symptom with `query` are left out
+    vector<SimilarPatient> nearest(SymptomMask query, size_t k, Measure measure = JACCARD, int excludeId = 0) const;
+    // Same result, computed by scoring every patient
+    vector<SimilarPatient> scan(SymptomMask query, size_t k, Measure measure = JACCARD, int excludeId = 0) const;
+};
@@ -0,0 +1,210 @@
+// Copy-on-write patient storage implementation
+#include "patient_store.h"
+#include <atomic>
+
+using namespace std;
+
+namespace {
+
+const int BITS = PatientNode::BITS;
+const int WIDTH = PatientNode::WIDTH;
+const int64_t MASK = WIDTH - 1;
+
+// The leaf that would hold `id`, or nullptr
+const PatientNode* leafFor(const PatientNode* node, int shift, int64_t id) {
+    if (!node || id < 0 || (id >> (shift + BITS)) != 0) return nullptr;
+    for (int s = shift; s > 0 && node; s -= BITS) node = node->children[(id >> s) & MASK].get();
+    return node;
+}
+
+// First leaf whose IDs start at or after `key` (a multiple of WIDTH), in
+// the subtree of `node` whose first ID is `prefix`
+const PatientNode* leafFrom(const PatientNode* node, int shift, int64_t prefix, int64_t key, int64_t& base) {
+    if (key - prefix >= (static_cast<int64_t>(WIDTH) << shift)) return nullptr;
+    if (shift == 0) {
+        base = prefix;
+        return node;
+    }
+    int first = key <= prefix ? 0 : static_cast<int>((key - prefix) >> shift);
+    for (int i = first; i < WIDTH; ++i) {
+        const PatientNode* child = node->children[i].get();
+        if (!child) continue;
+        int64_t childPrefix = prefix + (static_cast<int64_t>(i) << shift);
+        const PatientNode* leaf = leafFrom(child, shift - BITS, childPrefix, key, base);
+        if (leaf) return leaf;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void PatientSnapshot::const_iterator::seek(int64_t fromId) {
+    leaf = owner->root ? leafFrom(owner->root.get(), owner->shift, 0, fromId, base) : nullptr;
+    slot = 0;
+    // Pruning keeps every reachable leaf non-empty
+    while (leaf && !leaf->patients[slot]) slot++;
+    if (!leaf) slot = 0;
+}
+
+PatientSnapshot::const_iterator& PatientSnapshot::const_iterator::operator++() {
+    while (++slot < WIDTH) {
+        if (leaf->patients[slot]) return *this;
+    }
+    seek(base + WIDTH);
+    return *this;
+}
+
+PatientSnapshot::const_iterator PatientSnapshot::begin() const {
+    const_iterator it;
+    it.owner = this;
+    it.seek(0);
+    return it;
+}
+
+PatientSnapshot::const_iterator PatientSnapshot::end() const {
+    const_iterator it;
+    it.owner = this;
+    return it;
+}
+
+PatientSnapshot::const_iterator PatientSnapshot::from(int id) const {
+    const_iterator it;
+    it.owner = this;
+    it.seek(id < 0 ? 0 : id & ~MASK);
+    while (it.leaf && it->getId() < id) ++it;
+    return it;
+}
+
+size_t PatientSnapshot::size() const {
+    return count;
+}
+
+bool PatientSnapshot::empty() const {
+    return count == 0;
+}
+
+const Patient* PatientSnapshot::find(int id) const {
+    const PatientNode* leaf = leafFor(root.get(), shift, id);
+    return leaf && leaf->patients[id & MASK] ? &*leaf->patients[id & MASK] : nullptr;
+}
+
+const Patient& PatientSnapshot::back() const {
+    const PatientNode* node = root.get();
+    for (int s = shift; s > 0; s -= BITS) {
+        int i = WIDTH - 1;
+        while (!node->children[i]) i--;
+        node = node->children[i].get();
+    }
+    int slot = WIDTH - 1;
+    while (!node->patients[slot]) slot--;
+    return *node->patients[slot];
+}
+
+PatientNode* PatientStore::own(shared_ptr<PatientNode>& node, bool leaf) {
+    if (!node) {
+        node = make_shared<PatientNode>();
+        if (leaf) {
+            node->patients.resize(WIDTH);
+        } else {
+            node->children.resize(WIDTH);
+        }
+    } else if (node.use_count() > 1) {
+        node = make_shared<PatientNode>(*node);
+        copies++;
+    } else {
+        // The last snapshot may have been released on another thread;
+        // pair with its release so its reads finish before our writes
+        atomic_thread_fence(memory_order_acquire);
+    }
+    return node.get();
+}
+
+const Patient* PatientStore::find(int id) const {
+    const PatientNode* leaf = leafFor(root.get(), shift, id);
+    return leaf && leaf->patients[id & MASK] ? &*leaf->patients[id & MASK] : nullptr;
+}
+
+Patient* PatientStore::findMutable(int id) {
+    if (!find(id)) return nullptr;
+    PatientNode* node = own(root, shift == 0);
+    for (int s = shift; s > 0; s -= BITS) node = own(node->children[(id >> s) & MASK], s == BITS);
+    return &*node->patients[id & MASK];
+}
+
+void PatientStore::insert(const Patient& patient) {
+    int64_t id = patient.getId();
+    if (id < 0) return;
+    // Grow upwards until the root covers the ID
+    while ((id >> (shift + BITS)) != 0) {
+        if (root) {
+            auto grown = make_shared<PatientNode>();
+            grown->children.resize(WIDTH);
+            grown->count = root->count;
+            grown->children[0] = root;
+            root = grown;
+        }
+        shift += BITS;
+    }
+
+    vector<PatientNode*> path;
+    PatientNode* node = own(root, shift == 0);
+    for (int s = shift; s > 0; s -= BITS) {
+        path.push_back(node);
+        node = own(node->children[(id >> s) & MASK], s == BITS);
+    }
+    optional<Patient>& slot = node->patients[id & MASK];
+    bool added = !slot;
+    slot = patient;
+    if (added) {
+        node->count++;
+        for (PatientNode* parent : path) parent->count++;
+        count++;
+    }
+}
+
+bool PatientStore::erase(int id) {
+    if (!find(id)) return false;
+    vector<pair<PatientNode*, int64_t>> path;
+    PatientNode* node = own(root, shift == 0);
+    for (int s = shift; s > 0; s -= BITS) {
+        path.push_back({node, (id >> s) & MASK});
+        node = own(node->children[(id >> s) & MASK], s == BITS);
+    }
+    node->patients[id & MASK].reset();
+    node->count--;
+    // Drop nodes that became empty so iteration never visits them
+    bool empty = node->count == 0;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        if (empty) it->first->children[it->second].reset();
+        it->first->count--;
+        empty = it->first->count == 0;
+    }
+    if (--count == 0) clear();
+    return true;
+}
+
+void PatientStore::clear() {
+    root.reset();
+    shift = 0;
+    count = 0;
+}
+
+size_t PatientStore::size() const {
+    return count;
+}
+
+bool PatientStore::empty() const {
+    return count == 0;
+}
+
+PatientSnapshot PatientStore::snapshot() const {
+    PatientSnapshot snapshot;
+    snapshot.root = root;
+    snapshot.shift = shift;
+    snapshot.count = count;
+    return snapshot;
+}
+
+size_t PatientStore::copiedNodes() const {
+    return copies;
+}
@@ -0,0 +1,96 @@
+// Copy-on-write patient storage with constant-time snapshots
+#pragma once
+#include "patient.h"
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <vector>
+
+using namespace std;
+
+// Node of a 32-way radix tree keyed by patient ID. A node reachable from
+// a snapshot is never modified; the store copies it before writing.
+struct PatientNode {
+    static const int BITS = 5;
+    static const int WIDTH = 1 << BITS;
+
+    size_t count = 0;                        // patients below this node
+    vector<shared_ptr<PatientNode>> children; // inner nodes: WIDTH entries
+    vector<optional<Patient>> patients;       // leaves: WIDTH entries
+};
+
+// A frozen version of the store. Taking one copies a single pointer;
+// the nodes it shares are freed when the last snapshot using them goes.
+class PatientSnapshot {
+private:
+    shared_ptr<const PatientNode> root;
+    int shift = 0;
+    size_t count = 0;
+
+    friend class PatientStore;
+
+public:
+    // Visits patients in ID order
+    class const_iterator {
+    private:
+        const PatientSnapshot* owner = nullptr;
+        const PatientNode* leaf = nullptr;
+        int64_t base = 0; // ID of the leaf's first slot
+        int slot = 0;
+
+        friend class PatientSnapshot;
+        void seek(int64_t fromId);
+
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = Patient;
+        using difference_type = ptrdiff_t;
+        using pointer = const Patient*;
+        using reference = const Patient&;
+
+        reference operator*() const { return *leaf->patients[slot]; }
+        pointer operator->() const { return &*leaf->patients[slot]; }
+        const_iterator& operator++();
+        bool operator==(const const_iterator& other) const { return leaf == other.leaf && slot == other.slot; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+    };
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator from(int id) const; // first patient with an ID >= id
+    size_t size() const;
+    bool empty() const;
+
+    const Patient* find(int id) const;
+    const Patient& back() const; // highest ID; the snapshot must not be empty
+};
+
+class PatientStore {
+private:
+    shared_ptr<PatientNode> root;
+    int shift = 0; // ID bits below the root's children
+    size_t count = 0;
+    size_t copies = 0;
+
+    // Make `node` safe to modify: create it if missing, copy it if a
+    // snapshot shares it
+    PatientNode* own(shared_ptr<PatientNode>& node, bool leaf);
+
+public:
+    const Patient* find(int id) const;
+    // Copies the nodes on the path to the patient if a snapshot shares
+    // them. The pointer stays valid until the next snapshot() or erase();
+    // edit through it before taking a snapshot.
+    Patient* findMutable(int id);
+    void insert(const Patient& patient); // replaces a patient with the same ID
+    bool erase(int id);
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
+
+    PatientSnapshot snapshot() const;
+    // Nodes copied because a snapshot shared them, for tests and tuning
+    size_t copiedNodes() const;
+};
@@ -0,0 +1,288 @@
+// Background write-behind persistence implementation
+#include "persistence_writer.h"
+#include "async_storage.h"
+#include "atomic_file.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace std;
+
+void writeSymptomUpdates(const string& path, const map<int, vector<string>>& updates) {
+    vector<string> lines;
+    lines.push_back("patient_id,symptoms");
+
+    // Keep every existing line that is not being replaced
+    ifstream inFile(path);
+    string line;
+    bool firstLine = true;
+    while (getline(inFile, line)) {
+        if (firstLine) {
+            firstLine = false;
+            if (line == "patient_id,symptoms") continue;
+        }
+        if (line.empty()) continue;
+        stringstream ss(line);
+        string pidStr;
+        getline(ss, pidStr, ',');
+        char* end = nullptr;
+        long pid = strtol(pidStr.c_str(), &end, 10);
+        if (pidStr.empty() || *end != '\0') {
+            // Not ours to repair; keep the line rather than stop the writer
+            cout << "Skipping malformed line in " << path << ": " << line << "\n";
+            lines.push_back(line);
+            continue;
+        }
+        if (updates.find(static_cast<int>(pid)) == updates.end()) {
+            lines.push_back(line);
+        }
+    }
+    inFile.close();
+
+    // Add the new entry for each updated patient
+    for (const auto& entry : updates) {
+        const vector<string>& symptoms = entry.second;
+        if (symptoms.empty()) continue;
+        string symptomsStr = "";
+        for (size_t i = 0; i < symptoms.size(); ++i) {
+            symptomsStr += symptoms[i];
+            if (i < symptoms.size() - 1) symptomsStr += ";";
+        }
+        lines.push_back(to_string(entry.first) + "," + symptomsStr);
+    }
+
+    // Whole-file rewrite: go through a synced temp file and a rename so a
+    // crash can never leave a half-written symptoms file behind
+    string contents;
+    for (const string& l : lines) {
+        contents += l;
+        contents += "\n";
+    }
+    string error;
+    if (!replaceFileAtomically(path, contents, error)) {
+        cout << "Error saving symptoms: " << error << "\n";
+    }
+}
+
+namespace {
+
+// Queue CSV rows for `path`, with the header first if the file is new
+void addRows(vector<FileAppend>& appends, const string& path, const string& header, const vector<string>& rows) {
+    if (rows.empty()) return;
+    struct stat buffer;
+    bool fileExists = (stat(path.c_str(), &buffer) == 0);
+    bool isEmpty = !fileExists || buffer.st_size == 0;
+    string data;
+    if (isEmpty) data = header + "\n";
+    for (const string& row : rows) {
+        data += row;
+        data += "\n";
+    }
+    appends.push_back({path, move(data)});
+}
+
+} // namespace
+
+PersistenceWriter::PersistenceWriter(const string& patientsPath, const string& symptomsPath,
+                                     const string& historyPath)
+    : patientsPath(patientsPath), symptomsPath(symptomsPath), historyPath(historyPath) {}
+
+PersistenceWriter::~PersistenceWriter() {
+    shutdown();
+}
+
+void PersistenceWriter::appendPatient(int id, const string& name, int age, const string& gender) {
+    Op* op = new Op();
+    op->type = Op::APPEND_PATIENT;
+    op->patientId = id;
+    op->row = to_string(id) + "," + name + "," + to_string(age) + "," + gender;
+    submit(op);
+}
+
+void PersistenceWriter::updateSymptoms(int patientId, const vector<string>& symptoms) {
+    Op* op = new Op();
+    op->type = Op::UPDATE_SYMPTOMS;
+    op->patientId = patientId;
+    op->symptoms = symptoms;
+    submit(op);
+}
+
+void PersistenceWriter::appendHistory(int patientId, int64_t time, const string& symptom, bool onset) {
+    Op* op = new Op();
+    op->type = Op::APPEND_HISTORY;
+    op->patientId = patientId;
+    op->row = to_string(patientId) + "," + to_string(time) + "," + symptom + "," + (onset ? "onset" : "resolved");
+    submit(op);
+}
+
+void PersistenceWriter::submit(Op* op) {
+    // Counted before stopping is checked, so shutdown() can wait for every
+    // submit that saw the writer still running to finish pushing
+    submitting.fetch_add(1);
+    if (stopping.load()) {
+        submitting.fetch_sub(1);
+        // No writer thread any more: write on the caller, after whatever
+        // is still queued
+        op->next = nullptr;
+        lock_guard<mutex> lock(writeMutex);
+        if (Op* queued = pending.exchange(nullptr)) writeBatch(queued);
+        writeBatch(op);
+        endAppends();
+        return;
+    }
+    call_once(started, [this] {
+        worker = thread(&PersistenceWriter::run, this);
+        workerStarted.store(true);
+    });
+
+    Op* head = pending.load(memory_order_relaxed);
+    do {
+        op->next = head;
+    } while (!pending.compare_exchange_weak(head, op));
+    submitting.fetch_sub(1);
+
+    // Only pay for the mutex when the writer is actually asleep
+    if (workerSleeping.load()) {
+        lock_guard<mutex> lock(wakeMutex);
+        wakeCv.notify_one();
+    }
+}
+
+void PersistenceWriter::run() {
+    while (true) {
+        {
+            lock_guard<mutex> lock(writeMutex);
+            Op* batch = pending.exchange(nullptr);
+            if (batch) {
+                writeBatch(batch);
+                continue;
+            }
+        }
+        if (stopping.load()) break;
+
+        unique_lock<mutex> lock(wakeMutex);
+        workerSleeping.store(true);
+        wakeCv.wait(lock, [this] { return pending.load() != nullptr || stopping.load(); });
+        workerSleeping.store(false);
+    }
+}
+
+void PersistenceWriter::writeBatch(Op* batch) {
+    // The stack is newest-first; reverse it into submission order
+    vector<Op*> ops;
+    for (Op* op = batch; op; op = op->next) ops.push_back(op);
+
+    vector<string> rows;
+    vector<string> historyRows;
+    map<int, vector<string>> symptomUpdates; // later updates replace earlier ones
+    uint64_t flushedTicket = 0;
+    vector<function<void()>> flushCallbacks;
+    for (auto it = ops.rbegin(); it != ops.rend(); ++it) {
+        Op* op = *it;
+        switch (op->type) {
+            case Op::APPEND_PATIENT:
+                rows.push_back(op->row);
+                break;
+            case Op::UPDATE_SYMPTOMS:
+                symptomUpdates[op->patientId] = op->symptoms;
+                break;
+            case Op::APPEND_HISTORY:
+                historyRows.push_back(op->row);
+                break;
+            case Op::FLUSH:
+                if (op->ticket > flushedTicket) flushedTicket = op->ticket;
+                if (op->done) flushCallbacks.push_back(move(op->done));
+                break;
+        }
+    }
+
+    // Both appends go to the kernel together
+    vector<FileAppend> appends;
+    addRows(appends, patientsPath, "id,name,age,gender", rows);
+    addRows(appends, historyPath, "patient_id,time,symptom,event", historyRows);
+    string error;
+    for (const FileAppend& append : appends) {
+        if (find(appending.begin(), appending.end(), append.path) != appending.end()) continue;
+        if (beginAppending(append.path, error)) {
+            appending.push_back(append.path);
+        } else {
+            cout << "Error marking " << append.path << ": " << error << "\n";
+        }
+    }
+    if (!appends.empty() && !sharedStorage().appendFiles(move(appends), false, error).get()) {
+        cout << "Error saving patients: " << error << "\n";
+    }
+
+    if (!symptomUpdates.empty()) {
+        writeSymptomUpdates(symptomsPath, symptomUpdates);
+    }
+
+    for (Op* op : ops) delete op;
+
+    if (flushedTicket > 0) {
+        lock_guard<mutex> lock(flushMutex);
+        if (flushedTicket > completedTicket) completedTicket = flushedTicket;
+        flushCv.notify_all();
+    }
+    for (auto& done : flushCallbacks) done();
+}
+
+void PersistenceWriter::flush() {
+    if (stopping.load() || !workerStarted.load()) return;
+
+    Op* op = new Op();
+    op->type = Op::FLUSH;
+    op->ticket = ++nextTicket;
+    uint64_t ticket = op->ticket;
+    submit(op);
+
+    unique_lock<mutex> lock(flushMutex);
+    flushCv.wait(lock, [this, ticket] { return completedTicket >= ticket; });
+}
+
+void PersistenceWriter::flushThen(function<void()> done) {
+    if (stopping.load() || !workerStarted.load()) {
+        done();
+        return;
+    }
+    Op* op = new Op();
+    op->type = Op::FLUSH;
+    op->done = move(done);
+    submit(op);
+}
+
+void PersistenceWriter::FlushAwaiter::await_suspend(coroutine_handle<> handle) {
+    writer.flushThen([handle] { sharedStorage().post([handle] { handle.resume(); }); });
+}
+
+PersistenceWriter::FlushAwaiter PersistenceWriter::flushed() {
+    return FlushAwaiter{*this};
+}
+
+void PersistenceWriter::shutdown() {
+    if (stopping.exchange(true)) return;
+    while (submitting.load() > 0) this_thread::yield();
+    if (workerStarted.load()) {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            wakeCv.notify_one();
+        }
+        worker.join();
+    }
+    // The thread may have left before the last submits were pushed
+    lock_guard<mutex> lock(writeMutex);
+    if (Op* queued = pending.exchange(nullptr)) writeBatch(queued);
+    endAppends();
+}
+
+// Everything appended is complete: sync it and drop the markers
+void PersistenceWriter::endAppends() {
+    for (const string& path : appending) {
+        string error;
+        if (!endAppending(path, error)) cout << "Error saving patients: " << error << "\n";
+    }
+    appending.clear();
+}
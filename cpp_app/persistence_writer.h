@@ -0,0 +1,101 @@
+// Background write-behind persistence for the patient CSV files
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Rewrite symptoms.csv once, replacing the lines of every patient in
+// `updates` (an empty symptom list removes the patient's line). The file
+// is replaced atomically, see replaceFileAtomically().
+void writeSymptomUpdates(const string& path, const map<int, vector<string>>& updates);
+
+class PersistenceWriter {
+private:
+    // One pending write, linked into the lock-free submission stack
+    struct Op {
+        enum Type { APPEND_PATIENT, UPDATE_SYMPTOMS, APPEND_HISTORY, FLUSH };
+        Type type;
+        int patientId = 0;
+        string row;
+        vector<string> symptoms;
+        uint64_t ticket = 0;
+        function<void()> done; // FLUSH from flushThen()
+        Op* next = nullptr;
+    };
+
+    string patientsPath;
+    string symptomsPath;
+    string historyPath;
+
+    // Producers push with a CAS loop, the writer thread takes the whole
+    // stack with one exchange and replays it in submission order
+    atomic<Op*> pending{nullptr};
+
+    thread worker;
+    once_flag started;
+    // Held while a batch is written, so writes after shutdown() cannot
+    // overtake the last batch
+    mutex writeMutex;
+    atomic<int> submitting{0};
+    atomic<bool> workerStarted{false};
+    atomic<bool> stopping{false};
+    atomic<bool> workerSleeping{false};
+    mutex wakeMutex;
+    condition_variable wakeCv;
+
+    atomic<uint64_t> nextTicket{0};
+    uint64_t completedTicket = 0;
+    mutex flushMutex;
+    condition_variable flushCv;
+
+    // Files with an append marker (see beginAppending), cleared once the
+    // last batch is synced at shutdown; guarded by writeMutex
+    vector<string> appending;
+
+    void submit(Op* op);
+    void run();
+    void writeBatch(Op* batch);
+    void endAppends();
+
+public:
+    PersistenceWriter(const string& patientsPath = "data/patients.csv",
+                      const string& symptomsPath = "data/symptoms.csv",
+                      const string& historyPath = "data/symptom_history.csv");
+    ~PersistenceWriter();
+
+    PersistenceWriter(const PersistenceWriter&) = delete;
+    PersistenceWriter& operator=(const PersistenceWriter&) = delete;
+
+    // Queue writes; these return immediately without touching the disk
+    void appendPatient(int id, const string& name, int age, const string& gender);
+    void updateSymptoms(int patientId, const vector<string>& symptoms);
+    void appendHistory(int patientId, int64_t time, const string& symptom, bool onset);
+
+    // Block until everything submitted before this call is on disk
+    void flush();
+    // Call `done` on the writer thread once everything submitted before
+    // this call is on disk, without blocking the caller
+    void flushThen(function<void()> done);
+
+    // co_await flushed(): flush() for coroutines, which resume on a
+    // sharedStorage() worker thread
+    struct FlushAwaiter {
+        PersistenceWriter& writer;
+        bool await_ready() const { return false; }
+        void await_suspend(coroutine_handle<> handle);
+        void await_resume() {}
+    };
+    FlushAwaiter flushed();
+
+    // Drain the queue and stop the background thread
+    void shutdown();
+};
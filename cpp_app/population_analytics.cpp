@@ -0,0 +1,318 @@
+// Population analytics implementation
+#include "population_analytics.h"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// Patients per column window in rebuild(): 64 words per symptom
+const size_t WINDOW = 4096;
+const size_t WINDOW_WORDS = WINDOW / 64;
+
+size_t catalogSize() {
+    return symptomCatalog().size();
+}
+
+// Bit columns for up to WINDOW patients: bit i of column s is set when
+// the i-th patient of the window has symptom s
+struct ColumnWindow {
+    uint64_t columns[32][WINDOW_WORDS];
+    size_t patients = 0;
+    SymptomMask present = 0;
+
+    ColumnWindow() { clear(); }
+
+    void clear() {
+        for (auto& column : columns) fill(begin(column), end(column), 0);
+        patients = 0;
+        present = 0;
+    }
+
+    void add(SymptomMask mask) {
+        for (SymptomMask bits = mask; bits != 0; bits &= bits - 1) {
+            columns[countr_zero(bits)][patients / 64] |= uint64_t(1) << (patients % 64);
+        }
+        present |= mask;
+        patients++;
+    }
+
+    // Add this window's symptom, pair and triple counts to `stats`
+    void countInto(PopulationStats& stats) const {
+        size_t n = catalogSize();
+        size_t words = (patients + 63) / 64;
+        uint64_t both[WINDOW_WORDS];
+        for (size_t a = 0; a < n; ++a) {
+            if (!(present & (SymptomMask(1) << a))) continue;
+            int64_t single = 0;
+            for (size_t w = 0; w < words; ++w) single += popcount(columns[a][w]);
+            stats.symptomCounts[a] += single;
+            for (size_t b = a + 1; b < n; ++b) {
+                if (!(present & (SymptomMask(1) << b))) continue;
+                int64_t pairs = 0;
+                for (size_t w = 0; w < words; ++w) {
+                    both[w] = columns[a][w] & columns[b][w];
+                    pairs += popcount(both[w]);
+                }
+                if (pairs == 0) continue;
+                stats.pairCounts[a * n + b] += pairs;
+                for (size_t c = b + 1; c < n; ++c) {
+                    if (!(present & (SymptomMask(1) << c))) continue;
+                    int64_t triples = 0;
+                    for (size_t w = 0; w < words; ++w) triples += popcount(both[w] & columns[c][w]);
+                    stats.tripleCounts[(a * n + b) * n + c] += triples;
+                }
+            }
+        }
+    }
+};
+
+bool byCount(const pair<SymptomMask, int64_t>& a, const pair<SymptomMask, int64_t>& b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+}
+
+} // namespace
+
+PopulationStats::PopulationStats(const vector<string>& diseases)
+    : diseases(diseases),
+      symptomCounts(catalogSize()),
+      pairCounts(catalogSize() * catalogSize()),
+      tripleCounts(catalogSize() * catalogSize() * catalogSize()),
+      diseaseCounts(diseases.size() * AGE_BANDS * GENDERS) {}
+
+int PopulationStats::ageBand(int age) {
+    return min(max(age, 0) / 10, AGE_BANDS - 1);
+}
+
+PopulationStats::Gender PopulationStats::genderOf(const string& gender) {
+    char first = gender.empty() ? ' ' : static_cast<char>(toupper(static_cast<unsigned char>(gender[0])));
+    if (first == 'M') return MALE;
+    if (first == 'F') return FEMALE;
+    return OTHER;
+}
+
+string PopulationStats::ageBandName(int band) {
+    if (band == AGE_BANDS - 1) return to_string(band * 10) + "+";
+    return to_string(band * 10) + "-" + to_string(band * 10 + 9);
+}
+
+int64_t PopulationStats::pairCount(int a, int b) const {
+    size_t n = catalogSize();
+    if (a > b) swap(a, b);
+    return pairCounts[a * n + b];
+}
+
+int64_t PopulationStats::tripleCount(int a, int b, int c) const {
+    size_t n = catalogSize();
+    if (a > b) swap(a, b);
+    if (b > c) swap(b, c);
+    if (a > b) swap(a, b);
+    return tripleCounts[(a * n + b) * n + c];
+}
+
+int64_t PopulationStats::prevalence(int disease, int band, Gender gender) const {
+    return diseaseCounts[(disease * AGE_BANDS + band) * GENDERS + gender];
+}
+
+int64_t PopulationStats::prevalence(int disease) const {
+    int64_t total = 0;
+    for (int cell = 0; cell < AGE_BANDS * GENDERS; ++cell) total += diseaseCounts[disease * AGE_BANDS * GENDERS + cell];
+    return total;
+}
+
+vector<pair<SymptomMask, int64_t>> PopulationStats::topPairs(size_t limit) const {
+    size_t n = catalogSize();
+    vector<pair<SymptomMask, int64_t>> found;
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t b = a + 1; b < n; ++b) {
+            int64_t count = pairCounts[a * n + b];
+            if (count > 0) found.push_back({(SymptomMask(1) << a) | (SymptomMask(1) << b), count});
+        }
+    }
+    sort(found.begin(), found.end(), byCount);
+    if (found.size() > limit) found.resize(limit);
+    return found;
+}
+
+vector<pair<SymptomMask, int64_t>> PopulationStats::topTriples(size_t limit) const {
+    size_t n = catalogSize();
+    vector<pair<SymptomMask, int64_t>> found;
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t b = a + 1; b < n; ++b) {
+            for (size_t c = b + 1; c < n; ++c) {
+                int64_t count = tripleCounts[(a * n + b) * n + c];
+                SymptomMask mask = (SymptomMask(1) << a) | (SymptomMask(1) << b) | (SymptomMask(1) << c);
+                if (count > 0) found.push_back({mask, count});
+            }
+        }
+    }
+    sort(found.begin(), found.end(), byCount);
+    if (found.size() > limit) found.resize(limit);
+    return found;
+}
+
+void PopulationStats::merge(const PopulationStats& other) {
+    patients += other.patients;
+    undiagnosed += other.undiagnosed;
+    auto add = [](vector<int64_t>& into, const vector<int64_t>& from) {
+        for (size_t i = 0; i < into.size() && i < from.size(); ++i) into[i] += from[i];
+    };
+    add(symptomCounts, other.symptomCounts);
+    add(pairCounts, other.pairCounts);
+    add(tripleCounts, other.tripleCounts);
+    add(diseaseCounts, other.diseaseCounts);
+}
+
+PopulationStats PopulationStats::deltaFrom(const PopulationStats& earlier) const {
+    PopulationStats delta = earlier;
+    auto negate = [](vector<int64_t>& counts) {
+        for (auto& count : counts) count = -count;
+    };
+    delta.patients = -delta.patients;
+    delta.undiagnosed = -delta.undiagnosed;
+    negate(delta.symptomCounts);
+    negate(delta.pairCounts);
+    negate(delta.tripleCounts);
+    negate(delta.diseaseCounts);
+    delta.merge(*this);
+    return delta;
+}
+
+PopulationAnalytics::PopulationAnalytics(const RuleSet& rules) {
+    rebuild(PatientSnapshot(), rules, 1);
+}
+
+PopulationAnalytics::Member PopulationAnalytics::memberFor(const Patient& patient) const {
+    Member member;
+    member.id = patient.getId();
+    member.symptoms = toSymptomMask(patient.symptoms);
+    member.band = static_cast<uint8_t>(PopulationStats::ageBand(patient.age));
+    member.gender = static_cast<uint8_t>(PopulationStats::genderOf(patient.gender));
+    member.diseases = 0;
+    for (uint64_t matches = rules.evaluate(member.symptoms, static_cast<int>(patient.symptoms.size())); matches != 0;
+         matches &= matches - 1) {
+        member.diseases |= uint64_t(1) << diseaseOfRule[countr_zero(matches)];
+    }
+    return member;
+}
+
+// Add (sign 1) or take away (sign -1) one patient's contribution
+void PopulationAnalytics::count(const Member& member, int64_t sign) {
+    size_t n = catalogSize();
+    totals.patients += sign;
+    if (member.diseases == 0) totals.undiagnosed += sign;
+    for (uint64_t diseases = member.diseases; diseases != 0; diseases &= diseases - 1) {
+        size_t disease = countr_zero(diseases);
+        totals.diseaseCounts[(disease * PopulationStats::AGE_BANDS + member.band) * PopulationStats::GENDERS +
+                             member.gender] += sign;
+    }
+    for (SymptomMask as = member.symptoms; as != 0; as &= as - 1) {
+        size_t a = countr_zero(as);
+        totals.symptomCounts[a] += sign;
+        for (SymptomMask bs = as & (as - 1); bs != 0; bs &= bs - 1) {
+            size_t b = countr_zero(bs);
+            totals.pairCounts[a * n + b] += sign;
+            for (SymptomMask cs = bs & (bs - 1); cs != 0; cs &= cs - 1) {
+                totals.tripleCounts[(a * n + b) * n + countr_zero(cs)] += sign;
+            }
+        }
+    }
+}
+
+void PopulationAnalytics::rebuild(const PatientSnapshot& patients, const RuleSet& newRules, int threads) {
+    rules = newRules;
+    rulesText = rules.toText();
+    vector<string> diseases;
+    for (const auto& rule : rules.getRules()) diseases.push_back(rule.disease);
+    sort(diseases.begin(), diseases.end());
+    diseases.erase(unique(diseases.begin(), diseases.end()), diseases.end());
+    diseaseOfRule.clear();
+    for (const auto& rule : rules.getRules()) {
+        diseaseOfRule.push_back(static_cast<int>(lower_bound(diseases.begin(), diseases.end(), rule.disease) - diseases.begin()));
+    }
+    totals = PopulationStats(diseases);
+    members.clear();
+    if (patients.empty()) return;
+
+    // Each thread takes an equal slice of the ID space
+    int workers = threads > 0 ? threads : max(1, static_cast<int>(thread::hardware_concurrency()));
+    int64_t sliceSize = patients.back().getId() / workers + 1;
+    vector<PopulationStats> partial(workers, PopulationStats(diseases));
+    vector<vector<Member>> parts(workers);
+    auto countSlice = [&](int worker) {
+        PopulationStats& stats = partial[worker];
+        vector<Member>& part = parts[worker];
+        unique_ptr<ColumnWindow> window(new ColumnWindow());
+        int64_t end = (worker + 1) * sliceSize;
+        for (auto it = patients.from(static_cast<int>(worker * sliceSize)); it != patients.end() && it->getId() < end;
+             ++it) {
+            Member member = memberFor(*it);
+            part.push_back(member);
+            stats.patients++;
+            if (member.diseases == 0) stats.undiagnosed++;
+            for (uint64_t diseases = member.diseases; diseases != 0; diseases &= diseases - 1) {
+                size_t disease = countr_zero(diseases);
+                stats.diseaseCounts[(disease * PopulationStats::AGE_BANDS + member.band) * PopulationStats::GENDERS +
+                                    member.gender]++;
+            }
+            window->add(member.symptoms);
+            if (window->patients == WINDOW) {
+                window->countInto(stats);
+                window->clear();
+            }
+        }
+        window->countInto(stats);
+    };
+    vector<thread> pool;
+    for (int worker = 1; worker < workers; ++worker) pool.emplace_back(countSlice, worker);
+    countSlice(0);
+    for (auto& worker : pool) worker.join();
+
+    for (int worker = 0; worker < workers; ++worker) {
+        totals.merge(partial[worker]);
+        members.insert(members.end(), parts[worker].begin(), parts[worker].end());
+    }
+}
+
+void PopulationAnalytics::rebuild(const PatientSnapshot& patients, int threads) {
+    RuleSet current = rules;
+    rebuild(patients, current, threads);
+}
+
+bool PopulationAnalytics::usesRules(const RuleSet& other) const {
+    return other.toText() == rulesText;
+}
+
+void PopulationAnalytics::update(const Patient& patient) {
+    Member member = memberFor(patient);
+    auto position = lower_bound(members.begin(), members.end(), member.id,
+                                [](const Member& m, int id) { return m.id < id; });
+    if (position != members.end() && position->id == member.id) {
+        count(*position, -1);
+        *position = member;
+    } else {
+        members.insert(position, member);
+    }
+    count(member, 1);
+}
+
+void PopulationAnalytics::remove(int id) {
+    auto position = lower_bound(members.begin(), members.end(), id,
+                                [](const Member& m, int wanted) { return m.id < wanted; });
+    if (position == members.end() || position->id != id) return;
+    count(*position, -1);
+    members.erase(position);
+}
+
+void PopulationAnalytics::clear() {
+    members.clear();
+    totals = PopulationStats(totals.diseases);
+}
+
+const PopulationStats& PopulationAnalytics::stats() const {
+    return totals;
+}
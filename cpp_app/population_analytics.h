@@ -0,0 +1,89 @@
+// Symptom co-occurrence and disease prevalence across all patients
+#pragma once
+#include "patient.h"
+#include "patient_store.h"
+#include "rule_set.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Counts over a population. Symptoms are indexed like symptomCatalog()
+// and diseases like `diseases`; pairs and triples are only filled for
+// a < b < c. Counts are signed so that deltaFrom() can return changes.
+struct PopulationStats {
+    enum Gender { MALE, FEMALE, OTHER, GENDERS };
+    static const int AGE_BANDS = 10; // 0-9, 10-19, ..., 90+
+
+    vector<string> diseases;
+    int64_t patients = 0;
+    int64_t undiagnosed = 0;
+    vector<int64_t> symptomCounts;  // [symptom]
+    vector<int64_t> pairCounts;     // [a][b]
+    vector<int64_t> tripleCounts;   // [a][b][c]
+    vector<int64_t> diseaseCounts;  // [disease][age band][gender]
+
+    PopulationStats() = default;
+    explicit PopulationStats(const vector<string>& diseases);
+
+    static int ageBand(int age);
+    static Gender genderOf(const string& gender);
+    static string ageBandName(int band);
+
+    int64_t pairCount(int a, int b) const;
+    int64_t tripleCount(int a, int b, int c) const;
+    int64_t prevalence(int disease, int band, Gender gender) const;
+    int64_t prevalence(int disease) const; // all ages and genders
+
+    // Symptom pairs (as masks) by count, most frequent first
+    vector<pair<SymptomMask, int64_t>> topPairs(size_t limit) const;
+    vector<pair<SymptomMask, int64_t>> topTriples(size_t limit) const;
+
+    void merge(const PopulationStats& other);
+    // this - earlier, cell by cell; both must use the same diseases
+    PopulationStats deltaFrom(const PopulationStats& earlier) const;
+};
+
+// Keeps PopulationStats current as patients are added, edited and
+// removed. rebuild() recomputes everything in one pass split across
+// threads: each thread counts its share of the patients into its own
+// PopulationStats, turning symptoms into per-symptom bit columns so that
+// a pair or triple count is the popcount of ANDed columns, and the
+// partial results are added up at the end.
+class PopulationAnalytics {
+private:
+    // What a patient currently contributes, kept so update() can undo it
+    struct Member {
+        int id;
+        SymptomMask symptoms;
+        uint8_t band;
+        uint8_t gender;
+        uint64_t diseases; // one bit per entry of totals.diseases
+    };
+
+    RuleSet rules;
+    string rulesText;
+    vector<int> diseaseOfRule;
+    vector<Member> members; // by ID
+    PopulationStats totals;
+
+    Member memberFor(const Patient& patient) const;
+    void count(const Member& member, int64_t sign);
+
+public:
+    explicit PopulationAnalytics(const RuleSet& rules = RuleSet::builtin());
+
+    // Recompute from `patients` with these rules; threads = 0 uses one per core
+    void rebuild(const PatientSnapshot& patients, const RuleSet& rules, int threads = 0);
+    void rebuild(const PatientSnapshot& patients, int threads = 0);
+    bool usesRules(const RuleSet& other) const;
+
+    // Insert or re-count a patient after any change
+    void update(const Patient& patient);
+    void remove(int id);
+    void clear();
+
+    const PopulationStats& stats() const;
+};
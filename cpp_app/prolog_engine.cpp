@@ -0,0 +1,1053 @@
+// Embedded Prolog engine implementation
+#include "prolog_engine.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+string symptomAtom(const string& symptom) {
+    string atom = symptom;
+    replace(atom.begin(), atom.end(), ' ', '_');
+    return atom;
+}
+
+string diseaseDisplayName(const string& atom) {
+    static const map<string, string> names = {
+        {"common_cold", "Common Cold"}, {"flu", "Flu"}, {"covid19", "COVID-19"},
+        {"pneumonia", "Pneumonia"}, {"gastroenteritis", "Gastroenteritis"},
+        {"migraine", "Migraine"}, {"allergic_reaction", "Allergic Reaction"},
+        {"strep_throat", "Strep Throat"}, {"bronchitis", "Bronchitis"},
+        {"food_poisoning", "Food Poisoning"}, {"sinusitis", "Sinusitis"},
+        {"asthma", "Asthma"}, {"anxiety_panic_attack", "Anxiety/Panic Attack"},
+        {"dehydration", "Dehydration"}, {"arthritis", "Arthritis"},
+        {"inflammatory_arthritis", "Inflammatory Arthritis"},
+        {"tension_headache", "Tension Headache"}, {"skin_condition", "Skin Condition"},
+        {"fever_unknown_cause", "Fever (Unknown Cause)"}
+    };
+    auto it = names.find(atom);
+    return it != names.end() ? it->second : atom;
+}
+
+namespace {
+
+enum Builtin {
+    B_TRUE, B_FAIL, B_CONJ, B_DISJ, B_ITE, B_NOT, B_UNIFY, B_NOT_UNIFY, B_EQ,
+    B_MEMBER, B_LENGTH, B_FINDALL, B_SORT2, B_SORT4, B_MSORT, B_FORALL,
+    B_FORMAT1, B_FORMAT2, B_NL, B_CONSULT
+};
+
+// Resolution recurses natively, and a goal's continuation runs on top of
+// the frames of the goal before it, so the stack can grow faster than
+// `depth`. Both limits stop a runaway query with an error well before the
+// smallest default stack (1 MB for the main thread on Windows) runs out.
+const int MAX_DEPTH = 10000;
+const uintptr_t MAX_STACK_BYTES = 512 * 1024;
+
+struct OpDef {
+    int prec;
+    string type; // xfx, xfy, yfx, fy, fx
+};
+
+const map<string, OpDef>& infixOps() {
+    static const map<string, OpDef> ops = {
+        {":-", {1200, "xfx"}}, {"-->", {1200, "xfx"}}, {";", {1100, "xfy"}},
+        {"|", {1100, "xfy"}}, {"->", {1050, "xfy"}}, {",", {1000, "xfy"}},
+        {"=", {700, "xfx"}}, {"\\=", {700, "xfx"}}, {"==", {700, "xfx"}},
+        {"\\==", {700, "xfx"}}, {"@<", {700, "xfx"}}, {"@>", {700, "xfx"}},
+        {"@=<", {700, "xfx"}}, {"@>=", {700, "xfx"}}, {"is", {700, "xfx"}},
+        {"<", {700, "xfx"}}, {">", {700, "xfx"}}, {"=<", {700, "xfx"}},
+        {">=", {700, "xfx"}}, {"=:=", {700, "xfx"}}, {"=\\=", {700, "xfx"}},
+        {"+", {500, "yfx"}}, {"-", {500, "yfx"}}, {"*", {400, "yfx"}},
+        {"/", {400, "yfx"}}, {"^", {200, "xfy"}}
+    };
+    return ops;
+}
+
+const map<string, OpDef>& prefixOps() {
+    static const map<string, OpDef> ops = {
+        {":-", {1200, "fx"}}, {"\\+", {900, "fy"}}, {"-", {200, "fy"}}
+    };
+    return ops;
+}
+
+bool isSymbolChar(char c) {
+    return string("+-*/\\^<>=~:.?@#&$").find(c) != string::npos;
+}
+
+} // namespace
+
+// Tokenizer and operator-precedence parser for clause text
+class PrologParser {
+private:
+    enum TokenType { NAME, VARIABLE, NUMBER, PUNCT, END, END_OF_FILE };
+
+    struct Token {
+        TokenType type;
+        string text;
+        bool layoutBefore;
+        bool quoted;
+    };
+
+    PrologEngine& engine;
+    deque<PrologEngine::Term>& arena;
+    const string& src;
+    size_t pos = 0;
+    Token current;
+    map<string, int> varSlots;
+    int numVars = 0;
+    bool fresh; // runtime variables instead of clause slots
+
+    void skipLayout(bool& sawLayout) {
+        while (pos < src.size()) {
+            char c = src[pos];
+            if (isspace(static_cast<unsigned char>(c))) {
+                pos++;
+                sawLayout = true;
+            } else if (c == '%') {
+                while (pos < src.size() && src[pos] != '\n') pos++;
+                sawLayout = true;
+            } else if (c == '/' && pos + 1 < src.size() && src[pos + 1] == '*') {
+                size_t close = src.find("*/", pos + 2);
+                pos = close == string::npos ? src.size() : close + 2;
+                sawLayout = true;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool next() {
+        bool layout = false;
+        skipLayout(layout);
+        current = {END_OF_FILE, "", layout, false};
+        if (pos >= src.size()) return true;
+
+        char c = src[pos];
+        if (isdigit(static_cast<unsigned char>(c))) {
+            size_t start = pos;
+            while (pos < src.size() && isdigit(static_cast<unsigned char>(src[pos]))) pos++;
+            current = {NUMBER, src.substr(start, pos - start), layout, false};
+        } else if (isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t start = pos;
+            while (pos < src.size() && (isalnum(static_cast<unsigned char>(src[pos])) || src[pos] == '_')) pos++;
+            string text = src.substr(start, pos - start);
+            bool isVar = isupper(static_cast<unsigned char>(c)) || c == '_';
+            current = {isVar ? VARIABLE : NAME, text, layout, false};
+        } else if (c == '\'' || c == '"') {
+            char quote = c;
+            string text;
+            pos++;
+            while (true) {
+                if (pos >= src.size()) return fail("unterminated quoted atom");
+                char q = src[pos++];
+                if (q == quote) {
+                    if (pos < src.size() && src[pos] == quote) {
+                        text += quote;
+                        pos++;
+                        continue;
+                    }
+                    break;
+                }
+                if (q == '\\' && pos < src.size()) {
+                    char e = src[pos++];
+                    if (e == 'n') text += '\n';
+                    else if (e == 't') text += '\t';
+                    else text += e;
+                    continue;
+                }
+                text += q;
+            }
+            current = {NAME, text, layout, true};
+        } else if (c == '.' && (pos + 1 >= src.size() || isspace(static_cast<unsigned char>(src[pos + 1])) || src[pos + 1] == '%')) {
+            pos++;
+            current = {END, ".", layout, false};
+        } else if (string("()[]{},|").find(c) != string::npos) {
+            pos++;
+            current = {PUNCT, string(1, c), layout, false};
+        } else if (c == '!' || c == ';') {
+            pos++;
+            current = {NAME, string(1, c), layout, false};
+        } else if (isSymbolChar(c)) {
+            size_t start = pos;
+            while (pos < src.size() && isSymbolChar(src[pos])) pos++;
+            current = {NAME, src.substr(start, pos - start), layout, false};
+        } else {
+            return fail(string("unexpected character '") + c + "'");
+        }
+        return true;
+    }
+
+    bool fail(const string& message) {
+        if (engine.error.empty()) {
+            size_t line = count(src.begin(), src.begin() + min(pos, src.size()), '\n') + 1;
+            engine.error = "syntax error at line " + to_string(line) + ": " + message;
+        }
+        return false;
+    }
+
+    bool isTermStart(const Token& t) const {
+        if (t.type == END || t.type == END_OF_FILE) return false;
+        if (t.type == PUNCT) return t.text == "(" || t.text == "[" || t.text == "{";
+        if (t.type == NAME && !t.quoted && infixOps().count(t.text) && !prefixOps().count(t.text)) return false;
+        return true;
+    }
+
+    PrologEngine::Term* variable(const string& name) {
+        if (fresh) {
+            if (name != "_") {
+                auto it = freshVars.find(name);
+                if (it != freshVars.end()) return it->second;
+            }
+            PrologEngine::Term* v = engine.makeVar();
+            if (name != "_") freshVars[name] = v;
+            return v;
+        }
+        int slot;
+        if (name == "_") {
+            slot = numVars++;
+        } else {
+            auto it = varSlots.find(name);
+            if (it != varSlots.end()) {
+                slot = it->second;
+            } else {
+                slot = numVars++;
+                varSlots[name] = slot;
+            }
+        }
+        arena.push_back(PrologEngine::Term());
+        PrologEngine::Term* v = &arena.back();
+        v->kind = PrologEngine::Term::VAR;
+        v->ground = false;
+        v->functor = slot;
+        return v;
+    }
+
+    map<string, PrologEngine::Term*> freshVars;
+
+    PrologEngine::Term* parseArgList(int functor) {
+        vector<PrologEngine::Term*> args;
+        while (true) {
+            if (!next()) return nullptr;
+            PrologEngine::Term* arg = parse(999);
+            if (!arg) return nullptr;
+            args.push_back(arg);
+            if (current.type == PUNCT && current.text == ",") continue;
+            if (current.type == PUNCT && current.text == ")") break;
+            fail("expected ',' or ')' in arguments");
+            return nullptr;
+        }
+        if (!next()) return nullptr;
+        return engine.makeCompound(arena, functor, args);
+    }
+
+    PrologEngine::Term* parseList() {
+        if (!next()) return nullptr;
+        if (current.type == PUNCT && current.text == "]") {
+            if (!next()) return nullptr;
+            return engine.makeAtom(arena, engine.atomNil);
+        }
+        vector<PrologEngine::Term*> items;
+        PrologEngine::Term* tail = nullptr;
+        while (true) {
+            PrologEngine::Term* item = parse(999);
+            if (!item) return nullptr;
+            items.push_back(item);
+            if (current.type == PUNCT && current.text == ",") {
+                if (!next()) return nullptr;
+                continue;
+            }
+            if (current.type == PUNCT && current.text == "|") {
+                if (!next()) return nullptr;
+                tail = parse(999);
+                if (!tail) return nullptr;
+            }
+            if (current.type == PUNCT && current.text == "]") break;
+            fail("expected ',', '|' or ']' in list");
+            return nullptr;
+        }
+        if (!next()) return nullptr;
+        PrologEngine::Term* list = tail ? tail : engine.makeAtom(arena, engine.atomNil);
+        for (auto it = items.rbegin(); it != items.rend(); ++it) {
+            list = engine.makeCompound(arena, engine.atomDot, {*it, list});
+        }
+        return list;
+    }
+
+    PrologEngine::Term* parsePrimary(int maxPrec, int& prec) {
+        prec = 0;
+        Token tok = current;
+        if (tok.type == NUMBER) {
+            if (!next()) return nullptr;
+            return engine.makeInt(arena, stol(tok.text));
+        }
+        if (tok.type == VARIABLE) {
+            if (!next()) return nullptr;
+            return variable(tok.text);
+        }
+        if (tok.type == PUNCT && tok.text == "(") {
+            if (!next()) return nullptr;
+            PrologEngine::Term* inner = parse(1200);
+            if (!inner) return nullptr;
+            if (!(current.type == PUNCT && current.text == ")")) {
+                fail("expected ')'");
+                return nullptr;
+            }
+            if (!next()) return nullptr;
+            return inner;
+        }
+        if (tok.type == PUNCT && tok.text == "[") {
+            return parseList();
+        }
+        if (tok.type != NAME) {
+            fail("unexpected '" + tok.text + "'");
+            return nullptr;
+        }
+
+        int functor = engine.intern(tok.text);
+        if (!next()) return nullptr;
+        if (current.type == PUNCT && current.text == "(" && !current.layoutBefore) {
+            return parseArgList(functor);
+        }
+
+        auto prefix = prefixOps().find(tok.text);
+        if (!tok.quoted && prefix != prefixOps().end() && isTermStart(current)) {
+            if (tok.text == "-" && current.type == NUMBER && !current.layoutBefore) {
+                long value = -stol(current.text);
+                if (!next()) return nullptr;
+                return engine.makeInt(arena, value);
+            }
+            int opPrec = prefix->second.prec;
+            if (opPrec > maxPrec) opPrec = 999;
+            int argMax = prefix->second.type == "fy" ? opPrec : opPrec - 1;
+            PrologEngine::Term* arg = parse(argMax);
+            if (!arg) return nullptr;
+            prec = opPrec;
+            return engine.makeCompound(arena, functor, {arg});
+        }
+        return engine.makeAtom(arena, functor);
+    }
+
+public:
+    PrologParser(PrologEngine& engine, deque<PrologEngine::Term>& arena, const string& src, bool fresh)
+        : engine(engine), arena(arena), src(src), fresh(fresh) {}
+
+    bool start() { return next(); }
+    bool atEnd() const { return current.type == END_OF_FILE; }
+    int variableCount() const { return numVars; }
+
+    PrologEngine::Term* parse(int maxPrec) {
+        int leftPrec;
+        PrologEngine::Term* left = parsePrimary(maxPrec, leftPrec);
+        if (!left) return nullptr;
+
+        while (true) {
+            string name;
+            if (current.type == NAME && !current.quoted) name = current.text;
+            else if (current.type == PUNCT && (current.text == "," || current.text == "|")) name = current.text;
+            else break;
+
+            auto op = infixOps().find(name);
+            if (op == infixOps().end() || op->second.prec > maxPrec) break;
+            int opPrec = op->second.prec;
+            int leftMax = op->second.type == "yfx" ? opPrec : opPrec - 1;
+            int rightMax = op->second.type == "xfy" ? opPrec : opPrec - 1;
+            if (leftPrec > leftMax) break;
+
+            if (!next()) return nullptr;
+            PrologEngine::Term* right = parse(rightMax);
+            if (!right) return nullptr;
+            int functor = engine.intern(name == "|" ? ";" : name);
+            left = engine.makeCompound(arena, functor, {left, right});
+            leftPrec = opPrec;
+        }
+        return left;
+    }
+
+    // Parse one clause terminated by '.'; returns nullptr at end of input
+    PrologEngine::Term* clause() {
+        varSlots.clear();
+        freshVars.clear();
+        numVars = 0;
+        if (atEnd()) return nullptr;
+        PrologEngine::Term* t = parse(1200);
+        if (!t) return nullptr;
+        if (current.type != END) {
+            fail("operator expected before '" + current.text + "'");
+            return nullptr;
+        }
+        if (!next()) return nullptr;
+        return t;
+    }
+};
+
+PrologEngine::PrologEngine() {
+    atomNil = intern("[]");
+    atomDot = intern(".");
+    atomArrow = intern("->");
+    atomMinus = intern("-");
+
+    const pair<const char*, pair<int, int>> table[] = {
+        {"true", {0, B_TRUE}}, {"fail", {0, B_FAIL}}, {"false", {0, B_FAIL}},
+        {",", {2, B_CONJ}}, {";", {2, B_DISJ}}, {"->", {2, B_ITE}},
+        {"\\+", {1, B_NOT}}, {"=", {2, B_UNIFY}}, {"\\=", {2, B_NOT_UNIFY}},
+        {"==", {2, B_EQ}}, {"member", {2, B_MEMBER}}, {"length", {2, B_LENGTH}},
+        {"findall", {3, B_FINDALL}}, {"sort", {2, B_SORT2}}, {"sort", {4, B_SORT4}},
+        {"msort", {2, B_MSORT}}, {"forall", {2, B_FORALL}}, {"format", {1, B_FORMAT1}},
+        {"format", {2, B_FORMAT2}}, {"nl", {0, B_NL}}, {"consult", {1, B_CONSULT}}
+    };
+    for (const auto& entry : table) {
+        builtins[predicateKey(intern(entry.first), entry.second.first)] = entry.second.second;
+    }
+}
+
+int PrologEngine::intern(const string& name) {
+    auto it = atomIds.find(name);
+    if (it != atomIds.end()) return it->second;
+    int id = static_cast<int>(atomNames.size());
+    atomNames.push_back(name);
+    atomIds[name] = id;
+    return id;
+}
+
+uint64_t PrologEngine::predicateKey(int functor, size_t arity) {
+    return (static_cast<uint64_t>(functor) << 8) | arity;
+}
+
+bool PrologEngine::firstArgKey(const Term* t, uint64_t& key) {
+    switch (t->kind) {
+        case Term::ATOM:
+            key = (1ull << 62) | static_cast<uint32_t>(t->functor);
+            return true;
+        case Term::INT:
+            key = (2ull << 62) | static_cast<uint32_t>(t->value);
+            return true;
+        case Term::COMPOUND:
+            key = (3ull << 62) | predicateKey(t->functor, t->args.size());
+            return true;
+        default:
+            return false;
+    }
+}
+
+void PrologEngine::buildIndex(Predicate& p) {
+    p.byFirstArg.clear();
+    p.varFirstArg.clear();
+    p.all.clear();
+    for (int i = 0; i < static_cast<int>(p.clauses.size()); ++i) {
+        p.all.push_back(i);
+        const Term* head = p.clauses[i].head;
+        uint64_t key;
+        if (head->args.empty() || !firstArgKey(head->args[0], key)) {
+            p.varFirstArg.push_back(i);
+            for (auto& entry : p.byFirstArg) entry.second.push_back(i);
+        } else {
+            auto it = p.byFirstArg.find(key);
+            if (it == p.byFirstArg.end()) {
+                it = p.byFirstArg.emplace(key, p.varFirstArg).first;
+            }
+            it->second.push_back(i);
+        }
+    }
+    p.indexed = true;
+}
+
+PrologEngine::Term* PrologEngine::makeAtom(deque<Term>& arena, int id) {
+    arena.push_back(Term());
+    Term* t = &arena.back();
+    t->kind = Term::ATOM;
+    t->functor = id;
+    return t;
+}
+
+PrologEngine::Term* PrologEngine::makeInt(deque<Term>& arena, long value) {
+    arena.push_back(Term());
+    Term* t = &arena.back();
+    t->kind = Term::INT;
+    t->value = value;
+    return t;
+}
+
+PrologEngine::Term* PrologEngine::makeVar() {
+    heap.push_back(Term());
+    Term* t = &heap.back();
+    t->kind = Term::VAR;
+    t->ground = false;
+    return t;
+}
+
+PrologEngine::Term* PrologEngine::makeCompound(deque<Term>& arena, int functor, const vector<Term*>& args) {
+    arena.push_back(Term());
+    Term* t = &arena.back();
+    t->kind = Term::COMPOUND;
+    t->functor = functor;
+    t->args = args;
+    for (Term* arg : args) {
+        if (!arg->ground) t->ground = false;
+    }
+    return t;
+}
+
+PrologEngine::Term* PrologEngine::makeList(const vector<Term*>& items) {
+    Term* list = makeAtom(heap, atomNil);
+    for (auto it = items.rbegin(); it != items.rend(); ++it) {
+        list = makeCompound(heap, atomDot, {*it, list});
+    }
+    return list;
+}
+
+PrologEngine::Term* PrologEngine::deref(Term* t) {
+    while (t->kind == Term::VAR && t->ref) t = t->ref;
+    return t;
+}
+
+void PrologEngine::bind(Term* var, Term* value) {
+    var->ref = value;
+    trail.push_back(var);
+}
+
+void PrologEngine::undo(size_t mark) {
+    while (trail.size() > mark) {
+        trail.back()->ref = nullptr;
+        trail.pop_back();
+    }
+}
+
+bool PrologEngine::unify(Term* a, Term* b) {
+    a = deref(a);
+    b = deref(b);
+    if (a == b) return true;
+    if (a->kind == Term::VAR) {
+        bind(a, b);
+        return true;
+    }
+    if (b->kind == Term::VAR) {
+        bind(b, a);
+        return true;
+    }
+    if (a->kind != b->kind) return false;
+    switch (a->kind) {
+        case Term::ATOM:
+            return a->functor == b->functor;
+        case Term::INT:
+            return a->value == b->value;
+        case Term::COMPOUND:
+            if (a->functor != b->functor || a->args.size() != b->args.size()) return false;
+            for (size_t i = 0; i < a->args.size(); ++i) {
+                if (!unify(a->args[i], b->args[i])) return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Standard order of terms: Var < Number < Atom < Compound
+int PrologEngine::compare(Term* a, Term* b) {
+    a = deref(a);
+    b = deref(b);
+    if (a == b) return 0;
+    static const int rank[] = {0, 2, 1, 3}; // VAR, ATOM, INT, COMPOUND
+    if (a->kind != b->kind) return rank[a->kind] < rank[b->kind] ? -1 : 1;
+    switch (a->kind) {
+        case Term::VAR:
+            return a < b ? -1 : 1;
+        case Term::INT:
+            return a->value < b->value ? -1 : (a->value > b->value ? 1 : 0);
+        case Term::ATOM:
+            return atomNames[a->functor].compare(atomNames[b->functor]) < 0 ? -1
+                 : (a->functor == b->functor ? 0 : 1);
+        case Term::COMPOUND: {
+            if (a->args.size() != b->args.size()) return a->args.size() < b->args.size() ? -1 : 1;
+            if (a->functor != b->functor) {
+                return atomNames[a->functor] < atomNames[b->functor] ? -1 : 1;
+            }
+            for (size_t i = 0; i < a->args.size(); ++i) {
+                int c = compare(a->args[i], b->args[i]);
+                if (c != 0) return c;
+            }
+            return 0;
+        }
+    }
+    return 0;
+}
+
+PrologEngine::Term* PrologEngine::renameClauseTerm(Term* t, vector<Term*>& vars) {
+    if (t->ground) return t;
+    if (t->kind == Term::VAR) {
+        Term*& slot = vars[t->functor];
+        if (!slot) slot = makeVar();
+        return slot;
+    }
+    vector<Term*> args;
+    args.reserve(t->args.size());
+    for (Term* arg : t->args) args.push_back(renameClauseTerm(arg, vars));
+    return makeCompound(heap, t->functor, args);
+}
+
+PrologEngine::Term* PrologEngine::copyResolved(Term* t) {
+    t = deref(t);
+    if (t->ground || t->kind == Term::VAR) return t;
+    vector<Term*> args;
+    args.reserve(t->args.size());
+    for (Term* arg : t->args) args.push_back(copyResolved(arg));
+    Term* copy = makeCompound(heap, t->functor, args);
+    return copy;
+}
+
+bool PrologEngine::listToVector(Term* list, vector<Term*>& items) {
+    list = deref(list);
+    while (list->kind == Term::COMPOUND && list->functor == atomDot && list->args.size() == 2) {
+        items.push_back(list->args[0]);
+        list = deref(list->args[1]);
+    }
+    return list->kind == Term::ATOM && list->functor == atomNil;
+}
+
+void PrologEngine::write(ostream& os, Term* t) {
+    t = deref(t);
+    switch (t->kind) {
+        case Term::VAR:
+            os << "_G" << reinterpret_cast<uintptr_t>(t) % 100000;
+            return;
+        case Term::ATOM:
+            os << atomNames[t->functor];
+            return;
+        case Term::INT:
+            os << t->value;
+            return;
+        case Term::COMPOUND:
+            break;
+    }
+    if (t->functor == atomDot && t->args.size() == 2) {
+        vector<Term*> items;
+        bool proper = listToVector(t, items);
+        os << "[";
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i) os << ",";
+            write(os, items[i]);
+        }
+        if (!proper) {
+            Term* tail = t;
+            for (size_t i = 0; i < items.size(); ++i) tail = deref(tail->args[1]);
+            os << "|";
+            write(os, tail);
+        }
+        os << "]";
+        return;
+    }
+    if (t->args.size() == 2 && infixOps().count(atomNames[t->functor])) {
+        write(os, t->args[0]);
+        os << atomNames[t->functor];
+        write(os, t->args[1]);
+        return;
+    }
+    os << atomNames[t->functor] << "(";
+    for (size_t i = 0; i < t->args.size(); ++i) {
+        if (i) os << ",";
+        write(os, t->args[i]);
+    }
+    os << ")";
+}
+
+bool PrologEngine::unifyThen(Term* a, Term* b, const Cont& k) {
+    size_t mark = trail.size();
+    bool stop = unify(a, b) && k();
+    undo(mark);
+    return stop;
+}
+
+// Prove `goal`, calling `k` for every solution. Returns true as soon as
+// a continuation asks to stop (or an error occurs); bindings made here
+// are always undone before returning.
+bool PrologEngine::solve(Term* goal, const Cont& k, int depth) {
+    if (!error.empty()) return true;
+    // Addresses compared as integers: the frames are unrelated objects.
+    // The stack grows down on every platform built here.
+    char marker;
+    uintptr_t here = reinterpret_cast<uintptr_t>(&marker);
+    if (depth > MAX_DEPTH || (here < stackBase && stackBase - here > MAX_STACK_BYTES)) {
+        error = "stack depth exceeded";
+        return true;
+    }
+    goal = deref(goal);
+    if (goal->kind == Term::VAR) {
+        error = "instantiation error: unbound goal";
+        return true;
+    }
+    if (goal->kind == Term::INT) {
+        error = "type error: callable expected";
+        return true;
+    }
+    auto builtin = builtins.find(predicateKey(goal->functor, goal->args.size()));
+    if (builtin != builtins.end()) {
+        return callBuiltin(builtin->second, goal, k, depth);
+    }
+    return callPredicate(goal, k, depth);
+}
+
+bool PrologEngine::callPredicate(Term* goal, const Cont& k, int depth) {
+    auto found = predicates.find(predicateKey(goal->functor, goal->args.size()));
+    if (found == predicates.end()) {
+        error = "unknown procedure " + atomNames[goal->functor] + "/" + to_string(goal->args.size());
+        return true;
+    }
+    Predicate& p = found->second;
+    if (!p.indexed) buildIndex(p);
+
+    const vector<int>* candidates = &p.all;
+    uint64_t key;
+    if (!goal->args.empty() && firstArgKey(deref(goal->args[0]), key)) {
+        auto it = p.byFirstArg.find(key);
+        candidates = it != p.byFirstArg.end() ? &it->second : &p.varFirstArg;
+    }
+
+    for (int index : *candidates) {
+        const Clause& clause = p.clauses[index];
+        size_t mark = trail.size();
+        size_t heapSize = heap.size();
+        vector<Term*> vars(clause.numVars, nullptr);
+        bool matched = true;
+        for (size_t i = 0; i < goal->args.size() && matched; ++i) {
+            matched = unify(goal->args[i], renameClauseTerm(clause.head->args[i], vars));
+        }
+        bool stop = false;
+        if (matched) {
+            stop = clause.body ? solve(renameClauseTerm(clause.body, vars), k, depth + 1) : k();
+        }
+        undo(mark);
+        if (stop) return true;
+        // Nothing can reference the terms of a clause that failed
+        if (!matched) heap.resize(heapSize);
+    }
+    return false;
+}
+
+bool PrologEngine::callBuiltin(int builtin, Term* goal, const Cont& k, int depth) {
+    const vector<Term*>& a = goal->args;
+    switch (builtin) {
+        case B_TRUE:
+            return k();
+        case B_FAIL:
+            return false;
+        case B_CONJ:
+            return solve(a[0], [&] { return solve(a[1], k, depth + 1); }, depth + 1);
+        case B_DISJ: {
+            Term* left = deref(a[0]);
+            if (left->kind == Term::COMPOUND && left->functor == atomArrow && left->args.size() == 2) {
+                // (Cond -> Then ; Else): commit to the first solution of Cond
+                bool condTrue = false;
+                bool stop = false;
+                solve(left->args[0], [&] {
+                    condTrue = true;
+                    stop = solve(left->args[1], k, depth + 1);
+                    return true;
+                }, depth + 1);
+                if (!error.empty()) return true;
+                if (condTrue) return stop;
+                return solve(a[1], k, depth + 1);
+            }
+            if (solve(a[0], k, depth + 1)) return true;
+            return solve(a[1], k, depth + 1);
+        }
+        case B_ITE: {
+            bool stop = false;
+            solve(a[0], [&] {
+                stop = solve(a[1], k, depth + 1);
+                return true;
+            }, depth + 1);
+            return !error.empty() || stop;
+        }
+        case B_NOT: {
+            bool found = solve(a[0], [] { return true; }, depth + 1);
+            if (!error.empty()) return true;
+            return found ? false : k();
+        }
+        case B_FORALL: {
+            // forall(C, A) is \+ (C, \+ A)
+            bool counterExample = solve(a[0], [&] {
+                return !solve(a[1], [] { return true; }, depth + 1);
+            }, depth + 1);
+            if (!error.empty()) return true;
+            return counterExample ? false : k();
+        }
+        case B_UNIFY:
+            return unifyThen(a[0], a[1], k);
+        case B_NOT_UNIFY: {
+            size_t mark = trail.size();
+            bool unifiable = unify(a[0], a[1]);
+            undo(mark);
+            return unifiable ? false : k();
+        }
+        case B_EQ:
+            return compare(a[0], a[1]) == 0 ? k() : false;
+        case B_MEMBER: {
+            Term* list = deref(a[1]);
+            while (list->kind == Term::COMPOUND && list->functor == atomDot && list->args.size() == 2) {
+                if (unifyThen(a[0], list->args[0], k)) return true;
+                list = deref(list->args[1]);
+            }
+            return false;
+        }
+        case B_LENGTH: {
+            vector<Term*> items;
+            if (!listToVector(a[0], items)) {
+                error = "length/2: partial lists are not supported";
+                return true;
+            }
+            return unifyThen(a[1], makeInt(heap, static_cast<long>(items.size())), k);
+        }
+        case B_FINDALL: {
+            vector<Term*> results;
+            solve(a[1], [&] {
+                results.push_back(copyResolved(a[0]));
+                return false;
+            }, depth + 1);
+            if (!error.empty()) return true;
+            return unifyThen(a[2], makeList(results), k);
+        }
+        case B_SORT2:
+        case B_MSORT:
+        case B_SORT4: {
+            bool four = builtin == B_SORT4;
+            vector<Term*> items;
+            if (!listToVector(four ? a[2] : a[0], items)) {
+                error = "sort: list expected";
+                return true;
+            }
+            long keyIndex = 0;
+            string order = builtin == B_MSORT ? "@=<" : "@<";
+            if (four) {
+                Term* keyTerm = deref(a[0]);
+                Term* orderTerm = deref(a[1]);
+                if (keyTerm->kind != Term::INT || orderTerm->kind != Term::ATOM) {
+                    error = "sort/4: key and order must be bound";
+                    return true;
+                }
+                keyIndex = keyTerm->value;
+                order = atomNames[orderTerm->functor];
+            }
+            auto keyOf = [&](Term* t) -> Term* {
+                if (keyIndex == 0) return t;
+                t = deref(t);
+                if (t->kind != Term::COMPOUND || keyIndex > static_cast<long>(t->args.size())) return t;
+                return t->args[keyIndex - 1];
+            };
+            bool descending = order == "@>" || order == "@>=";
+            bool dedupe = order == "@<" || order == "@>";
+            stable_sort(items.begin(), items.end(), [&](Term* x, Term* y) {
+                int c = compare(keyOf(x), keyOf(y));
+                return descending ? c > 0 : c < 0;
+            });
+            if (dedupe) {
+                items.erase(unique(items.begin(), items.end(), [&](Term* x, Term* y) {
+                    return compare(keyOf(x), keyOf(y)) == 0;
+                }), items.end());
+            }
+            return unifyThen(four ? a[3] : a[1], makeList(items), k);
+        }
+        case B_FORMAT1:
+        case B_FORMAT2: {
+            Term* fmt = deref(a[0]);
+            vector<Term*> fmtArgs;
+            if (builtin == B_FORMAT2 && !listToVector(a[1], fmtArgs)) fmtArgs.push_back(a[1]);
+            ostringstream text;
+            string f = fmt->kind == Term::ATOM ? atomNames[fmt->functor] : "";
+            size_t next = 0;
+            for (size_t i = 0; i < f.size(); ++i) {
+                if (f[i] != '~' || i + 1 >= f.size()) {
+                    text << f[i];
+                    continue;
+                }
+                char d = f[++i];
+                if (d == 'n') text << "\n";
+                else if (d == '~') text << "~";
+                else if (next < fmtArgs.size()) write(text, fmtArgs[next++]);
+            }
+            if (out) *out << text.str();
+            return k();
+        }
+        case B_NL:
+            if (out) *out << "\n";
+            return k();
+        case B_CONSULT: {
+            Term* file = deref(a[0]);
+            if (file->kind != Term::ATOM || !loadFile(atomNames[file->functor])) return true;
+            return k();
+        }
+    }
+    return false;
+}
+
+bool PrologEngine::runQuery(Term* goal, const function<void()>& onSolution) {
+    error.clear();
+    bool found = false;
+    char base;
+    bool outermost = stackBase == 0;
+    if (outermost) stackBase = reinterpret_cast<uintptr_t>(&base);
+    solve(goal, [&] {
+        found = true;
+        onSolution();
+        return true;
+    }, 0);
+    if (outermost) stackBase = 0;
+    trail.clear();
+    heap.clear();
+    return found && error.empty();
+}
+
+void PrologEngine::addClause(Term* clause, int numVars) {
+    Term* head = clause;
+    Term* body = nullptr;
+    if (clause->kind == Term::COMPOUND && atomNames[clause->functor] == ":-" && clause->args.size() == 2) {
+        head = clause->args[0];
+        body = clause->args[1];
+    }
+    Predicate& p = predicates[predicateKey(head->functor, head->args.size())];
+    p.clauses.push_back({head, body, numVars});
+    p.indexed = false;
+}
+
+bool PrologEngine::loadFile(const string& path) {
+    string resolved = path;
+    ifstream file(resolved);
+    if (!file.is_open()) {
+        resolved = path + ".pl";
+        file.open(resolved);
+    }
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    if (!loadedFiles.insert(resolved).second) return true;
+
+    stringstream buffer;
+    buffer << file.rdbuf();
+    string src = buffer.str();
+    string dir;
+    size_t slash = resolved.find_last_of("/\\");
+    if (slash != string::npos) dir = resolved.substr(0, slash + 1);
+
+    PrologParser parser(*this, programTerms, src, false);
+    if (!parser.start()) return false;
+    while (!parser.atEnd()) {
+        Term* clause = parser.clause();
+        if (!clause) return false;
+        if (clause->kind == Term::COMPOUND && atomNames[clause->functor] == ":-" && clause->args.size() == 1) {
+            // Only consult/1 directives are honoured, relative to this file
+            Term* directive = clause->args[0];
+            if (directive->kind == Term::COMPOUND && atomNames[directive->functor] == "consult" &&
+                directive->args.size() == 1 && directive->args[0]->kind == Term::ATOM) {
+                if (!loadFile(dir + atomNames[directive->args[0]->functor])) return false;
+            }
+            continue;
+        }
+        if (clause->kind == Term::VAR || clause->kind == Term::INT) {
+            error = "invalid clause in " + resolved;
+            return false;
+        }
+        addClause(clause, parser.variableCount());
+    }
+    return true;
+}
+
+bool PrologEngine::consult(const string& path) {
+    error.clear();
+    bool ok = loadFile(path);
+    if (!ok && error.empty()) error = "failed to load " + path;
+    return ok;
+}
+
+const string& PrologEngine::lastError() const {
+    return error;
+}
+
+vector<string> PrologEngine::diagnose(const vector<string>& symptomAtoms) {
+    vector<Term*> items;
+    for (const auto& atom : symptomAtoms) items.push_back(makeAtom(heap, intern(atom)));
+    Term* result = makeVar();
+    Term* goal = makeCompound(heap, intern("diagnose"), {makeList(items), result});
+
+    vector<string> diseases;
+    runQuery(goal, [&] {
+        vector<Term*> list;
+        listToVector(result, list);
+        for (Term* t : list) {
+            t = deref(t);
+            if (t->kind == Term::ATOM) diseases.push_back(atomNames[t->functor]);
+        }
+    });
+    return diseases;
+}
+
+vector<pair<string, int>> PrologEngine::diagnoseDetailed(const vector<string>& symptomAtoms) {
+    vector<Term*> items;
+    for (const auto& atom : symptomAtoms) items.push_back(makeAtom(heap, intern(atom)));
+    Term* result = makeVar();
+    Term* goal = makeCompound(heap, intern("diagnose_detailed"), {makeList(items), result});
+
+    vector<pair<string, int>> scored;
+    runQuery(goal, [&] {
+        vector<Term*> list;
+        listToVector(result, list);
+        for (Term* t : list) {
+            t = deref(t);
+            if (t->kind != Term::COMPOUND || t->functor != atomMinus || t->args.size() != 2) continue;
+            Term* disease = deref(t->args[0]);
+            Term* score = deref(t->args[1]);
+            if (disease->kind == Term::ATOM && score->kind == Term::INT) {
+                scored.push_back({atomNames[disease->functor], static_cast<int>(score->value)});
+            }
+        }
+    });
+    return scored;
+}
+
+bool PrologEngine::runGoal(const string& goalText, string& output) {
+    string src = goalText + " .";
+    error.clear();
+    PrologParser parser(*this, heap, src, true);
+    Term* goal = parser.start() ? parser.clause() : nullptr;
+    if (!goal) {
+        heap.clear();
+        return false;
+    }
+    ostringstream captured;
+    out = &captured;
+    bool ok = runQuery(goal, [] {});
+    out = nullptr;
+    output = captured.str();
+    return ok;
+}
+
+vector<vector<string>> PrologEngine::collectCallArguments(const string& name, int arity, int argIndex) {
+    vector<vector<string>> found;
+    auto idIt = atomIds.find(name);
+    if (idIt == atomIds.end()) return found;
+    int functor = idIt->second;
+
+    function<void(Term*)> visit = [&](Term* t) {
+        if (t->kind != Term::COMPOUND) return;
+        if (t->functor == functor && static_cast<int>(t->args.size()) == arity) {
+            vector<Term*> items;
+            if (listToVector(t->args[argIndex], items)) {
+                vector<string> atoms;
+                bool allAtoms = true;
+                for (Term* item : items) {
+                    if (item->kind != Term::ATOM) allAtoms = false;
+                    else atoms.push_back(atomNames[item->functor]);
+                }
+                if (allAtoms) found.push_back(atoms);
+            }
+        }
+        for (Term* arg : t->args) visit(arg);
+    };
+    for (auto& entry : predicates) {
+        for (const Clause& clause : entry.second.clauses) {
+            if (clause.body) visit(clause.body);
+        }
+    }
+    return found;
+}
@@ -0,0 +1,121 @@
+// Embedded engine for the Prolog knowledge base in prolog_version/
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Map between the C++ vocabulary and the Prolog atoms
+string symptomAtom(const string& symptom);      // "runny nose" -> runny_nose
+string diseaseDisplayName(const string& atom);  // covid19 -> "COVID-19"
+
+// Interprets the subset of Prolog used by knowledge_base.pl and
+// diagnosis.pl: facts and rules with conjunction, disjunction,
+// if-then-else, \+, member/2, length/2, findall/3, sort/2,4 and format.
+// Clauses are compiled into per-predicate tables indexed on their
+// first argument.
+class PrologEngine {
+public:
+    struct Term {
+        enum Kind : uint8_t { VAR, ATOM, INT, COMPOUND };
+        Kind kind;
+        bool ground = true;
+        int functor = 0;       // atom id, or variable slot in a clause
+        long value = 0;        // INT
+        Term* ref = nullptr;   // binding of a runtime variable
+        vector<Term*> args;
+    };
+
+private:
+    struct Clause {
+        Term* head;
+        Term* body;            // nullptr for facts
+        int numVars;
+    };
+
+    struct Predicate {
+        vector<Clause> clauses;
+        // Clause numbers per first-argument key, merged in source order
+        // with the clauses whose first argument is a variable
+        unordered_map<uint64_t, vector<int>> byFirstArg;
+        vector<int> varFirstArg;
+        vector<int> all;
+        bool indexed = false;
+    };
+
+    using Cont = function<bool()>;
+
+    vector<string> atomNames;
+    unordered_map<string, int> atomIds;
+    unordered_map<uint64_t, Predicate> predicates;
+    unordered_map<uint64_t, int> builtins;
+    set<string> loadedFiles;
+
+    deque<Term> programTerms;  // compiled clauses, kept for the engine lifetime
+    deque<Term> heap;          // per-query terms, released after each query
+    vector<Term*> trail;
+    string error;
+    ostream* out = nullptr;
+    // Where the outermost query started on the native stack
+    uintptr_t stackBase = 0;
+
+    int atomNil, atomDot, atomArrow, atomMinus;
+
+    int intern(const string& name);
+    static uint64_t predicateKey(int functor, size_t arity);
+    static bool firstArgKey(const Term* t, uint64_t& key);
+    void buildIndex(Predicate& p);
+
+    Term* makeAtom(deque<Term>& arena, int id);
+    Term* makeInt(deque<Term>& arena, long value);
+    Term* makeVar();
+    Term* makeCompound(deque<Term>& arena, int functor, const vector<Term*>& args);
+    Term* makeList(const vector<Term*>& items);
+
+    static Term* deref(Term* t);
+    void bind(Term* var, Term* value);
+    void undo(size_t mark);
+    bool unify(Term* a, Term* b);
+    int compare(Term* a, Term* b);
+    Term* renameClauseTerm(Term* t, vector<Term*>& vars);
+    Term* copyResolved(Term* t);
+    bool listToVector(Term* list, vector<Term*>& items);
+    void write(ostream& os, Term* t);
+
+    bool solve(Term* goal, const Cont& k, int depth);
+    bool callPredicate(Term* goal, const Cont& k, int depth);
+    bool callBuiltin(int builtin, Term* goal, const Cont& k, int depth);
+    bool unifyThen(Term* a, Term* b, const Cont& k);
+    bool runQuery(Term* goal, const function<void()>& onSolution);
+
+    bool loadFile(const string& path);
+    void addClause(Term* clause, int numVars);
+
+    friend class PrologParser;
+
+public:
+    PrologEngine();
+
+    // Load a .pl file; `:- consult(x)` directives are followed relative
+    // to the file. Returns false and sets lastError() on failure.
+    bool consult(const string& path);
+    const string& lastError() const;
+
+    // diagnose/2 and diagnose_detailed/2 on a list of symptom atoms
+    vector<string> diagnose(const vector<string>& symptomAtoms);
+    vector<pair<string, int>> diagnoseDetailed(const vector<string>& symptomAtoms);
+
+    // Run a goal once, capturing anything it prints with format/nl
+    bool runGoal(const string& goalText, string& output);
+
+    // Every ground list passed as argument `argIndex` of a call to
+    // name/arity in the bodies of the loaded clauses
+    vector<vector<string>> collectCallArguments(const string& name, int arity, int argIndex);
+};
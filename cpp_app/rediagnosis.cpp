@@ -0,0 +1,271 @@
+// Population re-diagnosis implementation
+#include "rediagnosis.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <vector>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// One column per distinct disease; several rules may name the same one
+struct DiseaseColumns {
+    vector<string> names;
+    vector<int> columnOfRule;
+
+    explicit DiseaseColumns(const RuleSet& rules) {
+        for (const auto& rule : rules.getRules()) names.push_back(rule.disease);
+        sort(names.begin(), names.end());
+        names.erase(unique(names.begin(), names.end()), names.end());
+        for (const auto& rule : rules.getRules()) {
+            columnOfRule.push_back(static_cast<int>(lower_bound(names.begin(), names.end(), rule.disease) - names.begin()));
+        }
+    }
+};
+
+// counts = {patients, undiagnosed, one count per disease column}
+void countRange(const PatientSnapshot& patients, const RuleSet& rules, const DiseaseColumns& columns, int64_t first,
+                int64_t end, vector<uint64_t>& counts) {
+    fill(counts.begin(), counts.end(), 0);
+    for (auto it = patients.from(static_cast<int>(first)); it != patients.end() && it->getId() < end; ++it) {
+        uint64_t matches = rules.evaluate(toSymptomMask(it->symptoms), static_cast<int>(it->symptoms.size()));
+        counts[0]++;
+        if (matches == 0) counts[1]++;
+        uint64_t diseases = 0;
+        for (; matches != 0; matches &= matches - 1) {
+            diseases |= uint64_t(1) << columns.columnOfRule[countr_zero(matches)];
+        }
+        for (; diseases != 0; diseases &= diseases - 1) counts[2 + countr_zero(diseases)]++;
+    }
+}
+
+void addCounts(RediagnosisResult& result, const DiseaseColumns& columns, const vector<uint64_t>& counts) {
+    result.patients += counts[0];
+    result.undiagnosed += counts[1];
+    for (size_t i = 0; i < columns.names.size(); ++i) {
+        if (counts[2 + i] != 0) result.diseaseCounts[columns.names[i]] += counts[2 + i];
+    }
+}
+
+#ifndef _WIN32
+bool readFully(int fd, void* data, size_t size) {
+    char* out = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = read(fd, out, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        out += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// MSG_NOSIGNAL: a dead peer is an error to handle, not a SIGPIPE
+bool writeFully(int fd, const void* data, size_t size) {
+    const char* in = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, in, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        in += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+struct Worker {
+    pid_t pid = -1;
+    int fd = -1;
+    int64_t range = -1; // range being processed, -1 when idle
+    chrono::steady_clock::time_point deadline; // for the current range
+};
+
+// Worker process: answer range requests until the coordinator hangs up.
+// Only the inherited snapshot and rules are used, and the process ends
+// with _exit(), since the other threads of the parent do not exist here.
+[[noreturn]] void runWorker(int fd, int number, const PatientSnapshot& patients, const RuleSet& rules,
+                            const DiseaseColumns& columns, int64_t rangeSize, const RediagnosisOptions& options) {
+    vector<uint64_t> reply(3 + columns.names.size());
+    vector<uint64_t> counts(2 + columns.names.size());
+    int done = 0;
+    uint64_t range;
+    while (readFully(fd, &range, sizeof(range))) {
+        if (number == options.failWorker && done == options.failAfter) {
+            if (!options.failByHanging) _exit(3);
+            while (true) pause(); // until the coordinator kills us
+        }
+        int64_t first = static_cast<int64_t>(range) * rangeSize;
+        countRange(patients, rules, columns, first, first + rangeSize, counts);
+        reply[0] = range;
+        copy(counts.begin(), counts.end(), reply.begin() + 1);
+        if (!writeFully(fd, reply.data(), reply.size() * sizeof(uint64_t))) break;
+        done++;
+    }
+    _exit(0);
+}
+
+bool spawnWorker(Worker& worker, int number, const vector<Worker>& others, const PatientSnapshot& patients,
+                 const RuleSet& rules, const DiseaseColumns& columns, int64_t rangeSize,
+                 const RediagnosisOptions& options) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+    cout.flush(); // or the child would inherit, and later repeat, buffered output
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        for (const auto& other : others) {
+            if (other.fd >= 0) close(other.fd);
+        }
+        runWorker(fds[1], number, patients, rules, columns, rangeSize, options);
+    }
+    close(fds[1]);
+    worker.pid = pid;
+    worker.fd = fds[0];
+    worker.range = -1;
+    return true;
+}
+
+void stopWorker(Worker& worker) {
+    if (worker.fd >= 0) close(worker.fd);
+    // An idle worker exits once its socket closes; a busy one may be stuck
+    if (worker.pid > 0 && worker.range >= 0) kill(worker.pid, SIGKILL);
+    if (worker.pid > 0) waitpid(worker.pid, nullptr, 0);
+    worker.fd = -1;
+    worker.pid = -1;
+    worker.range = -1;
+}
+#endif
+
+} // namespace
+
+RediagnosisResult rediagnoseInProcess(const PatientSnapshot& patients, const RuleSet& rules) {
+    RediagnosisResult result;
+    DiseaseColumns columns(rules);
+    vector<uint64_t> counts(2 + columns.names.size());
+    countRange(patients, rules, columns, 0, INT64_MAX, counts);
+    addCounts(result, columns, counts);
+    result.ranges = 1;
+    return result;
+}
+
+RediagnosisResult rediagnoseInWorkers(const PatientSnapshot& patients, const RuleSet& rules,
+                                      const RediagnosisOptions& options) {
+#ifdef _WIN32
+    (void)options;
+    return rediagnoseInProcess(patients, rules);
+#else
+    RediagnosisResult result;
+    if (patients.empty()) return result;
+    DiseaseColumns columns(rules);
+    int workerCount = max(1, options.workers);
+    int64_t highestId = patients.back().getId();
+    int64_t rangeSize = options.rangeSize > 0 ? options.rangeSize : highestId / (workerCount * 8) + 1;
+    result.ranges = static_cast<int>(highestId / rangeSize + 1);
+
+    deque<int64_t> pending;
+    for (int64_t range = 0; range < result.ranges; ++range) pending.push_back(range);
+    vector<Worker> workers(min(workerCount, result.ranges));
+    int spawned = 0;
+    for (auto& worker : workers) {
+        if (!spawnWorker(worker, spawned++, workers, patients, rules, columns, rangeSize, options)) {
+            result.error = "could not start a worker process";
+        }
+    }
+
+    vector<uint64_t> reply(3 + columns.names.size());
+    vector<uint64_t> counts(2 + columns.names.size());
+    int completed = 0;
+    vector<pollfd> polled;
+    vector<Worker*> polledWorkers;
+    auto rangeTimeout = chrono::milliseconds(max(1, options.rangeTimeoutMs));
+    // The range goes back in the queue and the worker is stopped
+    auto fail = [&](Worker& worker) {
+        pending.push_front(worker.range);
+        result.rangesReassigned++;
+        result.workerFailures++;
+        stopWorker(worker);
+        if (result.workerFailures > 2 * workerCount) result.error = "too many worker failures";
+    };
+    while (completed < result.ranges && result.error.empty()) {
+        // Hand out ranges to idle workers; replace workers if all have died
+        bool anyAlive = false;
+        for (auto& worker : workers) anyAlive = anyAlive || worker.fd >= 0;
+        if (!anyAlive) {
+            if (!spawnWorker(workers[0], spawned++, workers, patients, rules, columns, rangeSize, options)) {
+                result.error = "could not start a replacement worker";
+                break;
+            }
+        }
+        polled.clear();
+        polledWorkers.clear();
+        auto now = chrono::steady_clock::now();
+        auto nextDeadline = chrono::steady_clock::time_point::max();
+        for (auto& worker : workers) {
+            if (worker.fd < 0) continue;
+            if (worker.range < 0 && !pending.empty()) {
+                worker.range = pending.front();
+                worker.deadline = now + rangeTimeout;
+                pending.pop_front();
+                uint64_t request = static_cast<uint64_t>(worker.range);
+                writeFully(worker.fd, &request, sizeof(request)); // a failure shows up as a hang-up below
+            }
+            if (worker.range >= 0) {
+                polled.push_back({worker.fd, POLLIN, 0});
+                polledWorkers.push_back(&worker);
+                nextDeadline = min(nextDeadline, worker.deadline);
+            }
+        }
+        // Wake up for the earliest deadline, so a stuck worker cannot hold
+        // up the run
+        auto wait = chrono::duration_cast<chrono::milliseconds>(nextDeadline - now).count();
+        int timeout = static_cast<int>(min<int64_t>(max<int64_t>(wait + 1, 0), INT32_MAX));
+        if (poll(polled.data(), polled.size(), timeout) < 0) {
+            if (errno == EINTR) continue;
+            result.error = "poll failed";
+            break;
+        }
+
+        now = chrono::steady_clock::now();
+        for (size_t i = 0; i < polled.size() && result.error.empty(); ++i) {
+            Worker& worker = *polledWorkers[i];
+            if (polled[i].revents == 0) {
+                if (now < worker.deadline) continue;
+                // No answer in time: kill it (in stopWorker) and reassign
+                result.workersTimedOut++;
+                fail(worker);
+                continue;
+            }
+            if (readFully(worker.fd, reply.data(), reply.size() * sizeof(uint64_t)) &&
+                reply[0] == static_cast<uint64_t>(worker.range)) {
+                copy(reply.begin() + 1, reply.end(), counts.begin());
+                addCounts(result, columns, counts);
+                completed++;
+                worker.range = -1;
+                continue;
+            }
+            // The worker died or sent garbage
+            fail(worker);
+        }
+    }
+
+    for (auto& worker : workers) stopWorker(worker);
+    return result;
+#endif
+}
@@ -0,0 +1,49 @@
+// Re-diagnosis of the whole population, split across worker processes
+#pragma once
+#include "patient_store.h"
+#include "rule_set.h"
+#include <cstdint>
+#include <map>
+#include <string>
+
+using namespace std;
+
+struct RediagnosisOptions {
+    int workers = 4;
+    int rangeSize = 0; // patient IDs per range; 0 gives each worker about 8 ranges
+    // A worker still holding a range after this long is killed and the
+    // range handed to another worker
+    int rangeTimeoutMs = 60000;
+    // Testing: worker number `failWorker` exits (or, with `failByHanging`,
+    // stops answering) after `failAfter` ranges
+    int failWorker = -1;
+    int failAfter = 0;
+    bool failByHanging = false;
+};
+
+struct RediagnosisResult {
+    uint64_t patients = 0;
+    uint64_t undiagnosed = 0; // patients no rule matched
+    map<string, uint64_t> diseaseCounts;
+    int ranges = 0;
+    int workerFailures = 0; // crashed or timed out
+    int workersTimedOut = 0;
+    int rangesReassigned = 0;
+    string error; // empty when every range was processed
+
+    bool sameCounts(const RediagnosisResult& other) const {
+        return patients == other.patients && undiagnosed == other.undiagnosed && diseaseCounts == other.diseaseCounts;
+    }
+};
+
+// Forks `workers` processes that inherit the snapshot and the rules, so
+// nothing is reloaded or copied up front. The coordinator splits the
+// patient IDs into ranges and sends them one at a time over a socket
+// pair per worker; each worker replies with per-disease counts for the
+// range. A range held by a worker that dies, or that does not answer
+// within rangeTimeoutMs, is given to another worker, and a replacement
+// is forked if none are left. On Windows this runs in-process.
+RediagnosisResult rediagnoseInWorkers(const PatientSnapshot& patients, const RuleSet& rules,
+                                      const RediagnosisOptions& options = RediagnosisOptions());
+// The same counts computed in this process
+RediagnosisResult rediagnoseInProcess(const PatientSnapshot& patients, const RuleSet& rules);
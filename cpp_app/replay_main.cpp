@@ -0,0 +1,95 @@
+// medicheck_replay: re-run a trace recorded with `medicheck --record FILE`
+// and report throughput and latency percentiles
+#include "patient_manager.h"
+#include "rule_registry.h"
+#include "workload_trace.h"
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+void usage() {
+    cout << "Usage: medicheck_replay TRACE [--recorded-speed] [--repeat N] [--rules FILE]\n"
+         << "  --recorded-speed  wait between calls as in the recording (default: back to back)\n"
+         << "  --repeat N        replay N times, each from the recorded starting state\n"
+         << "  --rules FILE      diagnose with these rules instead of the built-in ones\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    string tracePath;
+    string rulesPath;
+    bool recordedSpeed = false;
+    int repeat = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--recorded-speed") == 0) {
+            recordedSpeed = true;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rulesPath = argv[++i];
+        } else if (argv[i][0] != '-' && tracePath.empty()) {
+            tracePath = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (tracePath.empty()) {
+        usage();
+        return 1;
+    }
+
+    vector<TraceEvent> events;
+    string error;
+    if (!readTrace(tracePath, events, error)) {
+        if (events.empty()) {
+            cout << "Error: " << error << "\n";
+            return 1;
+        }
+        cout << "Warning: " << error << "; replaying the events before it\n";
+    }
+    if (!rulesPath.empty()) rulesPath = filesystem::absolute(rulesPath).string();
+
+    // The replay writes patients like the application does, so it runs in
+    // a scratch directory instead of next to real data files
+    char scratch[] = "/tmp/medicheck_replay.XXXXXX";
+    if (!mkdtemp(scratch) || chdir(scratch) != 0) {
+        cout << "Error: cannot create a scratch directory\n";
+        return 1;
+    }
+    filesystem::create_directory("data");
+
+    int status = 0;
+    for (int run = 1; run <= repeat && status == 0; ++run) {
+        if (!restoreTraceState(events, error)) {
+            cout << "Error: " << error << "\n";
+            status = 1;
+            break;
+        }
+        ReplayReport report;
+        {
+            RuleRegistry rules;
+            if (!rulesPath.empty() && !rules.reload(rulesPath, error)) {
+                cout << "Error: " << error << "\n";
+                status = 1;
+                break;
+            }
+            PatientManager manager;
+            manager.loadDataFromCSV(PatientManager::EAGER);
+            report = replayTrace(events, manager, rules, recordedSpeed);
+            manager.flushPersistence();
+        }
+        if (repeat > 1) cout << "Run " << run << ":\n";
+        cout << report.format();
+        for (const auto& entry : filesystem::directory_iterator("data")) filesystem::remove(entry.path());
+    }
+    filesystem::remove_all(scratch);
+    return status;
+}
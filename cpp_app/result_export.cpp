@@ -0,0 +1,435 @@
+// Binary diagnosis result export implementation
+#include "result_export.h"
+#include "atomic_file.h"
+#include <algorithm>
+#include <cstring>
+#ifdef MEDICHECK_USE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[4] = {'M', 'C', 'D', 'X'};
+const uint8_t FORMAT_VERSION = 1;
+
+// How a block's columns are stored
+enum Codec : uint8_t { CODEC_NONE = 0, CODEC_LZ = 1, CODEC_ZSTD = 2 };
+
+void putVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool getVarint(const string& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// A small LZ77 codec in the spirit of LZ4, used when no compression
+// library is built in. Stream: repeated (literal count, literals,
+// match length, match offset) as varints; the last run has no match.
+const int LZ_MIN_MATCH = 4;
+const int LZ_HASH_BITS = 14;
+
+uint32_t read32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+void lzCompress(const string& in, string& out) {
+    out.clear();
+    vector<int> table(1 << LZ_HASH_BITS, -1);
+    size_t n = in.size();
+    size_t anchor = 0, pos = 0;
+    while (pos + LZ_MIN_MATCH <= n) {
+        uint32_t hash = (read32(&in[pos]) * 2654435761u) >> (32 - LZ_HASH_BITS);
+        int candidate = table[hash];
+        table[hash] = static_cast<int>(pos);
+        if (candidate < 0 || read32(&in[candidate]) != read32(&in[pos])) {
+            pos++;
+            continue;
+        }
+        size_t length = LZ_MIN_MATCH;
+        while (pos + length < n && in[candidate + length] == in[pos + length]) length++;
+        putVarint(out, pos - anchor);
+        out.append(in, anchor, pos - anchor);
+        putVarint(out, length - LZ_MIN_MATCH);
+        putVarint(out, pos - candidate);
+        pos += length;
+        anchor = pos;
+    }
+    putVarint(out, n - anchor);
+    out.append(in, anchor, n - anchor);
+}
+
+bool lzDecompress(const string& in, size_t rawSize, string& out) {
+    out.clear();
+    // rawSize comes from the block header, so it is not trusted for the
+    // allocation; the output only grows as far as the data really goes
+    out.reserve(min<size_t>(rawSize, in.size() * 4));
+    size_t pos = 0;
+    while (pos < in.size()) {
+        uint64_t literals, length, offset;
+        if (!getVarint(in, pos, literals) || literals > in.size() - pos) return false;
+        out.append(in, pos, literals);
+        pos += literals;
+        if (pos == in.size()) break;
+        if (!getVarint(in, pos, length) || !getVarint(in, pos, offset)) return false;
+        length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > out.size() || out.size() + length > rawSize) return false;
+        // Byte by byte, since a match may overlap what it is copying
+        size_t from = out.size() - offset;
+        for (uint64_t i = 0; i < length; ++i) out += out[from + i];
+    }
+    return out.size() == rawSize;
+}
+
+} // namespace
+
+string exportCompression() {
+#ifdef MEDICHECK_USE_ZSTD
+    return "zstd";
+#else
+    return "lz";
+#endif
+}
+
+bool DiseaseDictionary::load(const string& path, DiseaseDictionary& out, string& error) {
+    out = DiseaseDictionary();
+    ifstream file(path);
+    if (!file) return true;
+    string line;
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        if (out.idFor(line) < 0) {
+            error = path + ": more than " + to_string(MAX_DISEASES) + " diseases";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DiseaseDictionary::save(const string& path, string& error) const {
+    string text;
+    for (const auto& name : names) text += name + "\n";
+    return replaceFileAtomically(path, text, error);
+}
+
+int DiseaseDictionary::idFor(const string& name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+    if (static_cast<int>(names.size()) >= MAX_DISEASES) return -1;
+    int id = static_cast<int>(names.size());
+    names.push_back(name);
+    ids[name] = id;
+    return id;
+}
+
+int DiseaseDictionary::find(const string& name) const {
+    auto it = ids.find(name);
+    return it == ids.end() ? -1 : it->second;
+}
+
+const vector<string>& DiseaseDictionary::getNames() const {
+    return names;
+}
+
+bool DiseaseDictionary::maskFor(const vector<string>& diseases, uint64_t& mask, string& error) {
+    mask = 0;
+    for (const auto& disease : diseases) {
+        int id = idFor(disease);
+        if (id < 0) {
+            error = "more than " + to_string(MAX_DISEASES) + " diseases; no ID left for " + disease;
+            return false;
+        }
+        mask |= uint64_t(1) << id;
+    }
+    return true;
+}
+
+vector<string> DiseaseDictionary::namesFor(uint64_t mask) const {
+    vector<string> result;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (mask & (uint64_t(1) << i)) result.push_back(names[i]);
+    }
+    return result;
+}
+
+bool ResultWriter::open(const string& filePath, string& error, bool useCompression, size_t recordsPerBlock) {
+    path = filePath;
+    compress = useCompression;
+    blockSize = recordsPerBlock == 0 ? 1 : recordsPerBlock;
+    written = 0;
+    block.clear();
+    // Written beside the target and renamed over it on close, so a reader
+    // never sees a half-written export
+    out.open(path + ".tmp", ios::binary | ios::trunc);
+    if (!out) {
+        error = "cannot create " + path + ".tmp";
+        return false;
+    }
+    out.write(MAGIC, 4);
+    out.put(static_cast<char>(FORMAT_VERSION));
+    return true;
+}
+
+void ResultWriter::discard() {
+    out.close();
+    remove((path + ".tmp").c_str());
+    block.clear();
+}
+
+void ResultWriter::add(int patientId, uint64_t diseases) {
+    block.push_back({patientId, diseases});
+    written++;
+    if (block.size() >= blockSize) writeBlock();
+}
+
+uint64_t ResultWriter::recordCount() const {
+    return written;
+}
+
+void ResultWriter::writeBlock() {
+    if (block.empty()) return;
+
+    // Columns: ID deltas (IDs are usually ascending, so mostly 1), then masks
+    raw.clear();
+    int64_t previous = block.front().patientId;
+    for (const auto& record : block) {
+        putVarint(raw, zigzag(static_cast<int64_t>(record.patientId) - previous));
+        previous = record.patientId;
+    }
+    for (const auto& record : block) putVarint(raw, record.diseases);
+
+    Codec codec = CODEC_NONE;
+    const string* payload = &raw;
+    if (compress) {
+#ifdef MEDICHECK_USE_ZSTD
+        compressed.resize(ZSTD_compressBound(raw.size()));
+        size_t size = ZSTD_compress(&compressed[0], compressed.size(), raw.data(), raw.size(), 3);
+        if (!ZSTD_isError(size)) {
+            compressed.resize(size);
+            codec = CODEC_ZSTD;
+        }
+#else
+        lzCompress(raw, compressed);
+        codec = CODEC_LZ;
+#endif
+        if (codec != CODEC_NONE && compressed.size() < raw.size()) {
+            payload = &compressed;
+        } else {
+            codec = CODEC_NONE;
+        }
+    }
+
+    string header;
+    putVarint(header, block.size());
+    putVarint(header, zigzag(block.front().patientId));
+    header += static_cast<char>(codec);
+    putVarint(header, raw.size());
+    putVarint(header, payload->size());
+    uint32_t checksum = crc32(raw);
+    for (int i = 0; i < 4; ++i) header += static_cast<char>((checksum >> (8 * i)) & 0xFF);
+
+    out.write(header.data(), header.size());
+    out.write(payload->data(), payload->size());
+    block.clear();
+}
+
+bool ResultWriter::close(const DiseaseDictionary& dictionary, string& error) {
+    writeBlock();
+
+    // Dictionary after the data, so names first seen while writing are included
+    uint64_t dictionaryOffset = static_cast<uint64_t>(out.tellp());
+    string tail;
+    putVarint(tail, dictionary.getNames().size());
+    for (const auto& name : dictionary.getNames()) {
+        putVarint(tail, name.size());
+        tail += name;
+    }
+    for (int i = 0; i < 8; ++i) tail += static_cast<char>((dictionaryOffset >> (8 * i)) & 0xFF);
+    tail.append(MAGIC, 4);
+    out.write(tail.data(), tail.size());
+    out.close();
+    if (!out) {
+        error = "cannot write " + path + ".tmp";
+        remove((path + ".tmp").c_str());
+        return false;
+    }
+    if (!commitTempFile(path, error)) {
+        remove((path + ".tmp").c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ResultReader::open(const string& path, string& openError) {
+    in.open(path, ios::binary);
+    char magic[4];
+    if (!in || !in.read(magic, 4) || memcmp(magic, MAGIC, 4) != 0 || in.get() != FORMAT_VERSION) {
+        openError = path + " is not a diagnosis export";
+        return false;
+    }
+
+    // Trailer: dictionary offset and magic
+    in.seekg(-12, ios::end);
+    unsigned char trailer[12];
+    if (!in.read(reinterpret_cast<char*>(trailer), 12) || memcmp(trailer + 8, MAGIC, 4) != 0) {
+        openError = path + " is truncated";
+        return false;
+    }
+    dataEnd = 0;
+    for (int i = 0; i < 8; ++i) dataEnd |= static_cast<uint64_t>(trailer[i]) << (8 * i);
+
+    uint64_t fileEnd = static_cast<uint64_t>(in.tellg());
+    if (dataEnd < 5 || dataEnd > fileEnd - 12) {
+        openError = path + " has a bad trailer";
+        return false;
+    }
+    string tail(fileEnd - 12 - dataEnd, '\0');
+    in.seekg(dataEnd);
+    in.read(&tail[0], tail.size());
+    size_t pos = 0;
+    uint64_t count, length;
+    bool ok = getVarint(tail, pos, count);
+    for (uint64_t i = 0; ok && i < count; ++i) {
+        ok = getVarint(tail, pos, length) && length <= tail.size() - pos;
+        if (ok) {
+            dictionary.idFor(tail.substr(pos, length));
+            pos += length;
+        }
+    }
+    if (!ok) {
+        openError = path + " has a damaged dictionary";
+        return false;
+    }
+
+    in.seekg(5);
+    block.clear();
+    position = 0;
+    error.clear();
+    return true;
+}
+
+const DiseaseDictionary& ResultReader::getDictionary() const {
+    return dictionary;
+}
+
+string ResultReader::lastError() const {
+    return error;
+}
+
+bool ResultReader::readBlock() {
+    block.clear();
+    position = 0;
+    if (static_cast<uint64_t>(in.tellg()) >= dataEnd) return false;
+
+    // The header is at most 5 varints + codec + CRC; read it byte-wise
+    auto readVarint = [this](uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = in.get();
+            if (byte == EOF) return false;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    };
+    uint64_t count, firstId, rawSize, storedSize;
+    int codec;
+    unsigned char crc[4];
+    if (!readVarint(count) || !readVarint(firstId) || (codec = in.get()) == EOF || !readVarint(rawSize) ||
+        !readVarint(storedSize) || !in.read(reinterpret_cast<char*>(crc), 4) ||
+        storedSize > dataEnd - static_cast<uint64_t>(in.tellg()) ||
+        (codec == CODEC_NONE && rawSize != storedSize)) {
+        error = "damaged block header";
+        return false;
+    }
+    stored.resize(storedSize);
+    in.read(&stored[0], storedSize);
+
+    bool ok = true;
+    switch (codec) {
+        case CODEC_NONE:
+            raw.swap(stored);
+            break;
+        case CODEC_LZ:
+            ok = lzDecompress(stored, rawSize, raw);
+            break;
+#ifdef MEDICHECK_USE_ZSTD
+        case CODEC_ZSTD:
+            // The frame records its own size; it must agree before allocating
+            ok = ZSTD_getFrameContentSize(stored.data(), stored.size()) == rawSize;
+            if (ok) {
+                raw.resize(rawSize);
+                ok = ZSTD_decompress(&raw[0], rawSize, stored.data(), stored.size()) == rawSize;
+            }
+            break;
+#endif
+        default:
+            error = "block uses an unsupported compression (" + to_string(codec) + ")";
+            return false;
+    }
+    uint32_t expected = crc[0] | crc[1] << 8 | crc[2] << 16 | static_cast<uint32_t>(crc[3]) << 24;
+    if (!ok || raw.size() != rawSize || crc32(raw) != expected) {
+        error = "block fails its checksum";
+        return false;
+    }
+
+    // Every row takes at least one byte in each column, so a count the
+    // columns cannot hold means a damaged header, not a huge block
+    if (count == 0 || count > raw.size() / 2) {
+        error = "damaged block header";
+        return false;
+    }
+    block.resize(count);
+    size_t pos = 0;
+    int64_t id = unzigzag(firstId);
+    uint64_t value;
+    for (uint64_t i = 0; i < count && ok; ++i) {
+        ok = getVarint(raw, pos, value);
+        id += unzigzag(value);
+        block[i].patientId = static_cast<int>(id);
+    }
+    for (uint64_t i = 0; i < count && ok; ++i) {
+        ok = getVarint(raw, pos, block[i].diseases);
+    }
+    if (ok && pos != raw.size()) {
+        error = "block has more columns than its header counts";
+        block.clear();
+        return false;
+    }
+    if (!ok) {
+        error = "block columns are short";
+        block.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ResultReader::next(DiagnosisRecord& record) {
+    if (position >= block.size() && !readBlock()) return false;
+    if (block.empty()) return false;
+    record = block[position++];
+    return true;
+}
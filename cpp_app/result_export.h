@@ -0,0 +1,97 @@
+// Compact binary export of diagnosis results for downstream analytics
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Disease name <-> small integer ID. IDs are handed out in the order
+// names are first seen and never change, so bit i of an exported mask
+// means the same disease in every file written with the same dictionary.
+class DiseaseDictionary {
+private:
+    vector<string> names;
+    unordered_map<string, int> ids;
+
+public:
+    static const int MAX_DISEASES = 64; // one bit each in a uint64_t
+
+    // One name per line, in ID order; a missing file is an empty dictionary
+    static bool load(const string& path, DiseaseDictionary& out, string& error);
+    bool save(const string& path, string& error) const;
+
+    int idFor(const string& name); // adds the name if new; -1 when full
+    int find(const string& name) const;
+    const vector<string>& getNames() const;
+
+    // False with `error` if a disease is new and all MAX_DISEASES IDs are
+    // taken; it would otherwise be left out of the export
+    bool maskFor(const vector<string>& diseases, uint64_t& mask, string& error);
+    vector<string> namesFor(uint64_t mask) const;
+};
+
+struct DiagnosisRecord {
+    int patientId;
+    uint64_t diseases; // bit i = dictionary ID i
+
+    bool operator==(const DiagnosisRecord& other) const {
+        return patientId == other.patientId && diseases == other.diseases;
+    }
+};
+
+// File layout: a sequence of blocks, then the dictionary, then a
+// trailer with the dictionary's offset. Each block holds up to
+// `blockSize` records as two columns, zigzag-varint patient ID deltas
+// and varint disease masks, optionally compressed and followed by a
+// CRC-32 of the uncompressed columns.
+class ResultWriter {
+private:
+    ofstream out;
+    string path;
+    vector<DiagnosisRecord> block;
+    size_t blockSize = 65536;
+    bool compress = true;
+    uint64_t written = 0;
+    string raw;        // reused column buffer
+    string compressed; // reused compression buffer
+
+    void writeBlock();
+
+public:
+    bool open(const string& path, string& error, bool compress = true, size_t blockSize = 65536);
+    void add(int patientId, uint64_t diseases);
+    // Writes the remaining block and the dictionary
+    bool close(const DiseaseDictionary& dictionary, string& error);
+    // Give up on the export; the previous file stays in place
+    void discard();
+
+    uint64_t recordCount() const;
+};
+
+class ResultReader {
+private:
+    ifstream in;
+    DiseaseDictionary dictionary;
+    uint64_t dataEnd = 0;
+    vector<DiagnosisRecord> block;
+    size_t position = 0;
+    string raw;
+    string stored;
+    string error;
+
+    bool readBlock();
+
+public:
+    bool open(const string& path, string& error);
+    const DiseaseDictionary& getDictionary() const;
+
+    // False at the end of the file or on a damaged block (see lastError)
+    bool next(DiagnosisRecord& record);
+    string lastError() const;
+};
+
+// Codec names for messages, e.g. "zstd" or "lz"
+string exportCompression();
@@ -0,0 +1,247 @@
+// Profile-guided decision DAG implementation
+#include "rule_optimizer.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <tuple>
+
+using namespace std;
+
+RuleProfile::RuleProfile(const RuleSet& rules, uint64_t ruleVersion)
+    : symptomCounts(symptomCatalog().size(), 0), version(ruleVersion) {
+    for (const auto& rule : rules.getRules()) {
+        clauseHits.push_back(vector<uint64_t>(rule.clauses.size(), 0));
+    }
+}
+
+void RuleProfile::record(const RuleSet& rules, SymptomMask symptoms, int symptomCount) {
+    patients++;
+    for (size_t i = 0; i < symptomCounts.size(); ++i) {
+        if (symptoms & (SymptomMask(1) << i)) symptomCounts[i]++;
+    }
+    const vector<DiseaseRule>& table = rules.getRules();
+    for (size_t r = 0; r < table.size() && r < clauseHits.size(); ++r) {
+        for (size_t c = 0; c < table[r].clauses.size() && c < clauseHits[r].size(); ++c) {
+            if (rules.clauseMatches(table[r].clauses[c], symptoms, symptomCount)) clauseHits[r][c]++;
+        }
+    }
+}
+
+uint64_t RuleProfile::patientCount() const {
+    return patients;
+}
+
+uint64_t RuleProfile::ruleVersion() const {
+    return version;
+}
+
+RuleProfile RuleProfile::symptomsOnly() const {
+    RuleProfile copy = *this;
+    copy.clauseHits.clear();
+    copy.version = 0;
+    return copy;
+}
+
+double RuleProfile::symptomFrequency(int symptom) const {
+    uint64_t seen = symptom < static_cast<int>(symptomCounts.size()) ? symptomCounts[symptom] : 0;
+    return (seen + 1.0) / (patients + 2.0);
+}
+
+double RuleProfile::clauseHitRate(size_t rule, size_t clause) const {
+    if (patients == 0 || rule >= clauseHits.size() || clause >= clauseHits[rule].size()) return 0.0;
+    return static_cast<double>(clauseHits[rule][clause]) / patients;
+}
+
+namespace {
+
+// A clause with the symptoms already tested removed
+struct Residual {
+    size_t rule;
+    SymptomMask required;
+    SymptomMask excluded;
+
+    bool operator<(const Residual& other) const {
+        return tie(rule, required, excluded) < tie(other.rule, other.required, other.excluded);
+    }
+    bool operator==(const Residual& other) const {
+        return rule == other.rule && required == other.required && excluded == other.excluded;
+    }
+};
+
+struct State {
+    uint64_t decided = 0;      // rules already known to match
+    vector<Residual> clauses;  // still undecided, sorted
+
+    bool operator<(const State& other) const {
+        return tie(decided, clauses) < tie(other.decided, other.clauses);
+    }
+};
+
+// Drop clauses of decided rules, duplicates, and clauses implied by a
+// weaker clause of the same rule, so equivalent sub-problems compare equal
+void normalize(State& state) {
+    vector<Residual> kept;
+    sort(state.clauses.begin(), state.clauses.end());
+    state.clauses.erase(unique(state.clauses.begin(), state.clauses.end()), state.clauses.end());
+    for (const Residual& c : state.clauses) {
+        if (state.decided & (uint64_t(1) << c.rule)) continue;
+        bool subsumed = false;
+        for (const Residual& other : state.clauses) {
+            if (&other == &c || other.rule != c.rule) continue;
+            bool weaker = (other.required & c.required) == other.required &&
+                          (other.excluded & c.excluded) == other.excluded;
+            if (weaker && !(other == c)) {
+                subsumed = true;
+                break;
+            }
+        }
+        if (!subsumed) kept.push_back(c);
+    }
+    state.clauses = kept;
+}
+
+State restrict(const State& state, int symptom, bool present) {
+    SymptomMask bit = SymptomMask(1) << symptom;
+    State next;
+    next.decided = state.decided;
+    for (Residual c : state.clauses) {
+        if (present) {
+            if (c.excluded & bit) continue;
+            c.required &= ~bit;
+        } else {
+            if (c.required & bit) continue;
+            c.excluded &= ~bit;
+        }
+        if (c.required == 0 && c.excluded == 0) {
+            next.decided |= uint64_t(1) << c.rule;
+        } else {
+            next.clauses.push_back(c);
+        }
+    }
+    normalize(next);
+    return next;
+}
+
+} // namespace
+
+DecisionDag DecisionDag::build(const RuleSet& rules, const RuleProfile& profile) {
+    DecisionDag dag;
+    const vector<DiseaseRule>& table = rules.getRules();
+    size_t symptoms = symptomCatalog().size();
+
+    State start;
+    for (size_t r = 0; r < table.size(); ++r) {
+        for (const RuleClause& clause : table[r].clauses) {
+            if (clause.exactCount >= 0) {
+                dag.countClauses.push_back({r, clause});
+            } else {
+                start.clauses.push_back({r, clause.required, clause.excluded});
+            }
+        }
+    }
+    normalize(start);
+
+    // Score each symptom by the expected number of clauses one test of it
+    // eliminates; clauses that rarely fire count for more, since ruling
+    // them out early is what saves work on a typical patient
+    vector<double> score(symptoms, 0.0);
+    for (size_t r = 0; r < table.size(); ++r) {
+        for (size_t c = 0; c < table[r].clauses.size(); ++c) {
+            const RuleClause& clause = table[r].clauses[c];
+            if (clause.exactCount >= 0) continue;
+            double weight = 2.0 - profile.clauseHitRate(r, c);
+            for (size_t s = 0; s < symptoms; ++s) {
+                double present = profile.symptomFrequency(static_cast<int>(s));
+                if (clause.required & (SymptomMask(1) << s)) score[s] += weight * (1.0 - present);
+                if (clause.excluded & (SymptomMask(1) << s)) score[s] += weight * present;
+            }
+        }
+    }
+    for (size_t s = 0; s < symptoms; ++s) dag.order.push_back(static_cast<int>(s));
+    stable_sort(dag.order.begin(), dag.order.end(), [&score](int a, int b) { return score[a] > score[b]; });
+
+    map<uint64_t, int> terminalIds;
+    map<tuple<int, int, int>, int> uniqueNodes;
+    map<State, int> memo;
+
+    auto terminal = [&](uint64_t decided) {
+        auto it = terminalIds.find(decided);
+        if (it != terminalIds.end()) return it->second;
+        int id = ~static_cast<int>(dag.terminals.size());
+        dag.terminals.push_back(decided);
+        terminalIds[decided] = id;
+        return id;
+    };
+
+    function<int(const State&)> construct = [&](const State& state) -> int {
+        if (state.clauses.empty()) return terminal(state.decided);
+        auto memoIt = memo.find(state);
+        if (memoIt != memo.end()) return memoIt->second;
+
+        SymptomMask mentioned = 0;
+        for (const Residual& c : state.clauses) mentioned |= c.required | c.excluded;
+        int symptom = -1;
+        for (int s : dag.order) {
+            if (mentioned & (SymptomMask(1) << s)) {
+                symptom = s;
+                break;
+            }
+        }
+
+        int low = construct(restrict(state, symptom, false));
+        int high = construct(restrict(state, symptom, true));
+        int id = low;
+        if (low != high) {
+            auto key = make_tuple(symptom, low, high);
+            auto nodeIt = uniqueNodes.find(key);
+            if (nodeIt != uniqueNodes.end()) {
+                id = nodeIt->second;
+            } else {
+                id = static_cast<int>(dag.nodes.size());
+                dag.nodes.push_back({symptom, low, high});
+                uniqueNodes[key] = id;
+            }
+        }
+        memo[state] = id;
+        return id;
+    };
+
+    dag.root = construct(start);
+    return dag;
+}
+
+uint64_t DecisionDag::evaluate(SymptomMask symptoms, int symptomCount) const {
+    int n = root;
+    while (n >= 0) {
+        const Node& node = nodes[n];
+        n = (symptoms >> node.symptom) & 1 ? node.high : node.low;
+    }
+    uint64_t matches = terminals[~n];
+    for (const auto& entry : countClauses) {
+        const RuleClause& clause = entry.second;
+        if ((symptoms & clause.required) == clause.required && (symptoms & clause.excluded) == 0 &&
+            clause.exactCount == symptomCount) {
+            matches |= uint64_t(1) << entry.first;
+        }
+    }
+    return matches;
+}
+
+size_t DecisionDag::nodeCount() const {
+    return nodes.size();
+}
+
+const vector<int>& DecisionDag::testOrder() const {
+    return order;
+}
+
+int DecisionDag::maxDepth() const {
+    vector<int> depth(nodes.size(), -1);
+    function<int(int)> walk = [&](int n) -> int {
+        if (n < 0) return 0;
+        if (depth[n] >= 0) return depth[n];
+        depth[n] = 1 + max(walk(nodes[n].low), walk(nodes[n].high));
+        return depth[n];
+    };
+    return walk(root);
+}
@@ -0,0 +1,66 @@
+// Profile-guided decision DAG for disease rule evaluation
+#pragma once
+#include "rule_set.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Symptom frequencies and clause hit rates observed over real patients.
+// Clause hits are kept by rule and clause position, so they only describe
+// the rule version they were recorded against.
+class RuleProfile {
+private:
+    vector<uint64_t> symptomCounts;     // per catalog symptom
+    vector<vector<uint64_t>> clauseHits; // per rule, per clause
+    uint64_t patients = 0;
+    uint64_t version = 0; // RuleRegistry version of the rules, 0 if unknown
+
+public:
+    RuleProfile() = default;
+    explicit RuleProfile(const RuleSet& rules, uint64_t ruleVersion = 0);
+
+    void record(const RuleSet& rules, SymptomMask symptoms, int symptomCount);
+
+    uint64_t patientCount() const;
+    uint64_t ruleVersion() const;
+    // The same profile without clause statistics, for other rule versions
+    RuleProfile symptomsOnly() const;
+    // Smoothed so that an empty profile gives 0.5 / 0.0
+    double symptomFrequency(int symptom) const;
+    double clauseHitRate(size_t rule, size_t clause) const;
+};
+
+// An ordered, reduced decision DAG over the symptom bits that computes
+// the same disease bitmask as RuleSet::evaluate. Symptoms are tested in
+// order of how many clauses they are likely to rule out, and identical
+// sub-problems (e.g. "fever and cough still undecided" shared by Flu,
+// COVID-19 and Pneumonia) are built once and shared. Clauses with an
+// exact symptom count depend on more than the mask and are checked
+// separately after the walk.
+class DecisionDag {
+private:
+    struct Node {
+        int symptom;
+        int low;  // >= 0: node index, < 0: ~terminal index
+        int high;
+    };
+
+    vector<Node> nodes;
+    vector<uint64_t> terminals;
+    int root = -1;
+    vector<int> order;
+    vector<pair<size_t, RuleClause>> countClauses; // rule index, clause
+
+public:
+    static DecisionDag build(const RuleSet& rules, const RuleProfile& profile);
+
+    uint64_t evaluate(SymptomMask symptoms, int symptomCount) const;
+
+    size_t nodeCount() const;
+    // Symptoms in the order the DAG tests them
+    const vector<int>& testOrder() const;
+    // Deepest root-to-terminal path, i.e. the most symptom tests per patient
+    int maxDepth() const;
+};
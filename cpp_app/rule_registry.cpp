@@ -0,0 +1,223 @@
+// Hot-reloadable rule registry implementation
+#include "rule_registry.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+
+const uint64_t CACHE_TAG_SHIFT = 40;
+const uint64_t CACHE_MATCH_MASK = (uint64_t(1) << CACHE_TAG_SHIFT) - 1;
+const uint64_t CACHE_TAG_MASK = 0xFFFFFF;
+
+bool fileStamp(const string& path, pair<long long, long long>& stamp) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    // Nanoseconds, so an edit of the same length within a second is seen
+#if defined(_WIN32)
+    long long modified = static_cast<long long>(info.st_mtime) * 1000000000LL;
+#elif defined(__APPLE__)
+    long long modified = static_cast<long long>(info.st_mtimespec.tv_sec) * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+    long long modified = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+    stamp = {modified, static_cast<long long>(info.st_size)};
+    return true;
+}
+
+} // namespace
+
+RuleRegistry::ReadGuard::ReadGuard(atomic<uint64_t>* slot, const Version* version)
+    : slot(slot), version(version) {}
+
+RuleRegistry::ReadGuard::ReadGuard(ReadGuard&& other) noexcept
+    : slot(other.slot), version(other.version) {
+    other.slot = nullptr;
+}
+
+RuleRegistry::ReadGuard::~ReadGuard() {
+    if (slot) slot->store(0);
+}
+
+const RuleSet& RuleRegistry::ReadGuard::rules() const {
+    return version->rules;
+}
+
+uint64_t RuleRegistry::ReadGuard::versionNumber() const {
+    return version->number;
+}
+
+uint64_t RuleRegistry::ReadGuard::evaluate(SymptomMask symptoms, int symptomCount) const {
+    if (version->optimized) return version->dag.evaluate(symptoms, symptomCount);
+    return version->rules.evaluate(symptoms, symptomCount);
+}
+
+RuleRegistry::RuleRegistry() : cache(new atomic<uint64_t>[CACHE_SIZE]) {
+    for (size_t i = 0; i < CACHE_SIZE; ++i) cache[i].store(0, memory_order_relaxed);
+    publish(RuleSet::builtin());
+}
+
+RuleRegistry::~RuleRegistry() {
+    stopWatching();
+    delete current.load();
+    for (auto& entry : retired) delete entry.second;
+}
+
+RuleRegistry::ReadGuard RuleRegistry::acquire() {
+    static thread_local int hint = 0;
+    uint64_t epoch = globalEpoch.load();
+    for (int attempt = 0;; ++attempt) {
+        int index = (hint + attempt) % READER_SLOTS;
+        uint64_t idle = 0;
+        if (readers[index].epoch.compare_exchange_strong(idle, epoch)) {
+            hint = index;
+            // Loaded after the slot is published, so a writer that swaps
+            // the pointer from here on will see us and keep our version
+            return ReadGuard(&readers[index].epoch, current.load());
+        }
+        if (attempt > 0 && index == hint) this_thread::yield();
+    }
+}
+
+uint64_t RuleRegistry::versionNumber() {
+    // Pinned like any reader, since a reload may free the version meanwhile
+    return acquire().versionNumber();
+}
+
+uint64_t RuleRegistry::publish(const RuleSet& rules) {
+    lock_guard<mutex> lock(writerMutex);
+    DecisionDag dag;
+    if (profiled) dag = DecisionDag::build(rules, profile.symptomsOnly());
+    return install(rules, profiled, dag);
+}
+
+uint64_t RuleRegistry::install(const RuleSet& rules, bool optimized, const DecisionDag& dag) {
+    Version* version = new Version{rules, nextVersion++, optimized, dag};
+    const Version* old = current.exchange(version);
+    if (old) retired.push_back({globalEpoch.fetch_add(1), old});
+    reclaim();
+    return version->number;
+}
+
+// Free every retired version that no pinned reader can still see.
+// Caller holds writerMutex.
+void RuleRegistry::reclaim() {
+    uint64_t oldestActive = UINT64_MAX;
+    for (const auto& reader : readers) {
+        uint64_t epoch = reader.epoch.load();
+        if (epoch != 0 && epoch < oldestActive) oldestActive = epoch;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < retired.size(); ++i) {
+        if (retired[i].first < oldestActive) {
+            delete retired[i].second;
+        } else {
+            retired[kept++] = retired[i];
+        }
+    }
+    retired.resize(kept);
+}
+
+size_t RuleRegistry::pendingReclaim() {
+    lock_guard<mutex> lock(writerMutex);
+    reclaim();
+    return retired.size();
+}
+
+void RuleRegistry::optimize(const RuleProfile& newProfile) {
+    // Built from the current version under the writer lock, so a reload
+    // that lands meanwhile is not overwritten with the rules it replaced.
+    // Writers are the only ones to free versions, so no pin is needed.
+    lock_guard<mutex> lock(writerMutex);
+    const Version* active = current.load();
+    profile = newProfile;
+    profiled = true;
+    bool sameRules = newProfile.ruleVersion() == active->number;
+    DecisionDag dag = DecisionDag::build(active->rules, sameRules ? newProfile : newProfile.symptomsOnly());
+    install(active->rules, true, dag);
+}
+
+bool RuleRegistry::isOptimized() {
+    ReadGuard guard = acquire();
+    return guard.version->optimized;
+}
+
+bool RuleRegistry::reload(const string& path, string& error) {
+    // Parsing and validation happen before anything is published
+    RuleSet rules;
+    if (!RuleSet::loadFromFile(path, rules, error)) return false;
+    publish(rules);
+    return true;
+}
+
+vector<string> RuleRegistry::diagnose(const vector<string>& symptoms) {
+    ReadGuard guard = acquire();
+    const RuleSet& rules = guard.rules();
+    SymptomMask mask = toSymptomMask(symptoms);
+    int count = static_cast<int>(symptoms.size());
+
+    uint64_t tag = guard.versionNumber() & CACHE_TAG_MASK;
+    bool cacheable = tag != 0 && mask < CACHE_SIZE &&
+                     count == popcount(mask) &&
+                     rules.getRules().size() <= CACHE_TAG_SHIFT;
+    if (cacheable) {
+        uint64_t entry = cache[mask].load(memory_order_relaxed);
+        if ((entry >> CACHE_TAG_SHIFT) == tag) return rules.diseaseNames(entry & CACHE_MATCH_MASK);
+    }
+
+    uint64_t matches = guard.evaluate(mask, count);
+    if (cacheable) cache[mask].store((tag << CACHE_TAG_SHIFT) | matches, memory_order_relaxed);
+    return rules.diseaseNames(matches);
+}
+
+vector<string> RuleRegistry::diagnose(const vector<string>& symptoms, const CodedRuleSet& coded,
+                                     const SymptomVocabulary& vocabulary) {
+    vector<string> diseases = diagnose(symptoms);
+    if (coded.getRules().empty()) return diseases;
+    for (auto& disease : coded.predict(vocabulary.encode(symptoms), static_cast<int>(symptoms.size()))) {
+        if (find(diseases.begin(), diseases.end(), disease) == diseases.end()) diseases.push_back(move(disease));
+    }
+    sort(diseases.begin(), diseases.end());
+    return diseases;
+}
+
+void RuleRegistry::startWatching(const string& path, int pollMilliseconds) {
+    stopWatching();
+    watching.store(true);
+    watcher = thread([this, path, pollMilliseconds]() {
+        pair<long long, long long> seen{-1, -1};
+        fileStamp(path, seen);
+        unique_lock<mutex> lock(watchMutex);
+        while (watching.load()) {
+            watchCv.wait_for(lock, chrono::milliseconds(pollMilliseconds));
+            if (!watching.load()) break;
+
+            pair<long long, long long> stamp;
+            if (!fileStamp(path, stamp) || stamp == seen) continue;
+            seen = stamp;
+
+            lock.unlock();
+            string error;
+            bool ok = reload(path, error);
+            lock.lock();
+            watchError = ok ? "" : error;
+        }
+    });
+}
+
+void RuleRegistry::stopWatching() {
+    {
+        lock_guard<mutex> lock(watchMutex);
+        if (!watching.exchange(false) && !watcher.joinable()) return;
+        watchCv.notify_all();
+    }
+    if (watcher.joinable()) watcher.join();
+}
+
+string RuleRegistry::lastWatchError() {
+    lock_guard<mutex> lock(watchMutex);
+    return watchError;
+}
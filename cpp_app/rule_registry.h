@@ -0,0 +1,121 @@
+// Hot-reloadable disease rules shared by all diagnosis callers
+#pragma once
+#include "rule_optimizer.h"
+#include "rule_set.h"
+#include "symptom_vocabulary.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Holds the active RuleSet behind an atomic pointer. A reload parses and
+// validates the new file first, then swaps the pointer; diagnoses that
+// already started keep using the old version, which is freed once no
+// reader from its epoch is left (epoch-based reclamation).
+class RuleRegistry {
+public:
+    struct Version {
+        RuleSet rules;
+        uint64_t number;
+        bool optimized;
+        DecisionDag dag; // built from a RuleProfile when optimized
+    };
+
+    // Pins the current version for the lifetime of the guard
+    class ReadGuard {
+    private:
+        atomic<uint64_t>* slot;
+        const Version* version;
+        friend class RuleRegistry;
+        ReadGuard(atomic<uint64_t>* slot, const Version* version);
+
+    public:
+        ReadGuard(ReadGuard&& other) noexcept;
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard();
+
+        const RuleSet& rules() const;
+        uint64_t versionNumber() const;
+        // Disease bitmask, through the decision DAG when one was built
+        uint64_t evaluate(SymptomMask symptoms, int symptomCount) const;
+    };
+
+private:
+    static const int READER_SLOTS = 128;
+    static const size_t CACHE_SIZE = size_t(1) << 18; // one entry per symptom mask
+
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch{0}; // 0 = not reading
+    };
+
+    atomic<const Version*> current{nullptr};
+    atomic<uint64_t> globalEpoch{1};
+    ReaderSlot readers[READER_SLOTS];
+
+    mutex writerMutex;
+    vector<pair<uint64_t, const Version*>> retired; // retire epoch, version
+    uint64_t nextVersion = 1;
+    RuleProfile profile;
+    bool profiled = false;
+
+    // Swap in a new version; caller holds writerMutex
+    uint64_t install(const RuleSet& rules, bool optimized, const DecisionDag& dag);
+
+    // Diagnosis results keyed by symptom mask, tagged with the rule
+    // version they were computed with; a stale tag means "recompute"
+    unique_ptr<atomic<uint64_t>[]> cache;
+
+    thread watcher;
+    atomic<bool> watching{false};
+    mutex watchMutex;
+    condition_variable watchCv;
+    string watchError;
+
+    void reclaim();
+
+public:
+    // Starts with RuleSet::builtin()
+    RuleRegistry();
+    ~RuleRegistry();
+
+    RuleRegistry(const RuleRegistry&) = delete;
+    RuleRegistry& operator=(const RuleRegistry&) = delete;
+
+    ReadGuard acquire();
+    uint64_t versionNumber();
+
+    // Install a new rule set; returns its version number
+    uint64_t publish(const RuleSet& rules);
+    // Parse, validate and publish a rule file; on error the active rules are kept
+    bool reload(const string& path, string& error);
+
+    // Rebuild the active rules as a decision DAG ordered by `profile`.
+    // Clause statistics are only used when the profile was recorded
+    // against the active version; otherwise, and on later reloads, only
+    // its symptom frequencies steer the test order. Results stay exact.
+    void optimize(const RuleProfile& profile);
+    bool isOptimized();
+
+    // Diagnose with the active rules, reusing cached results that were
+    // computed by the same rule version
+    vector<string> diagnose(const vector<string>& symptoms);
+    // The same plus the matches of `coded` rules over vocabulary terms,
+    // sorted; what the diagnosis menu shows and the export writes
+    vector<string> diagnose(const vector<string>& symptoms, const CodedRuleSet& coded,
+                            const SymptomVocabulary& vocabulary);
+
+    // Poll `path` in the background and reload it when it changes
+    void startWatching(const string& path, int pollMilliseconds = 1000);
+    void stopWatching();
+    string lastWatchError();
+
+    // Versions swapped out but still waiting for readers to finish
+    size_t pendingReclaim();
+};
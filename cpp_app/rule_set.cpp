@@ -0,0 +1,313 @@
+// Disease rule table implementation
+#include "rule_set.h"
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+const vector<string>& symptomCatalog() {
+    static const vector<string> catalog = {
+        "fever", "cough", "headache", "sore throat", "runny nose",
+        "shortness of breath", "fatigue", "muscle aches", "nausea",
+        "vomiting", "diarrhea", "loss of taste", "loss of smell",
+        "chest pain", "dizziness", "rash", "joint pain", "chills"
+    };
+    return catalog;
+}
+
+int symptomIndex(const string& symptom) {
+    static const unordered_map<string, int> indexes = []() {
+        unordered_map<string, int> byName;
+        const vector<string>& catalog = symptomCatalog();
+        for (size_t i = 0; i < catalog.size(); ++i) byName[catalog[i]] = static_cast<int>(i);
+        return byName;
+    }();
+    auto found = indexes.find(symptom);
+    return found == indexes.end() ? -1 : found->second;
+}
+
+SymptomMask toSymptomMask(const vector<string>& symptoms) {
+    SymptomMask mask = 0;
+    for (const auto& symptom : symptoms) {
+        int index = symptomIndex(symptom);
+        if (index >= 0) mask |= SymptomMask(1) << index;
+    }
+    return mask;
+}
+
+vector<string> fromSymptomMask(SymptomMask mask) {
+    vector<string> symptoms;
+    const vector<string>& catalog = symptomCatalog();
+    for (size_t i = 0; i < catalog.size(); ++i) {
+        if (mask & (SymptomMask(1) << i)) symptoms.push_back(catalog[i]);
+    }
+    return symptoms;
+}
+
+namespace {
+
+string trim(const string& text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+// One clause: "a + b - c =1"
+bool parseClause(const string& text, RuleLine::Clause& out, string& error) {
+    out = RuleLine::Clause();
+    string body = text;
+    size_t eq = body.find('=');
+    if (eq != string::npos) {
+        string count = trim(body.substr(eq + 1));
+        if (count.empty() || count.find_first_not_of("0123456789") != string::npos) {
+            error = "invalid symptom count '" + count + "'";
+            return false;
+        }
+        out.exactCount = stoi(count);
+        body = body.substr(0, eq);
+    }
+
+    char op = '+';
+    size_t pos = 0;
+    while (pos <= body.size()) {
+        size_t next = body.find_first_of("+-", pos);
+        string name = trim(body.substr(pos, next == string::npos ? string::npos : next - pos));
+        if (name.empty()) {
+            error = "missing symptom name";
+            return false;
+        }
+        if (op == '+') out.required.push_back(name);
+        else out.excluded.push_back(name);
+        if (next == string::npos) break;
+        op = body[next];
+        pos = next + 1;
+    }
+    return true;
+}
+
+RuleClause clause(const vector<string>& required, const vector<string>& excluded = {}, int exactCount = -1) {
+    RuleClause c;
+    c.required = toSymptomMask(required);
+    c.excluded = toSymptomMask(excluded);
+    c.exactCount = exactCount;
+    return c;
+}
+
+} // namespace
+
+RuleSet::RuleSet(const vector<DiseaseRule>& rules) : rules(rules) {}
+
+RuleSet RuleSet::builtin() {
+    return RuleSet({
+        {"Common Cold", {clause({"runny nose", "sore throat"}), clause({"runny nose", "cough"}),
+                         clause({"sore throat", "cough"}), clause({"runny nose", "headache"})}},
+        {"Flu", {clause({"fever", "cough"}), clause({"fever", "muscle aches"}),
+                 clause({"fever", "fatigue", "headache"}), clause({"fever", "chills"}),
+                 clause({"muscle aches", "fatigue", "headache"})}},
+        {"COVID-19", {clause({"fever", "cough", "loss of taste"}), clause({"fever", "shortness of breath"}),
+                      clause({"loss of taste", "loss of smell"}), clause({"fever", "fatigue", "muscle aches"}),
+                      clause({"cough", "loss of taste"}), clause({"cough", "loss of smell"}),
+                      clause({"fever", "headache", "sore throat"})}},
+        {"Pneumonia", {clause({"fever", "cough", "shortness of breath"}), clause({"chest pain", "cough", "fever"}),
+                       clause({"shortness of breath", "chest pain"}), clause({"fever", "chills", "shortness of breath"})}},
+        {"Gastroenteritis", {clause({"nausea", "vomiting", "diarrhea"}), clause({"nausea", "diarrhea"}),
+                             clause({"vomiting", "diarrhea"}), clause({"nausea", "vomiting"}),
+                             clause({"diarrhea", "fever"})}},
+        {"Migraine", {clause({"headache", "nausea"}), clause({"headache", "dizziness"}),
+                      clause({"headache", "vomiting"})}},
+        {"Allergic Reaction", {clause({"rash", "runny nose"}), clause({"rash", "sore throat"}),
+                               clause({"rash", "shortness of breath"})}},
+        {"Strep Throat", {clause({"sore throat", "fever"}, {"runny nose", "cough"})}},
+        {"Bronchitis", {clause({"cough", "chest pain"}), clause({"cough", "fatigue"}),
+                        clause({"cough", "shortness of breath"})}},
+        {"Food Poisoning", {clause({"nausea", "vomiting"}), clause({"diarrhea", "nausea"}),
+                            clause({"vomiting", "diarrhea", "fever"})}},
+        {"Sinusitis", {clause({"headache", "runny nose"}), clause({"headache", "sore throat", "runny nose"}),
+                       clause({"headache", "fever", "runny nose"})}},
+        {"Asthma", {clause({"shortness of breath", "cough"}), clause({"shortness of breath", "chest pain"})}},
+        {"Anxiety/Panic Attack", {clause({"shortness of breath", "dizziness"}), clause({"chest pain", "dizziness"}),
+                                  clause({"nausea", "dizziness", "shortness of breath"})}},
+        {"Dehydration", {clause({"dizziness", "fatigue"}), clause({"headache", "dizziness", "fatigue"})}},
+        {"Inflammatory Arthritis", {clause({"joint pain", "fever"})}},
+        {"Arthritis", {clause({"joint pain"}, {"fever"})}},
+        {"Fever (Unknown Cause)", {clause({"fever"}, {}, 1)}},
+        {"Tension Headache", {clause({"headache"}, {}, 1)}},
+        {"Skin Condition", {clause({"rash"}, {}, 1)}}
+    });
+}
+
+bool parseRuleLines(const string& text, const function<bool(const RuleLine&, string&)>& accept, string& error) {
+    set<string> seen;
+    stringstream ss(text);
+    string line;
+    int lineNumber = 0;
+    while (getline(ss, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != string::npos) line = line.substr(0, comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        string where = "line " + to_string(lineNumber) + ": ";
+        size_t colon = line.find(':');
+        if (colon == string::npos) {
+            error = where + "expected 'Disease: clauses'";
+            return false;
+        }
+        RuleLine rule;
+        rule.disease = trim(line.substr(0, colon));
+        if (rule.disease.empty()) {
+            error = where + "missing disease name";
+            return false;
+        }
+        if (!seen.insert(rule.disease).second) {
+            error = where + "duplicate rule for '" + rule.disease + "'";
+            return false;
+        }
+
+        stringstream clauses(line.substr(colon + 1));
+        string clauseText;
+        while (getline(clauses, clauseText, '|')) {
+            RuleLine::Clause c;
+            string clauseError;
+            if (!parseClause(clauseText, c, clauseError)) {
+                error = where + clauseError;
+                return false;
+            }
+            rule.clauses.push_back(c);
+        }
+        if (rule.clauses.empty()) {
+            error = where + "rule has no clauses";
+            return false;
+        }
+        string ruleError;
+        if (!accept(rule, ruleError)) {
+            error = where + ruleError;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RuleSet::parse(const string& text, RuleSet& out, string& error) {
+    vector<DiseaseRule> parsed;
+    bool ok = parseRuleLines(text, [&parsed](const RuleLine& line, string& ruleError) {
+        DiseaseRule rule;
+        rule.disease = line.disease;
+        auto lookup = [&ruleError](const vector<string>& names, SymptomMask& mask) {
+            for (const auto& name : names) {
+                int index = symptomIndex(name);
+                if (index < 0) {
+                    ruleError = "unknown symptom '" + name + "'";
+                    return false;
+                }
+                mask |= SymptomMask(1) << index;
+            }
+            return true;
+        };
+        for (const auto& clauseNames : line.clauses) {
+            RuleClause c;
+            c.exactCount = clauseNames.exactCount;
+            if (!lookup(clauseNames.required, c.required) || !lookup(clauseNames.excluded, c.excluded)) return false;
+            if (c.required & c.excluded) {
+                ruleError = "clause requires and excludes the same symptom";
+                return false;
+            }
+            rule.clauses.push_back(c);
+        }
+        parsed.push_back(rule);
+        return true;
+    }, error);
+    if (!ok) return false;
+
+    if (parsed.empty()) {
+        error = "no rules defined";
+        return false;
+    }
+    if (parsed.size() > MAX_RULES) {
+        error = "too many rules (maximum " + to_string(MAX_RULES) + ")";
+        return false;
+    }
+    out = RuleSet(parsed);
+    return true;
+}
+
+bool RuleSet::loadFromFile(const string& path, RuleSet& out, string& error) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    stringstream buffer;
+    buffer << file.rdbuf();
+    return parse(buffer.str(), out, error);
+}
+
+string RuleSet::toText() const {
+    string text;
+    for (const auto& rule : rules) {
+        text += rule.disease + ":";
+        for (size_t i = 0; i < rule.clauses.size(); ++i) {
+            text += (i ? " | " : " ") + describeClause(rule.clauses[i]);
+        }
+        text += "\n";
+    }
+    return text;
+}
+
+const vector<DiseaseRule>& RuleSet::getRules() const {
+    return rules;
+}
+
+bool RuleSet::clauseMatches(const RuleClause& clause, SymptomMask symptoms, int symptomCount) const {
+    return (symptoms & clause.required) == clause.required &&
+           (symptoms & clause.excluded) == 0 &&
+           (clause.exactCount < 0 || clause.exactCount == symptomCount);
+}
+
+int RuleSet::matchingClause(size_t rule, SymptomMask symptoms, int symptomCount) const {
+    const vector<RuleClause>& clauses = rules[rule].clauses;
+    for (size_t i = 0; i < clauses.size(); ++i) {
+        if (clauseMatches(clauses[i], symptoms, symptomCount)) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+uint64_t RuleSet::evaluate(SymptomMask symptoms, int symptomCount) const {
+    uint64_t matches = 0;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (matchingClause(i, symptoms, symptomCount) >= 0) matches |= uint64_t(1) << i;
+    }
+    return matches;
+}
+
+vector<string> RuleSet::diseaseNames(uint64_t matches) const {
+    vector<string> diseases;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (matches & (uint64_t(1) << i)) diseases.push_back(rules[i].disease);
+    }
+    sort(diseases.begin(), diseases.end());
+    diseases.erase(unique(diseases.begin(), diseases.end()), diseases.end());
+    return diseases;
+}
+
+vector<string> RuleSet::predict(const vector<string>& symptoms) const {
+    return diseaseNames(evaluate(toSymptomMask(symptoms), static_cast<int>(symptoms.size())));
+}
+
+string RuleSet::describeClause(const RuleClause& clause) const {
+    string text;
+    for (const auto& symptom : fromSymptomMask(clause.required)) {
+        if (!text.empty()) text += " + ";
+        text += symptom;
+    }
+    for (const auto& symptom : fromSymptomMask(clause.excluded)) {
+        text += " - " + symptom;
+    }
+    if (clause.exactCount >= 0) text += " =" + to_string(clause.exactCount);
+    return text;
+}
@@ -0,0 +1,85 @@
+// Disease rules as data, evaluated over symptom bitmasks
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Bit i is set when the patient has symptomCatalog()[i]
+typedef uint32_t SymptomMask;
+
+// The symptoms the system recognizes, in menu order
+const vector<string>& symptomCatalog();
+int symptomIndex(const string& symptom); // -1 if not in the catalog
+SymptomMask toSymptomMask(const vector<string>& symptoms);
+vector<string> fromSymptomMask(SymptomMask mask);
+
+// One alternative of a rule: all `required` symptoms present, none of
+// the `excluded` ones, and (if exactCount >= 0) exactly that many
+// symptoms recorded in total
+struct RuleClause {
+    SymptomMask required = 0;
+    SymptomMask excluded = 0;
+    int exactCount = -1;
+};
+
+// evaluate() returns one bit per rule
+const size_t MAX_RULES = 64;
+
+struct DiseaseRule {
+    string disease;
+    vector<RuleClause> clauses; // the disease is predicted if any clause matches
+};
+
+// One line of a rule file, with the symptoms still as names
+struct RuleLine {
+    struct Clause {
+        vector<string> required; // never empty
+        vector<string> excluded;
+        int exactCount = -1;
+    };
+    string disease;
+    vector<Clause> clauses;
+};
+
+// Reads the rule file format (see RuleSet::parse) and passes each rule
+// to `accept`, which looks up the symptom names. Errors, including the
+// ones `accept` sets, are reported with their line number.
+bool parseRuleLines(const string& text, const function<bool(const RuleLine&, string&)>& accept, string& error);
+
+class RuleSet {
+private:
+    vector<DiseaseRule> rules;
+
+public:
+    RuleSet() = default;
+    explicit RuleSet(const vector<DiseaseRule>& rules);
+
+    // The rules hard-coded in predictDiseases()
+    static RuleSet builtin();
+
+    // Rule file format, one disease per line ('#' starts a comment):
+    //   Disease Name: symptom + symptom - excluded | other clause =N
+    // where '=N' means exactly N symptoms recorded. Returns false and
+    // sets `error` (with the line number) if anything fails validation.
+    static bool parse(const string& text, RuleSet& out, string& error);
+    static bool loadFromFile(const string& path, RuleSet& out, string& error);
+    string toText() const;
+
+    const vector<DiseaseRule>& getRules() const;
+
+    bool clauseMatches(const RuleClause& clause, SymptomMask symptoms, int symptomCount) const;
+    // Index of the first matching clause of rules[rule], or -1
+    int matchingClause(size_t rule, SymptomMask symptoms, int symptomCount) const;
+
+    // Bit i of the result is set when rules[i] matches
+    uint64_t evaluate(SymptomMask symptoms, int symptomCount) const;
+
+    // Same contract as predictDiseases(): sorted, de-duplicated names
+    vector<string> predict(const vector<string>& symptoms) const;
+    vector<string> diseaseNames(uint64_t matches) const;
+
+    string describeClause(const RuleClause& clause) const;
+};
@@ -1,5 +1,5 @@
-@echo off
-echo Starting MediCheck Application...
-echo.
-bin\medicheck.exe
-pause
+@echo off
+echo Starting MediCheck Application...
+echo.
+bin\medicheck.exe
+pause
@@ -0,0 +1,351 @@
+// Shared-memory patient registry implementation
+#include "shared_registry.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const uint32_t MAGIC = 0x5253434D; // "MCSR"
+const uint32_t LAYOUT = 1;
+const size_t INITIAL_SIZE = 64 * 1024;
+const int MAX_READ_ATTEMPTS = 10000;
+
+// Fields after `layout` change while readers are attached; they are read
+// between the two loads of `sequence`
+struct Header {
+    uint32_t magic;
+    uint32_t layout;
+    atomic<uint64_t> sequence;
+    atomic<uint64_t> version;
+    atomic<uint64_t> segmentSize;
+    atomic<uint64_t> patientCount;
+    atomic<uint64_t> textSize;
+};
+
+struct Record {
+    int32_t age;
+    uint32_t textOffset; // name, then gender
+    uint16_t nameLength;
+    uint16_t genderLength;
+};
+
+struct Layout {
+    size_t ids;
+    size_t symptoms;
+    size_t records;
+    size_t text;
+    size_t end;
+};
+
+size_t align8(size_t value) {
+    return (value + 7) & ~size_t(7);
+}
+
+Layout layoutFor(size_t count, size_t textSize) {
+    Layout layout;
+    layout.ids = align8(sizeof(Header));
+    layout.symptoms = align8(layout.ids + count * sizeof(int32_t));
+    layout.records = align8(layout.symptoms + count * sizeof(SymptomMask));
+    layout.text = align8(layout.records + count * sizeof(Record));
+    layout.end = layout.text + textSize;
+    return layout;
+}
+
+// The columns of a consistent-looking segment; false if a concurrent
+// publish left sizes that do not fit the mapping
+bool locate(const char* base, size_t mapped, size_t& count, Layout& layout) {
+    const Header* header = reinterpret_cast<const Header*>(base);
+    count = header->patientCount.load(memory_order_relaxed);
+    size_t textSize = header->textSize.load(memory_order_relaxed);
+    if (count > mapped || textSize > mapped) return false;
+    layout = layoutFor(count, textSize);
+    return layout.end <= mapped;
+}
+
+} // namespace
+
+SharedRegistryWriter::~SharedRegistryWriter() {
+    close();
+}
+
+bool SharedRegistryWriter::grow(size_t size, string& error) {
+#ifdef _WIN32
+    (void)size;
+    error = "shared memory registry needs a POSIX system";
+    return false;
+#else
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        error = "cannot resize shared memory: " + string(strerror(errno));
+        return false;
+    }
+    void* grown = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (grown == MAP_FAILED) {
+        error = "cannot map shared memory: " + string(strerror(errno));
+        return false;
+    }
+    if (base) munmap(base, mapped);
+    base = static_cast<char*>(grown);
+    mapped = size;
+    return true;
+#endif
+}
+
+bool SharedRegistryWriter::create(const string& segmentName, string& error) {
+    close();
+#ifdef _WIN32
+    (void)segmentName;
+    error = "shared memory registry needs a POSIX system";
+    return false;
+#else
+    fd = shm_open(segmentName.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        error = "cannot open shared memory " + segmentName + ": " + strerror(errno);
+        return false;
+    }
+    name = segmentName;
+    struct stat info;
+    size_t existing = fstat(fd, &info) == 0 ? static_cast<size_t>(info.st_size) : 0;
+    if (!grow(max(existing, INITIAL_SIZE), error)) {
+        close();
+        return false;
+    }
+    Header* header = reinterpret_cast<Header*>(base);
+    if (existing >= sizeof(Header) && header->magic == MAGIC && header->layout == LAYOUT) {
+        // Taking over from an earlier publisher: keep counting from its version
+        published = header->version.load(memory_order_relaxed);
+    } else {
+        header->magic = MAGIC;
+        header->layout = LAYOUT;
+        header->sequence.store(0, memory_order_relaxed);
+        header->version.store(0, memory_order_relaxed);
+        header->patientCount.store(0, memory_order_relaxed);
+        header->textSize.store(0, memory_order_relaxed);
+    }
+    header->segmentSize.store(mapped, memory_order_release);
+    return true;
+#endif
+}
+
+bool SharedRegistryWriter::publish(const PatientSnapshot& patients, string& error) {
+    if (!base) {
+        error = "shared memory registry is not open";
+        return false;
+    }
+    size_t count = patients.size();
+    size_t textSize = 0;
+    for (const auto& patient : patients) {
+        textSize += min<size_t>(patient.name.size(), UINT16_MAX) + min<size_t>(patient.gender.size(), UINT16_MAX);
+    }
+    Layout layout = layoutFor(count, textSize);
+    if (layout.end > mapped && !grow(max(layout.end + layout.end / 2, mapped * 2), error)) return false;
+
+    Header* header = reinterpret_cast<Header*>(base);
+    // An odd value left by a publisher that crashed mid-write stays odd
+    uint64_t sequence = header->sequence.load(memory_order_relaxed) & ~uint64_t(1);
+    header->sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    int32_t* ids = reinterpret_cast<int32_t*>(base + layout.ids);
+    SymptomMask* symptoms = reinterpret_cast<SymptomMask*>(base + layout.symptoms);
+    Record* records = reinterpret_cast<Record*>(base + layout.records);
+    char* text = base + layout.text;
+    size_t i = 0;
+    uint32_t offset = 0;
+    for (const auto& patient : patients) {
+        Record record;
+        record.age = patient.age;
+        record.textOffset = offset;
+        record.nameLength = static_cast<uint16_t>(min<size_t>(patient.name.size(), UINT16_MAX));
+        record.genderLength = static_cast<uint16_t>(min<size_t>(patient.gender.size(), UINT16_MAX));
+        memcpy(text + offset, patient.name.data(), record.nameLength);
+        memcpy(text + offset + record.nameLength, patient.gender.data(), record.genderLength);
+        offset += record.nameLength + record.genderLength;
+        ids[i] = patient.getId();
+        symptoms[i] = toSymptomMask(patient.symptoms);
+        records[i] = record;
+        i++;
+    }
+    header->patientCount.store(count, memory_order_relaxed);
+    header->textSize.store(textSize, memory_order_relaxed);
+    header->segmentSize.store(mapped, memory_order_relaxed);
+    header->version.store(++published, memory_order_relaxed);
+    header->sequence.store(sequence + 2, memory_order_release);
+    return true;
+}
+
+void SharedRegistryWriter::close() {
+#ifndef _WIN32
+    if (base) munmap(base, mapped);
+    if (fd >= 0) ::close(fd);
+    if (!name.empty()) shm_unlink(name.c_str());
+#endif
+    base = nullptr;
+    mapped = 0;
+    fd = -1;
+    name.clear();
+}
+
+uint64_t SharedRegistryWriter::version() const {
+    return published;
+}
+
+SharedRegistryReader::~SharedRegistryReader() {
+    detach();
+}
+
+bool SharedRegistryReader::remap(size_t size) {
+#ifdef _WIN32
+    (void)size;
+    return false;
+#else
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < size || size < sizeof(Header)) return false;
+    void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) return false;
+    if (base) munmap(const_cast<char*>(base), mapped);
+    base = static_cast<const char*>(view);
+    mapped = size;
+    return true;
+#endif
+}
+
+bool SharedRegistryReader::attach(const string& segmentName, string& error) {
+    detach();
+#ifdef _WIN32
+    (void)segmentName;
+    error = "shared memory registry needs a POSIX system";
+    return false;
+#else
+    fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        error = "cannot open shared memory " + segmentName + ": " + strerror(errno);
+        detach();
+        return false;
+    }
+    const Header* header = nullptr;
+    if (remap(static_cast<size_t>(info.st_size))) header = reinterpret_cast<const Header*>(base);
+    if (!header || header->magic != MAGIC || header->layout != LAYOUT) {
+        error = segmentName + " is not a MediCheck registry";
+        detach();
+        return false;
+    }
+    return true;
+#endif
+}
+
+void SharedRegistryReader::detach() {
+#ifndef _WIN32
+    if (base) munmap(const_cast<char*>(base), mapped);
+    if (fd >= 0) close(fd);
+#endif
+    base = nullptr;
+    mapped = 0;
+    fd = -1;
+}
+
+template <typename Read>
+bool SharedRegistryReader::readConsistent(Read read) {
+    if (!base) return false;
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+        const Header* header = reinterpret_cast<const Header*>(base);
+        uint64_t before = header->sequence.load(memory_order_acquire);
+        if (before & 1) {
+            this_thread::yield(); // a publish is in progress
+            continue;
+        }
+        size_t size = header->segmentSize.load(memory_order_relaxed);
+        if (size > mapped) {
+            // The publisher grew the segment; the old mapping stays valid until replaced
+            if (!remap(size)) return false;
+            continue;
+        }
+        bool complete = read();
+        atomic_thread_fence(memory_order_acquire);
+        if (complete && header->sequence.load(memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
+
+uint64_t SharedRegistryReader::version() const {
+    if (!base) return 0;
+    return reinterpret_cast<const Header*>(base)->version.load(memory_order_acquire);
+}
+
+size_t SharedRegistryReader::patientCount() {
+    size_t result = 0;
+    readConsistent([this, &result]() {
+        Layout layout;
+        return locate(base, mapped, result, layout);
+    });
+    return result;
+}
+
+bool SharedRegistryReader::findPatient(int id, SharedPatient& out) {
+    bool found = false;
+    bool consistent = readConsistent([this, id, &out, &found]() {
+        size_t count;
+        Layout layout;
+        if (!locate(base, mapped, count, layout)) return false;
+        const int32_t* ids = reinterpret_cast<const int32_t*>(base + layout.ids);
+        const int32_t* match = lower_bound(ids, ids + count, id);
+        found = match != ids + count && *match == id;
+        if (!found) return true;
+        size_t i = match - ids;
+        Record record;
+        memcpy(&record, base + layout.records + i * sizeof(Record), sizeof(Record));
+        if (size_t(record.textOffset) + record.nameLength + record.genderLength > layout.end - layout.text) return false;
+        const char* text = base + layout.text + record.textOffset;
+        out.id = id;
+        out.name.assign(text, record.nameLength);
+        out.gender.assign(text + record.nameLength, record.genderLength);
+        out.age = record.age;
+        memcpy(&out.symptoms, base + layout.symptoms + i * sizeof(SymptomMask), sizeof(SymptomMask));
+        return true;
+    });
+    return consistent && found;
+}
+
+size_t SharedRegistryReader::countWithSymptoms(SymptomMask required) {
+    size_t result = 0;
+    readConsistent([this, required, &result]() {
+        size_t count;
+        Layout layout;
+        if (!locate(base, mapped, count, layout)) return false;
+        const SymptomMask* symptoms = reinterpret_cast<const SymptomMask*>(base + layout.symptoms);
+        result = 0;
+        for (size_t i = 0; i < count; ++i) result += (symptoms[i] & required) == required;
+        return true;
+    });
+    return result;
+}
+
+vector<size_t> SharedRegistryReader::symptomCounts() {
+    vector<size_t> result(symptomCatalog().size());
+    readConsistent([this, &result]() {
+        size_t count;
+        Layout layout;
+        if (!locate(base, mapped, count, layout)) return false;
+        const SymptomMask* symptoms = reinterpret_cast<const SymptomMask*>(base + layout.symptoms);
+        fill(result.begin(), result.end(), 0);
+        for (size_t i = 0; i < count; ++i) {
+            for (SymptomMask mask = symptoms[i]; mask != 0; mask &= mask - 1) {
+                size_t bit = countr_zero(mask);
+                if (bit < result.size()) result[bit]++;
+            }
+        }
+        return true;
+    });
+    return result;
+}
@@ -0,0 +1,76 @@
+// Read-only patient registry shared between processes through POSIX
+// shared memory
+#pragma once
+#include "patient_store.h"
+#include "rule_set.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Segment layout: a header, then the patients sorted by ID as columns:
+//   int32 ids[n], SymptomMask symptoms[n], record[n], text
+// where a record holds the age and where the name and gender are in the
+// text area. The header's sequence number is a seqlock: the publisher
+// makes it odd while rewriting the segment and even again afterwards,
+// and a reader retries whenever it changed during a read. There is one
+// publisher per segment.
+struct SharedPatient {
+    int id = 0;
+    string name;
+    int age = 0;
+    string gender;
+    SymptomMask symptoms = 0;
+};
+
+class SharedRegistryWriter {
+private:
+    string name;
+    int fd = -1;
+    char* base = nullptr;
+    size_t mapped = 0;
+    uint64_t published = 0;
+
+    bool grow(size_t size, string& error);
+
+public:
+    ~SharedRegistryWriter();
+
+    // Create (or take over) the segment, e.g. "/medicheck_registry"
+    bool create(const string& segmentName, string& error);
+    // Replace the contents with `patients` and bump the version
+    bool publish(const PatientSnapshot& patients, string& error);
+    // Unmap and remove the segment; attached readers keep their mapping
+    void close();
+
+    uint64_t version() const;
+};
+
+class SharedRegistryReader {
+private:
+    int fd = -1;
+    const char* base = nullptr;
+    size_t mapped = 0;
+
+    bool remap(size_t size);
+    // Run `read` until it completes without a concurrent publish; false
+    // when the segment stays inconsistent or cannot be mapped
+    template <typename Read>
+    bool readConsistent(Read read);
+
+public:
+    ~SharedRegistryReader();
+
+    bool attach(const string& segmentName, string& error);
+    void detach();
+
+    uint64_t version() const; // 0 before the first publish
+    size_t patientCount();
+    bool findPatient(int id, SharedPatient& out);
+    // Patients that have every symptom in `required`
+    size_t countWithSymptoms(SymptomMask required);
+    // Patients per symptom, indexed like symptomCatalog()
+    vector<size_t> symptomCounts();
+};
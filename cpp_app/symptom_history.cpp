@@ -0,0 +1,162 @@
+// Symptom history implementation
+#include "symptom_history.h"
+
+using namespace std;
+
+namespace {
+
+const uint8_t RESOLVED = 0x80;
+
+int varintSize(uint64_t value) {
+    int size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+} // namespace
+
+bool SymptomHistory::appendToChunk(Chunk& chunk, int64_t delta, uint8_t code) {
+    uint64_t value = static_cast<uint64_t>(delta);
+    if (chunk.count == CHUNK_CODES || chunk.timeBytes + varintSize(value) > CHUNK_TIME_BYTES) return false;
+    while (value >= 0x80) {
+        chunk.times[chunk.timeBytes++] = static_cast<uint8_t>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    chunk.times[chunk.timeBytes++] = static_cast<uint8_t>(value);
+    chunk.codes[chunk.count++] = code;
+    return true;
+}
+
+vector<SymptomEvent> SymptomHistory::decode(const Chunk& chunk) const {
+    vector<SymptomEvent> result;
+    int64_t time = chunk.baseTime;
+    int pos = 0;
+    for (int i = 0; i < chunk.count; ++i) {
+        uint64_t delta = 0;
+        for (int shift = 0; pos < chunk.timeBytes; shift += 7) {
+            uint8_t byte = chunk.times[pos++];
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        time += static_cast<int64_t>(delta);
+        result.push_back({time, chunk.codes[i] & 0x7F, !(chunk.codes[i] & RESOLVED)});
+    }
+    return result;
+}
+
+void SymptomHistory::record(int patientId, int symptom, bool onset, int64_t time) {
+    if (symptom < 0 || symptom >= static_cast<int>(symptomCatalog().size())) return;
+    Series& s = series[patientId];
+    SymptomMask bit = SymptomMask(1) << symptom;
+    if (onset == ((s.current & bit) != 0)) return;
+
+    if (s.last != NO_CHUNK && time < s.lastTime) time = s.lastTime;
+    uint8_t code = static_cast<uint8_t>(symptom) | (onset ? 0 : RESOLVED);
+    if (s.last == NO_CHUNK || !appendToChunk(chunks[s.last], time - s.lastTime, code)) {
+        // Start a new chunk; its header is the checkpoint for as-of queries
+        Chunk chunk = Chunk();
+        chunk.baseTime = time;
+        chunk.baseMask = s.current;
+        chunk.next = NO_CHUNK;
+        appendToChunk(chunk, 0, code);
+        uint32_t index = static_cast<uint32_t>(chunks.size());
+        chunks.push_back(chunk);
+        if (s.last == NO_CHUNK) {
+            s.first = index;
+        } else {
+            chunks[s.last].next = index;
+        }
+        s.last = index;
+    }
+    s.lastTime = time;
+    s.current ^= bit;
+    events++;
+}
+
+void SymptomHistory::recordChange(int patientId, SymptomMask before, SymptomMask after, int64_t time) {
+    for (size_t i = 0; i < symptomCatalog().size(); ++i) {
+        SymptomMask bit = SymptomMask(1) << i;
+        if ((before & bit) != (after & bit)) record(patientId, static_cast<int>(i), (after & bit) != 0, time);
+    }
+}
+
+void SymptomHistory::clear() {
+    chunks.clear();
+    series.clear();
+    events = 0;
+}
+
+SymptomMask SymptomHistory::current(int patientId) const {
+    auto it = series.find(patientId);
+    return it == series.end() ? 0 : it->second.current;
+}
+
+SymptomMask SymptomHistory::symptomsAt(int patientId, int64_t time) const {
+    auto it = series.find(patientId);
+    if (it == series.end() || it->second.first == NO_CHUNK) return 0;
+    if (time >= it->second.lastTime) return it->second.current;
+
+    // Find the last chunk that starts at or before `time` from the headers
+    uint32_t index = it->second.first;
+    if (chunks[index].baseTime > time) return 0;
+    while (chunks[index].next != NO_CHUNK && chunks[chunks[index].next].baseTime <= time) index = chunks[index].next;
+
+    SymptomMask mask = chunks[index].baseMask;
+    for (const auto& event : decode(chunks[index])) {
+        if (event.time > time) break;
+        mask ^= SymptomMask(1) << event.symptom;
+    }
+    return mask;
+}
+
+int64_t SymptomHistory::presentFor(int patientId, int symptom, int64_t time) const {
+    if (symptom < 0 || !(symptomsAt(patientId, time) & (SymptomMask(1) << symptom))) return 0;
+    // The latest onset at or before `time`; events are in time order
+    int64_t onset = time;
+    auto it = series.find(patientId);
+    for (uint32_t index = it->second.first; index != NO_CHUNK; index = chunks[index].next) {
+        if (chunks[index].baseTime > time) break;
+        for (const auto& event : decode(chunks[index])) {
+            if (event.time > time) break;
+            if (event.symptom == symptom && event.onset) onset = event.time;
+        }
+    }
+    return time - onset;
+}
+
+vector<SymptomEvent> SymptomHistory::eventsOf(int patientId) const {
+    vector<SymptomEvent> result;
+    auto it = series.find(patientId);
+    if (it == series.end()) return result;
+    for (uint32_t index = it->second.first; index != NO_CHUNK; index = chunks[index].next) {
+        vector<SymptomEvent> part = decode(chunks[index]);
+        result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+}
+
+size_t SymptomHistory::eventCount() const {
+    return events;
+}
+
+size_t SymptomHistory::bytesUsed() const {
+    return chunks.size() * sizeof(Chunk);
+}
+
+string describeDuration(int64_t seconds) {
+    struct Unit {
+        int64_t length;
+        const char* name;
+    };
+    const Unit units[] = {{86400, "day"}, {3600, "hour"}, {60, "minute"}, {1, "second"}};
+    for (const auto& unit : units) {
+        if (seconds >= unit.length || unit.length == 1) {
+            int64_t count = seconds / unit.length;
+            return to_string(count) + " " + unit.name + (count == 1 ? "" : "s");
+        }
+    }
+    return "";
+}
@@ -0,0 +1,74 @@
+// Timestamped symptom onset/resolution history for every patient
+#pragma once
+#include "rule_set.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct SymptomEvent {
+    int64_t time; // seconds since the epoch
+    int symptom;  // index into symptomCatalog()
+    bool onset;   // false: resolved
+};
+
+// Append-only event log. Events of all patients live in one shared pool
+// of 64-byte chunks; a patient's chunks are linked in time order. Inside
+// a chunk the events are stored as two columns, varint time deltas and
+// one-byte symptom codes, and the chunk header keeps the absolute start
+// time and the symptom set before its first event. An as-of query thus
+// skips whole chunks by their headers and decodes at most one chunk.
+class SymptomHistory {
+private:
+    static const int CHUNK_CODES = 14;
+    static const int CHUNK_TIME_BYTES = 32;
+    static const uint32_t NO_CHUNK = 0xFFFFFFFF;
+
+    struct Chunk {
+        int64_t baseTime;     // time of the first event
+        SymptomMask baseMask; // symptoms present before the first event
+        uint32_t next;
+        uint8_t count;
+        uint8_t timeBytes;
+        uint8_t codes[CHUNK_CODES]; // symptom index, high bit = resolved
+        uint8_t times[CHUNK_TIME_BYTES];
+    };
+
+    struct Series {
+        uint32_t first = NO_CHUNK;
+        uint32_t last = NO_CHUNK;
+        int64_t lastTime = 0;
+        SymptomMask current = 0;
+    };
+
+    vector<Chunk> chunks;
+    unordered_map<int, Series> series;
+    size_t events = 0;
+
+    bool appendToChunk(Chunk& chunk, int64_t delta, uint8_t code);
+    // Decode the events of one chunk, in order
+    vector<SymptomEvent> decode(const Chunk& chunk) const;
+
+public:
+    // Events are kept in time order per patient; an event older than the
+    // patient's latest one is recorded at the latest time instead.
+    // Onset of a present symptom or resolution of an absent one is ignored.
+    void record(int patientId, int symptom, bool onset, int64_t time);
+    // Record the difference between two symptom sets as events at `time`
+    void recordChange(int patientId, SymptomMask before, SymptomMask after, int64_t time);
+    void clear();
+
+    SymptomMask current(int patientId) const;
+    SymptomMask symptomsAt(int patientId, int64_t time) const;
+    // How long `symptom` has been continuously present at `time`; 0 if absent
+    int64_t presentFor(int patientId, int symptom, int64_t time) const;
+    vector<SymptomEvent> eventsOf(int patientId) const;
+
+    size_t eventCount() const;
+    size_t bytesUsed() const;
+};
+
+// "2 days", "5 hours", ...
+string describeDuration(int64_t seconds);
@@ -0,0 +1,148 @@
+// Deferred symptom parsing implementation
+#include "symptom_loader.h"
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+bool parseSymptomLine(const char* line, size_t length, int& id, size_t& symptomsBegin, size_t& symptomsEnd) {
+    if (length > 0 && line[length - 1] == '\r') --length;
+    const char* comma = static_cast<const char*>(memchr(line, ',', length));
+    if (!comma || comma == line) return false;
+    // strtol needs a terminated string; IDs are short
+    string idText(line, comma - line);
+    char* idEnd = nullptr;
+    errno = 0;
+    long value = strtol(idText.c_str(), &idEnd, 10);
+    if (*idEnd != '\0' || errno == ERANGE || value < INT_MIN || value > INT_MAX) return false;
+    id = static_cast<int>(value);
+    symptomsBegin = comma - line + 1;
+    symptomsEnd = length;
+    return true;
+}
+
+void splitSymptoms(const char* begin, const char* end, vector<string>& out) {
+    while (begin < end) {
+        const char* found = static_cast<const char*>(memchr(begin, ';', end - begin));
+        const char* separator = found ? found : end;
+        if (separator > begin) out.emplace_back(begin, separator - begin);
+        begin = separator + 1;
+    }
+}
+
+SymptomLoader::~SymptomLoader() {
+    close();
+}
+
+bool SymptomLoader::open(const string& path) {
+    close();
+    ifstream file(path, ios::binary);
+    if (!file) return false;
+    stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+
+    // One pass over the lines: note the ID and where the symptoms start
+    const char* data = contents.data();
+    size_t size = contents.size();
+    const char* header = static_cast<const char*>(memchr(data, '\n', size));
+    size_t pos = header ? header - data + 1 : size;
+    while (pos < size) {
+        const char* newline = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+        size_t end = newline ? newline - data : size;
+        int id = 0;
+        size_t symptomsBegin = 0, symptomsEnd = 0;
+        if (end == pos || (end == pos + 1 && data[pos] == '\r')) {
+            // Blank line
+        } else if (!parseSymptomLine(data + pos, end - pos, id, symptomsBegin, symptomsEnd)) {
+            cout << "Skipping malformed line in " << path << ": " << string(data + pos, end - pos) << "\n";
+        } else {
+            Row row = {pos + symptomsBegin, pos + symptomsEnd, NO_ROW};
+            auto inserted = firstRow.insert({id, static_cast<uint32_t>(rows.size())});
+            if (!inserted.second) {
+                // Rare: several rows for one patient; chain them in file order
+                uint32_t last = inserted.first->second;
+                while (rows[last].next != NO_ROW) last = rows[last].next;
+                rows[last].next = static_cast<uint32_t>(rows.size());
+            }
+            rows.push_back(row);
+        }
+        pos = end + 1;
+    }
+
+    states.reset(new atomic<uint8_t>[rows.size()]);
+    for (size_t i = 0; i < rows.size(); ++i) states[i].store(PENDING, memory_order_relaxed);
+    parsed.assign(rows.size(), vector<string>());
+    return true;
+}
+
+void SymptomLoader::parseRow(uint32_t row, vector<string>& out) const {
+    splitSymptoms(contents.data() + rows[row].begin, contents.data() + rows[row].end, out);
+}
+
+void SymptomLoader::warm() {
+    for (uint32_t row = 0; row < rows.size() && !stopping.load(memory_order_relaxed); ++row) {
+        uint8_t expected = PENDING;
+        if (!states[row].compare_exchange_strong(expected, PARSING, memory_order_acquire)) continue;
+        parseRow(row, parsed[row]);
+        states[row].store(PARSED, memory_order_release);
+    }
+}
+
+void SymptomLoader::startWarming() {
+    if (warmer.joinable() || rows.empty()) return;
+    stopping = false;
+    warmer = thread(&SymptomLoader::warm, this);
+}
+
+void SymptomLoader::close() {
+    stopping = true;
+    if (warmer.joinable()) warmer.join();
+    contents.clear();
+    rows.clear();
+    firstRow.clear();
+    states.reset();
+    parsed.clear();
+}
+
+bool SymptomLoader::has(int patientId) const {
+    return firstRow.count(patientId) != 0;
+}
+
+bool SymptomLoader::take(int patientId, vector<string>& out) {
+    auto it = firstRow.find(patientId);
+    if (it == firstRow.end()) return false;
+    for (uint32_t row = it->second; row != NO_ROW; row = rows[row].next) {
+        uint8_t state = PENDING;
+        if (states[row].compare_exchange_strong(state, TAKEN, memory_order_acquire)) {
+            parseRow(row, out);
+            continue;
+        }
+        // The warm-up thread has this row; wait for it to finish parsing
+        while (state == PARSING) {
+            this_thread::yield();
+            state = states[row].load(memory_order_acquire);
+        }
+        for (auto& symptom : parsed[row]) out.push_back(move(symptom));
+        vector<string>().swap(parsed[row]);
+        states[row].store(TAKEN, memory_order_relaxed);
+    }
+    firstRow.erase(it);
+    return true;
+}
+
+vector<int> SymptomLoader::pendingIds() const {
+    vector<int> ids;
+    ids.reserve(firstRow.size());
+    for (const auto& entry : firstRow) ids.push_back(entry.first);
+    return ids;
+}
+
+size_t SymptomLoader::pendingCount() const {
+    return firstRow.size();
+}
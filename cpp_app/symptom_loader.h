@@ -0,0 +1,61 @@
+// Deferred parsing of data/symptoms.csv, one patient at a time
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// One symptoms.csv line is "<id>,<symptom>;<symptom>...". Both the eager
+// load and SymptomLoader go through these two helpers so the modes agree.
+// parseSymptomLine drops a trailing '\r' and sets [symptomsBegin,
+// symptomsEnd) as offsets into `line`; false if the ID is not a number.
+bool parseSymptomLine(const char* line, size_t length, int& id, size_t& symptomsBegin, size_t& symptomsEnd);
+// Append the ';'-separated symptoms in [begin, end), skipping empty ones
+void splitSymptoms(const char* begin, const char* end, vector<string>& out);
+
+// open() reads the file and records where each patient's row starts;
+// rows are parsed only when take() asks for them. An optional warm-up
+// thread parses the remaining rows ahead of time. Only the rows are
+// shared with that thread, so everything else stays single-threaded.
+class SymptomLoader {
+private:
+    static const uint32_t NO_ROW = 0xFFFFFFFF;
+    enum State : uint8_t { PENDING, PARSING, PARSED, TAKEN };
+
+    struct Row {
+        size_t begin;      // first byte after the ID column
+        size_t end;        // end of the line
+        uint32_t next;     // another row for the same patient, or NO_ROW
+    };
+
+    string contents;
+    vector<Row> rows;
+    unordered_map<int, uint32_t> firstRow; // patients not taken yet
+    unique_ptr<atomic<uint8_t>[]> states;
+    vector<vector<string>> parsed;         // filled by the warm-up thread
+    thread warmer;
+    atomic<bool> stopping{false};
+
+    void parseRow(uint32_t row, vector<string>& out) const;
+    void warm();
+
+public:
+    ~SymptomLoader();
+
+    // False if the file cannot be read; an empty loader is left behind
+    bool open(const string& path);
+    void startWarming();
+    // Stop the warm-up thread and forget all rows
+    void close();
+
+    bool has(int patientId) const;
+    // Append the patient's symptoms to `out`; false if there are none left
+    bool take(int patientId, vector<string>& out);
+    vector<int> pendingIds() const;
+    size_t pendingCount() const;
+};
@@ -0,0 +1,331 @@
+// Symptom vocabulary implementation
+#include "symptom_vocabulary.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+string lowerCase(const string& text) {
+    string lower = text;
+    for (auto& c : lower) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return lower;
+}
+
+string trim(const string& text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+// First position at or after `from` whose code is not below `target`:
+// probe 1, 2, 4, ... ahead, then binary search the last step
+size_t gallop(const vector<SymptomCode>& codes, size_t from, SymptomCode target) {
+    size_t low = from;
+    size_t high = from;
+    size_t step = 1;
+    while (high < codes.size() && codes[high] < target) {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    high = min(high, codes.size());
+    return lower_bound(codes.begin() + low, codes.begin() + high, target) - codes.begin();
+}
+
+// Codes of `small` found in `large`; stops at the first miss if `all`
+size_t countFound(const vector<SymptomCode>& small, const vector<SymptomCode>& large, bool all) {
+    size_t found = 0;
+    size_t position = 0;
+    for (SymptomCode code : small) {
+        position = gallop(large, position, code);
+        if (position == large.size()) break;
+        if (large[position] == code) {
+            found++;
+            position++;
+        } else if (all) {
+            break;
+        }
+    }
+    return found;
+}
+
+} // namespace
+
+SymptomSet::SymptomSet(vector<SymptomCode> values) : codes(move(values)) {
+    sort(codes.begin(), codes.end());
+    codes.erase(unique(codes.begin(), codes.end()), codes.end());
+}
+
+bool SymptomSet::insert(SymptomCode code) {
+    auto position = lower_bound(codes.begin(), codes.end(), code);
+    if (position != codes.end() && *position == code) return false;
+    codes.insert(position, code);
+    return true;
+}
+
+bool SymptomSet::erase(SymptomCode code) {
+    auto position = lower_bound(codes.begin(), codes.end(), code);
+    if (position == codes.end() || *position != code) return false;
+    codes.erase(position);
+    return true;
+}
+
+bool SymptomSet::contains(SymptomCode code) const {
+    return binary_search(codes.begin(), codes.end(), code);
+}
+
+bool SymptomSet::containsAll(const SymptomSet& other) const {
+    if (other.codes.size() > codes.size()) return false;
+    return countFound(other.codes, codes, true) == other.codes.size();
+}
+
+bool SymptomSet::intersects(const SymptomSet& other) const {
+    const SymptomSet& small = size() <= other.size() ? *this : other;
+    const SymptomSet& large = size() <= other.size() ? other : *this;
+    size_t position = 0;
+    for (SymptomCode code : small.codes) {
+        position = gallop(large.codes, position, code);
+        if (position == large.codes.size()) return false;
+        if (large.codes[position] == code) return true;
+    }
+    return false;
+}
+
+size_t SymptomSet::intersectionSize(const SymptomSet& other) const {
+    if (size() <= other.size()) return countFound(codes, other.codes, false);
+    return countFound(other.codes, codes, false);
+}
+
+size_t SymptomSet::size() const {
+    return codes.size();
+}
+
+bool SymptomSet::empty() const {
+    return codes.empty();
+}
+
+const vector<SymptomCode>& SymptomSet::values() const {
+    return codes;
+}
+
+SymptomMask SymptomSet::catalogMask() const {
+    SymptomMask mask = 0;
+    size_t catalogSize = symptomCatalog().size();
+    for (SymptomCode code : codes) {
+        if (code >= catalogSize) break;
+        mask |= SymptomMask(1) << code;
+    }
+    return mask;
+}
+
+SymptomVocabulary::SymptomVocabulary() {
+    string error;
+    for (const auto& symptom : symptomCatalog()) addTerm("", symptom, error);
+    sortNames();
+}
+
+bool SymptomVocabulary::addTerm(const string& code, const string& name, string& error) {
+    string key = lowerCase(name);
+    if (byName.count(key)) {
+        error = "duplicate symptom name '" + name + "'";
+        return false;
+    }
+    if (!code.empty() && !byCode.emplace(lowerCase(code), static_cast<SymptomCode>(terms.size())).second) {
+        error = "duplicate code '" + code + "'";
+        return false;
+    }
+    byName[key] = static_cast<SymptomCode>(terms.size());
+    terms.push_back({code, name});
+    return true;
+}
+
+void SymptomVocabulary::sortNames() {
+    nameOrder.resize(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) nameOrder[i] = static_cast<SymptomCode>(i);
+    vector<string> keys(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) keys[i] = lowerCase(terms[i].name);
+    sort(nameOrder.begin(), nameOrder.end(), [&keys](SymptomCode a, SymptomCode b) { return keys[a] < keys[b]; });
+}
+
+bool SymptomVocabulary::parse(const string& text, SymptomVocabulary& out, string& error) {
+    SymptomVocabulary parsed;
+    size_t builtin = parsed.terms.size();
+    stringstream ss(text);
+    string line;
+    int lineNumber = 0;
+    while (getline(ss, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != string::npos) line = line.substr(0, comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        string where = "line " + to_string(lineNumber) + ": ";
+        size_t gap = line.find_first_of(" \t");
+        string name = gap == string::npos ? "" : trim(line.substr(gap));
+        if (name.empty()) {
+            error = where + "expected 'CODE name'";
+            return false;
+        }
+        string code = line.substr(0, gap);
+        auto existing = parsed.byName.find(lowerCase(name));
+        if (existing != parsed.byName.end() && existing->second < builtin && parsed.terms[existing->second].code.empty()) {
+            // A built-in symptom keeps its number and gains the file's code
+            if (!parsed.byCode.emplace(lowerCase(code), existing->second).second) {
+                error = where + "duplicate code '" + code + "'";
+                return false;
+            }
+            parsed.terms[existing->second].code = code;
+            continue;
+        }
+        string termError;
+        if (!parsed.addTerm(code, name, termError)) {
+            error = where + termError;
+            return false;
+        }
+    }
+    parsed.sortNames();
+    out = move(parsed);
+    return true;
+}
+
+bool SymptomVocabulary::loadFromFile(const string& path, SymptomVocabulary& out, string& error) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    stringstream buffer;
+    buffer << file.rdbuf();
+    return parse(buffer.str(), out, error);
+}
+
+size_t SymptomVocabulary::size() const {
+    return terms.size();
+}
+
+int SymptomVocabulary::find(const string& nameOrCode) const {
+    string key = lowerCase(trim(nameOrCode));
+    auto found = byName.find(key);
+    if (found != byName.end()) return static_cast<int>(found->second);
+    found = byCode.find(key);
+    return found == byCode.end() ? -1 : static_cast<int>(found->second);
+}
+
+const string& SymptomVocabulary::name(SymptomCode code) const {
+    return terms[code].name;
+}
+
+const string& SymptomVocabulary::externalCode(SymptomCode code) const {
+    return terms[code].code;
+}
+
+vector<SymptomCode> SymptomVocabulary::withPrefix(const string& prefix, size_t limit) const {
+    string key = lowerCase(prefix);
+    auto keyOf = [this](SymptomCode code) { return lowerCase(terms[code].name); };
+    auto first = lower_bound(nameOrder.begin(), nameOrder.end(), key,
+                             [&keyOf](SymptomCode code, const string& wanted) { return keyOf(code) < wanted; });
+    vector<SymptomCode> matches;
+    for (auto it = first; it != nameOrder.end() && matches.size() < limit; ++it) {
+        if (keyOf(*it).compare(0, key.size(), key) != 0) break;
+        matches.push_back(*it);
+    }
+    return matches;
+}
+
+SymptomSet SymptomVocabulary::encode(const vector<string>& names) const {
+    vector<SymptomCode> codes;
+    codes.reserve(names.size());
+    for (const auto& name : names) {
+        int code = find(name);
+        if (code >= 0) codes.push_back(static_cast<SymptomCode>(code));
+    }
+    return SymptomSet(move(codes));
+}
+
+vector<string> SymptomVocabulary::decode(const SymptomSet& symptoms) const {
+    vector<string> names;
+    for (SymptomCode code : symptoms.values()) {
+        if (code < terms.size()) names.push_back(terms[code].name);
+    }
+    return names;
+}
+
+bool CodedRuleSet::parse(const string& text, const SymptomVocabulary& vocabulary, CodedRuleSet& out, string& error) {
+    vector<CodedRule> parsed;
+    bool ok = parseRuleLines(text, [&parsed, &vocabulary](const RuleLine& line, string& ruleError) {
+        auto lookup = [&vocabulary, &ruleError](const vector<string>& names, SymptomSet& symptoms) {
+            for (const auto& name : names) {
+                int code = vocabulary.find(name);
+                if (code < 0) {
+                    ruleError = "unknown symptom '" + name + "'";
+                    return false;
+                }
+                symptoms.insert(static_cast<SymptomCode>(code));
+            }
+            return true;
+        };
+        CodedRule rule;
+        rule.disease = line.disease;
+        for (const auto& clauseNames : line.clauses) {
+            CodedClause c;
+            c.exactCount = clauseNames.exactCount;
+            if (!lookup(clauseNames.required, c.required) || !lookup(clauseNames.excluded, c.excluded)) return false;
+            if (c.required.intersects(c.excluded)) {
+                ruleError = "clause requires and excludes the same symptom";
+                return false;
+            }
+            rule.clauses.push_back(c);
+        }
+        parsed.push_back(rule);
+        return true;
+    }, error);
+    if (!ok) return false;
+    if (parsed.empty()) {
+        error = "no rules defined";
+        return false;
+    }
+    out.rules = move(parsed);
+    return true;
+}
+
+bool CodedRuleSet::loadFromFile(const string& path, const SymptomVocabulary& vocabulary, CodedRuleSet& out,
+                                string& error) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    stringstream buffer;
+    buffer << file.rdbuf();
+    return parse(buffer.str(), vocabulary, out, error);
+}
+
+const vector<CodedRule>& CodedRuleSet::getRules() const {
+    return rules;
+}
+
+bool CodedRuleSet::clauseMatches(const CodedClause& clause, const SymptomSet& symptoms, int symptomCount) const {
+    return (clause.exactCount < 0 || clause.exactCount == symptomCount) && symptoms.containsAll(clause.required) &&
+           !symptoms.intersects(clause.excluded);
+}
+
+vector<string> CodedRuleSet::predict(const SymptomSet& symptoms, int symptomCount) const {
+    vector<string> diseases;
+    for (const auto& rule : rules) {
+        for (const auto& clause : rule.clauses) {
+            if (clauseMatches(clause, symptoms, symptomCount)) {
+                diseases.push_back(rule.disease);
+                break;
+            }
+        }
+    }
+    sort(diseases.begin(), diseases.end());
+    diseases.erase(unique(diseases.begin(), diseases.end()), diseases.end());
+    return diseases;
+}
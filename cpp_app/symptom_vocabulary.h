@@ -0,0 +1,111 @@
+// Coded symptom vocabularies (e.g. ICD-10 or SNOMED extracts) and rules
+// over them
+#pragma once
+#include "rule_set.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Dense number of a vocabulary term. The built-in symptoms are always
+// 0 to 17, in symptomCatalog() order, so they line up with SymptomMask bits.
+typedef uint32_t SymptomCode;
+
+// Sorted, duplicate-free codes: memory grows with the symptoms a patient
+// has, not with the size of the vocabulary
+class SymptomSet {
+private:
+    vector<SymptomCode> codes;
+
+public:
+    SymptomSet() = default;
+    explicit SymptomSet(vector<SymptomCode> codes);
+
+    bool insert(SymptomCode code);
+    bool erase(SymptomCode code);
+    bool contains(SymptomCode code) const;
+    // Set operations walk the smaller set and gallop through the larger
+    // one, so a 3-symptom clause costs a few probes however many codes
+    // the patient has
+    bool containsAll(const SymptomSet& other) const;
+    bool intersects(const SymptomSet& other) const;
+    size_t intersectionSize(const SymptomSet& other) const;
+
+    size_t size() const;
+    bool empty() const;
+    const vector<SymptomCode>& values() const;
+    SymptomMask catalogMask() const; // the built-in symptoms as bits
+};
+
+// Term table: code 0..size()-1 -> external code (e.g. "R50.9") and name.
+// Lookups by name ignore case.
+class SymptomVocabulary {
+private:
+    struct Term {
+        string code; // empty for built-in symptoms the file did not list
+        string name;
+    };
+
+    vector<Term> terms;
+    unordered_map<string, SymptomCode> byName; // lower-case name
+    unordered_map<string, SymptomCode> byCode;
+    vector<SymptomCode> nameOrder; // by lower-case name, for prefix search
+
+    bool addTerm(const string& code, const string& name, string& error);
+    void sortNames();
+
+public:
+    // Just the built-in symptoms
+    SymptomVocabulary();
+
+    // One term per line: "CODE<tab or space>name", '#' starts a comment.
+    // A line naming a built-in symptom gives it that code; other terms
+    // are numbered from 18 in file order. Returns false and sets `error`
+    // (with the line number) on duplicate codes or names.
+    static bool parse(const string& text, SymptomVocabulary& out, string& error);
+    static bool loadFromFile(const string& path, SymptomVocabulary& out, string& error);
+
+    size_t size() const;
+    // By name or external code; -1 if unknown
+    int find(const string& nameOrCode) const;
+    const string& name(SymptomCode code) const;
+    const string& externalCode(SymptomCode code) const;
+    // Up to `limit` terms whose name starts with `prefix`, in name order
+    vector<SymptomCode> withPrefix(const string& prefix, size_t limit) const;
+
+    // Unknown names are skipped
+    SymptomSet encode(const vector<string>& names) const;
+    vector<string> decode(const SymptomSet& symptoms) const;
+};
+
+struct CodedClause {
+    SymptomSet required;
+    SymptomSet excluded;
+    int exactCount = -1;
+};
+
+struct CodedRule {
+    string disease;
+    vector<CodedClause> clauses;
+};
+
+// Disease rules over a vocabulary, in the rules.txt format, with any
+// term (by name or code) allowed. Unlike RuleSet there is no limit on the
+// number of symptoms or rules; clauses are checked with SymptomSet
+// operations instead of bitmask tests.
+class CodedRuleSet {
+private:
+    vector<CodedRule> rules;
+
+public:
+    static bool parse(const string& text, const SymptomVocabulary& vocabulary, CodedRuleSet& out, string& error);
+    static bool loadFromFile(const string& path, const SymptomVocabulary& vocabulary, CodedRuleSet& out,
+                             string& error);
+
+    const vector<CodedRule>& getRules() const;
+    bool clauseMatches(const CodedClause& clause, const SymptomSet& symptoms, int symptomCount) const;
+    // Same contract as predictDiseases(): sorted, de-duplicated names
+    vector<string> predict(const SymptomSet& symptoms, int symptomCount) const;
+};
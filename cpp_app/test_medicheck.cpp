@@ -1,288 +1,2607 @@
-// MediCheck Application Test Suite
-#include "patient_manager.h"
-#include "diagnosis.h"
-#include <iostream>
-#include <cassert>
-#include <fstream>
-#include <vector>
-#include <string>
-
-using namespace std;
-
-class MediCheckTester {
-private:
-    PatientManager manager;
-    int testsPassed = 0;
-    int testsFailed = 0;
-
-public:
-    void runAllTests() {
-        cout << "========================================\n";
-        cout << "     MediCheck Test Suite Starting     \n";
-        cout << "========================================\n\n";
-
-        // Clean up test files before starting
-        cleanupTestFiles();
-
-        testPatientManagement();
-        testSymptomManagement();
-        testDiagnosisEngine();
-        testCSVPersistence();
-        testDataLoading();
-
-        printTestResults();
-    }
-
-private:
-    void cleanupTestFiles() {
-        remove("data/patients.csv");
-        remove("data/symptoms.csv");
-        cout << "Test files cleaned up.\n\n";
-    }
-
-    void assertTrue(bool condition, const string& testName) {
-        if (condition) {
-            cout << " PASS: " << testName << "\n";
-            testsPassed++;
-        } else {
-            cout << " FAIL: " << testName << "\n";
-            testsFailed++;
-        }
-    }
-
-    void testPatientManagement() {
-        cout << "--- Testing Patient Management ---\n";
-
-        // Test 1: Add patients
-        manager.addPatient("John Doe", 30, "M");
-        manager.addPatient("Jane Smith", 25, "F");
-        manager.addPatient("Bob Johnson", 45, "M");
-        
-        assertTrue(manager.getPatientCount() == 3, "Add 3 patients");
-
-        // Test 2: Find patient by ID
-        Patient* patient = manager.findPatientById(1);
-        assertTrue(patient != nullptr, "Find patient by ID 1");
-        assertTrue(patient->name == "John Doe", "Patient 1 has correct name");
-        assertTrue(patient->age == 30, "Patient 1 has correct age");
-        assertTrue(patient->gender == "M", "Patient 1 has correct gender");
-
-        // Test 3: Find non-existent patient
-        Patient* nonExistent = manager.findPatientById(999);
-        assertTrue(nonExistent == nullptr, "Non-existent patient returns nullptr");
-
-        // Test 4: Delete patient
-        bool deleted = manager.deletePatient(2);
-        assertTrue(deleted == true, "Delete existing patient");
-        assertTrue(manager.getPatientCount() == 2, "Patient count after deletion");
-
-        // Test 5: Delete non-existent patient
-        bool notDeleted = manager.deletePatient(999);
-        assertTrue(notDeleted == false, "Delete non-existent patient fails");
-
-        cout << "\n";
-    }
-
-    void testSymptomManagement() {
-        cout << "--- Testing Symptom Management ---\n";
-
-        Patient* patient = manager.findPatientById(1);
-        if (patient) {
-            // Test 1: Add symptoms
-            patient->addSymptom("fever");
-            patient->addSymptom("cough");
-            patient->addSymptom("headache");
-            
-            assertTrue(patient->symptoms.size() == 3, "Add 3 symptoms to patient");
-
-            // Test 2: Add duplicate symptom
-            size_t beforeSize = patient->symptoms.size();
-            patient->addSymptom("fever"); // Should not add duplicate
-            assertTrue(patient->symptoms.size() == beforeSize, "Duplicate symptom not added");
-
-            // Test 3: Clear symptoms
-            patient->clearSymptoms();
-            assertTrue(patient->symptoms.empty(), "Clear all symptoms");
-
-            // Test 4: Re-add symptoms for further testing
-            patient->addSymptom("fever");
-            patient->addSymptom("cough");
-            patient->addSymptom("shortness of breath");
-        }
-
-        // Test 5: Available symptoms list
-        vector<string> availableSymptoms = manager.getAvailableSymptoms();
-        assertTrue(availableSymptoms.size() == 18, "Available symptoms list has 18 items");
-        assertTrue(availableSymptoms[0] == "fever", "First symptom is fever");
-        assertTrue(availableSymptoms[1] == "cough", "Second symptom is cough");
-
-        cout << "\n";
-    }
-
-    void testDiagnosisEngine() {
-        cout << "--- Testing Diagnosis Engine ---\n";
-
-        // Test 1: Common Cold diagnosis
-        vector<string> coldSymptoms = {"runny nose", "sore throat"};
-        vector<string> coldDiseases = predictDiseases(coldSymptoms);
-        bool hasCommonCold = false;
-        for (const auto& disease : coldDiseases) {
-            if (disease == "Common Cold") {
-                hasCommonCold = true;
-                break;
-            }
-        }
-        assertTrue(hasCommonCold, "Common Cold diagnosed with runny nose + sore throat");
-
-        // Test 2: Flu diagnosis
-        vector<string> fluSymptoms = {"fever", "cough"};
-        vector<string> fluDiseases = predictDiseases(fluSymptoms);
-        bool hasFlu = false;
-        for (const auto& disease : fluDiseases) {
-            if (disease == "Flu") {
-                hasFlu = true;
-                break;
-            }
-        }
-        assertTrue(hasFlu, "Flu diagnosed with fever + cough");
-
-        // Test 3: COVID-19 diagnosis
-        vector<string> covidSymptoms = {"fever", "cough", "loss of taste"};
-        vector<string> covidDiseases = predictDiseases(covidSymptoms);
-        bool hasCovid = false;
-        for (const auto& disease : covidDiseases) {
-            if (disease == "COVID-19") {
-                hasCovid = true;
-                break;
-            }
-        }
-        assertTrue(hasCovid, "COVID-19 diagnosed with fever + cough + loss of taste");
-
-        // Test 4: No symptoms = no diseases
-        vector<string> noSymptoms = {};
-        vector<string> noDiseases = predictDiseases(noSymptoms);
-        assertTrue(noDiseases.empty(), "No symptoms results in no diseases");
-
-        // Test 5: Pneumonia diagnosis
-        vector<string> pneumoniaSymptoms = {"fever", "cough", "shortness of breath"};
-        vector<string> pneumoniaDiseases = predictDiseases(pneumoniaSymptoms);
-        bool hasPneumonia = false;
-        for (const auto& disease : pneumoniaDiseases) {
-            if (disease == "Pneumonia") {
-                hasPneumonia = true;
-                break;
-            }
-        }
-        assertTrue(hasPneumonia, "Pneumonia diagnosed with fever + cough + shortness of breath");
-
-        cout << "\n";
-    }
-
-    void testCSVPersistence() {
-        cout << "--- Testing CSV Persistence ---\n";
-
-        // Test 1: Check if patients.csv is created
-        ifstream patientsFile("data/patients.csv");
-        assertTrue(patientsFile.is_open(), "Patients CSV file created");
-        
-        // Test 2: Check patients.csv content
-        string line;
-        getline(patientsFile, line); // header
-        assertTrue(line == "id,name,age,gender", "Patients CSV has correct header");
-        
-        bool foundJohnDoe = false;
-        while (getline(patientsFile, line)) {
-            if (line.find("John Doe") != string::npos) {
-                foundJohnDoe = true;
-                break;
-            }
-        }
-        patientsFile.close();
-        assertTrue(foundJohnDoe, "John Doe found in patients CSV");
-
-        // Test 3: Update symptoms CSV
-        Patient* patient = manager.findPatientById(1);
-        if (patient) {
-            patient->symptoms = {"fever", "cough", "headache"};
-            manager.updatePatientSymptomsInCSV(1, patient->symptoms);
-        }
-
-        // Test 4: Check symptoms.csv
-        ifstream symptomsFile("data/symptoms.csv");
-        assertTrue(symptomsFile.is_open(), "Symptoms CSV file created");
-        
-        getline(symptomsFile, line); // header
-        assertTrue(line == "patient_id,symptoms", "Symptoms CSV has correct header");
-        
-        bool foundPatientSymptoms = false;
-        while (getline(symptomsFile, line)) {
-            if (line.find("1,fever;cough;headache") != string::npos) {
-                foundPatientSymptoms = true;
-                break;
-            }
-        }
-        symptomsFile.close();
-        assertTrue(foundPatientSymptoms, "Patient symptoms found in symptoms CSV");
-
-        cout << "\n";
-    }
-
-    void testDataLoading() {
-        cout << "--- Testing Data Loading ---\n";
-
-        // Create a new PatientManager to test loading
-        PatientManager newManager;
-        
-        // Test 1: Load data from CSV
-        newManager.loadDataFromCSV();
-        assertTrue(newManager.getPatientCount() > 0, "Data loaded from CSV");
-
-        // Test 2: Check loaded patient data
-        Patient* loadedPatient = newManager.findPatientById(1);
-        assertTrue(loadedPatient != nullptr, "Patient 1 loaded successfully");
-        
-        if (loadedPatient) {
-            assertTrue(loadedPatient->name == "John Doe", "Loaded patient has correct name");
-            assertTrue(loadedPatient->age == 30, "Loaded patient has correct age");
-            assertTrue(loadedPatient->gender == "M", "Loaded patient has correct gender");
-            assertTrue(!loadedPatient->symptoms.empty(), "Loaded patient has symptoms");
-        }
-
-        // Test 3: Check if symptoms are loaded correctly
-        if (loadedPatient) {
-            bool hasRequiredSymptoms = false;
-            for (const auto& symptom : loadedPatient->symptoms) {
-                if (symptom == "fever" || symptom == "cough" || symptom == "headache") {
-                    hasRequiredSymptoms = true;
-                    break;
-                }
-            }
-            assertTrue(hasRequiredSymptoms, "Loaded patient has expected symptoms");
-        }
-
-        cout << "\n";
-    }
-
-    void printTestResults() {
-        cout << "========================================\n";
-        cout << "           Test Results Summary         \n";
-        cout << "========================================\n";
-        cout << "Tests Passed: " << testsPassed << "\n";
-        cout << "Tests Failed: " << testsFailed << "\n";
-        cout << "Total Tests:  " << (testsPassed + testsFailed) << "\n";
-        cout << "Success Rate: " << (testsPassed * 100.0 / (testsPassed + testsFailed)) << "%\n";
-        
-        if (testsFailed == 0) {
-            cout << "\n All tests passed! The application is working correctly.\n";
-        } else {
-            cout << "\n  Some tests failed. Please check the implementation.\n";
-        }
-        cout << "========================================\n";
-    }
-};
-
-int main() {
-    MediCheckTester tester;
-    tester.runAllTests();
-    return 0;
-}
+// MediCheck Application Test Suite
+#include "patient_manager.h"
+#include "diagnosis.h"
+#include "persistence_writer.h"
+#include "prolog_engine.h"
+#include "differential_harness.h"
+#include "rule_registry.h"
+#include "atomic_file.h"
+#include "result_export.h"
+#include "symptom_history.h"
+#include "patient_store.h"
+#include "rediagnosis.h"
+#include "shared_registry.h"
+#include "patient_similarity.h"
+#include "population_analytics.h"
+#include "symptom_vocabulary.h"
+#include "patient_id.h"
+#include "workload_trace.h"
+#include "bayes_scorer.h"
+#include "async_storage.h"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <atomic>
+#include <utime.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+class MediCheckTester {
+private:
+    PatientManager manager;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+public:
+    void runAllTests() {
+        cout << "========================================\n";
+        cout << "     MediCheck Test Suite Starting     \n";
+        cout << "========================================\n\n";
+
+        // Clean up test files before starting
+        cleanupTestFiles();
+
+        testPatientManagement();
+        testSymptomManagement();
+        testDiagnosisEngine();
+        testCSVPersistence();
+        testDataLoading();
+        testWriteBehindPersistence();
+        testPrologEngine();
+        testDifferentialHarness();
+        testRuleHotReload();
+        testRuleOptimizer();
+        testPatientIndex();
+        testPatientPaging();
+        testFuzzyNameSearch();
+        testAtomicFileReplace();
+        testResultExport();
+        testSymptomHistory();
+        testPatientSnapshots();
+        testLazySymptomLoading();
+        testRediagnosisWorkers();
+        testSharedRegistry();
+        testSimilarPatients();
+        testPopulationAnalytics();
+        testSymptomVocabulary();
+        testPatientIds();
+        testWorkloadTrace();
+        testBayesScorer();
+        testAsyncStorage();
+
+        printTestResults();
+    }
+
+private:
+    void cleanupTestFiles() {
+        remove("data/patients.csv");
+        remove("data/symptoms.csv");
+        remove("data/symptoms.csv.manifest");
+        remove("data/symptoms.csv.prev");
+        remove("data/symptom_history.csv");
+        remove("data/patients.csv.appending");
+        remove("data/symptom_history.csv.appending");
+        remove("data/symptom_codes.txt");
+        remove("data/next_id.txt");
+        remove("data/next_id.txt.manifest");
+        remove("data/next_id.txt.prev");
+        cout << "Test files cleaned up.\n\n";
+    }
+
+    void assertTrue(bool condition, const string& testName) {
+        if (condition) {
+            cout << " PASS: " << testName << "\n";
+            testsPassed++;
+        } else {
+            cout << " FAIL: " << testName << "\n";
+            testsFailed++;
+        }
+    }
+
+    void testPatientManagement() {
+        cout << "--- Testing Patient Management ---\n";
+
+        // Test 1: Add patients
+        manager.addPatient("John Doe", 30, "M");
+        manager.addPatient("Jane Smith", 25, "F");
+        manager.addPatient("Bob Johnson", 45, "M");
+        
+        assertTrue(manager.getPatientCount() == 3, "Add 3 patients");
+
+        // Test 2: Find patient by ID
+        Patient* patient = manager.findPatientById(1);
+        assertTrue(patient != nullptr, "Find patient by ID 1");
+        assertTrue(patient->name == "John Doe", "Patient 1 has correct name");
+        assertTrue(patient->age == 30, "Patient 1 has correct age");
+        assertTrue(patient->gender == "M", "Patient 1 has correct gender");
+
+        // Test 3: Find non-existent patient
+        Patient* nonExistent = manager.findPatientById(999);
+        assertTrue(nonExistent == nullptr, "Non-existent patient returns nullptr");
+
+        // Test 4: Delete patient
+        bool deleted = manager.deletePatient(2);
+        assertTrue(deleted == true, "Delete existing patient");
+        assertTrue(manager.getPatientCount() == 2, "Patient count after deletion");
+
+        // Test 5: Delete non-existent patient
+        bool notDeleted = manager.deletePatient(999);
+        assertTrue(notDeleted == false, "Delete non-existent patient fails");
+
+        cout << "\n";
+    }
+
+    void testSymptomManagement() {
+        cout << "--- Testing Symptom Management ---\n";
+
+        Patient* patient = manager.findPatientById(1);
+        if (patient) {
+            // Test 1: Add symptoms
+            patient->addSymptom("fever");
+            patient->addSymptom("cough");
+            patient->addSymptom("headache");
+            
+            assertTrue(patient->symptoms.size() == 3, "Add 3 symptoms to patient");
+
+            // Test 2: Add duplicate symptom
+            size_t beforeSize = patient->symptoms.size();
+            patient->addSymptom("fever"); // Should not add duplicate
+            assertTrue(patient->symptoms.size() == beforeSize, "Duplicate symptom not added");
+
+            // Test 3: Clear symptoms
+            patient->clearSymptoms();
+            assertTrue(patient->symptoms.empty(), "Clear all symptoms");
+
+            // Test 4: Re-add symptoms for further testing
+            patient->addSymptom("fever");
+            patient->addSymptom("cough");
+            patient->addSymptom("shortness of breath");
+        }
+
+        // Test 5: Available symptoms list
+        vector<string> availableSymptoms = manager.getAvailableSymptoms();
+        assertTrue(availableSymptoms.size() == 18, "Available symptoms list has 18 items");
+        assertTrue(availableSymptoms[0] == "fever", "First symptom is fever");
+        assertTrue(availableSymptoms[1] == "cough", "Second symptom is cough");
+
+        cout << "\n";
+    }
+
+    void testDiagnosisEngine() {
+        cout << "--- Testing Diagnosis Engine ---\n";
+
+        // Test 1: Common Cold diagnosis
+        vector<string> coldSymptoms = {"runny nose", "sore throat"};
+        vector<string> coldDiseases = predictDiseases(coldSymptoms);
+        bool hasCommonCold = false;
+        for (const auto& disease : coldDiseases) {
+            if (disease == "Common Cold") {
+                hasCommonCold = true;
+                break;
+            }
+        }
+        assertTrue(hasCommonCold, "Common Cold diagnosed with runny nose + sore throat");
+
+        // Test 2: Flu diagnosis
+        vector<string> fluSymptoms = {"fever", "cough"};
+        vector<string> fluDiseases = predictDiseases(fluSymptoms);
+        bool hasFlu = false;
+        for (const auto& disease : fluDiseases) {
+            if (disease == "Flu") {
+                hasFlu = true;
+                break;
+            }
+        }
+        assertTrue(hasFlu, "Flu diagnosed with fever + cough");
+
+        // Test 3: COVID-19 diagnosis
+        vector<string> covidSymptoms = {"fever", "cough", "loss of taste"};
+        vector<string> covidDiseases = predictDiseases(covidSymptoms);
+        bool hasCovid = false;
+        for (const auto& disease : covidDiseases) {
+            if (disease == "COVID-19") {
+                hasCovid = true;
+                break;
+            }
+        }
+        assertTrue(hasCovid, "COVID-19 diagnosed with fever + cough + loss of taste");
+
+        // Test 4: No symptoms = no diseases
+        vector<string> noSymptoms = {};
+        vector<string> noDiseases = predictDiseases(noSymptoms);
+        assertTrue(noDiseases.empty(), "No symptoms results in no diseases");
+
+        // Test 5: Pneumonia diagnosis
+        vector<string> pneumoniaSymptoms = {"fever", "cough", "shortness of breath"};
+        vector<string> pneumoniaDiseases = predictDiseases(pneumoniaSymptoms);
+        bool hasPneumonia = false;
+        for (const auto& disease : pneumoniaDiseases) {
+            if (disease == "Pneumonia") {
+                hasPneumonia = true;
+                break;
+            }
+        }
+        assertTrue(hasPneumonia, "Pneumonia diagnosed with fever + cough + shortness of breath");
+
+        cout << "\n";
+    }
+
+    void testCSVPersistence() {
+        cout << "--- Testing CSV Persistence ---\n";
+
+        // Patient rows are written in the background; wait for them
+        manager.flushPersistence();
+
+        // Test 1: Check if patients.csv is created
+        ifstream patientsFile("data/patients.csv");
+        assertTrue(patientsFile.is_open(), "Patients CSV file created");
+        
+        // Test 2: Check patients.csv content
+        string line;
+        getline(patientsFile, line); // header
+        assertTrue(line == "id,name,age,gender", "Patients CSV has correct header");
+        
+        bool foundJohnDoe = false;
+        while (getline(patientsFile, line)) {
+            if (line.find("John Doe") != string::npos) {
+                foundJohnDoe = true;
+                break;
+            }
+        }
+        patientsFile.close();
+        assertTrue(foundJohnDoe, "John Doe found in patients CSV");
+
+        // Test 3: Update symptoms CSV
+        Patient* patient = manager.findPatientById(1);
+        if (patient) {
+            patient->symptoms = {"fever", "cough", "headache"};
+            manager.updatePatientSymptomsInCSV(1, patient->symptoms);
+        }
+
+        // Test 4: Check symptoms.csv
+        ifstream symptomsFile("data/symptoms.csv");
+        assertTrue(symptomsFile.is_open(), "Symptoms CSV file created");
+        
+        getline(symptomsFile, line); // header
+        assertTrue(line == "patient_id,symptoms", "Symptoms CSV has correct header");
+        
+        bool foundPatientSymptoms = false;
+        while (getline(symptomsFile, line)) {
+            if (line.find("1,fever;cough;headache") != string::npos) {
+                foundPatientSymptoms = true;
+                break;
+            }
+        }
+        symptomsFile.close();
+        assertTrue(foundPatientSymptoms, "Patient symptoms found in symptoms CSV");
+
+        cout << "\n";
+    }
+
+    void testDataLoading() {
+        cout << "--- Testing Data Loading ---\n";
+
+        // Create a new PatientManager to test loading
+        PatientManager newManager;
+        
+        // Test 1: Load data from CSV
+        newManager.loadDataFromCSV();
+        assertTrue(newManager.getPatientCount() > 0, "Data loaded from CSV");
+
+        // Test 2: Check loaded patient data
+        Patient* loadedPatient = newManager.findPatientById(1);
+        assertTrue(loadedPatient != nullptr, "Patient 1 loaded successfully");
+        
+        if (loadedPatient) {
+            assertTrue(loadedPatient->name == "John Doe", "Loaded patient has correct name");
+            assertTrue(loadedPatient->age == 30, "Loaded patient has correct age");
+            assertTrue(loadedPatient->gender == "M", "Loaded patient has correct gender");
+            assertTrue(!loadedPatient->symptoms.empty(), "Loaded patient has symptoms");
+        }
+
+        // Test 3: Check if symptoms are loaded correctly
+        if (loadedPatient) {
+            bool hasRequiredSymptoms = false;
+            for (const auto& symptom : loadedPatient->symptoms) {
+                if (symptom == "fever" || symptom == "cough" || symptom == "headache") {
+                    hasRequiredSymptoms = true;
+                    break;
+                }
+            }
+            assertTrue(hasRequiredSymptoms, "Loaded patient has expected symptoms");
+        }
+
+        cout << "\n";
+    }
+
+    void testWriteBehindPersistence() {
+        cout << "--- Testing Write-Behind Persistence ---\n";
+
+        const string patientsPath = "data/test_writer_patients.csv";
+        const string symptomsPath = "data/test_writer_symptoms.csv";
+        remove(patientsPath.c_str());
+        remove(symptomsPath.c_str());
+
+        {
+            PersistenceWriter writer(patientsPath, symptomsPath);
+
+            // Test 1: Concurrent producers, repeated updates to one patient
+            vector<thread> producers;
+            for (int t = 0; t < 4; ++t) {
+                producers.emplace_back([&writer, t]() {
+                    for (int i = 0; i < 25; ++i) {
+                        int id = t * 25 + i + 1;
+                        writer.appendPatient(id, "Patient_" + to_string(id), 20 + i, "F");
+                        writer.updateSymptoms(1, {"fever"});
+                    }
+                });
+            }
+            for (auto& producer : producers) producer.join();
+            writer.updateSymptoms(1, {"fever", "cough"});
+            writer.updateSymptoms(2, {"rash"});
+            writer.flush();
+
+            ifstream patientsFile(patientsPath);
+            string line;
+            getline(patientsFile, line);
+            assertTrue(line == "id,name,age,gender", "Write-behind patients CSV has header");
+            int rows = 0;
+            while (getline(patientsFile, line)) {
+                if (!line.empty()) rows++;
+            }
+            assertTrue(rows == 100, "All 100 queued patients written after flush");
+
+            ifstream symptomsFile(symptomsPath);
+            vector<string> lines;
+            while (getline(symptomsFile, line)) lines.push_back(line);
+            assertTrue(lines.size() == 3, "Symptom updates coalesced to one line per patient");
+            assertTrue(lines.size() == 3 && lines[1] == "1,fever;cough", "Latest symptom update wins");
+
+            // Test 2: Writes queued before shutdown are not lost
+            writer.updateSymptoms(2, {});
+        }
+
+        ifstream symptomsFile(symptomsPath);
+        string line;
+        int lines = 0;
+        while (getline(symptomsFile, line)) lines++;
+        assertTrue(lines == 2, "Pending writes drained on shutdown");
+
+        // Test 3: Submits racing shutdown are written, not dropped
+        remove(patientsPath.c_str());
+        {
+            PersistenceWriter writer(patientsPath, symptomsPath);
+            vector<thread> producers;
+            for (int t = 0; t < 4; ++t) {
+                producers.emplace_back([&writer, t]() {
+                    for (int i = 0; i < 200; ++i) writer.appendPatient(t * 200 + i + 1, "Racing", 30, "M");
+                });
+            }
+            this_thread::sleep_for(chrono::microseconds(200));
+            writer.shutdown();
+            for (auto& producer : producers) producer.join();
+        }
+        ifstream racedFile(patientsPath);
+        int raced = 0;
+        while (getline(racedFile, line)) raced++;
+        assertTrue(raced == 801, "Every patient submitted around shutdown is written");
+
+        // Test 4: A malformed line is kept and skipped, not fatal
+        {
+            ofstream bad(symptomsPath);
+            bad << "patient_id,symptoms\n1,fever\nnot-a-number,cough\n";
+        }
+        writeSymptomUpdates(symptomsPath, {{1, {"rash"}}});
+        ifstream repaired(symptomsPath);
+        vector<string> kept;
+        while (getline(repaired, line)) kept.push_back(line);
+        assertTrue(kept.size() == 3 && kept[1] == "not-a-number,cough" && kept[2] == "1,rash",
+                   "Malformed symptom line is skipped by the writer");
+
+        remove(patientsPath.c_str());
+        remove(symptomsPath.c_str());
+        remove((symptomsPath + ".manifest").c_str());
+        remove((symptomsPath + ".prev").c_str());
+        cout << "\n";
+    }
+
+    void testPrologEngine() {
+        cout << "--- Testing Embedded Prolog Engine ---\n";
+
+        PrologEngine engine;
+
+        // Test 1: Load the Prolog test file (consults diagnosis and knowledge_base)
+        bool loaded = engine.consult("../prolog_version/test_diagnosis.pl");
+        assertTrue(loaded, "Prolog test file and knowledge base loaded");
+        if (!loaded) {
+            cout << "  " << engine.lastError() << "\n\n";
+            return;
+        }
+
+        // Test 2: Every diagnose/2 case in test_diagnosis.pl matches predictDiseases
+        vector<vector<string>> cases = engine.collectCallArguments("diagnose", 2, 0);
+        assertTrue(cases.size() >= 13, "Found diagnose/2 cases in test_diagnosis.pl");
+        int mismatches = 0;
+        for (const auto& symptomAtoms : cases) {
+            set<string> prologResult;
+            for (const auto& atom : engine.diagnose(symptomAtoms)) {
+                prologResult.insert(diseaseDisplayName(atom));
+            }
+            vector<string> symptoms;
+            for (const auto& atom : symptomAtoms) {
+                string symptom = atom;
+                replace(symptom.begin(), symptom.end(), '_', ' ');
+                symptoms.push_back(symptom);
+            }
+            vector<string> cppDiseases = predictDiseases(symptoms);
+            set<string> cppResult(cppDiseases.begin(), cppDiseases.end());
+            if (prologResult != cppResult) mismatches++;
+        }
+        assertTrue(mismatches == 0, "Prolog engine matches predictDiseases on test_diagnosis.pl cases");
+
+        // Test 3: Strep throat exclusion rule (\+) is honoured
+        vector<string> strep = engine.diagnose({"sore_throat", "fever"});
+        assertTrue(find(strep.begin(), strep.end(), "strep_throat") != strep.end(),
+                   "diagnose/2 finds strep_throat for [sore_throat, fever]");
+
+        // Test 4: diagnose_detailed/2 scores are sorted by match count
+        vector<pair<string, int>> detailed = engine.diagnoseDetailed({"fever", "cough", "headache"});
+        bool sorted = !detailed.empty();
+        for (size_t i = 1; i < detailed.size(); ++i) {
+            if (detailed[i - 1].second < detailed[i].second) sorted = false;
+        }
+        assertTrue(sorted && detailed[0].second == 3, "diagnose_detailed/2 returns scores in descending order");
+
+        // Test 5: The Prolog test driver itself runs in-process
+        string output;
+        bool ran = engine.runGoal("run_all_tests", output);
+        assertTrue(ran && output.find("=== Tests completed ===") != string::npos, "run_all_tests executes in the engine");
+
+        // Test 6: Unbounded recursion stops with an error instead of a crash
+        {
+            ofstream rules("data/test_recursion.pl");
+            rules << "loop(X) :- loop(X).\n";
+        }
+        bool recursionLoaded = engine.consult("data/test_recursion.pl");
+        string loopOutput;
+        bool looped = engine.runGoal("loop(a)", loopOutput);
+        bool guarded = !looped && engine.lastError().find("stack depth exceeded") != string::npos;
+        vector<string> after = engine.diagnose({"sore_throat", "fever"});
+        assertTrue(recursionLoaded && guarded && !after.empty(), "Runaway recursion hits the depth guard");
+        remove("data/test_recursion.pl");
+
+        cout << "\n";
+    }
+
+    void testDifferentialHarness() {
+        cout << "--- Testing Differential Engine Harness ---\n";
+
+        RuleSet rules = RuleSet::builtin();
+        auto reference = []() -> DiseasePredictor { return predictDiseases; };
+        auto ruleTable = [&rules]() -> DiseasePredictor {
+            return [&rules](const vector<string>& symptoms) { return rules.predict(symptoms); };
+        };
+        auto prolog = []() -> DiseasePredictor {
+            auto engine = make_shared<PrologEngine>();
+            engine->consult("../prolog_version/diagnosis.pl");
+            return [engine](const vector<string>& symptoms) {
+                vector<string> atoms;
+                for (const auto& symptom : symptoms) atoms.push_back(symptomAtom(symptom));
+                vector<string> diseases;
+                for (const auto& atom : engine->diagnose(atoms)) diseases.push_back(diseaseDisplayName(atom));
+                return diseases;
+            };
+        };
+
+        // Test 1: All 2^18 symptom subsets, predictDiseases vs the rule table
+        DifferentialHarness exhaustive;
+        exhaustive.addVariant("predictDiseases", reference);
+        exhaustive.addVariant("RuleSet", ruleTable);
+        DifferentialResult all = exhaustive.runExhaustive();
+        if (!all.agreed) DifferentialHarness::printResult(all);
+        assertTrue(all.agreed && all.casesChecked == (1u << 18), "Rule table agrees with predictDiseases on all 2^18 subsets");
+
+        // Test 2: Random subsets through the embedded Prolog engine
+        DifferentialHarness sampled;
+        sampled.addVariant("predictDiseases", reference);
+        sampled.addVariant("RuleSet", ruleTable);
+        sampled.addVariant("Prolog", prolog);
+        DifferentialResult random = sampled.runRandom(2000, 42);
+        if (!random.agreed) DifferentialHarness::printResult(random);
+        assertTrue(random.agreed && random.casesChecked == 2000, "Prolog engine agrees on 2000 random subsets");
+
+        // Test 3: A deliberately broken engine is caught and the rule named
+        DifferentialHarness broken;
+        broken.addVariant("predictDiseases", reference);
+        broken.addVariant("NoFlu", []() -> DiseasePredictor {
+            return [](const vector<string>& symptoms) {
+                vector<string> diseases = predictDiseases(symptoms);
+                diseases.erase(remove(diseases.begin(), diseases.end(), "Flu"), diseases.end());
+                return diseases;
+            };
+        });
+        DifferentialResult divergence = broken.runExhaustive();
+        assertTrue(!divergence.agreed && divergence.disease == "Flu", "Divergence reports the disease that differs");
+        assertTrue(divergence.symptoms == toSymptomMask({"fever", "cough"}), "Divergence reports the first diverging symptom set");
+        assertTrue(divergence.rule.find("Flu") != string::npos && divergence.rule.find("clause 1") != string::npos,
+                   "Divergence names the rule clause responsible");
+
+        // Test 4: Divergences are explained with the rules under test
+        RuleSet reloaded;
+        string error;
+        RuleSet::parse("Common Cold: runny nose + sore throat\nFlu: fever + sore throat\n", reloaded, error);
+        auto reloadedTable = [&reloaded]() -> DiseasePredictor {
+            return [&reloaded](const vector<string>& symptoms) { return reloaded.predict(symptoms); };
+        };
+        DifferentialHarness custom(reloaded);
+        custom.addVariant("RuleSet", reloadedTable);
+        custom.addVariant("NoFlu", [&reloaded]() -> DiseasePredictor {
+            return [&reloaded](const vector<string>& symptoms) {
+                vector<string> diseases = reloaded.predict(symptoms);
+                diseases.erase(remove(diseases.begin(), diseases.end(), "Flu"), diseases.end());
+                return diseases;
+            };
+        });
+        DifferentialResult customDivergence = custom.runExhaustive();
+        assertTrue(customDivergence.rule.find("Rule 2") != string::npos &&
+                       customDivergence.rule.find("fever + sore throat") != string::npos,
+                   "Divergence is explained with the reloaded rules");
+
+        cout << "\n";
+    }
+
+    void testRuleHotReload() {
+        cout << "--- Testing Rule Hot Reload ---\n";
+
+        // Test 1: The rule file format round-trips the built-in rules
+        RuleSet builtin = RuleSet::builtin();
+        RuleSet parsed;
+        string error;
+        bool ok = RuleSet::parse(builtin.toText(), parsed, error);
+        bool same = ok;
+        for (SymptomMask mask = 0; ok && mask < (1u << 18); ++mask) {
+            int count = popcount(mask);
+            if (parsed.evaluate(mask, count) != builtin.evaluate(mask, count)) {
+                same = false;
+                break;
+            }
+        }
+        assertTrue(same, "Rule file text round-trips the built-in rules");
+
+        // Test 2: Invalid files are rejected with a line number
+        RuleSet rejected;
+        bool invalid = RuleSet::parse("Flu: fever + cough\nBad: fever + sneezing\n", rejected, error);
+        assertTrue(!invalid && error.find("line 2") != string::npos && error.find("sneezing") != string::npos,
+                   "Unknown symptom rejected with line number");
+
+        const string path = "data/test_rules.txt";
+        auto writeRules = [&path](const string& text) {
+            ofstream file(path);
+            file << text;
+        };
+
+        RuleRegistry registry;
+        uint64_t initialVersion = registry.versionNumber();
+        vector<string> before = registry.diagnose({"fever", "cough"});
+        bool hadFlu = find(before.begin(), before.end(), "Flu") != before.end();
+
+        writeRules("Flu: fever + sneezing\n");
+        bool reloaded = registry.reload(path, error);
+        assertTrue(!reloaded && registry.versionNumber() == initialVersion,
+                   "Failed reload keeps the active rules");
+
+        // Test 3: A diagnosis in flight keeps the old version after a reload
+        RuleRegistry::ReadGuard inFlight = registry.acquire();
+        writeRules("Common Cold: runny nose + sore throat\n");
+        reloaded = registry.reload(path, error);
+        vector<string> after = registry.diagnose({"fever", "cough"});
+        assertTrue(reloaded && hadFlu && after.empty(), "Reloaded rules invalidate cached diagnoses");
+        assertTrue(inFlight.versionNumber() == initialVersion && inFlight.rules().getRules().size() == 19,
+                   "In-flight reader still sees the old rules");
+        assertTrue(registry.pendingReclaim() == 1, "Old rules kept while a reader is pinned");
+        { RuleRegistry::ReadGuard released = move(inFlight); }
+        assertTrue(registry.pendingReclaim() == 0, "Old rules reclaimed after the reader finishes");
+
+        // Test 4: The watcher picks up an edited file in the background
+        registry.startWatching(path, 20);
+        uint64_t watchedFrom = registry.versionNumber();
+        writeRules(builtin.toText());
+        for (int i = 0; i < 200 && registry.versionNumber() == watchedFrom; ++i) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        vector<string> restored = registry.diagnose({"fever", "cough"});
+        assertTrue(find(restored.begin(), restored.end(), "Flu") != restored.end(), "Watcher reloads the edited rule file");
+
+        // Test 5: An edit of the same length right after the last one is
+        // still seen
+        uint64_t editedFrom = registry.versionNumber();
+        writeRules("Cold A: runny nose + sore throat\n");
+        for (int i = 0; i < 200 && registry.versionNumber() == editedFrom; ++i) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        editedFrom = registry.versionNumber();
+        writeRules("Cold B: runny nose + sore throat\n");
+        for (int i = 0; i < 200 && registry.versionNumber() == editedFrom; ++i) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        registry.stopWatching();
+        vector<string> sameLength = registry.diagnose({"runny nose", "sore throat"});
+        assertTrue(sameLength.size() == 1 && sameLength[0] == "Cold B", "Watcher reloads a same-length edit within a second");
+
+        remove(path.c_str());
+        cout << "\n";
+    }
+
+    void testRuleOptimizer() {
+        cout << "--- Testing Profile-Guided Rule Optimizer ---\n";
+
+        // Synthetic population: fever and cough common, everything else rare
+        RuleSet rules = RuleSet::builtin();
+        RuleProfile profile(rules);
+        mt19937 rng(7);
+        uniform_real_distribution<double> chance(0.0, 1.0);
+        for (int p = 0; p < 5000; ++p) {
+            SymptomMask mask = 0;
+            for (int s = 0; s < 18; ++s) {
+                double rate = s == 0 ? 0.4 : (s == 1 ? 0.35 : 0.05);
+                if (chance(rng) < rate) mask |= SymptomMask(1) << s;
+            }
+            profile.record(rules, mask, popcount(mask));
+        }
+        assertTrue(profile.patientCount() == 5000 && profile.symptomFrequency(0) > profile.symptomFrequency(5),
+                   "Profile records symptom frequencies");
+
+        // Test 1: The DAG gives the same answer as the rules for every subset,
+        // including when extra unrecognized symptoms change the count
+        DecisionDag dag = DecisionDag::build(rules, profile);
+        bool same = true;
+        for (SymptomMask mask = 0; mask < (1u << 18) && same; ++mask) {
+            int count = popcount(mask);
+            same = dag.evaluate(mask, count) == rules.evaluate(mask, count) &&
+                   dag.evaluate(mask, count + 1) == rules.evaluate(mask, count + 1);
+        }
+        assertTrue(same, "Decision DAG matches the rule table on all 2^18 subsets");
+        assertTrue(dag.maxDepth() <= 18, "Decision DAG tests each symptom at most once");
+        cout << "  DAG: " << dag.nodeCount() << " nodes, max depth " << dag.maxDepth()
+             << ", first test: " << symptomCatalog()[dag.testOrder()[0]] << "\n";
+
+        // Test 2: The registry serves diagnoses from the DAG, also after a reload
+        RuleRegistry registry;
+        registry.optimize(profile);
+        vector<string> symptoms = {"fever", "cough", "loss of taste"};
+        assertTrue(registry.isOptimized() && registry.diagnose(symptoms) == predictDiseases(symptoms),
+                   "Optimized registry matches predictDiseases");
+        const string path = "data/test_rules.txt";
+        {
+            ofstream file(path);
+            file << rules.toText();
+        }
+        string error;
+        registry.reload(path, error);
+        assertTrue(registry.isOptimized() && registry.diagnose({"sore throat", "fever"}) == predictDiseases({"sore throat", "fever"}),
+                   "Reloaded rules are optimized with the stored profile");
+
+        // Test 3: A profile recorded against older rules optimizes the
+        // rules that are active now, not the ones it was recorded with
+        RuleProfile stale(rules, registry.versionNumber());
+        stale.record(rules, 3, 2);
+        {
+            ofstream file(path);
+            file << "Common Cold: runny nose + sore throat\n";
+        }
+        bool replaced = registry.reload(path, error);
+        registry.optimize(stale);
+        vector<string> cold = registry.diagnose({"runny nose", "sore throat"});
+        assertTrue(replaced && stale.ruleVersion() != 0 && registry.isOptimized() && cold == vector<string>{"Common Cold"} &&
+                       registry.diagnose({"fever", "cough"}).empty(),
+                   "Stale profile keeps the reloaded rules");
+        remove(path.c_str());
+
+        cout << "\n";
+    }
+
+    void testPatientIndex() {
+        cout << "--- Testing Patient Attribute Indexes ---\n";
+
+        PatientManager indexed;
+        mt19937 rng(11);
+        const vector<string> genders = {"M", "F", "Other"};
+        vector<string> catalog = symptomCatalog();
+        {
+            // Silence the per-patient messages while building the population
+            streambuf* saved = cout.rdbuf(nullptr);
+            for (int i = 0; i < 600; ++i) {
+                indexed.addPatient("Indexed " + to_string(i), 20 + rng() % 70, genders[rng() % 3]);
+                Patient* p = indexed.findPatientById(indexed.getAllPatients().back().getId());
+                for (int s = 0; s < 3; ++s) p->addSymptom(catalog[rng() % 6]);
+                if (i % 50 == 0) p->addSymptom("rash");
+            }
+            cout.rdbuf(saved);
+        }
+
+        auto scan = [&indexed](const PatientQuery& q) {
+            vector<int> ids;
+            for (const auto& p : indexed.getAllPatients()) {
+                bool ok = (q.minAge < 0 || p.age >= q.minAge) && (q.maxAge < 0 || p.age <= q.maxAge) &&
+                          (q.gender.empty() || p.gender == q.gender);
+                for (const auto& s : q.symptoms) ok = ok && find(p.symptoms.begin(), p.symptoms.end(), s) != p.symptoms.end();
+                if (ok) ids.push_back(p.getId());
+            }
+            return ids;
+        };
+        auto collect = [&indexed](const PatientQuery& q, size_t limit) {
+            vector<int> ids;
+            int afterId = 0;
+            do {
+                QueryPage page = indexed.findPatients(q, afterId, limit);
+                ids.insert(ids.end(), page.ids.begin(), page.ids.end());
+                afterId = page.nextAfterId;
+            } while (afterId != 0);
+            return ids;
+        };
+
+        // Test 1: Age range + gender + symptom agrees with a full scan
+        PatientQuery query;
+        query.minAge = 60;
+        query.maxAge = 80;
+        query.gender = "F";
+        query.symptoms = {"fever"};
+        vector<int> expected = scan(query);
+        assertTrue(!expected.empty() && collect(query, 1000) == expected, "Age 60-80, gender F, with fever");
+
+        // Test 2: The planner drives with the most selective index
+        PatientQuery rare;
+        rare.symptoms = {"rash"};
+        rare.gender = "m";
+        QueryPage page = indexed.findPatients(rare);
+        assertTrue(page.plan.find("rash") != string::npos, "Rare symptom drives the query");
+
+        // Test 3: Pages join up to the full result without gaps or repeats
+        PatientQuery ages;
+        ages.minAge = 30;
+        ages.maxAge = 40;
+        assertTrue(collect(ages, 7) == scan(ages), "Age range pages concatenate to the full result");
+        assertTrue(collect(PatientQuery(), 25) == scan(PatientQuery()), "Unfiltered pages cover every patient");
+
+        // Test 4: Edits through findPatientById and deletions are picked up
+        int target = scan(query).front();
+        indexed.findPatientById(target)->age = 20;
+        assertTrue(collect(query, 1000) == scan(query), "Edited age moves the patient out of the range");
+        streambuf* saved = cout.rdbuf(nullptr);
+        indexed.deletePatient(expected.back());
+        cout.rdbuf(saved);
+        assertTrue(collect(query, 1000) == scan(query), "Deleted patient disappears from results");
+        assertTrue(indexed.findPatientById(expected.back()) == nullptr && indexed.findPatientById(expected.front()) != nullptr,
+                   "ID index follows deletions");
+
+        // The generated patients were appended to the CSV files as well
+        indexed.flushPersistence();
+        cleanupTestFiles();
+        cout << "\n";
+    }
+
+    void testPatientPaging() {
+        cout << "--- Testing Paging and Name Search ---\n";
+
+        PatientManager paged;
+        streambuf* saved = cout.rdbuf(nullptr);
+        for (int i = 0; i < 45; ++i) paged.addPatient("Smith " + to_string(100 + i), 40, "F");
+        paged.addPatient("smithers", 50, "M");
+        paged.addPatient("Jones", 60, "M");
+        cout.rdbuf(saved);
+
+        // Test 1: Prefix search ignores case and pages through a cursor
+        vector<int> found;
+        NameCursor cursor;
+        int pages = 0;
+        while (true) {
+            NamePage page = paged.findPatientsByName("SMITH", cursor, 20);
+            found.insert(found.end(), page.ids.begin(), page.ids.end());
+            pages++;
+            if (!page.hasMore) break;
+            cursor = page.next;
+        }
+        set<int> distinct(found.begin(), found.end());
+        assertTrue(found.size() == 46 && distinct.size() == 46 && pages == 3, "Name prefix pages cover all 46 matches once");
+        assertTrue(paged.findPatientsByName("smithe").ids.size() == 1, "Longer prefix narrows the match");
+
+        // Test 2: Renames and deletions reach the name index
+        int jones = paged.findPatientsByName("jones").ids.front();
+        paged.findPatientById(jones)->name = "Zed Jones";
+        assertTrue(paged.findPatientsByName("jones").ids.empty() && paged.findPatientsByName("zed").ids.size() == 1,
+                   "Renamed patient is found under the new name");
+        saved = cout.rdbuf(nullptr);
+        paged.deletePatient(jones);
+        cout.rdbuf(saved);
+        assertTrue(paged.findPatientsByName("zed").ids.empty(), "Deleted patient leaves the name index");
+
+        // Test 3: A page renders exactly like the per-patient summaries
+        const Patient* first = paged.findPatientById(found.front());
+        string line;
+        first->appendSummary(line);
+        ostringstream captured;
+        saved = cout.rdbuf(captured.rdbuf());
+        first->displaySummary();
+        cout.rdbuf(saved);
+        assertTrue(captured.str() == line && line.find("| Symptoms: 0\n") != string::npos, "Buffered summary matches displaySummary");
+
+        // Test 4: selectPatient searches by name, then takes the typed ID
+        istringstream input("\nsmithers\n" + to_string(found.back()) + "\n");
+        streambuf* savedIn = cin.rdbuf(input.rdbuf());
+        saved = cout.rdbuf(captured.rdbuf());
+        captured.str("");
+        int chosen = paged.selectPatient("test");
+        cout.rdbuf(saved);
+        cin.rdbuf(savedIn);
+        assertTrue(chosen == found.back() && captured.str().find("Name: smithers") != string::npos,
+                   "selectPatient lists name matches and returns the chosen ID");
+
+        paged.flushPersistence();
+        cleanupTestFiles();
+        cout << "\n";
+    }
+
+    void testFuzzyNameSearch() {
+        cout << "--- Testing Fuzzy Name Search ---\n";
+
+        const vector<string> first = {"John", "Jon", "Maria", "Mario", "Anna", "Ann", "Li", "Mohammed", "Sophie", "Lukas"};
+        const vector<string> last = {"Smith", "Smyth", "Schmidt", "Garcia", "Nguyen", "Kowalski", "O'Brien", "Lee", "Muller", "Rossi"};
+        mt19937 rng(5);
+        NameIndex index;
+        map<int, string> names;
+        for (int id = 1; id <= 100000; ++id) {
+            string name = first[rng() % first.size()] + " " + last[rng() % last.size()];
+            if (rng() % 4 == 0) name += " " + to_string(rng() % 1000);
+            names[id] = name;
+            index.update(id, name);
+        }
+
+        auto lower = [](string text) {
+            transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return tolower(c); });
+            return text;
+        };
+        // Brute force: distance to the whole name or any one word
+        auto bruteForce = [&](const string& query, int k) {
+            set<int> ids;
+            string q = lower(query);
+            for (const auto& entry : names) {
+                string name = lower(entry.second);
+                bool hit = boundedEditDistance(q, name, k) <= k;
+                stringstream words(name);
+                string word;
+                while (!hit && words >> word) hit = boundedEditDistance(q, word, k) <= k;
+                if (hit) ids.insert(entry.first);
+            }
+            return ids;
+        };
+        auto found = [&index](const string& query, int k) {
+            set<int> ids;
+            for (const auto& match : index.findSimilar(query, k, SIZE_MAX)) ids.insert(match.id);
+            return ids;
+        };
+
+        // Test 1: Trigram filtering loses nothing compared with a full scan
+        bool exact = true;
+        vector<string> queries = {"Smiht", "jon smith", "Kowalsky", "Mohamed", "Garsia", "Li", "Nguyn", "Sofie Rossi"};
+        for (const auto& query : queries) exact = exact && found(query, 2) == bruteForce(query, 2);
+        assertTrue(exact, "Fuzzy matches equal a brute-force edit distance scan");
+        size_t mostCandidates = 0;
+        for (const char* query : {"Smiht", "smith", "jones", "Li", "Kowalsky", "jon smith", "Sofie Rossi"}) {
+            mostCandidates = max(mostCandidates, index.similarCandidates(query, 2));
+        }
+        assertTrue(mostCandidates <= 200, "Short and long queries compare only a few spellings");
+
+        // Test 2: Closest names come first
+        vector<NameMatch> matches = index.findSimilar("Smith", 1, 5);
+        assertTrue(!matches.empty() && matches.front().distance == 0, "Exact word match ranks first");
+        assertTrue(boundedEditDistance("kitten", "sitting", 5) == 3 && boundedEditDistance("kitten", "sitting", 2) == 3,
+                   "Bounded edit distance stops at the bound");
+
+        // The band around the diagonal loses nothing against the full table
+        auto fullDistance = [](const string& a, const string& b) {
+            vector<vector<int>> d(a.size() + 1, vector<int>(b.size() + 1));
+            for (size_t i = 0; i <= a.size(); ++i) d[i][0] = static_cast<int>(i);
+            for (size_t j = 0; j <= b.size(); ++j) d[0][j] = static_cast<int>(j);
+            for (size_t i = 1; i <= a.size(); ++i) {
+                for (size_t j = 1; j <= b.size(); ++j) {
+                    d[i][j] = min(d[i - 1][j - 1] + (a[i - 1] != b[j - 1]), min(d[i - 1][j], d[i][j - 1]) + 1);
+                }
+            }
+            return d[a.size()][b.size()];
+        };
+        bool banded = true;
+        for (int i = 0; i < 20000 && banded; ++i) {
+            string a(rng() % 10, 'a'), b(rng() % 10, 'a');
+            for (char& c : a) c = static_cast<char>('a' + rng() % 3);
+            for (char& c : b) c = static_cast<char>('a' + rng() % 3);
+            int k = static_cast<int>(rng() % 4);
+            banded = boundedEditDistance(a, b, k) == min(fullDistance(a, b), k + 1);
+        }
+        assertTrue(banded, "Banded edit distance equals the full table on random strings");
+
+        // Test 3: Renames and removals update the trigram lists
+        index.update(1, "Zebulon Quartermaine");
+        assertTrue(index.findSimilar("Quatermaine").size() == 1 && index.findSimilar("Quatermaine").front().id == 1,
+                   "Renamed patient is found by a misspelling");
+        index.remove(1);
+        assertTrue(index.findSimilar("Quatermaine").empty(), "Removed patient is no longer found");
+
+        // Lookup speed with 100000 names
+        auto start = chrono::steady_clock::now();
+        size_t total = 0;
+        for (int i = 0; i < 1000; ++i) total += index.findSimilar(queries[i % queries.size()] + "x", -1, 20).size();
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / 1000;
+        cout << "  Fuzzy lookup over 100000 names: " << micros << " us average (" << total << " matches)\n";
+
+        cout << "\n";
+    }
+
+    void testAtomicFileReplace() {
+        cout << "--- Testing Atomic File Replacement ---\n";
+
+        const string path = "data/test_atomic.csv";
+        auto read = [](const string& file) {
+            ifstream in(file, ios::binary);
+            stringstream buffer;
+            buffer << in.rdbuf();
+            return buffer.str();
+        };
+        auto write = [](const string& file, const string& data) {
+            ofstream out(file, ios::binary | ios::trunc);
+            out << data;
+        };
+        // Pretend a file was last touched a minute ago, as a file from
+        // before the crash would be
+        auto age = [](const string& file) {
+            struct utimbuf times;
+            times.actime = times.modtime = time(nullptr) - 60;
+            utime(file.c_str(), &times);
+        };
+        auto cleanup = [&path]() {
+            for (string suffix : {"", ".tmp", ".prev", ".manifest", ".manifest.tmp", ".appending"}) remove((path + suffix).c_str());
+        };
+        cleanup();
+
+        // Test 1: Two generations are kept and validate cleanly
+        string error, action;
+        bool ok = replaceFileAtomically(path, "id\n1\n", error) && replaceFileAtomically(path, "id\n1\n2\n", error);
+        assertTrue(ok && read(path) == "id\n1\n2\n" && read(path + ".prev") == "id\n1\n", "Atomic replace keeps the previous generation");
+        assertTrue(recoverFile(path, action) && action.empty(), "Intact file needs no recovery");
+
+        // Test 2: A torn file is restored from the previous generation
+        write(path, "id\n1\n2");
+        age(path);
+        assertTrue(recoverFile(path, action) && read(path) == "id\n1\n" && !action.empty(), "Torn file restored from previous generation");
+
+        // Test 3: A crash between manifest update and rename is rolled forward
+        replaceFileAtomically(path, "id\n3\n", error);
+        rename(path.c_str(), (path + ".tmp").c_str());
+        write(path, "id\n1\n");
+        age(path);
+        assertTrue(recoverFile(path, action) && read(path) == "id\n3\n", "Interrupted write completed from temp file");
+
+        // Test 4: A torn temp file is discarded and the old file kept
+        replaceFileAtomically(path, "id\n4\n", error);
+        write(path, "id\n3\n");
+        age(path);
+        write(path + ".tmp", "id\n4");
+        assertTrue(recoverFile(path, action) && read(path) == "id\n3\n" && !ifstream(path + ".tmp"),
+                   "Torn temp file discarded, previous generation kept");
+        assertTrue(read(path + ".manifest").find("stamp ") != string::npos, "Rolled-back manifest records the file's stamp");
+
+        // Test 5: Hand edits made after the last commit are accepted
+        write(path, "id\n5\n");
+        age(path + ".manifest");
+        assertTrue(recoverFile(path, action) && read(path) == "id\n5\n" && recoverFile(path, action) && action.empty(),
+                   "Edited file adopted as the current generation");
+
+        // Test 6: An edit within the same second as the commit is still seen
+        replaceFileAtomically(path, "id\n6\n", error);
+        write(path, "id\n7\n");
+        assertTrue(recoverFile(path, action) && read(path) == "id\n7\n" && !action.empty(),
+                   "Same-size edit right after a commit adopted");
+
+        // Test 7: An interrupted append loses only its partial line
+        beginAppending(path, error);
+        write(path, "id\n1\n2\n3");
+        bool trimmed = repairLastLine(path, action) && read(path) == "id\n1\n2\n" && !action.empty();
+        assertTrue(trimmed && repairLastLine(path, action) && action.empty(), "Partial last line trimmed");
+        string lines;
+        for (int i = 0; i < 2000; ++i) lines += to_string(i) + "\n";
+        write(path, lines + string(5000, 'x'));
+        assertTrue(repairLastLine(path, action) && read(path) == lines, "Partial line longer than one read block trimmed");
+
+        // A file without an append in flight was edited by hand; its last
+        // line is kept
+        endAppending(path, error);
+        write(path, "id\n1\n2\n3");
+        assertTrue(!ifstream(path + ".appending") && repairLastLine(path, action) && read(path) == "id\n1\n2\n3\n",
+                   "Hand-edited last line without newline kept");
+
+        // Test 8: Symptom updates go through the atomic path
+        cleanup();
+        writeSymptomUpdates(path, {{7, {"fever"}}});
+        assertTrue(ifstream(path + ".manifest").good() && recoverFile(path, action) && action.empty(),
+                   "Symptom rewrite leaves a valid manifest");
+
+        cleanup();
+        cout << "\n";
+    }
+
+    void testResultExport() {
+        cout << "--- Testing Binary Result Export ---\n";
+
+        const string path = "data/test_export.mcdx";
+        const string dictionaryPath = "data/test_disease_ids.txt";
+        string error;
+
+        // Test 1: Disease IDs survive a save/load and new names are appended
+        DiseaseDictionary dictionary;
+        uint64_t fluCovid = 0, migraineFlu = 0;
+        dictionary.maskFor({"Flu", "COVID-19"}, fluCovid, error);
+        dictionary.save(dictionaryPath, error);
+        DiseaseDictionary reloaded;
+        DiseaseDictionary::load(dictionaryPath, reloaded, error);
+        bool stable = reloaded.find("COVID-19") == 1 && reloaded.maskFor({"Migraine", "Flu"}, migraineFlu, error) &&
+                      migraineFlu == 0b101 && reloaded.namesFor(fluCovid) == vector<string>({"Flu", "COVID-19"});
+        assertTrue(stable, "Disease IDs are stable across save and load");
+
+        // A full dictionary refuses a new disease instead of dropping it
+        DiseaseDictionary full;
+        for (int i = 0; i < DiseaseDictionary::MAX_DISEASES; ++i) full.idFor("Disease " + to_string(i));
+        uint64_t overflow = 0;
+        bool refused = !full.maskFor({"Flu", "Disease 3"}, overflow, error) && error.find("Flu") != string::npos;
+        assertTrue(refused && full.maskFor({"Disease 3"}, overflow, error) && overflow == 0b1000,
+                   "Full dictionary reports the disease without an ID");
+
+        // Test 2: One million results round-trip, compressed and raw
+        mt19937 rng(3);
+        vector<DiagnosisRecord> records;
+        int id = 0;
+        for (int i = 0; i < 1000000; ++i) {
+            id += 1 + (rng() % 16 == 0 ? rng() % 5 : 0); // deletions leave gaps
+            uint64_t mask = rng() % 4 == 0 ? (uint64_t(1) << (rng() % 11)) | (uint64_t(1) << (rng() % 11)) : 0;
+            records.push_back({id, mask});
+        }
+        for (bool compress : {true, false}) {
+            auto start = chrono::steady_clock::now();
+            ResultWriter writer;
+            writer.open(path, error, compress);
+            for (const auto& record : records) writer.add(record.patientId, record.diseases);
+            bool written = writer.close(reloaded, error);
+
+            ResultReader reader;
+            vector<DiagnosisRecord> readBack;
+            DiagnosisRecord record;
+            bool opened = reader.open(path, error);
+            while (opened && reader.next(record)) readBack.push_back(record);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            ifstream file(path, ios::binary | ios::ate);
+            cout << "  " << (compress ? exportCompression() : "raw") << ": " << file.tellg() << " bytes, "
+                 << ms << " ms for write + read\n";
+            assertTrue(written && opened && reader.lastError().empty() && readBack == records &&
+                           reader.getDictionary().getNames() == reloaded.getNames(),
+                       compress ? "Compressed export round-trips 1M results" : "Raw export round-trips 1M results");
+        }
+
+        // Test 3: IDs in any order, including negative deltas
+        ResultWriter writer;
+        writer.open(path, error, true, 3);
+        vector<DiagnosisRecord> shuffled = {{50, 1}, {7, 0}, {1000000, ~uint64_t(0)}, {8, 2}, {1, 4}};
+        for (const auto& record : shuffled) writer.add(record.patientId, record.diseases);
+        writer.close(reloaded, error);
+        ResultReader reader;
+        vector<DiagnosisRecord> readBack;
+        DiagnosisRecord record;
+        reader.open(path, error);
+        while (reader.next(record)) readBack.push_back(record);
+        assertTrue(readBack == shuffled, "Unordered IDs and full masks round-trip across blocks");
+
+        // Test 4: Until close(), readers keep seeing the previous export
+        ResultWriter replacing;
+        replacing.open(path, error);
+        replacing.add(99, 1);
+        ResultReader during;
+        vector<DiagnosisRecord> seen;
+        bool openedDuring = during.open(path, error);
+        while (openedDuring && during.next(record)) seen.push_back(record);
+        bool replaced = replacing.close(reloaded, error);
+        ResultReader after;
+        bool openedAfter = after.open(path, error);
+        bool single = openedAfter && after.next(record) && record == DiagnosisRecord{99, 1} && !after.next(record);
+        assertTrue(seen == shuffled && replaced && single && !ifstream(path + ".tmp"),
+                   "Export replaces the previous file only when complete");
+
+        // Test 5: A block header whose row count does not fit its columns
+        for (char badCount : {'\x7F', '\x02'}) {
+            writer.open(path, error, false, 3);
+            for (const auto& record : shuffled) writer.add(record.patientId, record.diseases);
+            writer.close(reloaded, error);
+            {
+                fstream file(path, ios::binary | ios::in | ios::out);
+                file.seekp(5);
+                file.put(badCount);
+            }
+            ResultReader wrongCount;
+            size_t rows = 0;
+            if (wrongCount.open(path, error)) {
+                while (wrongCount.next(record)) rows++;
+            }
+            assertTrue(rows < shuffled.size() && !wrongCount.lastError().empty(),
+                       badCount == '\x7F' ? "Oversized row count rejected before allocating" : "Short row count rejected");
+        }
+
+        // Test 6: A damaged block is reported, not returned
+        writer.open(path, error, true, 3);
+        for (const auto& record : shuffled) writer.add(record.patientId, record.diseases);
+        writer.close(reloaded, error);
+        {
+            fstream file(path, ios::binary | ios::in | ios::out);
+            file.seekp(12);
+            file.put('\x7F');
+        }
+        ResultReader damaged;
+        size_t count = 0;
+        if (damaged.open(path, error)) {
+            while (damaged.next(record)) count++;
+        }
+        assertTrue(count < shuffled.size() && !damaged.lastError().empty(), "Damaged block fails its checksum");
+        assertTrue(!ResultReader().open(dictionaryPath, error), "Non-export file is rejected");
+
+        remove(path.c_str());
+        remove(dictionaryPath.c_str());
+        remove((dictionaryPath + ".manifest").c_str());
+        remove((dictionaryPath + ".prev").c_str());
+        cout << "\n";
+    }
+
+    void testSymptomHistory() {
+        cout << "--- Testing Symptom History ---\n";
+
+        const int64_t day = 86400;
+        const int64_t start = 1700000000;
+
+        // Test 1: As-of queries agree with replaying the events, across many chunks
+        SymptomHistory history;
+        mt19937 rng(5);
+        int symptomCount = static_cast<int>(symptomCatalog().size());
+        map<int, vector<pair<int64_t, SymptomMask>>> states; // per patient: time -> symptoms from then on
+        map<int, int64_t> clock;
+        for (int i = 0; i < 20000; ++i) {
+            int patientId = 1 + rng() % 50;
+            int64_t& now = clock[patientId];
+            now = (now == 0 ? start : now) + (rng() % 4 == 0 ? 0 : rng() % (3 * day));
+            SymptomMask before = history.current(patientId);
+            history.record(patientId, rng() % symptomCount, rng() % 2 == 0, now);
+            if (history.current(patientId) != before) states[patientId].push_back({now, history.current(patientId)});
+        }
+        bool agrees = true;
+        for (int i = 0; i < 5000 && agrees; ++i) {
+            int patientId = 1 + rng() % 50;
+            int64_t t = start - day + static_cast<int64_t>(rng() % (clock[patientId] - start + 2 * day));
+            SymptomMask expected = 0;
+            for (const auto& state : states[patientId]) {
+                if (state.first <= t) expected = state.second;
+            }
+            agrees = history.symptomsAt(patientId, t) == expected;
+        }
+        assertTrue(agrees, "As-of queries match a replay of the events");
+        double bytesPerEvent = double(history.bytesUsed()) / history.eventCount();
+        cout << "  " << history.eventCount() << " events in " << history.bytesUsed() << " bytes ("
+             << bytesPerEvent << " per event)\n";
+        assertTrue(bytesPerEvent < 8, "History stores under 8 bytes per event");
+
+        // Test 2: Durations and out-of-order events
+        SymptomHistory fever;
+        int feverIndex = symptomIndex("fever");
+        fever.record(1, feverIndex, true, start);
+        fever.record(1, symptomIndex("cough"), true, start + 2 * day);
+        assertTrue(fever.presentFor(1, feverIndex, start + 3 * day + 60) > 3 * day, "Fever present for over 3 days");
+        assertTrue(fever.presentFor(1, feverIndex, start - 1) == 0, "No duration before the onset");
+        fever.record(1, feverIndex, false, start + day); // older than the cough onset
+        assertTrue(fever.eventsOf(1).back().time == start + 2 * day && fever.current(1) == toSymptomMask({"cough"}),
+                   "Out-of-order event recorded at the latest time");
+        assertTrue(describeDuration(3 * day + 60) == "3 days" && describeDuration(3600) == "1 hour",
+                   "Durations described in the largest unit");
+
+        // Test 3: Diagnosis at a point in time, and the history survives a reload
+        {
+            PatientManager clinic;
+            streambuf* saved = cout.rdbuf(nullptr);
+            clinic.addPatient("History Patient", 40, "F");
+            int patientId = clinic.getAllPatients().back().getId();
+            clinic.recordSymptomEvent(patientId, "runny nose", true, start);
+            clinic.recordSymptomEvent(patientId, "sore throat", true, start + day);
+            clinic.recordSymptomEvent(patientId, "runny nose", false, start + 4 * day);
+            clinic.recordSymptomEvent(patientId, "fever", true, start + 5 * day);
+            clinic.recordSymptomEvent(patientId, "cough", true, start + 5 * day);
+            cout.rdbuf(saved);
+            auto has = [](const vector<string>& diseases, const string& name) {
+                return find(diseases.begin(), diseases.end(), name) != diseases.end();
+            };
+            assertTrue(has(clinic.diagnoseAt(patientId, start + 2 * day), "Common Cold") &&
+                           !has(clinic.diagnoseAt(patientId, start + 2 * day), "Flu") &&
+                           has(clinic.diagnoseAt(patientId, start + 6 * day), "Flu") &&
+                           clinic.diagnoseAt(patientId, start - day).empty(),
+                       "Diagnosis as of earlier and later times");
+            assertTrue(clinic.diagnoseAt(patientId, start + 6 * day) == predictDiseases(clinic.findPatientById(patientId)->symptoms),
+                       "Latest history matches the current symptoms");
+            clinic.flushPersistence();
+
+            PatientManager reloaded;
+            saved = cout.rdbuf(nullptr);
+            reloaded.loadDataFromCSV();
+            cout.rdbuf(saved);
+            const Patient* patient = reloaded.findPatientById(patientId);
+            bool sameEvents = reloaded.getSymptomHistory().eventsOf(patientId).size() == 5 &&
+                              reloaded.getSymptomHistory().symptomsAt(patientId, start + 2 * day) ==
+                                  toSymptomMask({"runny nose", "sore throat"});
+            assertTrue(patient && sameEvents && reloaded.getSymptomHistory().current(patientId) == toSymptomMask(patient->symptoms),
+                       "History reloaded from the history file");
+            reloaded.flushPersistence();
+
+            // Test 4: Malformed rows are skipped instead of aborting the load
+            {
+                ofstream hfile("data/symptom_history.csv", ios::app);
+                hfile << "x7,100,fever,onset\n" << patientId << ",soon,fever,onset\n"
+                      << patientId << ",100,sneezing,onset\n" << patientId << ",100,fever,maybe\n";
+            }
+            PatientManager tolerant;
+            saved = cout.rdbuf(nullptr);
+            tolerant.loadDataFromCSV();
+            cout.rdbuf(saved);
+            assertTrue(tolerant.getSymptomHistory().eventsOf(patientId).size() == 5,
+                       "Malformed history rows skipped, the rest loaded");
+            tolerant.flushPersistence();
+        }
+        cleanupTestFiles();
+        cout << "\n";
+    }
+
+    void testPatientSnapshots() {
+        cout << "--- Testing Patient Snapshots ---\n";
+
+        // Test 1: A snapshot is one pointer copy; an edit copies one path
+        PatientStore store;
+        vector<int> ids;
+        for (int i = 0; i < 100000; ++i) {
+            Patient patient("Stored " + to_string(i), i % 90, i % 2 ? "F" : "M");
+            store.insert(patient);
+            ids.push_back(patient.getId());
+        }
+        auto start = chrono::steady_clock::now();
+        PatientSnapshot frozen = store.snapshot();
+        double snapshotUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        start = chrono::steady_clock::now();
+        vector<Patient> copied(frozen.begin(), frozen.end());
+        double copyUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        cout << "  Snapshot of 100000 patients: " << snapshotUs << " us (copying them: " << copyUs << " us)\n";
+
+        size_t copiesBefore = store.copiedNodes();
+        store.findMutable(ids[500])->age = 200;
+        assertTrue(store.copiedNodes() - copiesBefore <= 5 && frozen.find(ids[500])->age == 500 % 90 &&
+                       store.find(ids[500])->age == 200,
+                   "Edit after a snapshot copies only the path to the patient");
+
+        // Test 2: Readers on another thread see the frozen version while the store changes
+        long long expectedAges = 0;
+        for (const auto& patient : copied) expectedAges += patient.age;
+        bool readerConsistent = true;
+        thread reader([&frozen, &copied, expectedAges, &readerConsistent]() {
+            for (int round = 0; round < 20; ++round) {
+                long long ages = 0;
+                size_t seen = 0;
+                for (const auto& patient : frozen) {
+                    ages += patient.age;
+                    seen++;
+                }
+                if (ages != expectedAges || seen != copied.size()) readerConsistent = false;
+            }
+        });
+        mt19937 rng(17);
+        set<int> live(ids.begin(), ids.end());
+        for (int i = 0; i < 20000; ++i) {
+            int id = ids[rng() % ids.size()];
+            if (rng() % 3 == 0) {
+                if (store.erase(id)) live.erase(id);
+            } else if (Patient* patient = store.findMutable(id)) {
+                patient->age++;
+            }
+        }
+        Patient added("Added Later", 30, "F");
+        store.insert(added);
+        live.insert(added.getId());
+        reader.join();
+        assertTrue(readerConsistent, "Reader thread sees a consistent frozen version");
+
+        vector<int> frozenIds, liveIds;
+        for (const auto& patient : frozen) frozenIds.push_back(patient.getId());
+        for (const auto& patient : store.snapshot()) liveIds.push_back(patient.getId());
+        assertTrue(frozenIds == ids && frozen.size() == ids.size(), "Snapshot keeps every original patient in ID order");
+        assertTrue(liveIds == vector<int>(live.begin(), live.end()) && store.size() == live.size() &&
+                       store.snapshot().back().getId() == added.getId(),
+                   "Store reflects the edits made after the snapshot");
+
+        // Test 3: Once the last snapshot is released, writes stop copying
+        frozen = PatientSnapshot();
+        copiesBefore = store.copiedNodes();
+        for (int id : live) store.findMutable(id)->age = 1;
+        assertTrue(store.copiedNodes() == copiesBefore, "Released snapshot no longer forces copies");
+
+        // Test 4: Manager snapshots are unaffected by later edits and deletions
+        {
+            PatientManager clinic;
+            streambuf* saved = cout.rdbuf(nullptr);
+            for (int i = 0; i < 50; ++i) clinic.addPatient("Snapshot " + to_string(i), 20 + i, "M");
+            PatientSnapshot report = clinic.snapshot();
+            int first = report.begin()->getId();
+            clinic.findPatientById(first)->name = "Renamed";
+            clinic.deletePatient(report.back().getId());
+            clinic.addPatient("After Report", 40, "F");
+            cout.rdbuf(saved);
+            assertTrue(report.size() == 50 && report.find(first)->name == "Snapshot 0" &&
+                           clinic.findPatientById(first)->name == "Renamed" && clinic.getPatientCount() == 50 &&
+                           clinic.getAllPatients().back().name == "After Report",
+                       "Manager snapshot unaffected by later changes");
+            clinic.flushPersistence();
+        }
+        cleanupTestFiles();
+        cout << "\n";
+    }
+
+    void testLazySymptomLoading() {
+        cout << "--- Testing Lazy Symptom Loading ---\n";
+
+        const int count = 50000;
+        vector<string> catalog = symptomCatalog();
+        map<int, vector<string>> expected;
+        {
+            ofstream pfile("data/patients.csv");
+            ofstream sfile("data/symptoms.csv");
+            pfile << "id,name,age,gender\n";
+            sfile << "patient_id,symptoms\n";
+            mt19937 rng(23);
+            for (int id = 1; id <= count; ++id) {
+                pfile << id << ",Lazy " << id << "," << 20 + id % 60 << "," << (id % 2 ? "F" : "M") << "\n";
+                vector<string>& symptoms = expected[id];
+                for (int i = rng() % 4; i > 0; --i) {
+                    const string& symptom = catalog[rng() % catalog.size()];
+                    if (find(symptoms.begin(), symptoms.end(), symptom) == symptoms.end()) symptoms.push_back(symptom);
+                }
+                if (symptoms.empty()) continue;
+                sfile << id << ",";
+                for (size_t i = 0; i < symptoms.size(); ++i) sfile << (i ? ";" : "") << symptoms[i];
+                sfile << "\n";
+            }
+        }
+
+        auto timedLoad = [](PatientManager& target, PatientManager::SymptomLoading loading) {
+            streambuf* saved = cout.rdbuf(nullptr);
+            auto start = chrono::steady_clock::now();
+            target.loadDataFromCSV(loading);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            cout.rdbuf(saved);
+            return ms;
+        };
+        auto sameSymptoms = [&expected](const Patient* patient) {
+            return patient && patient->symptoms == expected[patient->getId()];
+        };
+
+        // Test 1: Lazy load defers parsing; a patient's symptoms appear on first access
+        PatientManager lazy;
+        double lazyMs = timedLoad(lazy, PatientManager::LAZY);
+        size_t pending = lazy.pendingSymptomCount();
+        int first = 4321, last = count;
+        while (expected[first].empty()) first++;
+        while (expected[last].empty()) last--;
+        bool firstAccess = sameSymptoms(lazy.findPatientById(first)) && sameSymptoms(lazy.findPatientById(last)) &&
+                           lazy.pendingSymptomCount() == pending - 2;
+        assertTrue(pending > count / 2 && firstAccess, "Symptoms parsed on first access to a patient");
+        assertTrue(lazy.getSymptomHistory().current(first) == toSymptomMask(expected[first]),
+                   "History reconciled when symptoms are loaded");
+        vector<int> named = lazy.findPatientsByName("lazy " + to_string(first)).ids;
+        assertTrue(find(named.begin(), named.end(), first) != named.end(), "Indexes built in the background are searchable");
+
+        // Test 2: Symptom queries and snapshots see every patient's symptoms
+        PatientManager eager;
+        double eagerMs = timedLoad(eager, PatientManager::EAGER);
+        cout << "  " << count << " patients: eager load " << eagerMs << " ms, lazy load " << lazyMs << " ms\n";
+        PatientQuery query;
+        query.symptoms = {"fever", "cough"};
+        assertTrue(lazy.findPatients(query, 0, count).ids == eager.findPatients(query, 0, count).ids &&
+                       lazy.pendingSymptomCount() == 0,
+                   "Symptom query loads the remaining patients first");
+
+        // Test 3: The warm-up thread and first access can meet on the same rows
+        PatientManager warmed;
+        timedLoad(warmed, PatientManager::LAZY_WITH_WARMUP);
+        bool allSame = true;
+        for (int id = count; id > 0 && allSame; id -= 7) allSame = sameSymptoms(warmed.findPatientById(id));
+        size_t matched = 0;
+        for (const auto& patient : warmed.snapshot()) {
+            if (patient.symptoms == expected[patient.getId()]) matched++;
+        }
+        assertTrue(allSame && matched == size_t(count) && warmed.pendingSymptomCount() == 0,
+                   "Warm-up thread and on-demand loading agree");
+
+        // Test 4: Deleting a patient drops its unloaded row
+        PatientManager deleting;
+        timedLoad(deleting, PatientManager::LAZY);
+        int unloaded = expected[10].empty() ? 11 : 10;
+        size_t before = deleting.pendingSymptomCount();
+        streambuf* saved = cout.rdbuf(nullptr);
+        deleting.deletePatient(unloaded);
+        cout.rdbuf(saved);
+        assertTrue(deleting.pendingSymptomCount() == before - 1 && deleting.findPatientById(unloaded) == nullptr,
+                   "Deleted patient's symptoms are never loaded");
+
+        // Test 5: A sample loads only the sampled patients
+        before = deleting.pendingSymptomCount();
+        vector<Patient> sample = deleting.samplePatients(500);
+        bool sampleSame = sample.size() > 450;
+        for (const auto& patient : sample) sampleSame = sampleSame && patient.symptoms == expected[patient.getId()];
+        assertTrue(sampleSame && deleting.pendingSymptomCount() >= before - sample.size(),
+                   "Sample loads only the sampled patients");
+
+        for (PatientManager* manager : {&lazy, &eager, &warmed, &deleting}) manager->flushPersistence();
+        cleanupTestFiles();
+
+        // Test 6: Both modes read a CRLF file with a bad row the same way
+        {
+            ofstream pfile("data/patients.csv", ios::binary);
+            ofstream sfile("data/symptoms.csv", ios::binary);
+            pfile << "id,name,age,gender\r\n1,Crlf One,30,F\r\n2,Crlf Two,40,M\r\n";
+            sfile << "patient_id,symptoms\r\n1,fever;cough\r\nbad,fever\r\n2,headache;;fever;headache\r\n\r\n";
+        }
+        PatientManager eagerCrlf, lazyCrlf;
+        timedLoad(eagerCrlf, PatientManager::EAGER);
+        timedLoad(lazyCrlf, PatientManager::LAZY);
+        bool agree = true;
+        for (int id : {1, 2}) {
+            const Patient* fromEager = eagerCrlf.findPatientById(id);
+            const Patient* fromLazy = lazyCrlf.findPatientById(id);
+            agree = agree && fromEager && fromLazy && fromEager->symptoms == fromLazy->symptoms;
+        }
+        const Patient* two = eagerCrlf.findPatientById(2);
+        assertTrue(agree && two && two->symptoms == vector<string>({"headache", "fever"}),
+                   "Eager and lazy loads agree on CRLF rows");
+        eagerCrlf.flushPersistence();
+        lazyCrlf.flushPersistence();
+        cleanupTestFiles();
+        cout << "\n";
+    }
+
+    void testRediagnosisWorkers() {
+        cout << "--- Testing Multi-Process Re-Diagnosis ---\n";
+
+        PatientStore store;
+        vector<string> catalog = symptomCatalog();
+        mt19937 rng(29);
+        for (int i = 0; i < 200000; ++i) {
+            Patient patient("Worker " + to_string(i), 20 + i % 60, "F");
+            for (int s = rng() % 5; s > 0; --s) {
+                const string& symptom = catalog[rng() % 8];
+                if (find(patient.symptoms.begin(), patient.symptoms.end(), symptom) == patient.symptoms.end()) {
+                    patient.symptoms.push_back(symptom);
+                }
+            }
+            if (i % 5 != 0) store.insert(patient); // gaps in the ID space
+        }
+        PatientSnapshot patients = store.snapshot();
+        RuleSet rules = RuleSet::builtin();
+
+        // Test 1: In-process counts agree with predictDiseases
+        RediagnosisResult reference = rediagnoseInProcess(patients, rules);
+        map<string, uint64_t> expected;
+        uint64_t undiagnosed = 0;
+        for (const auto& patient : patients) {
+            vector<string> diseases = predictDiseases(patient.symptoms);
+            if (diseases.empty()) undiagnosed++;
+            for (const auto& disease : diseases) expected[disease]++;
+        }
+        assertTrue(reference.patients == patients.size() && reference.undiagnosed == undiagnosed &&
+                       reference.diseaseCounts == expected,
+                   "In-process counts match predictDiseases");
+
+        // Test 2: Worker processes produce the same aggregates
+        for (int workers : {1, 4}) {
+            RediagnosisOptions options;
+            options.workers = workers;
+            auto start = chrono::steady_clock::now();
+            RediagnosisResult result = rediagnoseInWorkers(patients, rules, options);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            cout << "  " << workers << " worker(s): " << ms << " ms for " << result.ranges << " ranges\n";
+            assertTrue(result.error.empty() && result.sameCounts(reference) && result.workerFailures == 0,
+                       to_string(workers) + " worker(s) merge to the in-process counts");
+        }
+
+        // Test 3: A worker that dies mid-range has its range reassigned
+        RediagnosisOptions failing;
+        failing.workers = 3;
+        failing.rangeSize = 5000;
+        failing.failWorker = 1;
+        failing.failAfter = 2;
+        RediagnosisResult recovered = rediagnoseInWorkers(patients, rules, failing);
+        assertTrue(recovered.error.empty() && recovered.sameCounts(reference) && recovered.workerFailures == 1 &&
+                       recovered.rangesReassigned == 1,
+                   "Failed worker's range reassigned");
+
+        // Test 4: If every worker dies, replacements finish the job
+        RediagnosisOptions alone;
+        alone.workers = 1;
+        alone.rangeSize = 20000;
+        alone.failWorker = 0;
+        alone.failAfter = 1;
+        RediagnosisResult replaced = rediagnoseInWorkers(patients, rules, alone);
+        assertTrue(replaced.error.empty() && replaced.sameCounts(reference) && replaced.workerFailures == 1,
+                   "Replacement worker started when none are left");
+
+        // Test 5: A worker that stops answering is killed after the timeout
+        RediagnosisOptions hanging = failing;
+        hanging.failByHanging = true;
+        hanging.rangeTimeoutMs = 200;
+        auto hangStart = chrono::steady_clock::now();
+        RediagnosisResult unstuck = rediagnoseInWorkers(patients, rules, hanging);
+        double hangMs = chrono::duration<double, milli>(chrono::steady_clock::now() - hangStart).count();
+        assertTrue(unstuck.error.empty() && unstuck.sameCounts(reference) && unstuck.workersTimedOut == 1 &&
+                       unstuck.rangesReassigned == 1 && hangMs < 10000,
+                   "Stuck worker killed and its range reassigned");
+        cout << "\n";
+    }
+
+    void testSharedRegistry() {
+        cout << "--- Testing Shared Memory Registry ---\n";
+
+        // Two versions of the same patients: in A everyone is 30 with a
+        // fever, in B everyone is 40 with a cough
+        PatientStore store;
+        for (int i = 0; i < 20000; ++i) store.insert(Patient("Shared", 0, i % 2 ? "F" : "M"));
+        auto population = [](const PatientSnapshot& base, int age, const string& symptom) {
+            PatientStore copy;
+            for (Patient patient : base) {
+                patient.name = "Shared " + to_string(age) + " " + to_string(patient.getId());
+                patient.age = age;
+                patient.symptoms = {symptom};
+                if (patient.getId() % 3 == 0) patient.symptoms.push_back("headache");
+                copy.insert(patient);
+            }
+            return copy.snapshot();
+        };
+        PatientSnapshot ids = store.snapshot();
+        PatientSnapshot a = population(ids, 30, "fever");
+        PatientSnapshot b = population(ids, 40, "cough");
+        int someId = ids.back().getId() - 1234;
+        string segment = "/medicheck_test_" + to_string(getpid());
+        string error;
+
+        // Test 1: A reader attached to the segment sees the published patients
+        SharedRegistryWriter writer;
+        SharedRegistryReader reader;
+        bool opened = writer.create(segment, error) && writer.publish(a, error) && reader.attach(segment, error);
+        assertTrue(opened && reader.version() == 1 && reader.patientCount() == a.size(), "Reader attaches to published registry");
+
+        SharedPatient shared;
+        const Patient* original = a.find(someId);
+        assertTrue(reader.findPatient(someId, shared) && original && shared.name == original->name &&
+                       shared.age == 30 && shared.gender == original->gender &&
+                       shared.symptoms == toSymptomMask(original->symptoms),
+                   "Shared patient matches the original");
+        assertTrue(!reader.findPatient(ids.back().getId() + 1, shared), "Unknown ID is not found");
+
+        // Test 2: Symptom queries agree with a scan of the snapshot
+        SymptomMask required = toSymptomMask({"fever", "headache"});
+        size_t expected = 0;
+        for (const auto& patient : a) expected += (toSymptomMask(patient.symptoms) & required) == required;
+        vector<size_t> counts = reader.symptomCounts();
+        size_t fever = find(symptomCatalog().begin(), symptomCatalog().end(), "fever") - symptomCatalog().begin();
+        assertTrue(reader.countWithSymptoms(required) == expected && counts[fever] == a.size(),
+                   "Symptom counts match a scan of the snapshot");
+
+        // Test 3: Readers never see a half-written publish
+        atomic<bool> done{false};
+        atomic<int> torn{0};
+        atomic<int> reads{0};
+        thread concurrent([&]() {
+            SharedRegistryReader other;
+            string attachError;
+            if (!other.attach(segment, attachError)) {
+                torn++;
+                return;
+            }
+            SharedPatient seen;
+            auto next = ids.begin();
+            while (!done) {
+                int id = next->getId();
+                if (++next == ids.end()) next = ids.begin();
+                size_t withFever = other.countWithSymptoms(toSymptomMask({"fever"}));
+                if (withFever != 0 && withFever != 20000) torn++;
+                if (!other.findPatient(id, seen)) {
+                    torn++;
+                    continue;
+                }
+                bool fromA = seen.age == 30 && seen.name == "Shared 30 " + to_string(id) && seen.symptoms & toSymptomMask({"fever"});
+                bool fromB = seen.age == 40 && seen.name == "Shared 40 " + to_string(id) && seen.symptoms & toSymptomMask({"cough"});
+                if (!fromA && !fromB) torn++;
+                reads++;
+            }
+        });
+        for (int i = 0; i < 200; ++i) writer.publish(i % 2 ? a : b, error);
+        done = true;
+        concurrent.join();
+        assertTrue(torn == 0 && reads > 0, "Concurrent reader saw only complete versions (" + to_string(reads) + " reads)");
+        assertTrue(reader.version() == 201, "Each publish bumps the version");
+
+        // Test 4: The segment grows for a larger registry and readers follow it
+        for (int i = 0; i < 180000; ++i) store.insert(Patient("Shared", 0, "F"));
+        PatientSnapshot large = population(store.snapshot(), 30, "fever");
+        int lastId = large.back().getId();
+        writer.publish(large, error);
+        assertTrue(reader.patientCount() == large.size() && reader.findPatient(lastId, shared) &&
+                       shared.name == "Shared 30 " + to_string(lastId),
+                   "Reader remaps after the segment grows");
+
+        // Test 5: Closing the writer removes the segment
+        writer.close();
+        SharedRegistryReader late;
+        assertTrue(!late.attach(segment, error), "Segment removed when the writer closes");
+        cout << "\n";
+    }
+
+    void testSimilarPatients() {
+        cout << "--- Testing Similar-Patient Search ---\n";
+
+        // Patients have 1-5 symptoms, the first few symptoms more often
+        mt19937 rng(41);
+        size_t catalogSize = symptomCatalog().size();
+        auto randomMask = [&rng, catalogSize]() {
+            SymptomMask mask = 0;
+            for (int s = 1 + rng() % 5; s > 0; --s) mask |= SymptomMask(1) << (rng() % 2 ? rng() % 6 : rng() % catalogSize);
+            return mask;
+        };
+        auto same = [](const vector<SimilarPatient>& a, const vector<SimilarPatient>& b) {
+            if (a.size() != b.size()) return false;
+            for (size_t i = 0; i < a.size(); ++i) {
+                if (a[i].id != b[i].id || a[i].score != b[i].score) return false;
+            }
+            return true;
+        };
+
+        // Test 1: Scan results match scoring every patient by hand
+        SimilarityIndex small;
+        map<int, SymptomMask> reference;
+        for (int id = 1; id <= 5000; ++id) {
+            reference[id] = randomMask();
+            small.update(id, reference[id]);
+        }
+        bool scanCorrect = true;
+        for (int q = 0; q < 20; ++q) {
+            SymptomMask query = randomMask();
+            vector<SimilarPatient> expected;
+            for (const auto& entry : reference) {
+                float score = float(popcount(entry.second & query)) / float(popcount(entry.second | query));
+                if (score > 0) expected.push_back({entry.first, score});
+            }
+            stable_sort(expected.begin(), expected.end(),
+                        [](const SimilarPatient& a, const SimilarPatient& b) { return a.score > b.score; });
+            expected.resize(min<size_t>(expected.size(), 20));
+            scanCorrect = scanCorrect && same(small.scan(query, 20), expected);
+        }
+        assertTrue(scanCorrect, "Top-20 scan matches a full sort");
+
+        // Test 2: The grouped search agrees with the scan, for both measures
+        // and after edits and deletions
+        for (int id = 1; id <= 5000; id += 7) small.update(id, randomMask());
+        for (int id = 3; id <= 5000; id += 11) small.remove(id);
+        bool grouped = true;
+        for (int q = 0; q < 50; ++q) {
+            SymptomMask query = randomMask();
+            for (auto measure : {SimilarityIndex::JACCARD, SimilarityIndex::WEIGHTED}) {
+                for (size_t k : {1, 20, 500}) {
+                    grouped = grouped && same(small.nearest(query, k, measure, q), small.scan(query, k, measure, q));
+                }
+            }
+        }
+        assertTrue(grouped, "Grouped search matches the scan (" + to_string(small.distinctSets()) + " distinct sets)");
+
+        // Test 3: PatientManager ranks identical symptom sets first
+        PatientManager similar;
+        {
+            streambuf* saved = cout.rdbuf(nullptr);
+            for (int i = 0; i < 50; ++i) {
+                similar.addPatient("Similar " + to_string(i), 30, "F");
+                Patient* p = similar.findPatientById(similar.getAllPatients().back().getId());
+                for (const auto& symptom : fromSymptomMask(randomMask())) p->addSymptom(symptom);
+            }
+            cout.rdbuf(saved);
+        }
+        int firstId = similar.getAllPatients().begin()->getId();
+        Patient* twin = similar.findPatientById(similar.getAllPatients().back().getId());
+        twin->symptoms = similar.findPatientById(firstId)->symptoms;
+        vector<SimilarPatient> matches = similar.findSimilarPatients(firstId, 5);
+        bool excludesSelf = true;
+        for (const auto& match : matches) excludesSelf = excludesSelf && match.id != firstId;
+        assertTrue(!matches.empty() && matches[0].score == 1.0f && excludesSelf,
+                   "Patient with the same symptoms ranked first, patient itself excluded");
+
+        // Test 4: A million patients
+        SimilarityIndex large;
+        for (int id = 1; id <= 1000000; ++id) large.update(id, randomMask());
+        double scanMs = 0, nearestMs = 0;
+        bool agree = true;
+        for (int q = 0; q < 10; ++q) {
+            SymptomMask query = randomMask();
+            auto start = chrono::steady_clock::now();
+            vector<SimilarPatient> scanned = large.scan(query, 20);
+            auto middle = chrono::steady_clock::now();
+            vector<SimilarPatient> found = large.nearest(query, 20);
+            auto end = chrono::steady_clock::now();
+            scanMs += chrono::duration<double, milli>(middle - start).count() / 10;
+            nearestMs += chrono::duration<double, milli>(end - middle).count() / 10;
+            agree = agree && same(scanned, found);
+        }
+        cout << "  1000000 patients, " << large.distinctSets() << " distinct sets: scan " << scanMs << " ms, grouped "
+             << nearestMs << " ms per top-20 query\n";
+        assertTrue(agree, "Both searches agree on a million patients");
+        cout << "\n";
+    }
+
+    void testPopulationAnalytics() {
+        cout << "--- Testing Population Analytics ---\n";
+
+        mt19937 rng(42);
+        vector<string> catalog = symptomCatalog();
+        const vector<string> genders = {"M", "F", "Other"};
+        auto randomize = [&](Patient& patient) {
+            patient.age = rng() % 100;
+            patient.gender = genders[rng() % 3];
+            patient.symptoms.clear();
+            for (int s = rng() % 6; s > 0; --s) {
+                const string& symptom = catalog[rng() % 2 ? rng() % 6 : rng() % catalog.size()];
+                if (find(patient.symptoms.begin(), patient.symptoms.end(), symptom) == patient.symptoms.end()) {
+                    patient.symptoms.push_back(symptom);
+                }
+            }
+        };
+        auto same = [](const PopulationStats& a, const PopulationStats& b) {
+            return a.diseases == b.diseases && a.patients == b.patients && a.undiagnosed == b.undiagnosed &&
+                   a.symptomCounts == b.symptomCounts && a.pairCounts == b.pairCounts &&
+                   a.tripleCounts == b.tripleCounts && a.diseaseCounts == b.diseaseCounts;
+        };
+
+        PatientStore store;
+        for (int i = 0; i < 3000; ++i) {
+            Patient patient("Analytics " + to_string(i), 0, "");
+            randomize(patient);
+            store.insert(patient);
+        }
+
+        // Test 1: One parallel pass matches counting patient by patient
+        PopulationAnalytics analytics;
+        analytics.rebuild(store.snapshot(), 4);
+        const PopulationStats& stats = analytics.stats();
+        size_t n = catalog.size();
+        vector<int64_t> singles(n), pairs(n * n), triples(n * n * n);
+        map<string, int64_t> diseases;
+        map<string, int64_t> fluByGender;
+        int64_t undiagnosed = 0;
+        for (const auto& patient : store.snapshot()) {
+            vector<int> present;
+            for (const auto& symptom : patient.symptoms) present.push_back(symptomIndex(symptom));
+            sort(present.begin(), present.end());
+            for (size_t a = 0; a < present.size(); ++a) {
+                singles[present[a]]++;
+                for (size_t b = a + 1; b < present.size(); ++b) {
+                    pairs[present[a] * n + present[b]]++;
+                    for (size_t c = b + 1; c < present.size(); ++c) triples[(present[a] * n + present[b]) * n + present[c]]++;
+                }
+            }
+            vector<string> predicted = predictDiseases(patient.symptoms);
+            if (predicted.empty()) undiagnosed++;
+            for (const auto& disease : predicted) {
+                diseases[disease]++;
+                if (disease == stats.diseases[0] && patient.age >= 60 && patient.age < 70) fluByGender[patient.gender]++;
+            }
+        }
+        bool prevalenceMatches = stats.undiagnosed == undiagnosed &&
+                                 stats.prevalence(0, 6, PopulationStats::FEMALE) == fluByGender["F"] &&
+                                 stats.prevalence(0, 6, PopulationStats::OTHER) == fluByGender["Other"];
+        for (size_t d = 0; d < stats.diseases.size(); ++d) {
+            prevalenceMatches = prevalenceMatches && stats.prevalence(static_cast<int>(d)) == diseases[stats.diseases[d]];
+        }
+        assertTrue(stats.patients == 3000 && stats.symptomCounts == singles && stats.pairCounts == pairs &&
+                       stats.tripleCounts == triples,
+                   "Symptom, pair and triple counts match a per-patient count");
+        assertTrue(prevalenceMatches, "Disease prevalence by age band and gender matches predictDiseases");
+
+        // Test 2: The number of threads does not change the result
+        PopulationAnalytics single;
+        single.rebuild(store.snapshot(), 1);
+        assertTrue(same(single.stats(), stats), "Single-threaded pass gives the same counts");
+
+        // Test 3: Incremental updates end where a full pass over the result would
+        PopulationStats before = analytics.stats();
+        PatientSnapshot original = store.snapshot();
+        int edited = 0;
+        for (const auto& patient : original) {
+            if (patient.getId() % 7 == 0) {
+                Patient changed = patient;
+                randomize(changed);
+                store.insert(changed);
+                analytics.update(changed);
+                edited++;
+            } else if (patient.getId() % 13 == 0) {
+                store.erase(patient.getId());
+                analytics.remove(patient.getId());
+            }
+        }
+        Patient extra("Analytics extra", 34, "F");
+        extra.symptoms = {"fever", "cough", "fatigue"};
+        store.insert(extra);
+        analytics.update(extra);
+        PopulationAnalytics fresh;
+        fresh.rebuild(store.snapshot(), 2);
+        assertTrue(edited > 0 && same(analytics.stats(), fresh.stats()), "Incremental updates match a full pass");
+
+        // Test 4: Deltas between two points in time
+        PopulationStats after = analytics.stats();
+        PopulationStats delta = after.deltaFrom(before);
+        int fever = symptomIndex("fever"), cough = symptomIndex("cough"), fatigue = symptomIndex("fatigue");
+        assertTrue(delta.patients == after.patients - before.patients &&
+                       delta.tripleCount(fever, cough, fatigue) ==
+                           after.tripleCount(fever, cough, fatigue) - before.tripleCount(fatigue, cough, fever),
+                   "Trend delta is the cell-by-cell difference");
+
+        // Test 5: PatientManager keeps the statistics current and recomputes for new rules
+        PatientManager tracked;
+        RuleSet feverOnly;
+        string error;
+        RuleSet::parse("Fever Only: fever", feverOnly, error);
+        {
+            streambuf* saved = cout.rdbuf(nullptr);
+            tracked.addPatient("Stats A", 25, "M");
+            tracked.addPatient("Stats B", 71, "F");
+            cout.rdbuf(saved);
+        }
+        int last = tracked.getAllPatients().back().getId();
+        tracked.findPatientById(last)->symptoms = {"fever", "rash"};
+        const PopulationStats& managed = tracked.populationStats(feverOnly);
+        assertTrue(managed.patients == 2 && managed.diseases == vector<string>{"Fever Only"} &&
+                       managed.prevalence(0, 7, PopulationStats::FEMALE) == 1 &&
+                       managed.pairCount(symptomIndex("rash"), fever) == 1,
+                   "PatientManager statistics follow edits and rules");
+
+        // Test 6: A million patients in one pass
+        PatientStore large;
+        for (int i = 0; i < 1000000; ++i) {
+            Patient patient("", 0, "");
+            randomize(patient);
+            large.insert(patient);
+        }
+        auto start = chrono::steady_clock::now();
+        PopulationAnalytics population;
+        population.rebuild(large.snapshot());
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "  1000000 patients: " << ms << " ms (" << thread::hardware_concurrency() << " threads)\n";
+        assertTrue(population.stats().patients == 1000000, "Million-patient pass counts everyone");
+        cout << "\n";
+    }
+
+    void testSymptomVocabulary() {
+        cout << "--- Testing Coded Symptom Vocabulary ---\n";
+
+        // Test 1: Galloping set operations agree with the standard algorithms
+        mt19937 rng(43);
+        bool setsAgree = true;
+        for (int round = 0; round < 200; ++round) {
+            vector<SymptomCode> large, small;
+            for (int i = 0; i < 2000; ++i) large.push_back(rng() % 60000);
+            for (int i = 0, n = 1 + rng() % 6; i < n; ++i) {
+                small.push_back(rng() % 2 ? large[rng() % large.size()] : rng() % 60000);
+            }
+            SymptomSet a(large), b(small);
+            vector<SymptomCode> common;
+            set_intersection(a.values().begin(), a.values().end(), b.values().begin(), b.values().end(),
+                             back_inserter(common));
+            setsAgree = setsAgree && a.intersectionSize(b) == common.size() && b.intersectionSize(a) == common.size() &&
+                        a.intersects(b) == !common.empty() && a.containsAll(b) == (common.size() == b.size()) &&
+                        a.contains(b.values()[0]) == binary_search(a.values().begin(), a.values().end(), b.values()[0]) &&
+                        is_sorted(a.values().begin(), a.values().end());
+        }
+        assertTrue(setsAgree, "SymptomSet operations match std::set_intersection");
+
+        // Test 2: A 50000-term code table keeps the built-in symptoms at 0-17
+        string table = "# code table\nR50.9\tFever\nR05 Cough\n";
+        for (int i = 0; i < 50000; ++i) table += "X" + to_string(100000 + i) + "\tcoded term " + to_string(i) + "\n";
+        SymptomVocabulary vocabulary;
+        string error;
+        bool parsed = SymptomVocabulary::parse(table, vocabulary, error);
+        assertTrue(parsed && vocabulary.size() == 18 + 50000 && vocabulary.find("r50.9") == 0 &&
+                       vocabulary.find("COUGH") == 1 && vocabulary.externalCode(0) == "R50.9" &&
+                       vocabulary.find("coded term 49999") == 18 + 49999 && vocabulary.find("X149999") == 18 + 49999,
+                   "Code table loads with built-in symptoms keeping their numbers");
+        vector<SymptomCode> prefixed = vocabulary.withPrefix("Coded Term 4999", 20);
+        bool prefixOk = prefixed.size() == 11;
+        for (size_t i = 1; i < prefixed.size(); ++i) prefixOk = prefixOk && vocabulary.name(prefixed[i - 1]) < vocabulary.name(prefixed[i]);
+        assertTrue(prefixOk, "Prefix search returns matching names in order");
+
+        SymptomVocabulary rejected;
+        bool duplicateCode = !SymptomVocabulary::parse("A1 one\nA1 two\n", rejected, error) && error == "line 2: duplicate code 'A1'";
+        bool duplicateName = !SymptomVocabulary::parse("A1 one\nA2 ONE\n", rejected, error) && error.find("line 2") == 0;
+        assertTrue(duplicateCode && duplicateName, "Duplicate codes and names are rejected with the line number");
+
+        // Test 3: The built-in rules over the vocabulary give the same diagnoses
+        CodedRuleSet builtinCoded;
+        bool converted = CodedRuleSet::parse(RuleSet::builtin().toText(), vocabulary, builtinCoded, error);
+        bool sameDiagnoses = converted;
+        vector<string> catalog = symptomCatalog();
+        for (int round = 0; round < 2000 && sameDiagnoses; ++round) {
+            vector<string> symptoms;
+            for (const auto& symptom : catalog) {
+                if (rng() % 5 == 0) symptoms.push_back(symptom);
+            }
+            SymptomSet coded = vocabulary.encode(symptoms);
+            sameDiagnoses = coded.catalogMask() == toSymptomMask(symptoms) &&
+                            builtinCoded.predict(coded, static_cast<int>(symptoms.size())) == predictDiseases(symptoms);
+        }
+        assertTrue(sameDiagnoses, "Coded built-in rules match predictDiseases");
+
+        // Test 4: Rules can name coded terms by name or code
+        CodedRuleSet coded;
+        bool codedParsed = CodedRuleSet::parse("Rare Syndrome: X100123 + coded term 4567 - fever\n", vocabulary, coded, error);
+        vector<string> patientSymptoms = {"coded term 123", "coded term 4567", "cough"};
+        SymptomSet present = vocabulary.encode(patientSymptoms);
+        assertTrue(codedParsed && coded.predict(present, 3) == vector<string>{"Rare Syndrome"} &&
+                       coded.predict(vocabulary.encode({"coded term 123", "coded term 4567", "Fever"}), 3).empty() &&
+                       present.size() == 3,
+                   "Coded rules match coded symptoms");
+        assertTrue(!CodedRuleSet::parse("Bad: no such term\n", vocabulary, coded, error) &&
+                       error == "line 1: unknown symptom 'no such term'",
+                   "Unknown coded symptom is rejected");
+
+        // Test 5: PatientManager offers the loaded vocabulary
+        {
+            ofstream file("data/symptom_codes.txt");
+            file << table;
+        }
+        PatientManager withCodes;
+        bool loaded = withCodes.loadVocabulary("data/symptom_codes.txt", error);
+        assertTrue(loaded && withCodes.getAvailableSymptoms().size() == 18 + 50000 &&
+                       withCodes.getAvailableSymptoms()[0] == "fever",
+                   "PatientManager loads the code table");
+        remove("data/symptom_codes.txt");
+
+        // Test 6: Coded terms go through symptom events and the shared
+        // diagnosis entry point used by the menu and the export
+        int codedPatient = withCodes.addPatient("Coded Patient", 40, "F");
+        bool eventsOk = withCodes.recordSymptomEvent(codedPatient, "X100123", true, 1000) &&
+                        withCodes.recordSymptomEvent(codedPatient, "coded term 4567", true, 1001) &&
+                        withCodes.recordSymptomEvent(codedPatient, "cough", true, 1002) &&
+                        !withCodes.recordSymptomEvent(codedPatient, "no such term", true, 1003);
+        const vector<string>& stored = withCodes.findPatientById(codedPatient)->symptoms;
+        RuleRegistry registry;
+        vector<string> combined = registry.diagnose(stored, coded, withCodes.getVocabulary());
+        assertTrue(eventsOk && stored == vector<string>{"coded term 123", "coded term 4567", "cough"} &&
+                       find(combined.begin(), combined.end(), "Rare Syndrome") != combined.end() &&
+                       registry.diagnose({"fever", "cough"}, CodedRuleSet(), vocabulary) == registry.diagnose({"fever", "cough"}),
+                   "Coded symptom events reach the combined diagnosis");
+        withCodes.deletePatient(codedPatient);
+
+        // Test 7: Evaluation cost does not grow with the vocabulary
+        auto start = chrono::steady_clock::now();
+        size_t matched = 0;
+        for (int i = 0; i < 100000; ++i) {
+            vector<SymptomCode> codes;
+            for (int s = 0; s < 4; ++s) codes.push_back(rng() % vocabulary.size());
+            SymptomSet symptoms(codes);
+            matched += builtinCoded.predict(symptoms, static_cast<int>(symptoms.size())).size() > 0;
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "  100000 patients against " << builtinCoded.getRules().size() << " rules: " << ms << " ms\n";
+        assertTrue(matched < 100000, "Coded evaluation over a 50018-term vocabulary");
+        cout << "\n";
+    }
+
+    void testPatientIds() {
+        cout << "--- Testing Patient ID Allocation ---\n";
+
+        // Test 1: Concurrent allocation gives unique, consecutive IDs
+        IdAllocator ids;
+        const int threads = 8, perThread = 20000;
+        vector<vector<int>> taken(threads);
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&ids, &taken, t]() {
+                for (int i = 0; i < perThread; ++i) taken[t].push_back(ids.allocate());
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        vector<int> all;
+        for (const auto& part : taken) all.insert(all.end(), part.begin(), part.end());
+        sort(all.begin(), all.end());
+        bool consecutive = all.size() == size_t(threads * perThread) && all.front() == 1;
+        for (size_t i = 1; i < all.size() && consecutive; ++i) consecutive = all[i] == all[i - 1] + 1;
+        assertTrue(consecutive && ids.peekNext() == threads * perThread + 1, "Concurrent allocation is unique and dense");
+
+        // Test 2: Bulk imports take blocks per thread; an unfinished last
+        // block is given back
+        workers.clear();
+        vector<vector<int>> imported(threads);
+        int before = ids.peekNext();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&ids, &imported, t]() {
+                IdBlock block(ids);
+                for (int i = 0; i < 1000; ++i) imported[t].push_back(block.next());
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        set<int> unique;
+        for (const auto& part : imported) unique.insert(part.begin(), part.end());
+        assertTrue(unique.size() == size_t(threads * 1000) && *unique.begin() >= before, "Block allocation across threads is unique");
+        int first = ids.peekNext();
+        {
+            IdBlock block(ids);
+            for (int i = 0; i < 10; ++i) block.next();
+        }
+        assertTrue(ids.peekNext() == first + 10, "Unused IDs of a block are returned");
+
+        // Test 3: Once persisting, the saved mark is past every ID handed
+        // out, before anything is flushed
+        string error;
+        IdAllocator durable;
+        bool persisting = durable.persistTo("data/test_next_id.txt", error, 4);
+        bool covered = persisting;
+        int lastId = 0;
+        for (int i = 0; i < 10 && covered; ++i) {
+            lastId = durable.allocate();
+            IdAllocator afterCrash;
+            covered = afterCrash.load("data/test_next_id.txt", error) && afterCrash.peekNext() > lastId &&
+                      afterCrash.peekNext() <= lastId + 5;
+        }
+        assertTrue(covered, "ID mark is saved ahead of every allocated ID");
+        durable.stopPersisting();
+        for (int i = 0; i < 10; ++i) durable.allocate();
+        IdAllocator stopped;
+        assertTrue(stopped.load("data/test_next_id.txt", error) && stopped.peekNext() <= lastId + 5,
+                   "Stopped allocator no longer writes the mark");
+
+        // Test 4: A mark that cannot be saved is reported once and retried
+        // a window later, while IDs keep coming
+        IdAllocator failing;
+        bool started = failing.persistTo("data/test_next_id.txt", error, 4);
+        mkdir("data/test_next_id.txt.tmp", 0755); // the temporary file cannot be written
+        stringstream reported;
+        streambuf* console = cout.rdbuf(reported.rdbuf());
+        int firstFailing = failing.allocate();
+        int lastFailing = firstFailing;
+        for (int i = 0; i < 40; ++i) lastFailing = failing.allocate();
+        rmdir("data/test_next_id.txt.tmp");
+        for (int i = 0; i < 5; ++i) lastFailing = failing.allocate();
+        cout.rdbuf(console);
+        string output = reported.str();
+        size_t reports = 0;
+        for (size_t at = output.find("Could not save"); at != string::npos; at = output.find("Could not save", at + 1)) reports++;
+        IdAllocator recovered;
+        assertTrue(started && lastFailing == firstFailing + 45 && reports == 1 && output.find("again") != string::npos &&
+                       recovered.load("data/test_next_id.txt", error) && recovered.peekNext() > lastFailing,
+                   "Failed mark save reported once and retried");
+        remove("data/test_next_id.txt");
+        remove("data/test_next_id.txt.manifest");
+        remove("data/test_next_id.txt.prev");
+
+        // Test 5: Restored and temporary patients do not take IDs
+        int next = patientIds().peekNext();
+        Patient restored(next + 500, "Restored", 40, "F");
+        Patient unnamed;
+        assertTrue(restored.getId() == next + 500 && unnamed.getId() == 0 && patientIds().peekNext() == next,
+                   "Restoring or default-constructing a Patient allocates nothing");
+
+        // Test 6: The high-water mark survives a restart
+        IdAllocator afterRestart;
+        bool saved = ids.save("data/next_id.txt", error);
+        bool loaded = afterRestart.load("data/next_id.txt", error);
+        assertTrue(saved && loaded && afterRestart.peekNext() == ids.peekNext(), "High-water mark is saved and loaded");
+
+        // Test 7: A loaded registry numbers new patients after every stored ID
+        int stored = max(patientIds().peekNext(), ids.peekNext()) + 1000;
+        {
+            ofstream file("data/patients.csv");
+            file << "ID,Name,Age,Gender\n" << stored << ",Stored,50,M\n";
+        }
+        remove("data/next_id.txt");
+        remove("data/next_id.txt.manifest");
+        remove("data/next_id.txt.prev");
+        {
+            PatientManager restarted;
+            restarted.loadDataFromCSV();
+            const Patient* patient = restarted.findPatientById(stored);
+            restarted.addPatient("New Intake", 30, "F");
+            assertTrue(patient && patient->name == "Stored" && restarted.findPatientById(stored + 1) &&
+                           restarted.findPatientById(stored + 1)->name == "New Intake",
+                       "Loaded IDs are kept and new patients follow them");
+            restarted.flushPersistence();
+        }
+        IdAllocator reloaded;
+        assertTrue(reloaded.load("data/next_id.txt", error) && reloaded.peekNext() > stored + 1 &&
+                       reloaded.peekNext() <= stored + 1 + IdAllocator::MARK_WINDOW,
+                   "PatientManager saves the mark past the new ID");
+
+        // Test 8: An import numbers its rows from one block after the
+        // stored IDs, saves them and keeps the mark past them
+        {
+            ofstream file("data/test_import.csv");
+            file << "name,age,gender\n";
+            for (int i = 0; i < 100; ++i) file << "Imported " << i << "," << 20 + i % 50 << ",F\n";
+            file << "No Age,,M\n";
+        }
+        {
+            PatientManager importing;
+            importing.loadDataFromCSV();
+            int firstNew = patientIds().peekNext();
+            streambuf* quiet = cout.rdbuf(nullptr);
+            int count = importing.importPatients("data/test_import.csv", error);
+            cout.rdbuf(quiet);
+            bool numbered = count == 100 && patientIds().peekNext() == firstNew + 100;
+            for (int i = 0; i < 100 && numbered; ++i) {
+                const Patient* patient = importing.findPatientById(firstNew + i);
+                numbered = patient && patient->name == "Imported " + to_string(i);
+            }
+            IdAllocator mark;
+            assertTrue(numbered && mark.load("data/next_id.txt", error) && mark.peekNext() >= firstNew + 100,
+                       "Import numbers rows consecutively and keeps the mark past them");
+            importing.flushPersistence();
+        }
+        {
+            PatientManager reopened;
+            reopened.loadDataFromCSV();
+            assertTrue(reopened.findPatientsByName("imported 99").ids.size() == 1, "Imported patients are saved");
+            reopened.flushPersistence();
+        }
+        remove("data/test_import.csv");
+        cleanupTestFiles();
+        cout << "\n";
+    }
+
+    void testWorkloadTrace() {
+        cout << "--- Testing Workload Trace and Replay ---\n";
+        cleanupTestFiles();
+        const string path = "data/test_trace.bin";
+        auto describe = [](const PatientSnapshot& all) {
+            multiset<string> rows;
+            for (const auto& patient : all) {
+                vector<string> symptoms = patient.symptoms;
+                sort(symptoms.begin(), symptoms.end());
+                string row = patient.name + "|" + to_string(patient.age) + "|" + patient.gender;
+                for (const auto& symptom : symptoms) row += "|" + symptom;
+                rows.insert(row);
+            }
+            return rows;
+        };
+
+        // Test 1: Calls are recorded with their arguments, after the
+        // patients that existed when recording started
+        WorkloadRecorder recorder;
+        string error;
+        multiset<string> recordedState;
+        size_t recordedEvents = 0;
+        {
+            PatientManager recorded;
+            int first = recorded.addPatient("Before Trace", 40, "F");
+            recorded.setPatientSymptoms(first, {"fever", "cough"}, 100);
+            assertTrue(recorder.open(path, error), "Trace file opens");
+            recorded.startRecording(&recorder);
+            vector<int> added;
+            for (int i = 0; i < 30; ++i) added.push_back(recorded.addPatient("Traced " + to_string(i), 20 + i, i % 2 ? "F" : "M"));
+            const vector<string>& catalog = symptomCatalog();
+            for (int i = 0; i < 30; ++i) {
+                recorded.setPatientSymptoms(added[i], {catalog[i % 18], catalog[(i * 7) % 18]}, 200 + i);
+            }
+            recorded.recordSymptomEvent(added[3], "chills", true, 300);
+            PatientQuery query;
+            query.minAge = -1;
+            query.maxAge = 35;
+            query.gender = "F";
+            query.symptoms = {"fever"};
+            recorded.findPatients(query);
+            recorded.findPatientsByName("trac");
+            recorded.findSimilarNames("Traced 1x");
+            recorded.findSimilarPatients(added[5], 5, SimilarityIndex::WEIGHTED);
+            recorded.diagnoseAt(added[3], 250);
+            recorder.record(TraceEvent::DIAGNOSE, {first}, {"fever", "cough"});
+            recorded.populationStats(RuleSet::builtin());
+            recorded.deletePatient(added[7]);
+            recorded.stopRecording();
+            recorded.findSimilarNames("Not Traced");
+            recordedState = describe(recorded.snapshot());
+            recordedEvents = recorder.eventCount();
+            recorder.close();
+        }
+        vector<TraceEvent> events;
+        bool read = readTrace(path, events, error);
+        size_t patientEvents = count_if(events.begin(), events.end(), [](const TraceEvent& e) { return e.op == TraceEvent::PATIENT; });
+        auto findEvent = [&events](TraceEvent::Op op) {
+            for (const auto& event : events) {
+                if (event.op == op) return event;
+            }
+            return TraceEvent();
+        };
+        TraceEvent find = findEvent(TraceEvent::FIND_PATIENTS);
+        bool ordered = is_sorted(events.begin(), events.end(),
+                                 [](const TraceEvent& a, const TraceEvent& b) { return a.offsetNs < b.offsetNs; });
+        assertTrue(read && events.size() == recordedEvents && events.size() == 1 + 30 + 30 + 9 && patientEvents == 1 &&
+                       events[0].texts == vector<string>{"Before Trace", "F", "fever", "cough"} && ordered,
+                   "Trace holds the starting patients and every call in order");
+        assertTrue(find.numbers == vector<int64_t>{-1, 35, 0, 20} && find.texts == vector<string>{"F", "fever"} &&
+                       findEvent(TraceEvent::FIND_SIMILAR_PATIENTS).numbers[2] == SimilarityIndex::WEIGHTED,
+                   "Call arguments survive the round trip");
+
+        // Test 2: A cut trace keeps the events before the damage
+        {
+            ifstream in(path, ios::binary);
+            string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+            ofstream out("data/test_trace_cut.bin", ios::binary);
+            out << data.substr(0, data.size() - 3);
+        }
+        vector<TraceEvent> partial;
+        bool cutRead = readTrace("data/test_trace_cut.bin", partial, error);
+        assertTrue(!cutRead && partial.size() == events.size() - 1 && error.find("damaged") != string::npos,
+                   "Damaged trace is reported with the events before it");
+        remove("data/test_trace_cut.bin");
+
+        // Test 3: Replaying from the recorded starting state ends in the
+        // same state as the recording
+        remove("data/patients.csv");
+        remove("data/symptoms.csv");
+        remove("data/symptom_history.csv");
+        RuleRegistry rules;
+        ReplayReport report;
+        multiset<string> replayedState;
+        bool restored = restoreTraceState(events, error);
+        {
+            PatientManager replayed;
+            replayed.loadDataFromCSV();
+            report = replayTrace(events, replayed, rules, false);
+            replayedState = describe(replayed.snapshot());
+        }
+        assertTrue(restored && replayedState == recordedState, "Replay ends in the recorded state");
+        assertTrue(restored && report.operations == events.size() - patientEvents &&
+                       report.ops[TraceEvent::ADD_PATIENT].count == 30 && report.ops[TraceEvent::DIAGNOSE].count == 1 &&
+                       report.ops[TraceEvent::SET_SYMPTOMS].p50 <= report.ops[TraceEvent::SET_SYMPTOMS].max,
+                   "Replay runs every recorded call");
+        cout << report.format();
+
+        // Test 4: At recorded speed the replay takes as long as the recording
+        vector<TraceEvent> paced = {events[0]};
+        for (int i = 0; i < 5; ++i) {
+            TraceEvent diagnose = findEvent(TraceEvent::DIAGNOSE);
+            diagnose.offsetNs = (i + 1) * 10000000LL;
+            paced.push_back(diagnose);
+        }
+        ReplayReport pacedReport;
+        {
+            PatientManager pacedManager;
+            pacedReport = replayTrace(paced, pacedManager, rules, true);
+        }
+        assertTrue(pacedReport.seconds >= 0.05 && pacedReport.operations == 5, "Recorded speed keeps the recorded gaps");
+
+        // Test 5: A replayed edit goes through the manager, so it is
+        // indexed and saved like one made from the menu
+        cleanupTestFiles();
+        int edited = 0;
+        {
+            PatientManager editing;
+            edited = editing.addPatient("Before Edit", 30, "F");
+            WorkloadRecorder editRecorder;
+            editRecorder.open(path, error);
+            editing.startRecording(&editRecorder);
+            editing.updatePatient(edited, "After Edit", 31, "M");
+            editing.stopRecording();
+            editRecorder.close();
+            editing.flushPersistence();
+        }
+        cleanupTestFiles();
+        vector<TraceEvent> editEvents;
+        bool editRead = readTrace(path, editEvents, error) && restoreTraceState(editEvents, error);
+        {
+            PatientManager replayedEdit;
+            replayedEdit.loadDataFromCSV();
+            replayTrace(editEvents, replayedEdit, rules, false);
+            replayedEdit.flushPersistence();
+        }
+        PatientManager afterReplay;
+        afterReplay.loadDataFromCSV();
+        const Patient* reloadedEdit = afterReplay.findPatientById(edited);
+        PatientQuery editedQuery;
+        editedQuery.minAge = 31;
+        editedQuery.maxAge = 31;
+        editedQuery.gender = "M";
+        assertTrue(editRead && reloadedEdit && reloadedEdit->name == "After Edit" &&
+                       afterReplay.findPatients(editedQuery).ids == vector<int>{edited} &&
+                       afterReplay.findPatientsByName("after").ids == vector<int>{edited},
+                   "Replayed edit is saved and searchable");
+        afterReplay.flushPersistence();
+
+        // Test 6: Recording overhead
+        WorkloadRecorder overhead;
+        overhead.open(path, error);
+        vector<string> symptoms = {"fever", "cough", "headache"};
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < 200000; ++i) overhead.record(TraceEvent::DIAGNOSE, {i}, symptoms);
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / 200000;
+        overhead.close();
+        ifstream traced(path, ios::binary | ios::ate);
+        cout << "  Recording: " << ns << " ns per call, " << double(traced.tellg()) / 200000 << " bytes per call\n";
+        assertTrue(readTrace(path, events, error) && events.size() == 200000, "200000 recorded calls read back");
+        remove(path.c_str());
+        cleanupTestFiles();
+        cout << "\n";
+    }
+
+    void testBayesScorer() {
+        cout << "--- Testing Naive Bayes Diagnosis Ranking ---\n";
+
+        // Test 1: Seeded from has_symptom/2
+        PrologEngine engine;
+        BayesScorer seeded;
+        string error;
+        bool built = engine.consult("../prolog_version/knowledge_base.pl") &&
+                     BayesScorer::fromKnowledgeBase(engine, seeded, error);
+        assertTrue(built && seeded.diseaseCount() == 19 && seeded.diseaseName(0) == "Common Cold",
+                   "Model seeded from the knowledge base");
+
+        // Test 2: Matching diseases are ranked
+        vector<DiseaseScore> ranked = seeded.rank({"fever", "cough", "loss of taste", "loss of smell"});
+        double total = 0;
+        for (const auto& entry : ranked) total += entry.probability;
+        assertTrue(!ranked.empty() && ranked[0].disease == "COVID-19" && ranked[0].probability > ranked[1].probability &&
+                       fabs(total - 1) < 1e-9,
+                   "COVID-19 ranks first for fever, cough and loss of taste and smell");
+
+        // Test 3: SIMD scores match a scalar evaluation, single and batched
+        BayesScorer model;
+        bool parsed = BayesScorer::parse("Flu: prior=0.3, fever=0.9, cough=0.8, chills=0.6\n"
+                                         "Cold: prior=0.6, other=0.1, runny nose=0.9, cough=0.5\n"
+                                         "Rare: fever=0.2\n",
+                                         model, error);
+        mt19937 rng(46);
+        vector<SymptomMask> masks(4096);
+        for (auto& mask : masks) mask = rng() & ((1u << 18) - 1) & rng() & rng();
+        vector<float> batch(masks.size() * BayesScorer::MAX_DISEASES);
+        model.scoreBatch(masks.data(), masks.size(), batch.data());
+        bool agree = parsed && model.diseaseCount() == 3;
+        const double priors[3] = {0.3, 0.6, 0.1};
+        for (size_t i = 0; i < masks.size() && agree; ++i) {
+            float single[BayesScorer::MAX_DISEASES];
+            model.score(masks[i], single);
+            for (size_t d = 0; d < BayesScorer::MAX_DISEASES; ++d) {
+                agree = agree && single[d] == batch[i * BayesScorer::MAX_DISEASES + d];
+            }
+            for (int d = 0; d < 3; ++d) {
+                double expected = log(priors[d]);
+                for (int s = 0; s < 18; ++s) {
+                    double p = 0.05;
+                    if (d == 0) p = s == 0 ? 0.9 : s == 1 ? 0.8 : s == 17 ? 0.6 : 0.05;
+                    if (d == 1) p = s == 4 ? 0.9 : s == 1 ? 0.5 : 0.1;
+                    if (d == 2) p = s == 0 ? 0.2 : 0.05;
+                    expected += (masks[i] >> s) & 1 ? log(p) : log(1 - p);
+                }
+                agree = agree && fabs(single[d] - expected) < 1e-3;
+            }
+            agree = agree && std::isinf(single[3]) && single[3] < 0;
+        }
+        assertTrue(agree, "Vectorized scores match the scalar log-likelihoods");
+
+        // Test 4: The model file round-trips and bad lines are rejected
+        BayesScorer reloaded;
+        bool roundTrip = BayesScorer::parse(seeded.toText(), reloaded, error);
+        float a[BayesScorer::MAX_DISEASES], b[BayesScorer::MAX_DISEASES];
+        for (int i = 0; i < 1000 && roundTrip; ++i) {
+            SymptomMask mask = rng() & ((1u << 18) - 1) & rng();
+            seeded.score(mask, a);
+            reloaded.score(mask, b);
+            for (size_t d = 0; d < seeded.diseaseCount(); ++d) roundTrip = roundTrip && fabs(a[d] - b[d]) < 1e-4;
+        }
+        assertTrue(roundTrip, "Model text round-trips");
+        BayesScorer rejected;
+        bool unknown = !BayesScorer::parse("Flu: fever=0.9\nCold: sneezing=0.8\n", rejected, error) &&
+                       error == "line 2: unknown symptom 'sneezing'";
+        bool range = !BayesScorer::parse("Flu: fever=1.5\n", rejected, error);
+        bool duplicate = !BayesScorer::parse("Flu: fever=0.9\nFlu: cough=0.9\n", rejected, error);
+        assertTrue(unknown && range && duplicate, "Invalid model lines are rejected");
+
+        // Test 5: Whole-population scoring stays within the boolean rules' time
+        vector<SymptomMask> population(1000000);
+        for (auto& mask : population) mask = rng() & ((1u << 18) - 1) & rng() & rng();
+        RuleSet rules = RuleSet::builtin();
+        auto start = chrono::steady_clock::now();
+        uint64_t matched = 0;
+        for (SymptomMask mask : population) matched += rules.evaluate(mask, popcount(mask)) != 0;
+        double rulesMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        vector<int> best(population.size());
+        start = chrono::steady_clock::now();
+        seeded.mostLikely(population.data(), population.size(), best.data());
+        double bayesMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "  1000000 patients: rules " << rulesMs << " ms, naive Bayes " << bayesMs << " ms\n";
+        bool valid = matched > 0;
+        for (size_t i = 0; i < population.size() && valid; i += 997) {
+            seeded.score(population[i], a);
+            valid = best[i] >= 0 && *max_element(a, a + seeded.diseaseCount()) == a[best[i]];
+        }
+        assertTrue(valid && bayesMs <= rulesMs * 1.5, "Batched scoring keeps up with rule evaluation");
+
+        PatientStore store;
+        for (int i = 0; i < 100; ++i) {
+            Patient patient("Bayes " + to_string(i), 30, "F");
+            patient.symptoms = i % 2 ? vector<string>{"nausea", "vomiting", "diarrhea"} : vector<string>{"rash"};
+            store.insert(patient);
+        }
+        vector<size_t> counts = seeded.countMostLikely(store.snapshot());
+        size_t counted = 0;
+        for (size_t count : counts) counted += count;
+        assertTrue(counted == 100, "Every patient is counted once");
+        cout << "\n";
+    }
+
+    void testAsyncStorage() {
+        cout << "--- Testing Asynchronous Storage ---\n";
+        cleanupTestFiles();
+        // More than CHUNK * READ_AHEAD, so the read takes several waves
+        string big(5 * 1024 * 1024 + 123, ' ');
+        mt19937 rng(47);
+        for (char& c : big) c = static_cast<char>('a' + rng() % 26);
+        vector<string> paths = {"data/async_a.txt", "data/async_b.txt", "data/async_missing.txt"};
+
+        for (AsyncStorage::Backend backend : {AsyncStorage::IO_URING, AsyncStorage::THREAD_POOL}) {
+            AsyncStorage storage(backend);
+            string name = storage.backendName();
+            remove("data/async_a.txt");
+            remove("data/async_b.txt");
+
+            // Test 1: Appends to two files go out together, in order per file
+            vector<FileAppend> appends = {{"data/async_a.txt", big.substr(0, 1000)},
+                                          {"data/async_b.txt", "one\n"},
+                                          {"data/async_a.txt", big.substr(1000)},
+                                          {"data/async_b.txt", "two\n"}};
+            string error;
+            bool appended = storage.appendFiles(appends, true, error).get();
+            vector<string> contents;
+            bool read = storage.readFiles(paths, contents, error).get();
+            assertTrue(appended && read && contents.size() == 3 && contents[0] == big && contents[1] == "one\ntwo\n" &&
+                           contents[2].empty(),
+                       name + ": batched appends read back with read-ahead");
+
+            // Test 2: A failed write names the file
+            vector<FileAppend> bad = {{"data/no_such_dir/file.txt", "x"}};
+            error.clear();
+            bool failed = !storage.appendFiles(bad, false, error).get() && error.find("no_such_dir") != string::npos;
+            assertTrue(failed, name + ": failed append reports the file");
+        }
+
+        // Test 3: Tasks compose; awaiting I/O continues on a worker thread
+        AsyncStorage storage;
+        thread::id caller = this_thread::get_id();
+        auto readBoth = [&storage, caller](string& first, string& second, bool& movedOff) -> Task<size_t> {
+            string error;
+            co_await storage.readFile("data/async_a.txt", first, error);
+            co_await storage.schedule();
+            movedOff = this_thread::get_id() != caller;
+            co_await storage.readFile("data/async_b.txt", second, error);
+            co_return first.size() + second.size();
+        };
+        string first, second;
+        bool movedOff = false;
+        size_t total = readBoth(first, second, movedOff).get();
+        assertTrue(total == big.size() + 8 && first == big && movedOff, "Nested tasks return their results");
+
+        // Test 4: Patient writes run while the patients are diagnosed, and
+        // each task finishes once its row is on disk
+        const vector<string>& catalog = symptomCatalog();
+        vector<int> ids;
+        size_t diagnosed = 0;
+        {
+            PatientManager manager;
+            vector<Task<int>> adds;
+            for (int i = 0; i < 20; ++i) {
+                adds.push_back(manager.addPatientAsync("Async " + to_string(i), 30 + i, i % 2 ? "F" : "M"));
+                adds.back().start();
+            }
+            for (auto& add : adds) ids.push_back(add.get());
+            vector<Task<bool>> updates;
+            for (int i = 0; i < 20; ++i) {
+                updates.push_back(manager.setPatientSymptomsAsync(ids[i], {catalog[i % 18], catalog[(i * 5) % 18]}, 100 + i));
+                updates.back().start();
+            }
+            for (const auto& patient : manager.snapshot()) diagnosed += predictDiseases(patient.symptoms).size();
+            bool allSet = true;
+            for (auto& update : updates) allSet = update.get() && allSet;
+            ifstream patientsFile("data/patients.csv");
+            string line;
+            size_t rows = 0;
+            while (getline(patientsFile, line)) rows++;
+            ifstream symptomsFile("data/symptoms.csv");
+            size_t symptomRows = 0;
+            while (getline(symptomsFile, line)) symptomRows++;
+            assertTrue(allSet && set<int>(ids.begin(), ids.end()).size() == 20 && rows == 21 && symptomRows == 21,
+                       "Awaited adds and symptom updates are on disk");
+            manager.flushPersistenceAsync().get();
+        }
+
+        // Test 5: Loading through the async reads gives the same patients
+        {
+            PatientManager loaded;
+            loaded.loadDataFromCSVAsync(PatientManager::EAGER).get();
+            bool same = loaded.getPatientCount() == 20;
+            for (int i = 0; i < 20 && same; ++i) {
+                const Patient* patient = loaded.findPatientById(ids[i]);
+                same = patient && patient->name == "Async " + to_string(i) && patient->symptoms.size() == (i % 18 == (i * 5) % 18 ? 1u : 2u);
+            }
+            PatientManager lazy;
+            lazy.loadDataFromCSVAsync(PatientManager::LAZY).get();
+            const Patient* lazyPatient = lazy.findPatientById(ids[7]);
+            assertTrue(same && lazyPatient && lazyPatient->symptoms.size() == 2, "Asynchronous load matches the saved patients");
+        }
+        cout << "  (" << diagnosed << " diagnoses while writing, " << storage.backendName() << ")\n";
+
+        // Test 6: An exception thrown by a task reaches get() and the task
+        // awaiting it
+        auto failing = []() -> Task<int> {
+            throw runtime_error("task failed");
+            co_return 0;
+        };
+        auto awaiting = [&failing]() -> Task<string> {
+            try {
+                co_await failing();
+            } catch (const runtime_error& e) {
+                co_return string(e.what());
+            }
+            co_return string();
+        };
+        bool thrown = false;
+        try {
+            failing().get();
+        } catch (const runtime_error&) {
+            thrown = true;
+        }
+        assertTrue(thrown && awaiting().get() == "task failed", "Task exceptions are rethrown to the caller");
+
+        for (const string& path : paths) remove(path.c_str());
+        cleanupTestFiles();
+    }
+
+    void printTestResults() {
+        cout << "========================================\n";
+        cout << "           Test Results Summary         \n";
+        cout << "========================================\n";
+        cout << "Tests Passed: " << testsPassed << "\n";
+        cout << "Tests Failed: " << testsFailed << "\n";
+        cout << "Total Tests:  " << (testsPassed + testsFailed) << "\n";
+        cout << "Success Rate: " << (testsPassed * 100.0 / (testsPassed + testsFailed)) << "%\n";
+        
+        if (testsFailed == 0) {
+            cout << "\n All tests passed! The application is working correctly.\n";
+        } else {
+            cout << "\n  Some tests failed. Please check the implementation.\n";
+        }
+        cout << "========================================\n";
+    }
+};
+
+int main() {
+    MediCheckTester tester;
+    tester.runAllTests();
+    return 0;
+}
@@ -0,0 +1,348 @@
+// Workload trace recording and replay implementation
+#include "workload_trace.h"
+#include "atomic_file.h"
+#include "patient_manager.h"
+#include "rule_registry.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[] = "MCTRACE1";
+const size_t MAGIC_SIZE = 8;
+
+void putVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool getVarint(const string& data, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Small negative numbers (e.g. -1 for "no age limit") stay one byte
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool decodeEvent(const string& data, size_t& pos, int64_t& offset, TraceEvent& event) {
+    uint8_t op = static_cast<uint8_t>(data[pos++]);
+    if (op < TraceEvent::PATIENT || op >= TraceEvent::OP_COUNT) return false;
+    event = TraceEvent();
+    event.op = static_cast<TraceEvent::Op>(op);
+    uint64_t delta, count, value;
+    if (!getVarint(data, pos, delta) || !getVarint(data, pos, count)) return false;
+    offset += static_cast<int64_t>(delta);
+    event.offsetNs = offset;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!getVarint(data, pos, value)) return false;
+        event.numbers.push_back(unzigzag(value));
+    }
+    if (!getVarint(data, pos, count)) return false;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!getVarint(data, pos, value) || value > data.size() - pos) return false;
+        event.texts.push_back(data.substr(pos, value));
+        pos += value;
+    }
+    return true;
+}
+
+// Missing arguments read as 0 / "", so a trace from a build that recorded
+// fewer of them still replays
+int64_t number(const TraceEvent& event, size_t i) {
+    return i < event.numbers.size() ? event.numbers[i] : 0;
+}
+
+string text(const TraceEvent& event, size_t i) {
+    return i < event.texts.size() ? event.texts[i] : "";
+}
+
+vector<string> textsFrom(const TraceEvent& event, size_t first) {
+    if (first >= event.texts.size()) return {};
+    return vector<string>(event.texts.begin() + first, event.texts.end());
+}
+
+// Swallows the manager's console messages during a replay
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+void runEvent(const TraceEvent& event, PatientManager& manager, RuleRegistry& rules, unordered_map<int, int>& ids) {
+    auto idOf = [&ids, &event](size_t i) {
+        int recorded = static_cast<int>(number(event, i));
+        auto found = ids.find(recorded);
+        return found == ids.end() ? recorded : found->second;
+    };
+    switch (event.op) {
+        case TraceEvent::ADD_PATIENT:
+            ids[static_cast<int>(number(event, 0))] =
+                manager.addPatient(text(event, 0), static_cast<int>(number(event, 1)), text(event, 1));
+            break;
+        case TraceEvent::DELETE_PATIENT:
+            manager.deletePatient(idOf(0));
+            break;
+        case TraceEvent::EDIT_PATIENT:
+            manager.updatePatient(idOf(0), text(event, 0), static_cast<int>(number(event, 1)), text(event, 1));
+            break;
+        case TraceEvent::SET_SYMPTOMS:
+            manager.setPatientSymptoms(idOf(0), event.texts, number(event, 1));
+            break;
+        case TraceEvent::SYMPTOM_EVENT:
+            manager.recordSymptomEvent(idOf(0), text(event, 0), number(event, 1) != 0, number(event, 2));
+            break;
+        case TraceEvent::FIND_PATIENTS: {
+            PatientQuery query;
+            query.minAge = static_cast<int>(number(event, 0));
+            query.maxAge = static_cast<int>(number(event, 1));
+            query.gender = text(event, 0);
+            query.symptoms = textsFrom(event, 1);
+            manager.findPatients(query, idOf(2), static_cast<size_t>(number(event, 3)));
+            break;
+        }
+        case TraceEvent::FIND_BY_NAME: {
+            NameCursor after;
+            after.id = idOf(0);
+            after.name = text(event, 1);
+            manager.findPatientsByName(text(event, 0), after, static_cast<size_t>(number(event, 1)));
+            break;
+        }
+        case TraceEvent::FIND_SIMILAR_NAMES:
+            manager.findSimilarNames(text(event, 0), static_cast<size_t>(number(event, 0)));
+            break;
+        case TraceEvent::FIND_SIMILAR_PATIENTS:
+            manager.findSimilarPatients(idOf(0), static_cast<size_t>(number(event, 1)),
+                                        static_cast<SimilarityIndex::Measure>(number(event, 2)));
+            break;
+        case TraceEvent::DIAGNOSE:
+            // The recorded symptoms, so the result does not depend on
+            // edits the trace did not capture
+            manager.findPatientById(idOf(0));
+            rules.diagnose(event.texts);
+            break;
+        case TraceEvent::DIAGNOSE_AT:
+            manager.diagnoseAt(idOf(0), number(event, 1));
+            break;
+        case TraceEvent::POPULATION_STATS: {
+            RuleSet active;
+            {
+                RuleRegistry::ReadGuard guard = rules.acquire();
+                active = guard.rules();
+            }
+            manager.populationStats(active);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Nearest-rank percentile of sorted latencies
+double percentile(const vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(ceil(p * sorted.size()));
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+} // namespace
+
+const char* traceOpName(TraceEvent::Op op) {
+    static const char* names[TraceEvent::OP_COUNT] = {
+        "", "patient", "add patient", "delete patient", "edit patient", "set symptoms", "symptom event",
+        "find patients", "find by name", "similar names", "similar patients", "diagnose", "diagnose at",
+        "population stats"
+    };
+    return op > 0 && op < TraceEvent::OP_COUNT ? names[op] : "unknown";
+}
+
+WorkloadRecorder::~WorkloadRecorder() {
+    close();
+}
+
+bool WorkloadRecorder::open(const string& path, string& error) {
+    lock_guard<mutex> guard(lock);
+    file.open(path, ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        error = "cannot create " + path;
+        return false;
+    }
+    file.write(MAGIC, MAGIC_SIZE);
+    buffer.clear();
+    buffer.reserve(CHUNK);
+    start = chrono::steady_clock::now();
+    lastOffset = 0;
+    events = 0;
+    return true;
+}
+
+bool WorkloadRecorder::isOpen() const {
+    return file.is_open();
+}
+
+void WorkloadRecorder::record(TraceEvent::Op op, initializer_list<int64_t> numbers, const vector<string>& texts) {
+    int64_t offset = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    lock_guard<mutex> guard(lock);
+    if (!file.is_open()) return;
+    // Offsets are stored as deltas; another thread may have taken the lock
+    // with a later clock reading first
+    offset = max(offset, lastOffset);
+    buffer += static_cast<char>(op);
+    putVarint(buffer, static_cast<uint64_t>(offset - lastOffset));
+    lastOffset = offset;
+    putVarint(buffer, numbers.size());
+    for (int64_t value : numbers) putVarint(buffer, zigzag(value));
+    putVarint(buffer, texts.size());
+    for (const auto& value : texts) {
+        putVarint(buffer, value.size());
+        buffer += value;
+    }
+    events++;
+    if (buffer.size() >= CHUNK) writeBuffer();
+}
+
+void WorkloadRecorder::record(TraceEvent::Op op, initializer_list<int64_t> numbers, initializer_list<string> texts) {
+    record(op, numbers, vector<string>(texts));
+}
+
+void WorkloadRecorder::writeBuffer() {
+    file.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    buffer.clear();
+}
+
+size_t WorkloadRecorder::eventCount() {
+    lock_guard<mutex> guard(lock);
+    return events;
+}
+
+void WorkloadRecorder::close() {
+    lock_guard<mutex> guard(lock);
+    if (!file.is_open()) return;
+    writeBuffer();
+    file.close();
+}
+
+bool readTrace(const string& path, vector<TraceEvent>& events, string& error) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    stringstream contents;
+    contents << file.rdbuf();
+    string data = contents.str();
+    if (data.compare(0, MAGIC_SIZE, MAGIC) != 0) {
+        error = path + " is not a MediCheck trace";
+        return false;
+    }
+    events.clear();
+    size_t pos = MAGIC_SIZE;
+    int64_t offset = 0;
+    while (pos < data.size()) {
+        TraceEvent event;
+        if (!decodeEvent(data, pos, offset, event)) {
+            error = "trace is damaged after " + to_string(events.size()) + " events";
+            return false;
+        }
+        events.push_back(move(event));
+    }
+    return true;
+}
+
+bool restoreTraceState(const vector<TraceEvent>& events, string& error) {
+    ofstream patients("data/patients.csv");
+    if (!patients.is_open()) {
+        error = "cannot write data/patients.csv";
+        return false;
+    }
+    patients << "id,name,age,gender\n";
+    string symptoms = "patient_id,symptoms\n";
+    for (const auto& event : events) {
+        if (event.op != TraceEvent::PATIENT) continue;
+        int64_t id = number(event, 0);
+        patients << id << "," << text(event, 0) << "," << number(event, 1) << "," << text(event, 1) << "\n";
+        if (event.texts.size() <= 2) continue;
+        symptoms += to_string(id) + ",";
+        for (size_t i = 2; i < event.texts.size(); ++i) symptoms += (i > 2 ? ";" : "") + event.texts[i];
+        symptoms += "\n";
+    }
+    // Through the manifest, like every other write of symptoms.csv
+    return replaceFileAtomically("data/symptoms.csv", symptoms, error);
+}
+
+double ReplayReport::throughput() const {
+    return seconds > 0 ? operations / seconds : 0;
+}
+
+string ReplayReport::format() const {
+    string out;
+    char line[160];
+    snprintf(line, sizeof(line), "Replayed %zu operations in %.3f s (%.0f operations/s)\n", operations, seconds,
+             throughput());
+    out += line;
+    snprintf(line, sizeof(line), "%-18s %9s %10s %10s %10s %10s\n", "operation", "count", "p50 us", "p90 us", "p99 us",
+             "max us");
+    out += line;
+    for (int op = TraceEvent::ADD_PATIENT; op < TraceEvent::OP_COUNT; ++op) {
+        const OpStats& stats = ops[op];
+        if (stats.count == 0) continue;
+        snprintf(line, sizeof(line), "%-18s %9zu %10.1f %10.1f %10.1f %10.1f\n",
+                 traceOpName(static_cast<TraceEvent::Op>(op)), stats.count, stats.p50, stats.p90, stats.p99,
+                 stats.max);
+        out += line;
+    }
+    return out;
+}
+
+ReplayReport replayTrace(const vector<TraceEvent>& events, PatientManager& manager, RuleRegistry& rules,
+                         bool recordedSpeed) {
+    ReplayReport report;
+    array<vector<double>, TraceEvent::OP_COUNT> latencies;
+    unordered_map<int, int> ids;
+
+    NullBuffer discard;
+    streambuf* console = cout.rdbuf(&discard);
+    auto start = chrono::steady_clock::now();
+    for (const auto& event : events) {
+        if (event.op == TraceEvent::PATIENT) continue;
+        if (recordedSpeed) this_thread::sleep_until(start + chrono::nanoseconds(event.offsetNs));
+        auto began = chrono::steady_clock::now();
+        runEvent(event, manager, rules, ids);
+        latencies[event.op].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - began).count());
+        report.operations++;
+    }
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout.rdbuf(console);
+
+    for (int op = 0; op < TraceEvent::OP_COUNT; ++op) {
+        vector<double>& times = latencies[op];
+        if (times.empty()) continue;
+        sort(times.begin(), times.end());
+        ReplayReport::OpStats& stats = report.ops[op];
+        stats.count = times.size();
+        stats.p50 = percentile(times, 0.50);
+        stats.p90 = percentile(times, 0.90);
+        stats.p99 = percentile(times, 0.99);
+        stats.max = times.back();
+    }
+    return report;
+}
@@ -0,0 +1,103 @@
+// Recording PatientManager and diagnosis calls to a binary trace, and
+// replaying a trace to measure a build
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class PatientManager;
+class RuleRegistry;
+
+// One recorded call. Arguments are kept as numbers and texts in the
+// order listed next to each operation.
+struct TraceEvent {
+    enum Op {
+        PATIENT = 1,            // {id, age} {name, gender, symptoms...}: state when recording started
+        ADD_PATIENT,            // {id, age} {name, gender}; id is the one assigned at the time
+        DELETE_PATIENT,         // {id}
+        EDIT_PATIENT,           // {id, age} {name, gender}
+        SET_SYMPTOMS,           // {id, time} {symptoms...}
+        SYMPTOM_EVENT,          // {id, onset, time} {symptom}
+        FIND_PATIENTS,          // {minAge, maxAge, afterId, limit} {gender, symptoms...}
+        FIND_BY_NAME,           // {afterId, limit} {prefix, afterName}
+        FIND_SIMILAR_NAMES,     // {limit} {name}
+        FIND_SIMILAR_PATIENTS,  // {id, k, measure}
+        DIAGNOSE,               // {id} {symptoms...}
+        DIAGNOSE_AT,            // {id, time}
+        POPULATION_STATS,       // {}
+        OP_COUNT
+    };
+
+    Op op = PATIENT;
+    int64_t offsetNs = 0; // since the recording started
+    vector<int64_t> numbers;
+    vector<string> texts;
+};
+
+const char* traceOpName(TraceEvent::Op op);
+
+// Appends events to a trace file. Each event is encoded into a memory
+// buffer (a few varints and strings, no formatting) that is written out
+// in 64 KiB chunks, so recording costs well under a microsecond per call.
+// Safe to use from several threads.
+class WorkloadRecorder {
+private:
+    static const size_t CHUNK = 64 * 1024;
+
+    mutex lock;
+    ofstream file;
+    string buffer;
+    chrono::steady_clock::time_point start;
+    int64_t lastOffset = 0;
+    size_t events = 0;
+
+    void writeBuffer();
+
+public:
+    ~WorkloadRecorder();
+
+    bool open(const string& path, string& error);
+    bool isOpen() const;
+    void record(TraceEvent::Op op, initializer_list<int64_t> numbers, const vector<string>& texts = {});
+    void record(TraceEvent::Op op, initializer_list<int64_t> numbers, initializer_list<string> texts);
+    size_t eventCount();
+    // Write what is buffered and close the file
+    void close();
+};
+
+// Read a whole trace; false with `error` if it is not a trace or is cut
+// short (events before the damage are kept)
+bool readTrace(const string& path, vector<TraceEvent>& events, string& error);
+
+// Write the PATIENT events as data/patients.csv and data/symptoms.csv in
+// the current directory, for loadDataFromCSV() before a replay
+bool restoreTraceState(const vector<TraceEvent>& events, string& error);
+
+struct ReplayReport {
+    struct OpStats {
+        size_t count = 0;
+        double p50 = 0, p90 = 0, p99 = 0, max = 0; // microseconds
+    };
+
+    size_t operations = 0;
+    double seconds = 0;
+    array<OpStats, TraceEvent::OP_COUNT> ops;
+
+    double throughput() const; // operations per second
+    string format() const;
+};
+
+// Re-run every event after the PATIENT ones against `manager`, with
+// diagnoses through `rules`. At recorded speed each call waits for its
+// recorded offset, otherwise calls run back to back. Latencies are the
+// time spent inside each call. IDs of patients added during the
+// recording are mapped to the IDs they get in the replay.
+ReplayReport replayTrace(const vector<TraceEvent>& events, PatientManager& manager, RuleRegistry& rules,
+                         bool recordedSpeed);